@@ -0,0 +1,372 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+/*
+ * Throughput and allocation benchmark for the Json, CBOR and DynamicData modules.
+ *
+ * Usage: rsp-json-benchmark [--min-time <ms>] [--files-only] [file.json ...]
+ *
+ * Every operation is run on a built in corpus of synthetic documents, and on any Json
+ * files given on the command line. For each document and operation it reports the
+ * throughput in MB/s of Json text, or of CBOR bytes for the CBOR operations, the time per
+ * document and the number of heap allocations per document.
+ */
+
+#include <json/JsonDocument.h>
+#include <json/JsonEncoder.h>
+#include <json/JsonValue.h>
+#include <utils/Cbor.h>
+#include <utils/DynamicData.h>
+#include <utils/StopWatch.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace rsp::utils;
+using namespace rsp::json;
+
+/*
+ * Count every allocation made through the global operator new.
+ */
+static std::size_t gAllocations = 0;
+
+void* operator new(std::size_t aSize)
+{
+    ++gAllocations;
+    if (void *p = std::malloc(aSize ? aSize : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t aSize)
+{
+    return ::operator new(aSize);
+}
+
+void operator delete(void *apMem) noexcept { std::free(apMem); }
+void operator delete[](void *apMem) noexcept { std::free(apMem); }
+void operator delete(void *apMem, std::size_t) noexcept { std::free(apMem); }
+void operator delete[](void *apMem, std::size_t) noexcept { std::free(apMem); }
+
+struct Document {
+    std::string mName;
+    std::string mJson;
+};
+
+static std::int64_t gMinTimeNs = 200'000'000;
+static volatile std::size_t gSink = 0;
+
+/*
+ * Deterministic pseudo random numbers, so the corpus is the same on every run.
+ */
+static std::uint32_t gSeed = 2463534242;
+
+static std::uint32_t rnd(std::uint32_t aRange)
+{
+    gSeed ^= gSeed << 13;
+    gSeed ^= gSeed >> 17;
+    gSeed ^= gSeed << 5;
+    return gSeed % aRange;
+}
+
+static std::string word(std::size_t aMinLength, std::size_t aMaxLength)
+{
+    std::string result;
+    std::size_t len = aMinLength + rnd(static_cast<std::uint32_t>(aMaxLength - aMinLength + 1));
+    for (std::size_t i = 0 ; i < len ; ++i) {
+        result += static_cast<char>('a' + rnd(26));
+    }
+    return result;
+}
+
+/*
+ * Array of records, as returned by a typical REST API.
+ */
+static std::string makeRecords(unsigned int aCount)
+{
+    std::ostringstream os;
+    os << R"({"status":"ok","count":)" << aCount << R"(,"results":[)";
+    for (unsigned int i = 0 ; i < aCount ; ++i) {
+        if (i) {
+            os << ",";
+        }
+        os << R"({"id":)" << (100000 + i)
+           << R"(,"guid":")" << std::hex << rnd(0x7FFFFFFF) << "-" << rnd(0xFFFF) << "-" << rnd(0x7FFFFFFF) << std::dec
+           << R"(","active":)" << (rnd(2) ? "true" : "false")
+           << R"(,"balance":)" << rnd(100000) << "." << rnd(100)
+           << R"(,"name":")" << word(4, 10) << " " << word(5, 12)
+           << R"(","email":")" << word(5, 10) << "@" << word(4, 8) << ".com"
+           << R"(","tags":[")" << word(3, 8) << R"(",")" << word(3, 8) << R"(",")" << word(3, 8)
+           << R"("],"address":{"street":")" << rnd(999) << " " << word(5, 12) << R"( Street","city":")" << word(4, 10)
+           << R"(","zip":")" << (1000 + rnd(8999))
+           << R"("},"location":{"lat":)" << (static_cast<double>(rnd(180000000)) / 1e6 - 90.0)
+           << R"(,"lon":)" << (static_cast<double>(rnd(360000000)) / 1e6 - 180.0)
+           << R"(},"notes":null})";
+    }
+    os << "]}";
+    return os.str();
+}
+
+/*
+ * Array of integers and floating point numbers in various notations.
+ */
+static std::string makeNumbers(unsigned int aCount)
+{
+    std::ostringstream os;
+    os << std::setprecision(17) << "[";
+    for (unsigned int i = 0 ; i < aCount ; ++i) {
+        if (i) {
+            os << ",";
+        }
+        switch (i % 4) {
+            case 0: os << rnd(1000); break;
+            case 1: os << -static_cast<std::int64_t>(rnd(0x7FFFFFFF)) * 4096; break;
+            case 2: os << static_cast<double>(rnd(0x7FFFFFFF)) / 3.0; break;
+            default: os << rnd(1000) << "." << rnd(1000) << "e-" << rnd(300); break;
+        }
+    }
+    os << "]";
+    return os.str();
+}
+
+/*
+ * Array of documents nested to close to the maximum depth of the decoders.
+ */
+static std::string makeDeep(unsigned int aCount, unsigned int aDepth)
+{
+    std::string nested;
+    for (unsigned int i = 0 ; i < aDepth / 2 ; ++i) {
+        nested += R"({"a":[)";
+    }
+    nested += "1";
+    for (unsigned int i = 0 ; i < aDepth / 2 ; ++i) {
+        nested += "]}";
+    }
+
+    std::string result = "[";
+    for (unsigned int i = 0 ; i < aCount ; ++i) {
+        if (i) {
+            result += ",";
+        }
+        result += nested;
+    }
+    result += "]";
+    return result;
+}
+
+/*
+ * Object with strings where most characters are escaped.
+ */
+static std::string makeEscapes(unsigned int aCount)
+{
+    static const char* cEscapes[] = { R"(\")", R"(\\)", R"(\/)", R"(\n)", R"(\t)", R"(\u00e6)", R"(\u20ac)", R"(\ud83d\ude00)", "\xC3\xB8" };
+
+    std::string result = "{";
+    for (unsigned int i = 0 ; i < aCount ; ++i) {
+        if (i) {
+            result += ",";
+        }
+        result += "\"key" + std::to_string(i) + "\":\"";
+        for (unsigned int j = 0 ; j < 64 ; ++j) {
+            result += cEscapes[rnd(sizeof(cEscapes) / sizeof(cEscapes[0]))];
+            if (rnd(4) == 0) {
+                result += word(1, 4);
+            }
+        }
+        result += "\"";
+    }
+    result += "}";
+    return result;
+}
+
+/*
+ * Array of long strings without escapes.
+ */
+static std::string makeLongStrings(unsigned int aCount, unsigned int aLength)
+{
+    std::string result = "[";
+    for (unsigned int i = 0 ; i < aCount ; ++i) {
+        if (i) {
+            result += ",";
+        }
+        result += "\"";
+        std::size_t start = result.size();
+        while ((result.size() - start) < aLength) {
+            result += word(1, 12) + " ";
+        }
+        result += "\"";
+    }
+    result += "]";
+    return result;
+}
+
+static std::vector<Document> makeCorpus()
+{
+    std::vector<Document> result;
+    result.push_back({ "records-small", makeRecords(10) });
+    result.push_back({ "records-large", makeRecords(2000) });
+    result.push_back({ "numbers", makeNumbers(50000) });
+    result.push_back({ "deep-nesting", makeDeep(64, 500) });
+    result.push_back({ "escaped-strings", makeEscapes(2000) });
+    result.push_back({ "long-strings", makeLongStrings(64, 16 * 1024) });
+    return result;
+}
+
+/*
+ * Run the function until the minimum time has passed, then report the average result.
+ * Allocations are counted on a single run, after a warm up run.
+ */
+template <class F>
+static void measure(std::string_view aOperation, std::size_t aBytes, F aFunction)
+{
+    aFunction();
+    std::size_t allocations = gAllocations;
+    aFunction();
+    allocations = gAllocations - allocations;
+
+    std::size_t iterations = 0;
+    std::int64_t elapsed;
+    StopWatch sw;
+    do {
+        aFunction();
+        ++iterations;
+        elapsed = sw.Elapsed<std::chrono::nanoseconds>();
+    } while (elapsed < gMinTimeNs);
+
+    double ns = static_cast<double>(elapsed) / static_cast<double>(iterations);
+    double mbs = (static_cast<double>(aBytes) / (1024.0 * 1024.0)) / (ns / 1e9);
+
+    std::cout << "  " << std::left << std::setw(20) << aOperation << std::right
+        << std::fixed << std::setprecision(1)
+        << std::setw(10) << mbs << " MB/s"
+        << std::setw(12) << (ns / 1000.0) << " us/doc"
+        << std::setw(12) << allocations << " allocs/doc" << std::endl;
+}
+
+/*
+ * Read every value of the tree through the index operators, by key for object members.
+ */
+static std::size_t visit(const DynamicData &arData)
+{
+    std::size_t result = 1;
+    if (arData.IsObject()) {
+        for (const DynamicData &item : arData.GetItems()) {
+            result += visit(arData[item.GetName()]);
+        }
+    }
+    else if (arData.IsArray()) {
+        for (DynamicData::size_type i = 0, count = arData.GetCount() ; i < count ; ++i) {
+            result += visit(arData[i]);
+        }
+    }
+    return result;
+}
+
+static void run(const Document &arDocument)
+{
+    const std::string &json = arDocument.mJson;
+    JsonValue value = JsonValue::Decode(json);
+    DynamicData data = JsonDocument(json).ToDynamicData();
+    std::size_t encoded_size = JsonEncoder::Encode(data).size();
+    std::string cbor = CborEncoder::Encode(data);
+    std::string cbor_value = CborEncoder::Encode(value);
+
+    std::cout << arDocument.mName << " (" << std::fixed << std::setprecision(1)
+        << (static_cast<double>(json.size()) / 1024.0) << " KB, "
+        << (static_cast<double>(cbor.size()) / 1024.0) << " KB CBOR, "
+        << visit(data) << " values)" << std::endl;
+
+    measure("JsonValue::Decode", json.size(), [&]() {
+        gSink = JsonValue::Decode(json).GetCount();
+    });
+    measure("  indexed", json.size(), [&]() {
+        gSink = JsonValue::Decode(json, true).GetCount();
+    });
+    measure("JsonValue::Encode", value.Encode().size(), [&]() {
+        gSink = value.Encode().size();
+    });
+    measure("JsonEncoder::Encode", encoded_size, [&]() {
+        gSink = JsonEncoder::Encode(data).size();
+    });
+    measure("CborEncoder::Encode", cbor.size(), [&]() {
+        gSink = CborEncoder::Encode(data).size();
+    });
+    measure("  JsonValue", cbor_value.size(), [&]() {
+        gSink = CborEncoder::Encode(value).size();
+    });
+    measure("CborDecoder::Decode", cbor.size(), [&]() {
+        gSink = CborDecoder::Decode<DynamicData>(cbor).GetCount();
+    });
+    measure("  JsonValue", cbor_value.size(), [&]() {
+        gSink = CborDecoder::Decode<JsonValue>(cbor_value).GetCount();
+    });
+    measure("DynamicData access", json.size(), [&]() {
+        gSink = visit(data);
+    });
+    measure("DynamicData copy", json.size(), [&]() {
+        DynamicData copy(data);
+        gSink = copy.GetCount();
+    });
+}
+
+static std::string readFile(const std::string &arFileName)
+{
+    std::ifstream fs(arFileName, std::ios::binary);
+    if (!fs) {
+        std::cerr << "Could not open " << arFileName << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    std::ostringstream os;
+    os << fs.rdbuf();
+    return os.str();
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<Document> corpus;
+    bool builtin = true;
+
+    for (int i = 1 ; i < argc ; ++i) {
+        std::string arg(argv[i]);
+        if (arg == "--min-time" && (i + 1) < argc) {
+            gMinTimeNs = std::atoll(argv[++i]) * 1'000'000;
+        }
+        else if (arg == "--files-only") {
+            builtin = false;
+        }
+        else {
+            corpus.push_back({ arg, readFile(arg) });
+        }
+    }
+    if (builtin) {
+        auto documents = makeCorpus();
+        corpus.insert(corpus.begin(), documents.begin(), documents.end());
+    }
+
+    try {
+        for (const Document &doc : corpus) {
+            run(doc);
+        }
+    }
+    catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
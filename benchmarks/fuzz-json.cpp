@@ -0,0 +1,183 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+/*
+ * libFuzzer harness for the Json decoders and the CBOR decoder.
+ *
+ * Usage: rsp-json-fuzzer [libFuzzer options] [corpus directory ...]
+ *
+ * The input is given to every decoder. A decoder must either succeed or throw an exception
+ * derived from CoreException, anything else is reported as a crash. The Json decoders
+ * must agree on what is valid Json, and on the decoded values, which must survive
+ * an encode and decode round trip through both Json and CBOR.
+ *
+ * When built without libFuzzer (FUZZ_REPLAY_MAIN) the harness runs each file or
+ * directory of files given on the command line once, e.g. to replay a crash.
+ */
+
+#include <json/JsonDocument.h>
+#include <json/JsonEncoder.h>
+#include <json/JsonLazyDocument.h>
+#include <json/JsonReader.h>
+#include <json/JsonValue.h>
+#include <utils/Cbor.h>
+#include <utils/CoreException.h>
+#include <utils/DynamicData.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+using namespace rsp::utils;
+using namespace rsp::json;
+
+static void check(bool aCondition, const char *apMessage)
+{
+    if (!aCondition) {
+        std::fprintf(stderr, "Fuzz check failed: %s\n", apMessage);
+        std::abort();
+    }
+}
+
+/*
+ * Returns true if the function succeeds, false if it throws a CoreException.
+ */
+template <class F>
+static bool accepts(F aFunction)
+{
+    try {
+        aFunction();
+        return true;
+    }
+    catch (const CoreException &) {
+        return false;
+    }
+}
+
+static bool isFloat(const JsonValue &arValue)
+{
+    return (arValue.GetType() == Variant::Types::Double) || (arValue.GetType() == Variant::Types::Float);
+}
+
+/*
+ * Deep compare that keeps member order and duplicate keys. Numbers without a fraction
+ * may change between integer and floating point in a round trip, e.g. -0.0 becomes 0.
+ */
+static bool same(const JsonValue &arA, const JsonValue &arB)
+{
+    if (arA.GetJsonType() != arB.GetJsonType()) {
+        return false;
+    }
+    if (arA.IsObject() || arA.IsArray()) {
+        const auto &a = CborTree<JsonValue>::GetItems(arA);
+        const auto &b = CborTree<JsonValue>::GetItems(arB);
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (std::size_t i = 0 ; i < a.size() ; ++i) {
+            if ((CborTree<JsonValue>::GetName(a[i]) != CborTree<JsonValue>::GetName(b[i])) || !same(a[i], b[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+    if ((arA.GetJsonType() == JsonTypes::Number) && (isFloat(arA) || isFloat(arB))) {
+        return arA.AsDouble() == arB.AsDouble();
+    }
+    return arA.Encode() == arB.Encode();
+}
+
+static void readAll(std::string_view aInput, std::size_t aSplit)
+{
+    JsonReader reader;
+    std::string_view first = aInput.substr(0, aSplit);
+    std::string_view second = aInput.substr(first.size());
+
+    reader.Feed(first);
+    while (reader.Next() != JsonReader::Event::NeedInput) {
+    }
+    reader.Feed(second).Finish();
+    for (auto ev = reader.Next() ; ev != JsonReader::Event::EndOfDocument ; ev = reader.Next()) {
+        check(ev != JsonReader::Event::NeedInput, "JsonReader wants input after Finish");
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t *apData, std::size_t aSize);
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t *apData, std::size_t aSize)
+{
+    std::string_view input(reinterpret_cast<const char*>(apData), aSize);
+
+    JsonValue value;
+    bool valid = accepts([&]() { value = JsonValue::Decode(input, true); });
+
+    // JsonDecoder stops after the root value, so it also accepts input with trailing content
+    JsonValue plain;
+    bool prefix = accepts([&]() { plain = JsonValue::Decode(input); });
+    check(!valid || prefix, "JsonDecoder rejects valid Json");
+    check(!valid || same(plain, value), "JsonDecoder value differs");
+
+    JsonValue lazy;
+    check(valid == accepts([&]() { lazy = JsonLazyDocument(std::string(input)).GetRoot().GetValue(); }), "JsonLazyDocument disagrees on validity");
+    check(!valid || same(lazy, value), "JsonLazyDocument value differs");
+
+    DynamicData data;
+    check(valid == accepts([&]() { data = JsonDocument(std::string(input)).ToDynamicData(); }), "JsonDocument disagrees on validity");
+
+    accepts([&]() { readAll(input, aSize ? (apData[0] % aSize) : 0); });
+    accepts([&]() { CborDecoder::Decode<DynamicData>(input); });
+
+    if (valid) {
+        check(same(JsonValue::Decode(value.Encode()), value), "JsonValue Json round trip");
+        check(same(JsonValue::Decode(value.Encode(true)), value), "JsonValue pretty Json round trip");
+        check(same(CborDecoder::Decode<JsonValue>(CborEncoder::Encode(value)), value), "JsonValue CBOR round trip");
+        std::string text = JsonEncoder::Encode(data);
+        check(same(JsonValue::Decode(text), value), "DynamicData Json round trip");
+        check(JsonEncoder::Encode(CborDecoder::Decode<DynamicData>(CborEncoder::Encode(data))) == text, "DynamicData CBOR round trip");
+    }
+    return 0;
+}
+
+#ifdef FUZZ_REPLAY_MAIN
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static void replay(const std::filesystem::path &arPath)
+{
+    std::ifstream fs(arPath, std::ios::binary);
+    std::ostringstream os;
+    os << fs.rdbuf();
+    std::string input = os.str();
+    std::cout << "Running " << arPath.string() << " (" << input.size() << " bytes)" << std::endl;
+    LLVMFuzzerTestOneInput(reinterpret_cast<const std::uint8_t*>(input.data()), input.size());
+}
+
+int main(int argc, char **argv)
+{
+    for (int i = 1 ; i < argc ; ++i) {
+        std::filesystem::path path(argv[i]);
+        if (std::filesystem::is_directory(path)) {
+            for (const auto &entry : std::filesystem::directory_iterator(path)) {
+                replay(entry.path());
+            }
+        }
+        else {
+            replay(path);
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+#endif /* FUZZ_REPLAY_MAIN */
@@ -11,7 +11,9 @@
 #ifndef INCLUDE_APPLICATION_APPLICATIONBASE_H_
 #define INCLUDE_APPLICATION_APPLICATIONBASE_H_
 
+#include <atomic>
 #include <utils/CoreException.h>
+#include <utils/EventLoop.h>
 #include <logging/Logger.h>
 #include <application/CommandLine.h>
 
@@ -59,6 +61,15 @@ public:
      */
     CommandLine& GetCommandLine() { return mCmd; }
 
+    /**
+     * Get the event loop of the application.
+     * Unless execute() is overridden, the application sleeps in this loop until one of its
+     * file descriptors, signals, timers or posted closures wakes it.
+     *
+     * \return Reference to the EventLoop object.
+     */
+    utils::EventLoop& GetEventLoop() { return mEventLoop; }
+
     /**
      * Static getter for the ApplicationBase instance.
      *
@@ -91,7 +102,7 @@ public:
     int Run();
 
     /**
-     * Terminate the application.
+     * Terminate the application. Safe to call from any thread.
      *
      * \param aResult Integer result value to return from the application.
      */
@@ -99,20 +110,22 @@ public:
         if (!mTerminated) {
             mApplicationResult = aResult;
             mTerminated = true;
+            mEventLoop.Wakeup();
         }
     }
 
 protected:
     int mApplicationResult = 0;
-    bool mTerminated = false;
+    std::atomic<bool> mTerminated = false;
     logging::Logger mLogger;
     CommandLine mCmd;
+    utils::EventLoop mEventLoop{};
 
     /**
      * Virtual helpers, override these to add functionality during the run loop.
      */
     virtual void beforeExecute();
-    virtual void execute() {};
+    virtual void execute() { mEventLoop.RunOnce(); };
     virtual void afterExecute() {};
 
     /**
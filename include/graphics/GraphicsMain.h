@@ -10,9 +10,11 @@
 #ifndef GRAPHICSMAIN_H
 #define GRAPHICSMAIN_H
 
+#include <atomic>
 #include <graphics/controls/SceneMap.h>
 #include <messaging/Subscriber.h>
 #include <messaging/Broker.h>
+#include <utils/EventLoop.h>
 #include "BufferedCanvas.h"
 #include "TouchParser.h"
 
@@ -23,8 +25,8 @@ class GraphicsMain
 {
 public:
     GraphicsMain(BufferedCanvas &arCanvas, TouchParser &arTouchParser, SceneMap &arScenes);
-    GraphicsMain(const GraphicsMain &) = default;
-    GraphicsMain &operator=(const GraphicsMain &) = default;
+    GraphicsMain(const GraphicsMain &) = delete;
+    GraphicsMain &operator=(const GraphicsMain &) = delete;
     ~GraphicsMain();
 
     /**
@@ -34,10 +36,32 @@ public:
     void Run(int aMaxFPS = 30, bool aPollTimers = false);
 
     /**
-     * \brief Sets Gui loop to terminate on next loop through
+     * \brief Runs the Gui loop on an event loop, only rendering when something has happened.
+     *
+     * The loop sleeps until touch input, a timer, a posted closure or any other event of the
+     * event loop arrives, so an idle GUI uses no CPU. Touch input is handled as soon as it
+     * arrives, and a frame is rendered at most once per 1/aMaxFPS seconds. Touch parsers
+     * without a pollable device are polled at the frame rate. Enable EventLoop::PollTimers
+     * to trigger timers in the loop. Subscribers handled from UpdateData should wake the loop
+     * on new events, see SubscriberBase::SetEventLoop.
+     * \param arLoop Event loop to run on
+     * \param aMaxFPS Maximum allowed frames per second on the GUI.
+     */
+    void Run(rsp::utils::EventLoop &arLoop, int aMaxFPS = 30);
+
+    /**
+     * \brief Sets Gui loop to terminate on next loop through. Safe to call from any thread.
      * \return self
      */
-    GraphicsMain& Terminate() { mTerminated = true; return *this; }
+    GraphicsMain& Terminate()
+    {
+        mTerminated = true;
+        rsp::utils::EventLoop *loop = mpLoop.load();
+        if (loop) {
+            loop->Wakeup();
+        }
+        return *this;
+    }
 
     /**
      * \brief Change the current active Scene
@@ -63,10 +87,14 @@ protected:
     BufferedCanvas &mrBufferedCanvas;
     TouchParser &mrTouchParser;
     SceneMap &mrScenes;
-    bool mTerminated = false;
+    std::atomic<bool> mTerminated = false;
+    std::atomic<rsp::utils::EventLoop*> mpLoop = nullptr; // Loop being run, woken by Terminate
     std::uint32_t mNextScene = 0;
     Control *mpOverlay = nullptr;
     int mFps = 0;
+
+    void processInput(TouchEvent &arEvent);
+    void renderFrame();
 };
 
 } // namespace rsp::graphics
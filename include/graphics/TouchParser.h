@@ -62,6 +62,12 @@ public:
      */
     virtual void Flush();
 
+    /**
+     * \brief Get the file descriptor of the touch device, for use in event loops.
+     * \return File descriptor, or -1 if no device is open
+     */
+    virtual int GetFd() { return mTouchDevice.GetHandle(); }
+
 protected:
     rsp::posix::FileIO mTouchDevice{};
     RawTouchEvent mRawTouchEvent{};
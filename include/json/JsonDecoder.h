@@ -15,51 +15,56 @@
 #include <json/JsonValue.h>
 #include <string>
 #include <string_view>
-#include <vector>
 
 namespace rsp::json {
 
 /**
- * \class JsonString
- * \brief String derivative specialized in traversing a Json formatted string.
+ * \class JsonDecoder
+ * \brief Single pass recursive descent parser for Json formatted text.
+ *
+ * The decoder only references the given text, the text must outlive the decoder.
+ * Strings are decoded directly into the resulting values, so the input is never copied.
  */
-class JsonDecoder : public std::string
+class JsonDecoder
 {
 public:
     /**
      * Constructor that takes a json formatted string.
      *
-     * \param std::string
+     * \param aJson View of json text, must stay valid while decoding
      */
     JsonDecoder(std::string_view aJson);
-    JsonDecoder(const JsonDecoder &arJson);
-
-    JsonDecoder& operator=(const JsonDecoder &arJson);
 
     /**
      * Decode a value object from the content. The result can be a complex hierarchy of value objects.
-     * \return JsonValue*
+     * \return JsonValue
      */
     JsonValue GetValue();
 
+    /**
+     * \brief Get the json text being decoded.
+     */
+    operator std::string_view() const { return mJson; }
+
 protected:
-    std::string::iterator mIt; // Current index iterator, this is always moving forward.
-    std::string::iterator mEnd; // Current end iterator, to limit the end of the current extraction.
-    std::vector<std::string::iterator> mStack{}; // Used to stack end iterators when parsing sub-strings.
+    static constexpr unsigned int cMaxDepth = 512;
 
-    void findSubString(const char aToken1, const char aToken2);
-    void push();
-    void pop();
-    void skipWhiteSpace();
-    std::string getString();
-    JsonValue getObject();
-    JsonValue getArray();
-    JsonValue getNumber();
+    std::string_view mJson;
+    std::size_t mPos = 0; // Current position, this is always moving forward.
+    unsigned int mDepth = 0;
+    std::string mStringBuffer{}; // String values are decoded here, then stored in their value
 
-    unsigned int getOffset() { return static_cast<unsigned int>(mIt - begin()); };
-    unsigned int getLength() { return static_cast<unsigned int>(mEnd - mIt); };
+    void skipWhiteSpace();
+    void expectLiteral(std::string_view aLiteral);
+    unsigned int getHex4();
+    void getString(std::string &arResult);
+    void getValue(JsonValue &arResult);
+    void getObject(JsonValue &arResult);
+    void getArray(JsonValue &arResult);
+    void getNumber(JsonValue &arResult);
+    std::string_view scanNumber(bool &arIsFloat);
 
-    std::string debug(bool aIncludeText = false, bool aIncludeSubstr = false);
+    std::string debug() const;
 };
 
 } /* rsp::json */
@@ -0,0 +1,253 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#ifndef INCLUDE_JSON_JSONDOCUMENT_H_
+#define INCLUDE_JSON_JSONDOCUMENT_H_
+
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utils/DynamicData.h>
+#include <utils/MemberIndex.h>
+
+namespace rsp::json {
+
+/**
+ * \class JsonDocument
+ * \brief Compact, read only representation of a decoded Json document.
+ *
+ * All values are stored as 16 byte nodes in a single vector, in document order.
+ * Containers hold their member count and the position after their last descendant,
+ * so a subtree is skipped in one step. Object keys are stored once in a string pool,
+ * string values without escapes are referenced in the source text, which the document owns.
+ *
+ * Decoding does a handful of allocations per document instead of several per value.
+ *
+ * \code
+ * JsonDocument doc(std::move(text));
+ * for (JsonDocument::Value v : doc["Items"]) {
+ *     std::cout << v["Name"].AsString() << std::endl;
+ * }
+ * \endcode
+ *
+ * Values are light weight handles, they are invalidated if the document is moved or destroyed.
+ */
+class JsonDocument
+{
+protected:
+    struct Node;
+
+public:
+    enum class Types : std::uint8_t { Null, Bool, Int, Uint, Double, String, Object, Array };
+
+    class Value;
+
+    /**
+     * \class Iterator
+     * \brief Forward iterator over the members of an object or array.
+     */
+    class Iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Value;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = Value;
+
+        Iterator(const JsonDocument &arDocument, std::uint32_t aIndex) : mpDocument(&arDocument), mIndex(aIndex) {}
+        Iterator(const Iterator&) = default;
+        Iterator& operator=(const Iterator&) = default;
+
+        Value operator*() const { return Value(*mpDocument, mIndex); }
+        Iterator& operator++() { mIndex = mpDocument->next(mIndex); return *this; }
+        Iterator operator++(int) { Iterator result(*this); ++(*this); return result; }
+        bool operator==(const Iterator &arOther) const { return mIndex == arOther.mIndex; }
+        bool operator!=(const Iterator &arOther) const { return mIndex != arOther.mIndex; }
+
+    protected:
+        const JsonDocument *mpDocument;
+        std::uint32_t mIndex;
+    };
+
+    /**
+     * \class Value
+     * \brief Handle to a single value in a document.
+     */
+    class Value
+    {
+    public:
+        Value(const JsonDocument &arDocument, std::uint32_t aIndex) : mpDocument(&arDocument), mIndex(aIndex) {}
+        Value(const Value&) = default;
+        Value& operator=(const Value&) = default;
+
+        Types GetType() const { return node().mType; }
+        bool IsNull() const { return GetType() == Types::Null; }
+        bool IsObject() const { return GetType() == Types::Object; }
+        bool IsArray() const { return GetType() == Types::Array; }
+
+        /**
+         * \brief Named conversion functions. Throws EJsonTypeError if the value is not of a compatible type.
+         */
+        bool AsBool() const;
+        std::int64_t AsInt() const;
+        double AsDouble() const;
+        std::string_view AsString() const;
+
+        /**
+         * \brief Get the key of this value, if it is an object member.
+         * \return Key, empty if not an object member
+         */
+        std::string_view GetName() const;
+
+        /**
+         * \brief Get the number of members in an object or array.
+         * \return Number of members, 0 for other types
+         */
+        std::size_t GetCount() const;
+
+        /**
+         * \brief Check if an object has a member with the given key.
+         * \param aKey
+         * \return True if member exists
+         */
+        bool MemberExists(std::string_view aKey) const;
+
+        /**
+         * \brief Get object member by key. Throws EMemberNotExisting if not found.
+         * \param aKey
+         * \return Value
+         */
+        Value operator[](std::string_view aKey) const;
+
+        /**
+         * \brief Get array or object member by position. This is linear in aIndex, prefer iteration.
+         * \param aIndex
+         * \return Value
+         */
+        Value operator[](std::size_t aIndex) const;
+        Value operator[](int aIndex) const { return (*this)[static_cast<std::size_t>(aIndex)]; }
+
+        Iterator begin() const;
+        Iterator end() const;
+
+        /**
+         * \brief Copy this value and all its members into a DynamicData object.
+         * \return DynamicData
+         */
+        rsp::utils::DynamicData ToDynamicData() const;
+
+    protected:
+        const JsonDocument *mpDocument;
+        std::uint32_t mIndex;
+
+        const Node& node() const { return mpDocument->mNodes[mIndex]; }
+        void tryObject() const;
+        void tryContainer() const;
+    };
+
+    /**
+     * \brief Construct a document holding a null value.
+     */
+    JsonDocument();
+
+    /**
+     * \brief Decode Json formatted text into a document.
+     * \param aJson Json text, kept by the document to reference unescaped strings
+     */
+    explicit JsonDocument(std::string aJson);
+    explicit JsonDocument(const char *apJson) : JsonDocument(std::string(apJson)) {}
+
+    /**
+     * \brief Construct a document from the content of a DynamicData object.
+     * \param arData
+     */
+    explicit JsonDocument(const rsp::utils::DynamicData &arData);
+
+    JsonDocument(const JsonDocument&) = default;
+    JsonDocument(JsonDocument&&) = default;
+    JsonDocument& operator=(const JsonDocument&) = default;
+    JsonDocument& operator=(JsonDocument&&) = default;
+
+    /**
+     * \brief Get the root value of the document.
+     * \return Value
+     */
+    Value GetRoot() const { return Value(*this, 0); }
+
+    Value operator[](std::string_view aKey) const { return GetRoot()[aKey]; }
+    Value operator[](std::size_t aIndex) const { return GetRoot()[aIndex]; }
+    Value operator[](int aIndex) const { return GetRoot()[aIndex]; }
+
+    /**
+     * \brief Copy the entire document into a DynamicData object.
+     * \return DynamicData
+     */
+    rsp::utils::DynamicData ToDynamicData() const { return GetRoot().ToDynamicData(); }
+
+    /**
+     * \brief Get the number of values in the document.
+     * \return Number of nodes
+     */
+    std::size_t GetNodeCount() const { return mNodes.size(); }
+
+protected:
+    class Parser;
+    friend Parser;
+
+    static constexpr std::uint32_t cNoKey = UINT32_MAX;
+    static constexpr std::uint8_t cPooled = 0x01; // String value is in the string pool, not the source
+
+    struct StringRef {
+        std::uint32_t mOffset;
+        std::uint32_t mLength;
+    };
+
+    struct Range {
+        std::uint32_t mCount; // Number of members
+        std::uint32_t mEnd;   // Position after last descendant
+    };
+
+    struct Node {
+        Types mType;
+        std::uint8_t mFlags;
+        std::uint16_t mReserved;
+        std::uint32_t mKey; // Position in mKeys, or cNoKey
+        union {
+            bool mBool;
+            std::int64_t mInt;
+            std::uint64_t mUint;
+            double mDouble;
+            StringRef mString;
+            Range mRange;
+        };
+    };
+    static_assert(sizeof(Node) == 16, "JsonDocument::Node is expected to be 16 bytes");
+
+    std::string mSource{};
+    std::vector<Node> mNodes{};
+    std::string mPool{};
+    std::vector<StringRef> mKeys{};
+    rsp::utils::MemberIndex mKeyIndex{};
+
+    std::uint32_t next(std::uint32_t aIndex) const;
+    std::string_view getString(const Node &arNode) const;
+    std::string_view getKey(std::uint32_t aKey) const;
+    std::uint32_t findKey(std::string_view aKey) const;
+    std::uint32_t addKey(std::string_view aKey);
+    StringRef addToPool(std::string_view aString);
+    void fromDynamicData(const rsp::utils::DynamicData &arData, std::uint32_t aKey);
+};
+
+} /* namespace rsp::json */
+
+#endif /* INCLUDE_JSON_JSONDOCUMENT_H_ */
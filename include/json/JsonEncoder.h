@@ -6,8 +6,10 @@
 #ifndef INCLUDE_JSON_JSONENCODER_H_
 #define INCLUDE_JSON_JSONENCODER_H_
 
+#include <functional>
 #include <string>
-#include <sstream>
+#include <string_view>
+#include <posix/FileIO.h>
 #include <utils/DynamicData.h>
 #include "JsonExceptions.h"
 
@@ -16,10 +18,20 @@ namespace rsp::json {
 /**
  * \class JsonEncoder
  * \brief Visitor pattern, DynamicData to JSON encoder
+ *
+ * Output is appended directly to a string. When encoding to a file or a sink, the output is
+ * passed on in chunks of about cSinkBufferSize bytes, so large documents are never held in memory.
  */
 class JsonEncoder
 {
 public:
+    /**
+     * \brief Receiver of encoded output, called with consecutive chunks of the document.
+     */
+    using Sink_t = std::function<void(std::string_view)>;
+
+    static constexpr std::size_t cSinkBufferSize = 16 * 1024;
+
     /**
      * \brief Encodes all data in the DynamicData object into valid JSON.
      *
@@ -31,6 +43,48 @@ public:
      */
     static std::string Encode(const rsp::utils::DynamicData &arData, bool aPrettyPrint = false, bool aForceToUCS2 = false, unsigned int aArrayLineLength = 0);
 
+    /**
+     * \brief Encodes all data in the DynamicData object, appending to the given string.
+     *
+     * \param arData DynamicData object
+     * \param arResult String to append to
+     * \param aPrettyPrint Human readable output format
+     * \param aForceToUCS2
+     * \param aArrayLineLength Allows for multiple elements per line if PrettyPrint is enabled.
+     */
+    static void Encode(const rsp::utils::DynamicData &arData, std::string &arResult, bool aPrettyPrint = false, bool aForceToUCS2 = false, unsigned int aArrayLineLength = 0);
+
+    /**
+     * \brief Encodes all data in the DynamicData object, writing it to the given file.
+     *
+     * \param arData DynamicData object
+     * \param arFile File to write to
+     * \param aPrettyPrint Human readable output format
+     * \param aForceToUCS2
+     * \param aArrayLineLength Allows for multiple elements per line if PrettyPrint is enabled.
+     */
+    static void Encode(const rsp::utils::DynamicData &arData, rsp::posix::FileIO &arFile, bool aPrettyPrint = false, bool aForceToUCS2 = false, unsigned int aArrayLineLength = 0);
+
+    /**
+     * \brief Encodes all data in the DynamicData object, passing it to a sink in chunks.
+     *
+     * \param arData DynamicData object
+     * \param arSink Receiver of output chunks
+     * \param aPrettyPrint Human readable output format
+     * \param aForceToUCS2
+     * \param aArrayLineLength Allows for multiple elements per line if PrettyPrint is enabled.
+     */
+    static void EncodeToSink(const rsp::utils::DynamicData &arData, const Sink_t &arSink, bool aPrettyPrint = false, bool aForceToUCS2 = false, unsigned int aArrayLineLength = 0);
+
+    /**
+     * \brief Append a string with Json escapes applied, without quotes.
+     *
+     * \param arResult String to append to
+     * \param aString UTF-8 string to escape
+     * \param aForceToUCS2 Escape all non ASCII characters as \\uXXXX
+     */
+    static void EscapeString(std::string &arResult, std::string_view aString, bool aForceToUCS2 = false);
+
 protected:
     class PrintFormat {
     public:
@@ -41,17 +95,23 @@ protected:
     };
 
     const PrintFormat& mrPf;
-    std::stringstream mResult{};
+    std::string &mrResult;
+    const Sink_t *mpSink;
     bool mForceToUCS2 = false;
 
-    JsonEncoder(const PrintFormat &arPf, bool aForceToUCS2);
+    JsonEncoder(const PrintFormat &arPf, std::string &arResult, bool aForceToUCS2, const Sink_t *apSink = nullptr);
+    JsonEncoder(const JsonEncoder&) = delete;
+    JsonEncoder& operator=(const JsonEncoder&) = delete;
 
-    std::string getResult() const { return mResult.str(); }
+    static PrintFormat makePrintFormat(bool aPrettyPrint, unsigned int aArrayLineLength);
 
-    void stringToStringStream(const rsp::utils::DynamicData &arData, unsigned int aLevel);
-    void arrayToStringStream(const rsp::utils::DynamicData &arData, unsigned int aLevel);
-    void objectToStringStream(const rsp::utils::DynamicData &arData, unsigned int aLevel);
-    void toStringStream(const rsp::utils::DynamicData &arData, unsigned int aLevel);
+    void flush();
+    void indent(unsigned int aLevel);
+    void stringToResult(std::string_view aString);
+    void scalarToResult(const rsp::utils::DynamicData &arData, int aMinWidth);
+    void arrayToResult(const rsp::utils::DynamicData &arData, unsigned int aLevel);
+    void objectToResult(const rsp::utils::DynamicData &arData, unsigned int aLevel);
+    void toResult(const rsp::utils::DynamicData &arData, unsigned int aLevel, int aMinWidth = 0);
 };
 
 } /* namespace rsp::json */
@@ -0,0 +1,71 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#ifndef INCLUDE_JSON_JSONINDEXEDDECODER_H_
+#define INCLUDE_JSON_JSONINDEXEDDECODER_H_
+
+#include <json/JsonDecoder.h>
+#include <json/JsonStructuralIndex.h>
+
+namespace rsp::json {
+
+/**
+ * \class JsonIndexedDecoder
+ * \brief Two stage Json decoder.
+ *
+ * The first stage builds a JsonStructuralIndex of the text, the second stage walks
+ * the index to build the value tree. Whitespace is never scanned, and the extent of
+ * every string is known before it is decoded, so strings without escapes are copied in one go.
+ * The member count of every object and array is taken from the index up front, so member
+ * vectors are allocated once with their final size.
+ *
+ * Results and errors are the same as for JsonDecoder, except that content after
+ * the root value is an error instead of being ignored.
+ */
+class JsonIndexedDecoder : public JsonDecoder
+{
+public:
+    /**
+     * \brief Constructor that takes a json formatted string.
+     *
+     * \param aJson View of json text, must stay valid while decoding
+     * \param aKernel Block classifier used for the structural index
+     */
+    explicit JsonIndexedDecoder(std::string_view aJson, JsonStructuralIndex::Kernels aKernel = JsonStructuralIndex::GetBestKernel());
+
+    /**
+     * Decode a value object from the content. The result can be a complex hierarchy of value objects.
+     * \return JsonValue
+     */
+    JsonValue GetValue();
+
+protected:
+    JsonStructuralIndex mIndex;
+    std::size_t mNext = 0; // Position in mIndex of the next token
+    std::vector<std::uint32_t> mCounts{}; // Member counts of objects and arrays, in order of their start token
+    std::size_t mNextCount = 0;
+
+    std::size_t peekToken() const { return (mNext < mIndex.GetCount()) ? mIndex[mNext] : mJson.size(); }
+    char peekChar() const { std::size_t pos = peekToken(); return (pos < mJson.size()) ? mJson[pos] : '\0'; }
+    void countMembers();
+    std::size_t nextCount() { return (mNextCount < mCounts.size()) ? mCounts[mNextCount++] : 0; }
+    char nextToken();
+    std::size_t scalarEnd() const;
+    void endOfScalar();
+
+    void getIndexedString(std::string &arResult);
+    void getIndexedValue(JsonValue &arResult);
+    void getIndexedObject(JsonValue &arResult);
+    void getIndexedArray(JsonValue &arResult);
+};
+
+} /* namespace rsp::json */
+
+#endif /* INCLUDE_JSON_JSONINDEXEDDECODER_H_ */
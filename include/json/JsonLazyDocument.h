@@ -0,0 +1,191 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#ifndef INCLUDE_JSON_JSONLAZYDOCUMENT_H_
+#define INCLUDE_JSON_JSONLAZYDOCUMENT_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <json/JsonStructuralIndex.h>
+#include <json/JsonValue.h>
+
+namespace rsp::json {
+
+/**
+ * \class JsonLazyDocument
+ * \brief Read only access to Json text, decoding values only when they are accessed.
+ *
+ * On construction the text is indexed by JsonStructuralIndex and validated in a single walk
+ * over the tokens, which also records where every object and array ends. No values are built.
+ * Lookups step from member to member, skipping nested objects and arrays in one step,
+ * and only the values asked for are decoded.
+ *
+ * Values are found with operator[] chains or with JSON Pointers (RFC 6901):
+ * \code
+ * JsonLazyDocument doc(std::move(response));
+ * std::int64_t id = doc.At("/results/0/id").AsInt();
+ * std::string name = doc["results"][0]["name"].AsString();
+ * \endcode
+ *
+ * Values are light weight handles, they are valid as long as the document exists.
+ * The document can not be copied or moved, as Values refer to it.
+ */
+class JsonLazyDocument
+{
+public:
+    /**
+     * \class Value
+     * \brief Handle to a single, not yet decoded, value in a document.
+     */
+    class Value
+    {
+    public:
+        Value(const JsonLazyDocument &arDocument, std::uint32_t aToken) : mpDocument(&arDocument), mToken(aToken) {}
+        Value(const Value&) = default;
+        Value& operator=(const Value&) = default;
+
+        /**
+         * \brief Get the type of the value, without decoding it.
+         * \return JsonTypes
+         */
+        JsonTypes GetType() const;
+        bool IsNull() const { return GetType() == JsonTypes::Null; }
+        bool IsObject() const { return GetType() == JsonTypes::Object; }
+        bool IsArray() const { return GetType() == JsonTypes::Array; }
+
+        /**
+         * \brief Decode the value and all its members.
+         * \return JsonValue
+         */
+        JsonValue GetValue() const;
+
+        /**
+         * \brief Named conversion functions, the value is decoded and converted like a JsonValue.
+         */
+        bool AsBool() const { return GetValue().AsBool(); }
+        std::int64_t AsInt() const { return GetValue().AsInt(); }
+        double AsDouble() const { return GetValue().AsDouble(); }
+        std::string AsString() const;
+
+        /**
+         * \brief Get the Json text of this value, including all its members.
+         * \return View of the document text
+         */
+        std::string_view GetText() const;
+
+        /**
+         * \brief Get the number of members in an object or array.
+         * \return Number of members, 0 for other types
+         */
+        std::size_t GetCount() const;
+
+        /**
+         * \brief Check if an object has a member with the given key.
+         * \param aKey
+         * \return True if member exists
+         */
+        bool MemberExists(std::string_view aKey) const;
+
+        /**
+         * \brief Get object member by key. Throws EMemberNotExisting if not found.
+         * \param aKey
+         * \return Value
+         */
+        Value operator[](std::string_view aKey) const;
+        Value operator[](const char *apKey) const { return (*this)[std::string_view(apKey)]; }
+
+        /**
+         * \brief Get array or object member by position. This is linear in aIndex.
+         * \param aIndex
+         * \return Value
+         */
+        Value operator[](std::size_t aIndex) const;
+        Value operator[](int aIndex) const { return (*this)[static_cast<std::size_t>(aIndex)]; }
+
+        /**
+         * \brief Get a value by JSON Pointer (RFC 6901), relative to this value.
+         *
+         * Throws EJsonParseError if the pointer is malformed, EMemberNotExisting if
+         * the value does not exist.
+         *
+         * \param aPointer JSON Pointer, e.g. "/results/0/id"
+         * \return Value
+         */
+        Value At(std::string_view aPointer) const;
+
+        /**
+         * \brief Check if a JSON Pointer refers to an existing value.
+         * \param aPointer JSON Pointer
+         * \return True if value exists
+         */
+        bool Contains(std::string_view aPointer) const;
+
+    protected:
+        const JsonLazyDocument *mpDocument;
+        std::uint32_t mToken; // Position in the structural index of the first token of this value
+
+        char firstChar() const { return mpDocument->tokenChar(mToken); }
+        bool find(std::string_view aKey, std::uint32_t &arToken) const;
+        bool index(std::size_t aIndex, std::uint32_t &arToken) const;
+        bool resolve(std::string_view aPointer, std::uint32_t &arToken) const;
+        void tryObject() const;
+        void tryContainer() const;
+    };
+
+    /**
+     * \brief Index and validate Json formatted text. Throws EJsonException if the text is not valid Json.
+     * \param aJson Json text, kept by the document
+     */
+    explicit JsonLazyDocument(std::string aJson);
+    explicit JsonLazyDocument(const char *apJson) : JsonLazyDocument(std::string(apJson)) {}
+
+    JsonLazyDocument(const JsonLazyDocument&) = delete;
+    JsonLazyDocument& operator=(const JsonLazyDocument&) = delete;
+    JsonLazyDocument(JsonLazyDocument&&) = delete;
+    JsonLazyDocument& operator=(JsonLazyDocument&&) = delete;
+
+    /**
+     * \brief Get the root value of the document.
+     * \return Value
+     */
+    Value GetRoot() const { return Value(*this, 0); }
+
+    Value operator[](std::string_view aKey) const { return GetRoot()[aKey]; }
+    Value operator[](const char *apKey) const { return GetRoot()[apKey]; }
+    Value operator[](std::size_t aIndex) const { return GetRoot()[aIndex]; }
+    Value operator[](int aIndex) const { return GetRoot()[aIndex]; }
+    Value At(std::string_view aPointer) const { return GetRoot().At(aPointer); }
+    bool Contains(std::string_view aPointer) const { return GetRoot().Contains(aPointer); }
+
+    /**
+     * \brief Get the number of tokens in the structural index.
+     * \return Number of tokens
+     */
+    std::size_t GetTokenCount() const { return mIndex.GetCount(); }
+
+protected:
+    class Validator;
+    friend Validator;
+
+    std::string mSource;
+    JsonStructuralIndex mIndex;
+    std::vector<std::uint32_t> mEnds{}; // Position in mIndex of the matching end token, for object and array start tokens
+
+    char tokenChar(std::uint32_t aToken) const { return (aToken < mIndex.GetCount()) ? mSource[mIndex[aToken]] : '\0'; }
+    std::uint32_t next(std::uint32_t aToken) const;
+    std::size_t textEnd(std::uint32_t aToken) const;
+    bool keyEquals(std::uint32_t aToken, std::string_view aKey) const;
+};
+
+} /* namespace rsp::json */
+
+#endif /* INCLUDE_JSON_JSONLAZYDOCUMENT_H_ */
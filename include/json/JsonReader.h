@@ -0,0 +1,144 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#ifndef INCLUDE_JSON_JSONREADER_H_
+#define INCLUDE_JSON_JSONREADER_H_
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <posix/FileIO.h>
+#include <utils/Variant.h>
+
+namespace rsp::json {
+
+/**
+ * \class JsonReader
+ * \brief Incremental pull parser for Json formatted text.
+ *
+ * Input is given in chunks of any size, and the document is returned as a sequence of events.
+ * No document tree is built, memory use is bounded by the longest string and the nesting depth,
+ * regardless of the document size.
+ *
+ * \code
+ * JsonReader reader;
+ * reader.Feed(chunk);
+ * for (auto ev = reader.Next(); ev != JsonReader::Event::NeedInput; ev = reader.Next()) {
+ *     ...
+ * }
+ * \endcode
+ *
+ * A chunk given to Feed must stay valid until Next returns NeedInput.
+ * Strings and keys are decoded while parsing, partial tokens are carried over between chunks.
+ */
+class JsonReader
+{
+public:
+    enum class Event { NeedInput, StartObject, EndObject, StartArray, EndArray, Key, String, Number, Bool, Null, EndOfDocument };
+
+    static constexpr std::size_t cDefaultMaxStringLength = 1024 * 1024;
+    static constexpr std::size_t cReadChunkSize = 16 * 1024;
+
+    /**
+     * \brief Construct a reader.
+     *
+     * \param aMaxStringLength Maximum length of a single string, key or number
+     * \param aMaxDepth Maximum nesting depth of objects and arrays
+     */
+    explicit JsonReader(std::size_t aMaxStringLength = cDefaultMaxStringLength, unsigned int aMaxDepth = 512);
+
+    /**
+     * \brief Give the next chunk of input to the reader.
+     *
+     * \param aChunk Json text, must stay valid until Next returns NeedInput
+     * \return self
+     */
+    JsonReader& Feed(std::string_view aChunk);
+
+    /**
+     * \brief Signal that no more input will be given.
+     * \return self
+     */
+    JsonReader& Finish();
+
+    /**
+     * \brief Parse to the next event.
+     * \return Event, NeedInput if the current chunk is consumed
+     */
+    Event Next();
+
+    /**
+     * \brief Parse to the next event, reading input from a file as needed.
+     * \param arFile
+     * \return Event, never NeedInput
+     */
+    Event Next(rsp::posix::FileIO &arFile);
+
+    /**
+     * \brief Get the decoded text of a Key or String event, or the text of a Number event.
+     * \return View valid until next call to Next
+     */
+    std::string_view GetString() const { return mText; }
+
+    /**
+     * \brief Get the value of a String, Number, Bool or Null event.
+     * \return Variant
+     */
+    rsp::utils::Variant GetValue() const;
+
+    /**
+     * \brief Get the current nesting depth.
+     * \return Number of open objects and arrays
+     */
+    std::size_t GetDepth() const { return mStack.size(); }
+
+    /**
+     * \brief Reset the reader to parse a new document.
+     */
+    void Reset();
+
+protected:
+    enum class State { Value, ValueOrEnd, KeyOrEnd, Key, Colon, CommaOrEnd, Done };
+    enum class Token { None, String, Escape, Unicode, SurrogateEscape, SurrogateU, Number, Literal };
+
+    std::size_t mMaxStringLength;
+    unsigned int mMaxDepth;
+    std::string_view mInput{};
+    std::size_t mPos = 0;
+    bool mFinished = false;
+    bool mStarted = false;
+    std::vector<char> mStack{};
+    State mState = State::Value;
+    Token mToken = Token::None;
+    bool mIsKey = false;
+    bool mTextValue = false;
+    std::string mText{};
+    unsigned int mCodePoint = 0;
+    unsigned int mHexDigits = 0;
+    unsigned int mHighSurrogate = 0;
+    std::string_view mLiteral{};
+    std::size_t mLiteralPos = 0;
+    rsp::utils::Variant mValue{};
+    std::string mReadBuffer{};
+
+    std::optional<Event> startValue(char c);
+    Event closeContainer(char c);
+    Event endOfInput();
+    bool scanToken();
+    Event finishToken();
+    void scanUnicode(char c);
+    void append(const char *apBegin, const char *apEnd);
+    void afterValue();
+};
+
+} /* namespace rsp::json */
+
+#endif /* INCLUDE_JSON_JSONREADER_H_ */
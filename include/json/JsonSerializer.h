@@ -0,0 +1,396 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#ifndef INCLUDE_JSON_JSONSERIALIZER_H_
+#define INCLUDE_JSON_JSONSERIALIZER_H_
+
+#include <bitset>
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <json/JsonEncoder.h>
+#include <json/JsonExceptions.h>
+#include <json/JsonReader.h>
+#include <utils/StructElement.h>
+
+namespace rsp::json {
+
+/**
+ * \class JsonField
+ * \brief Entry in the field registry of a struct, binding a Json member name to a data member.
+ *
+ * \tparam T Struct type
+ * \tparam M Member type
+ */
+template <class T, class M>
+struct JsonField
+{
+    constexpr JsonField(std::string_view aName, M T::*apMember) : mName(aName), mpMember(apMember) {}
+
+    std::string_view mName;
+    M T::*mpMember;
+};
+
+/**
+ * \class JsonFields
+ * \brief Field registry of a struct.
+ *
+ * By default the registry is taken from a static constexpr GetJsonFields() member function,
+ * returning a tuple of JsonField. Specialize this template for structs that can not be modified.
+ *
+ * \tparam T Struct type
+ */
+template <class T>
+struct JsonFields
+{
+    static constexpr auto Get() requires requires { T::GetJsonFields(); } { return T::GetJsonFields(); }
+};
+
+/**
+ * \brief Types with a field registry.
+ */
+template <class T>
+concept JsonReflected = requires { JsonFields<T>::Get(); };
+
+/**
+ * \class JsonSerializer
+ * \brief Json encoding and decoding of structs, driven by a compile time field registry.
+ *
+ * Values are written directly to the output string, and read directly from the events
+ * of a JsonReader, no JsonValue or DynamicData tree is built in either direction.
+ *
+ * Supported member types are bool, integers, floating point numbers, std::string,
+ * std::vector of supported types (including std::vector<bool>), StructElement of supported types
+ * and structs with a field registry.
+ *
+ * StructElement members are optional: null members are left out when encoding, and members
+ * missing from the input are set to null when decoding. All other members are required,
+ * EMemberNotExisting is thrown if one is missing. Unknown members in the input are skipped.
+ *
+ * \code
+ * struct Sensor {
+ *     std::string mName{};
+ *     StructElement<double> mValue{};
+ *
+ *     static constexpr auto GetJsonFields() {
+ *         return std::make_tuple(JsonField("Name", &Sensor::mName), JsonField("Value", &Sensor::mValue));
+ *     }
+ * };
+ *
+ * std::string json = JsonSerializer::Encode(sensor);
+ * Sensor copy = JsonSerializer::Decode<Sensor>(json);
+ * \endcode
+ */
+class JsonSerializer
+{
+public:
+    /**
+     * \brief Encode a value to a Json formatted string.
+     * \param arValue
+     * \return Json text
+     */
+    template <class T>
+    static std::string Encode(const T &arValue)
+    {
+        std::string result;
+        Encode(arValue, result);
+        return result;
+    }
+
+    /**
+     * \brief Encode a value, appending to the given string.
+     * \param arValue
+     * \param arResult String to append to
+     */
+    template <class T>
+    static void Encode(const T &arValue, std::string &arResult)
+    {
+        encodeValue(arResult, arValue);
+    }
+
+    /**
+     * \brief Decode Json formatted text into a new value.
+     * \param aJson
+     * \return Value
+     */
+    template <class T>
+    static T Decode(std::string_view aJson)
+    {
+        T result{};
+        Decode(aJson, result);
+        return result;
+    }
+
+    /**
+     * \brief Decode Json formatted text into an existing value.
+     * \param aJson
+     * \param arValue
+     */
+    template <class T>
+    static void Decode(std::string_view aJson, T &arValue)
+    {
+        JsonReader reader;
+        reader.Feed(aJson).Finish();
+        Input input(reader, nullptr);
+        decodeValue(input, input.Next(), arValue);
+        if (input.Next() != JsonReader::Event::EndOfDocument) {
+            THROW_WITH_BACKTRACE1(EJsonParseError, "Unexpected content after root value.");
+        }
+    }
+
+    /**
+     * \brief Decode the next value of a reader, from the input already fed to it.
+     *
+     * EJsonParseError is thrown if the reader needs more input before the value is complete.
+     *
+     * \param arReader
+     * \param arValue
+     */
+    template <class T>
+    static void Decode(JsonReader &arReader, T &arValue)
+    {
+        Input input(arReader, nullptr);
+        decodeValue(input, input.Next(), arValue);
+    }
+
+    /**
+     * \brief Decode the next value of a reader, reading input from a file as needed.
+     * \param arReader
+     * \param arFile
+     * \param arValue
+     */
+    template <class T>
+    static void Decode(JsonReader &arReader, rsp::posix::FileIO &arFile, T &arValue)
+    {
+        Input input(arReader, &arFile);
+        decodeValue(input, input.Next(), arValue);
+    }
+
+protected:
+    template <class T> struct isStructElement : std::false_type {};
+    template <class T> struct isStructElement<rsp::utils::StructElement<T>> : std::true_type {};
+    template <class T> struct isVector : std::false_type {};
+    template <class T, class A> struct isVector<std::vector<T, A>> : std::true_type {};
+
+    /**
+     * \brief Events of a reader, with more input read from a file if one is given.
+     */
+    class Input
+    {
+    public:
+        Input(JsonReader &arReader, rsp::posix::FileIO *apFile) : mrReader(arReader), mpFile(apFile) {}
+        Input(const Input&) = delete;
+        Input& operator=(const Input&) = delete;
+
+        /**
+         * \brief Parse to the next event.
+         * \return Event, never NeedInput
+         */
+        JsonReader::Event Next();
+
+        JsonReader &mrReader;
+
+    protected:
+        rsp::posix::FileIO *mpFile;
+    };
+
+    static void appendNumber(std::string &arResult, std::int64_t aValue);
+    static void appendNumber(std::string &arResult, std::uint64_t aValue);
+    static void appendNumber(std::string &arResult, float aValue);
+    static void appendNumber(std::string &arResult, double aValue);
+    static void appendString(std::string &arResult, std::string_view aValue);
+    [[noreturn]] static void typeError(std::string_view aExpected, JsonReader::Event aEvent);
+    [[noreturn]] static void numberError(std::string_view aText, std::string_view aType);
+    static void skipValue(Input &arInput, JsonReader::Event aEvent);
+
+    template <class T>
+    static void encodeValue(std::string &arResult, const T &arValue)
+    {
+        if constexpr (std::is_same_v<T, bool>) {
+            arResult += arValue ? "true" : "false";
+        }
+        else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+            appendNumber(arResult, static_cast<std::int64_t>(arValue));
+        }
+        else if constexpr (std::is_integral_v<T>) {
+            appendNumber(arResult, static_cast<std::uint64_t>(arValue));
+        }
+        else if constexpr (std::is_same_v<T, float>) {
+            appendNumber(arResult, arValue);
+        }
+        else if constexpr (std::is_floating_point_v<T>) {
+            appendNumber(arResult, static_cast<double>(arValue));
+        }
+        else if constexpr (std::is_same_v<T, std::string>) {
+            appendString(arResult, arValue);
+        }
+        else if constexpr (isStructElement<T>::value) {
+            if (arValue.IsNull()) {
+                arResult += "null";
+            }
+            else {
+                encodeValue(arResult, arValue.Get());
+            }
+        }
+        else if constexpr (isVector<T>::value) {
+            arResult += '[';
+            for (std::size_t i = 0 ; i < arValue.size() ; ++i) {
+                if (i) {
+                    arResult += ',';
+                }
+                encodeValue(arResult, arValue[i]);
+            }
+            arResult += ']';
+        }
+        else if constexpr (JsonReflected<T>) {
+            arResult += '{';
+            bool first = true;
+            std::apply([&](const auto &...arFields) {
+                (encodeMember(arResult, arFields.mName, arValue.*(arFields.mpMember), first), ...);
+            }, JsonFields<T>::Get());
+            arResult += '}';
+        }
+        else {
+            static_assert(JsonReflected<T>, "Type is not supported by JsonSerializer, add a field registry");
+        }
+    }
+
+    template <class M>
+    static void encodeMember(std::string &arResult, std::string_view aName, const M &arMember, bool &arFirst)
+    {
+        if constexpr (isStructElement<M>::value) {
+            if (arMember.IsNull()) {
+                return;
+            }
+        }
+        if (!arFirst) {
+            arResult += ',';
+        }
+        arFirst = false;
+        appendString(arResult, aName);
+        arResult += ':';
+        encodeValue(arResult, arMember);
+    }
+
+    template <class T>
+    static void decodeNumber(Input &arInput, JsonReader::Event aEvent, T &arValue, std::string_view aType)
+    {
+        if (aEvent != JsonReader::Event::Number) {
+            typeError("number", aEvent);
+        }
+        std::string_view text = arInput.mrReader.GetString();
+        const char *end = text.data() + text.size();
+        auto [ptr, ec] = std::from_chars(text.data(), end, arValue);
+        if ((ec != std::errc()) || (ptr != end)) {
+            numberError(text, aType);
+        }
+    }
+
+    template <class T>
+    static void decodeValue(Input &arInput, JsonReader::Event aEvent, T &arValue)
+    {
+        if constexpr (std::is_same_v<T, bool>) {
+            if (aEvent != JsonReader::Event::Bool) {
+                typeError("bool", aEvent);
+            }
+            arValue = arInput.mrReader.GetValue().AsBool();
+        }
+        else if constexpr (std::is_integral_v<T>) {
+            decodeNumber(arInput, aEvent, arValue, "integer");
+        }
+        else if constexpr (std::is_floating_point_v<T>) {
+            decodeNumber(arInput, aEvent, arValue, "floating point");
+        }
+        else if constexpr (std::is_same_v<T, std::string>) {
+            if (aEvent != JsonReader::Event::String) {
+                typeError("string", aEvent);
+            }
+            arValue.assign(arInput.mrReader.GetString());
+        }
+        else if constexpr (isStructElement<T>::value) {
+            if (aEvent == JsonReader::Event::Null) {
+                arValue = T();
+            }
+            else {
+                std::remove_cvref_t<decltype(arValue.Get())> value{};
+                decodeValue(arInput, aEvent, value);
+                arValue.Set(std::move(value));
+            }
+        }
+        else if constexpr (isVector<T>::value) {
+            if (aEvent != JsonReader::Event::StartArray) {
+                typeError("array", aEvent);
+            }
+            arValue.clear();
+            for (JsonReader::Event ev = arInput.Next() ; ev != JsonReader::Event::EndArray ; ev = arInput.Next()) {
+                if constexpr (std::is_same_v<typename T::value_type, bool>) {
+                    // std::vector<bool> packs its items, there is no bool& to decode into
+                    bool item = false;
+                    decodeValue(arInput, ev, item);
+                    arValue.push_back(item);
+                }
+                else {
+                    decodeValue(arInput, ev, arValue.emplace_back());
+                }
+            }
+        }
+        else if constexpr (JsonReflected<T>) {
+            if (aEvent != JsonReader::Event::StartObject) {
+                typeError("object", aEvent);
+            }
+            decodeObject(arInput, arValue, JsonFields<T>::Get(),
+                std::make_index_sequence<std::tuple_size_v<decltype(JsonFields<T>::Get())>>());
+        }
+        else {
+            static_assert(JsonReflected<T>, "Type is not supported by JsonSerializer, add a field registry");
+        }
+    }
+
+    template <class T, class Fields, std::size_t... I>
+    static void decodeObject(Input &arInput, T &arValue, const Fields &arFields, std::index_sequence<I...>)
+    {
+        std::bitset<sizeof...(I)> seen;
+
+        for (JsonReader::Event ev = arInput.Next() ; ev != JsonReader::Event::EndObject ; ev = arInput.Next()) {
+            // The key is only valid until the next event, it is compared before any member is decoded
+            std::string_view key = arInput.mrReader.GetString();
+            bool found = ((std::get<I>(arFields).mName == key
+                && (decodeValue(arInput, arInput.Next(), arValue.*(std::get<I>(arFields).mpMember)), seen.set(I), true)) || ...);
+            if (!found) {
+                skipValue(arInput, arInput.Next());
+            }
+        }
+
+        (missingMember(seen[I], std::get<I>(arFields).mName, arValue.*(std::get<I>(arFields).mpMember)), ...);
+    }
+
+    template <class M>
+    static void missingMember(bool aSeen, std::string_view aName, M &arMember)
+    {
+        if (aSeen) {
+            return;
+        }
+        if constexpr (isStructElement<M>::value) {
+            arMember = M();
+        }
+        else {
+            THROW_WITH_BACKTRACE1(EMemberNotExisting, std::string(aName));
+        }
+    }
+};
+
+} /* namespace rsp::json */
+
+#endif /* INCLUDE_JSON_JSONSERIALIZER_H_ */
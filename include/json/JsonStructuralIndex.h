@@ -0,0 +1,74 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#ifndef INCLUDE_JSON_JSONSTRUCTURALINDEX_H_
+#define INCLUDE_JSON_JSONSTRUCTURALINDEX_H_
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace rsp::json {
+
+/**
+ * \class JsonStructuralIndex
+ * \brief First stage of the two stage Json decoder.
+ *
+ * The text is classified 64 bytes at a time into quotes, backslashes, whitespace and
+ * structural characters, using AVX2 or SSE2 on x86 and NEON on ARM, with a portable
+ * scalar fallback. Escapes and string ranges are then resolved with a few operations
+ * on 64 bit masks, without branching per byte.
+ *
+ * The result is the position of every structural character ({ } [ ] : ,), every string
+ * start and every start of a number or literal outside of strings, in text order.
+ * Tokens are only located, not validated. The only error detected here is an unterminated string.
+ */
+class JsonStructuralIndex
+{
+public:
+    enum class Kernels { Scalar, Sse2, Avx2, Neon };
+
+    /**
+     * \brief Build the structural index of Json text.
+     *
+     * \param aJson Json text, at most 4 GB
+     * \param aKernel Block classifier to use, must be supported by this CPU
+     */
+    explicit JsonStructuralIndex(std::string_view aJson, Kernels aKernel = GetBestKernel());
+
+    /**
+     * \brief Get the fastest block classifier supported by this build and CPU.
+     * \return Kernel
+     */
+    static Kernels GetBestKernel();
+
+    /**
+     * \brief Check if a block classifier can be used on this build and CPU.
+     * \param aKernel
+     * \return True if supported
+     */
+    static bool IsSupported(Kernels aKernel);
+
+    /**
+     * \brief Get the token positions.
+     * \return Positions in text order
+     */
+    const std::vector<std::uint32_t>& GetPositions() const { return mPositions; }
+
+    std::size_t GetCount() const { return mPositions.size(); }
+    std::uint32_t operator[](std::size_t aIndex) const { return mPositions[aIndex]; }
+
+protected:
+    std::vector<std::uint32_t> mPositions{};
+};
+
+} /* namespace rsp::json */
+
+#endif /* INCLUDE_JSON_JSONSTRUCTURALINDEX_H_ */
@@ -12,11 +12,18 @@
 
 #include <string_view>
 #include <vector>
+#include <utils/MemberIndex.h>
 #include <utils/Variant.h>
 
+namespace rsp::utils {
+template <class T>
+struct CborTree;
+}
+
 namespace rsp::json {
 
 class JsonDecoder;
+class JsonIndexedDecoder;
 
 enum class JsonTypes : unsigned int { Null, Bool, Number, String, Object, Array };
 
@@ -38,7 +45,7 @@ public:
     JsonValue(JsonTypes aType);
 
     JsonValue(const JsonValue&);
-    JsonValue(JsonValue&&);
+    JsonValue(JsonValue&&) noexcept;
     /**
      * \brief Construct a JsonValue holding the given value
      * \tparam T Type of value to contain
@@ -52,7 +59,7 @@ public:
     virtual ~JsonValue();
 
     JsonValue& operator=(const JsonValue&);
-    JsonValue& operator=(JsonValue&&);
+    JsonValue& operator=(JsonValue&&) noexcept;
 
     /**
      * \brief Encode this object and all its children to a JSON formatted string
@@ -65,9 +72,10 @@ public:
     /**
      * \brief Decode a string into a JsonValue object
      * \param aJson JSON formatted string
+     * \param aUseStructuralIndex Set to decode in two stages with JsonIndexedDecoder
      * \return JsonValue object
      */
-    static JsonValue Decode(std::string_view aJson);
+    static JsonValue Decode(std::string_view aJson, bool aUseStructuralIndex = false);
 
     /**
      * \brief Get the type of the value content
@@ -247,13 +255,18 @@ protected:
     };
 
     friend JsonDecoder;
+    friend JsonIndexedDecoder;
+    friend rsp::utils::CborTree<JsonValue>;
     std::string mName{}; // Name if this value is an object member
     std::vector<JsonValue> mItems{};
+    rsp::utils::MemberIndex mIndex{}; // Index of mItems by name, used if this is an object
 
     void tryArray() const;
     void tryObject() const;
     void forceObject();
     void forceArray();
+    std::size_t findMember(std::string_view aKey) const;
+    void rebuildIndex();
 
     void stringToStringStream(std::stringstream &arResult, PrintFormat &arPf, unsigned int aLevel, bool aForceToUCS2) const;
     void arrayToStringStream(std::stringstream &arResult, PrintFormat &arPf, unsigned int aLevel, bool aForceToUCS2) const;
@@ -265,4 +278,45 @@ std::ostream& operator<< (std::ostream& os, const JsonValue &arValue);
 
 } /* namespace rsp::json */
 
+/**
+ * \brief Direct access to the tree for CborEncoder and CborDecoder.
+ */
+template <>
+struct rsp::utils::CborTree<rsp::json::JsonValue>
+{
+    using JsonValue = rsp::json::JsonValue;
+
+    static bool IsObject(const JsonValue &arValue) { return arValue.IsObject(); }
+    static bool IsArray(const JsonValue &arValue) { return arValue.IsArray(); }
+    static const std::vector<JsonValue>& GetItems(const JsonValue &arValue) { return arValue.mItems; }
+    static std::string_view GetName(const JsonValue &arValue) { return arValue.mName; }
+
+    static void SetString(JsonValue &arValue, std::string_view aString)
+    {
+        arValue.setString(aString);
+    }
+
+    static void MakeContainer(JsonValue &arValue, bool aObject, std::size_t aReserve)
+    {
+        if (aObject) {
+            arValue.forceObject();
+        }
+        else {
+            arValue.forceArray();
+        }
+        arValue.mItems.reserve(aReserve);
+    }
+
+    static JsonValue& AddItem(JsonValue &arValue) { return arValue.mItems.emplace_back(); }
+
+    static JsonValue& AddMember(JsonValue &arValue, std::string_view aName)
+    {
+        JsonValue &result = arValue.mItems.emplace_back();
+        result.mName.assign(aName);
+        return result;
+    }
+
+    static void EndObject(JsonValue &arValue) { arValue.rebuildIndex(); }
+};
+
 #endif /* INCLUDE_JSON_JSONVALUE_H_ */
@@ -12,6 +12,7 @@
 #define SRC_LOGGING_FILELOGWRITER_H_
 
 #include <logging/LogWriterInterface.h>
+#include <logging/LogTimestamp.h>
 #include <fstream>
 #include <mutex>
 
@@ -47,6 +48,7 @@ public:
 protected:
     std::ofstream mOutput;
     LogLevel mAcceptLevel;
+    LogTimestamp mTimestamp{};
 };
 
 } /* namespace logging */
@@ -0,0 +1,115 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#ifndef INCLUDE_LOGGING_FLIGHTRECORDERLOGWRITER_H_
+#define INCLUDE_LOGGING_FLIGHTRECORDERLOGWRITER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <logging/LogWriterInterface.h>
+
+namespace rsp::logging {
+
+/**
+ * \class FlightRecorderLogWriter
+ * \brief An in-memory log writer keeping the most recent records in a ring buffer.
+ *
+ * Records of all levels are stored unformatted in a preallocated ring buffer, overwriting
+ * the oldest records when full. Writing a record is a clock read and a few memcpy's,
+ * no locks are taken and no memory is allocated.
+ *
+ * The content is formatted and dumped to a file:
+ *  - on demand by calling Dump(),
+ *  - when a record of level Critical or more severe is written,
+ *  - on fatal signals (SIGSEGV, SIGABRT, SIGBUS, SIGFPE, SIGILL) if signal handling is enabled.
+ *
+ * The dump path is async-signal-safe. Only one instance can handle signals at a time.
+ * The handlers run on an alternate signal stack, which is given to the thread constructing the
+ * recorder. Call InstallSignalStack() on other threads that should be dumped on stack overflow.
+ *
+ * Every record carries its position in the record stream as a sequence number. Records
+ * overwritten by other threads while a dump reads them are left out of the dump.
+ * Records are truncated to 4 KB, and the log context is not recorded.
+ */
+class FlightRecorderLogWriter : public LogWriterInterface
+{
+public:
+    /**
+     * \brief Construct a flight recorder.
+     *
+     * \param aCapacity Size of ring buffer in bytes, rounded up to a power of two
+     * \param aDumpFileName File to dump to on Critical records and fatal signals
+     * \param aHandleSignals Install handlers for fatal signals
+     */
+    FlightRecorderLogWriter(std::size_t aCapacity, std::string aDumpFileName, bool aHandleSignals = true);
+    ~FlightRecorderLogWriter() override;
+
+    FlightRecorderLogWriter(const FlightRecorderLogWriter&) = delete;
+    FlightRecorderLogWriter& operator=(const FlightRecorderLogWriter&) = delete;
+
+    void Write(const std::string &arMsg, LogLevel aCurrentLevel, const std::string &arChannel, const rsp::utils::DynamicData &arContext) override;
+
+    /**
+     * \brief Dump the recorded records to the dump file given at construction.
+     * \return True on success
+     */
+    bool Dump() const;
+
+    /**
+     * \brief Dump the recorded records to the given file.
+     * \param arFileName
+     * \return True on success
+     */
+    bool Dump(const std::string &arFileName) const;
+
+    /**
+     * \brief Get the size of the ring buffer.
+     * \return Capacity in bytes
+     */
+    std::size_t GetCapacity() const { return mBuffer.size(); }
+
+    /**
+     * \brief Give the calling thread an alternate signal stack, unless it has one already.
+     *        The stack is released when the thread exits.
+     */
+    static void InstallSignalStack();
+
+protected:
+    struct RecordHeader {
+        std::uint32_t mSize;
+        std::uint8_t mLevel;
+        std::uint8_t mReserved;
+        std::uint16_t mChannelLength;
+        std::uint32_t mMessageLength;
+        std::int64_t mTime;
+        std::uint64_t mSequence;
+    };
+
+    std::vector<char> mBuffer;
+    std::uint64_t mMask;
+    std::atomic<std::uint64_t> mReserved{0};
+    std::atomic<std::uint64_t> mCommitted{0};
+    std::string mDumpFileName;
+    bool mHandleSignals;
+
+    void put(std::uint64_t aPos, const void *apData, std::size_t aSize);
+    void get(std::uint64_t aPos, void *apData, std::size_t aSize) const;
+    bool isIntact(std::uint64_t aPos) const;
+    std::uint64_t findOldest(std::uint64_t aEnd) const;
+    bool dumpToFile(const char *apFileName) const;
+
+    static void signalHandler(int aSignal);
+};
+
+} /* namespace rsp::logging */
+
+#endif /* INCLUDE_LOGGING_FLIGHTRECORDERLOGWRITER_H_ */
@@ -0,0 +1,165 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#ifndef INCLUDE_LOGGING_LOGTHROTTLE_H_
+#define INCLUDE_LOGGING_LOGTHROTTLE_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+#include "LogTypes.h"
+
+namespace rsp::logging {
+
+/**
+ * \class LogThrottle
+ * \brief Log storm suppression used by LoggerInterface.
+ *
+ * Two independent mechanisms are supported, both disabled by default:
+ *  - Token bucket rate limits, configured per log level and optionally per channel.
+ *    Each channel gets its own bucket, a limit without channel applies to all channels
+ *    that do not have a specific limit.
+ *  - Folding of identical consecutive records in a channel into a single
+ *    "Last message repeated N times" record.
+ *
+ * Records are only suppressed, never delayed. Summary records are emitted when normal
+ * logging resumes in the channel.
+ */
+class LogThrottle
+{
+public:
+    using Clock_t = std::chrono::steady_clock;
+
+    /**
+     * \brief Summary record to be written before the record given to Accept.
+     */
+    struct Summary {
+        LogLevel mLevel;
+        std::string mChannel;
+        std::string mMessage;
+    };
+
+    /**
+     * \brief Counters of suppressed records.
+     */
+    struct Counters {
+        std::uint64_t mRateLimited = 0;
+        std::uint64_t mFolded = 0;
+
+        std::uint64_t Total() const { return mRateLimited + mFolded; }
+    };
+
+    /**
+     * \brief Set a token bucket rate limit for records of the given level.
+     *
+     * \param aLevel Log level to limit
+     * \param aRecordsPerSecond Sustained number of records allowed per second
+     * \param aBurst Number of records allowed in a burst
+     * \param arChannel Channel to limit, an empty channel applies to all channels without a specific limit
+     * \return self
+     */
+    LogThrottle& SetRateLimit(LogLevel aLevel, double aRecordsPerSecond, unsigned aBurst, const std::string &arChannel = {});
+
+    /**
+     * \brief Remove a rate limit set by SetRateLimit.
+     *
+     * \param aLevel
+     * \param arChannel
+     * \return self
+     */
+    LogThrottle& RemoveRateLimit(LogLevel aLevel, const std::string &arChannel = {});
+
+    /**
+     * \brief Enable or disable folding of identical consecutive records.
+     *
+     * \param aEnable
+     * \param aInterval While a record keeps repeating, a summary is written at this interval
+     * \return self
+     */
+    LogThrottle& SetFolding(bool aEnable, std::chrono::milliseconds aInterval = std::chrono::seconds(30));
+
+    /**
+     * \brief Get the counters of suppressed records for all channels.
+     * \return Counters
+     */
+    Counters GetCounters() const;
+
+    /**
+     * \brief Get the counters of suppressed records for a single channel.
+     * \param arChannel
+     * \return Counters
+     */
+    Counters GetCounters(const std::string &arChannel) const;
+
+    /**
+     * \brief Reset all counters of suppressed records.
+     */
+    void ResetCounters();
+
+    /**
+     * \brief Decide if a record should be written.
+     *
+     * \param aLevel Level of record
+     * \param arChannel Channel of record
+     * \param arMsg Message of record
+     * \param arSummaries Summary records that must be written before this record
+     * \param aNow Current time
+     * \return True if the record should be written
+     */
+    bool Accept(LogLevel aLevel, const std::string &arChannel, const std::string &arMsg,
+                std::vector<Summary> &arSummaries, Clock_t::time_point aNow = Clock_t::now());
+
+protected:
+    static constexpr std::size_t cLevels = std::size_t(LogLevel::__END__);
+
+    struct Limit {
+        double mRate = 0.0;
+        double mBurst = 0.0;
+    };
+
+    struct Bucket {
+        double mTokens = 0.0;
+        Clock_t::time_point mLast{};
+        std::uint64_t mSuppressed = 0;
+    };
+
+    struct ChannelState {
+        std::array<std::optional<Limit>, cLevels> mLimits{};
+        std::array<Bucket, cLevels> mBuckets{};
+        std::string mLastMessage{};
+        LogLevel mLastLevel = LogLevel::__END__;
+        std::uint64_t mRepeats = 0;
+        Clock_t::time_point mRepeatStart{};
+        Counters mCounters{};
+    };
+
+    mutable std::mutex mMutex{};
+    std::atomic_bool mActive = false;
+    bool mFolding = false;
+    std::chrono::milliseconds mFoldInterval = std::chrono::seconds(30);
+    std::array<std::optional<Limit>, cLevels> mDefaultLimits{};
+    std::map<std::string, ChannelState, std::less<>> mChannels{};
+
+    void updateActive();
+    bool fold(ChannelState &arState, LogLevel aLevel, const std::string &arChannel, const std::string &arMsg,
+              std::vector<Summary> &arSummaries, Clock_t::time_point aNow);
+    bool limit(ChannelState &arState, LogLevel aLevel, const std::string &arChannel,
+               std::vector<Summary> &arSummaries, Clock_t::time_point aNow);
+};
+
+} /* namespace rsp::logging */
+
+#endif /* INCLUDE_LOGGING_LOGTHROTTLE_H_ */
@@ -0,0 +1,55 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#ifndef INCLUDE_LOGGING_LOGTIMESTAMP_H_
+#define INCLUDE_LOGGING_LOGTIMESTAMP_H_
+
+#include <array>
+#include <chrono>
+#include <limits>
+#include <string_view>
+#include <utils/DateTime.h>
+
+namespace rsp::logging {
+
+/**
+ * \class LogTimestamp
+ * \brief Fast timestamp formatter for log writers.
+ *
+ * The "YYYY-MM-DD hh:mm:ss." prefix is formatted once per second and cached,
+ * subsequent calls within the same second only patch in the millisecond digits.
+ *
+ * An instance is not thread safe, it is intended as a member of a log writer,
+ * where all writes are serialized by the logger.
+ */
+class LogTimestamp
+{
+public:
+    /**
+     * \brief Get the current time in logging format.
+     * \return string_view valid until next call on this object
+     */
+    std::string_view Now() { return Format(std::chrono::system_clock::now()); }
+
+    /**
+     * \brief Format the given time point in logging format.
+     * \param aTp
+     * \return string_view valid until next call on this object
+     */
+    std::string_view Format(std::chrono::system_clock::time_point aTp);
+
+protected:
+    std::chrono::seconds::rep mCachedSecond = std::numeric_limits<std::chrono::seconds::rep>::min();
+    std::array<char, rsp::utils::DateTime::cLoggingLength> mBuffer{};
+};
+
+} /* namespace rsp::logging */
+
+#endif /* INCLUDE_LOGGING_LOGTIMESTAMP_H_ */
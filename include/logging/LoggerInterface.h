@@ -11,6 +11,7 @@
 #include <memory>
 #include <mutex>
 #include "LogStream.h"
+#include "LogThrottle.h"
 #include "LogWriterInterface.h"
 
 #ifndef INCLUDE_LOGGING_LOGGERINTERFACE_H_
@@ -53,6 +54,12 @@ public:
     LoggerInterface& SetChannel(const std::string &arChannel) { mChannel = arChannel; return *this; }
     LoggerInterface& SetContext(rsp::utils::DynamicData &arContext) { mContext = arContext; return *this; }
 
+    /**
+     * \brief Get the log storm suppression settings and counters of this logger.
+     * \return LogThrottle reference
+     */
+    LogThrottle& GetThrottle() { return mThrottle; }
+
     virtual void write(const LogStream &arStream, const std::string &arMsg,
                        const std::string &arChannel, const rsp::utils::DynamicData &arContext);
 protected:
@@ -61,6 +68,7 @@ protected:
     std::vector<std::shared_ptr<LogWriterInterface>> mWriters{};
     std::string mChannel{};
     rsp::utils::DynamicData mContext{};
+    LogThrottle mThrottle{};
 };
 
 
@@ -11,6 +11,8 @@
 #ifndef INCLUDE_LOGGING_OUTSTREAMBUFFER_H_
 #define INCLUDE_LOGGING_OUTSTREAMBUFFER_H_
 
+#include <atomic>
+#include <cstdint>
 #include <iostream>
 #include <mutex>
 #include "LoggerInterface.h"
@@ -27,19 +29,47 @@ namespace rsp::logging {
  * \brief A streambuf implementation of LogStream can be used to replace std::cout/cerr/clog streambuf's.
  *
  * This is not intended to be used directly, instead simply instantiate a Logger with the aCaptureClog argument.
+ *
+ * Characters are collected in a buffer owned by the writing thread, so no lock is taken while
+ * the stream formats its output. Only complete lines are handed to the logger, under the lock,
+ * so lines from several threads are never interleaved. The level set by SetLevel applies to
+ * lines started after it, and to the unfinished line of the calling thread.
+ *
+ * Unfinished lines of the destroying thread are written by the destructor, those of other
+ * threads are discarded.
+ *
+ * The buffer deliberately has no put area. pbase, pptr and epptr are members of the streambuf,
+ * shared by every thread writing to the stream, and sputc advances pptr without calling into this
+ * class, so a per thread area installed with setp would be written by other threads as well.
+ * It could only be guarded by holding a lock from the first character of a line to its end,
+ * i.e. while user code formats its output. Instead every insertion reaches overflow or xsputn,
+ * which look up the line of the calling thread with the last used entry cached.
  */
 class OutStreamBuffer : public std::streambuf, public LogStream
 {
 public:
     OutStreamBuffer(LoggerInterface *apOwner, LogLevel aLevel);
+    OutStreamBuffer(const OutStreamBuffer&) = delete;
+    ~OutStreamBuffer() override;
 
-    void Lock() { mMutex.lock(); }
+    OutStreamBuffer& operator=(const OutStreamBuffer&) = delete;
+
+    /**
+     * \brief Set log level for the current and following lines.
+     * \param aLevel
+     */
+    void SetLevel(LogLevel aLevel);
 
 protected:
     std::mutex mMutex{};
+    std::atomic<LogLevel> mLineLevel;
+    const std::uint64_t mId; // Identifies this buffer in the per thread lines, never reused
 
     int overflow(int c) override;
-    int sync() override;
+    std::streamsize xsputn(const char *apData, std::streamsize aSize) override;
+
+    void append(const char *apBegin, const char *apEnd);
+    void writeLine(const std::string &arText, LogLevel aLevel);
 };
 
 
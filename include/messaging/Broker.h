@@ -11,28 +11,75 @@
 #define BROKER_H
 
 #include <iostream>
-#include <map>
+#include <memory>
+#include <mutex>
+#include <type_traits>
 #include <vector>
+#include <utils/SharedSnapshot.h>
 
 #include "messaging/Event.h"
+#include "messaging/Mailbox.h"
 
 namespace rsp::messaging
 {
 
 class SubscriberBase;
 
+/**
+ * \class BrokerBase
+ * \brief Thread safe registry of subscribers per topic.
+ *
+ * Topics are enum values and index directly into a dense table of subscriber lists.
+ * Neither the table nor the lists are ever changed in place. Subscription changes build
+ * new copies and swap in the new table, while publishers only hold a shared lock long enough
+ * to take a reference to the current table, then index it and walk the contiguous list.
+ * Subscriptions can therefore change at any time, also from within an event handler, and
+ * an ongoing publication keeps delivering to the subscribers it started with.
+ *
+ * A topic can be made a latest value topic, for state that is published far more often than
+ * it is consumed. The broker then keeps the newest event of the topic, and each subscriber only
+ * gets the newest undelivered event when it processes events, see SubscriberBase::ProcessEvents.
+ */
 class BrokerBase
 {
   public:
+    /**
+     * Largest topic value accepted, the table is sized by the highest topic subscribed to.
+     */
+    static constexpr int cMaxTopic = 1023;
+
     virtual ~BrokerBase() {}
 
   protected:
-    std::map<int, std::vector<SubscriberBase *>> mSubscriberMap{};
+    struct Subscription
+    {
+        std::shared_ptr<Mailbox> mpMailbox;
+        std::shared_ptr<Mailbox::LatestSlot> mpSlot; // Only set on latest value topics
+    };
+    using SubscriberList = std::vector<Subscription>;
+
+    struct Topic
+    {
+        SubscriberList mSubscribers{};
+        std::shared_ptr<Mailbox::LatestSlot> mpLatest{}; // Newest event of latest value topics
+    };
+    using TopicTable = std::vector<std::shared_ptr<const Topic>>;
+
+    rsp::utils::SharedSnapshot<TopicTable> mTopics{};
+    std::mutex mWriteMutex{};
 
     void doPublish(int aTopic, Event &arNewEvent);
+    void doPublish(int aTopic, EventPtr apNewEvent);
     void subscribe(SubscriberBase &arSubscriber, int aTopic);
     void unsubscribe(SubscriberBase &arSubscriber, int aTopic);
     void removeSubscriber(SubscriberBase &arSubscriber);
+    void setLatestValue(int aTopic, bool aEnable);
+    bool isLatestValue(int aTopic) const;
+    EventPtr getLatest(int aTopic) const;
+    std::size_t getSubscriberCount(int aTopic) const;
+    static void publishLatest(const Topic &arTopic, EventPtr apNewEvent);
+    static const Topic* findTopic(const TopicTable &arTable, int aTopic);
+    static std::size_t topicIndex(int aTopic);
 };
 
 template <typename T>
@@ -46,11 +93,14 @@ class Subscriber;
 template <typename T>
 class Broker : public BrokerBase
 {
+    static_assert(std::is_enum_v<T>, "Broker topics must be an enum type");
+
   public:
     /**
      * \brief Add a subscriber to the broker
      * \param arSubscriber Reference to the subscriber that is registering
      * \param aTopic Topic to subscribe to
+     * \throws std::out_of_range if the topic value is negative or above cMaxTopic
      */
     void Subscribe(Subscriber<T> &arSubscriber, T aTopic)
     {
@@ -67,7 +117,7 @@ class Broker : public BrokerBase
      */
     void Unsubscribe(Subscriber<T> &arSubscriber, T aTopic)
     {
-        unsubscribe(arSubscriber, aTopic);
+        unsubscribe(arSubscriber, static_cast<int>(aTopic));
     }
 
     /**
@@ -81,6 +131,10 @@ class Broker : public BrokerBase
 
     /**
      * \brief Publish an event through this broker
+     *
+     * Synchronous subscribers are called before this returns. Queued subscribers
+     * receive a pooled copy of the event, made once per call.
+     *
      * \param aTopic Topic to publish to
      * \param arNewEvent Event to publish
      */
@@ -88,6 +142,57 @@ class Broker : public BrokerBase
     {
         doPublish(static_cast<int>(aTopic), arNewEvent);
     }
+
+    /**
+     * \brief Publish a pooled event through this broker, queued subscribers share it without copying.
+     * \param aTopic Topic to publish to
+     * \param apNewEvent Event made by MakeEvent
+     */
+    void Publish(T aTopic, EventPtr apNewEvent)
+    {
+        doPublish(static_cast<int>(aTopic), std::move(apNewEvent));
+    }
+
+    /**
+     * \brief Make a topic keep only its latest value.
+     *
+     * Publications to the topic replace any event not yet delivered to a subscriber, and are
+     * handed to subscribers when they call ProcessEvents, also to synchronous subscribers.
+     * New subscribers receive the current value on their first ProcessEvents.
+     *
+     * \param aTopic Topic to configure
+     * \param aEnable False to return the topic to normal delivery
+     * \throws std::out_of_range if the topic value is negative or above cMaxTopic
+     */
+    void SetLatestValue(T aTopic, bool aEnable = true)
+    {
+        setLatestValue(static_cast<int>(aTopic), aEnable);
+    }
+
+    bool IsLatestValue(T aTopic) const
+    {
+        return isLatestValue(static_cast<int>(aTopic));
+    }
+
+    /**
+     * \brief Get the newest event published to a latest value topic.
+     * \param aTopic
+     * \return Event, or empty if nothing is published yet or the topic is not a latest value topic
+     */
+    EventPtr GetLatest(T aTopic) const
+    {
+        return getLatest(static_cast<int>(aTopic));
+    }
+
+    /**
+     * \brief Get the number of subscribers to a topic
+     * \param aTopic
+     * \return Number of subscribers
+     */
+    std::size_t GetSubscriberCount(T aTopic) const
+    {
+        return getSubscriberCount(static_cast<int>(aTopic));
+    }
 };
 
 } // namespace rsp::messaging
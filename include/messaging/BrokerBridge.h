@@ -0,0 +1,171 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+#ifndef BROKERBRIDGE_H
+#define BROKERBRIDGE_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "messaging/Broker.h"
+#include "messaging/EventCodec.h"
+#include "messaging/IpcChannel.h"
+#include "messaging/Subscriber.h"
+
+namespace rsp::messaging
+{
+
+/**
+ * \class BrokerBridgeBase
+ * \brief Topic independent part of BrokerBridge, framing and counting of events.
+ */
+class BrokerBridgeBase
+{
+  public:
+    explicit BrokerBridgeBase(IpcChannel &arChannel) : mrChannel(arChannel) {}
+    virtual ~BrokerBridgeBase() {}
+
+    BrokerBridgeBase(const BrokerBridgeBase&) = delete;
+    BrokerBridgeBase& operator=(const BrokerBridgeBase&) = delete;
+
+    IpcChannel& GetChannel() { return mrChannel; }
+
+    std::size_t GetSentCount() const { return mSent.load(std::memory_order_relaxed); }
+    std::size_t GetReceivedCount() const { return mReceived.load(std::memory_order_relaxed); }
+
+    /**
+     * \brief Get the number of events not sent, because the channel was full or closed, or not received, because
+     *        their type is not registered in the EventCodec.
+     * \return Number of events
+     */
+    std::size_t GetDroppedCount() const { return mDropped.load(std::memory_order_relaxed); }
+
+  protected:
+    IpcChannel &mrChannel;
+    std::mutex mSendMutex{};
+    std::string mSendBuffer{};
+    std::string mReceiveBuffer{};
+    std::atomic<std::size_t> mSent{0};
+    std::atomic<std::size_t> mReceived{0};
+    std::atomic<std::size_t> mDropped{0};
+
+    bool send(int aTopic, const Event &arEvent);
+    std::size_t receive(std::chrono::milliseconds aTimeout);
+    virtual void deliver(int aTopic, EventPtr apEvent) = 0;
+};
+
+/**
+ * \class BrokerBridge
+ * \brief Connects a broker to a broker in another process.
+ *
+ * Events published locally on a forwarded topic are encoded by the EventCodec and sent over the
+ * channel. Events received from the channel are published to the local broker on the same topic,
+ * so subscribers can not tell them from local events. Both processes must register the event types
+ * in their EventCodec, and usually forward different topics:
+ * \code
+ * // GUI process
+ * auto channel = ShmChannel::Create(listener.Accept(std::chrono::seconds(5)));
+ * BrokerBridge<Topics> bridge(broker, *channel);
+ * bridge.Forward(Topics::UserInput);
+ * worker.GetExecute() = [&bridge]() { bridge.Process(std::chrono::milliseconds(100)); };
+ *
+ * // Measurement process
+ * auto channel = ShmChannel::Attach(SocketChannel::Connect(path));
+ * BrokerBridge<Topics> bridge(broker, *channel);
+ * bridge.Forward(Topics::Temperature);
+ * \endcode
+ *
+ * If both processes forward the same topic, events received on it are not sent back.
+ * Forward must be called before events are published on the topic or Process is called.
+ *
+ * \tparam T Enum type used for topics
+ */
+template <typename T>
+class BrokerBridge : public BrokerBridgeBase
+{
+  public:
+    BrokerBridge(Broker<T> &arBroker, IpcChannel &arChannel) : BrokerBridgeBase(arChannel), mrBroker(arBroker) {}
+
+    /**
+     * \brief Send events published locally on the topic to the other process.
+     * \param aTopic
+     * \return Reference to this
+     */
+    BrokerBridge& Forward(T aTopic)
+    {
+        mForwarders.push_back(std::make_unique<Forwarder>(*this, aTopic));
+        return *this;
+    }
+
+    /**
+     * \brief Publish events received from the other process, and send pending latest values.
+     * \param aTimeout Maximum time to wait for events to arrive
+     * \return Number of events received
+     */
+    std::size_t Process(std::chrono::milliseconds aTimeout = std::chrono::milliseconds(0))
+    {
+        for (auto &forwarder : mForwarders) {
+            forwarder->ProcessEvents();
+        }
+        return receive(aTimeout);
+    }
+
+  protected:
+    class Forwarder : public Subscriber<T>
+    {
+      public:
+        Forwarder(BrokerBridge &arBridge, T aTopic)
+            : Subscriber<T>(arBridge.mrBroker),
+              mrBridge(arBridge),
+              mTopic(aTopic)
+        {
+            Subscriber<T>::Subscribe(aTopic);
+        }
+        ~Forwarder() override
+        {
+            this->Detach();
+        }
+        Forwarder(const Forwarder&) = delete;
+        Forwarder& operator=(const Forwarder&) = delete;
+
+        void HandleEvent(Event &arNewEvent) override
+        {
+            if (&arNewEvent != mpReceived.load(std::memory_order_acquire)) {
+                mrBridge.send(static_cast<int>(mTopic), arNewEvent);
+            }
+        }
+
+        BrokerBridge &mrBridge;
+        T mTopic;
+        EventPtr mpHeld{}; // Keeps the received event, and so its address, from being reused
+        std::atomic<const Event*> mpReceived{nullptr};
+    };
+
+    Broker<T> &mrBroker;
+    std::vector<std::unique_ptr<Forwarder>> mForwarders{};
+
+    void deliver(int aTopic, EventPtr apEvent) override
+    {
+        auto topic = static_cast<T>(aTopic);
+        for (auto &forwarder : mForwarders) {
+            if (forwarder->mTopic == topic) {
+                forwarder->mpHeld = apEvent;
+                forwarder->mpReceived.store(apEvent.Get(), std::memory_order_release);
+            }
+        }
+        mrBroker.Publish(topic, std::move(apEvent));
+    }
+};
+
+} // namespace rsp::messaging
+
+#endif // BROKERBRIDGE_H
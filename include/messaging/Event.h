@@ -10,19 +10,113 @@
 #ifndef EVENT_H
 #define EVENT_H
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
 #include <type_traits>
-#include <typeinfo>
+#include <utility>
+#include <utils/BoundedQueue.h>
+#include <utils/ConstTypeInfo.h>
+#include <utils/CoreException.h>
 #include <utils/ExceptionHelper.h>
 
 namespace rsp::messaging
 {
 
+class Event;
+
+/**
+ * \brief Compile time id of an event type, the crc32 hash of the type name.
+ */
+template <class T>
+inline constexpr std::uint32_t cEventTypeId = rsp::utils::crc32::HashOf<T>();
+
+/**
+ * \class EventPtr
+ * \brief Shared ownership of an event, using the reference count inside the event.
+ *
+ * Copying an EventPtr only increments the count, no memory is allocated. When the last
+ * EventPtr is gone the event is handed back to where it came from, normally its EventPool.
+ */
+class EventPtr
+{
+  public:
+    EventPtr() = default;
+    EventPtr(std::nullptr_t) {}
+
+    /**
+     * \brief Take shared ownership of an event.
+     * \param apEvent Event made by EventPool or MakeEvent
+     */
+    explicit EventPtr(Event *apEvent);
+
+    EventPtr(const EventPtr &arOther) : EventPtr(arOther.mpEvent) {}
+    EventPtr(EventPtr &&arOther) noexcept : mpEvent(std::exchange(arOther.mpEvent, nullptr)) {}
+    ~EventPtr() { reset(); }
+
+    EventPtr &operator=(const EventPtr &arOther)
+    {
+        EventPtr(arOther).swap(*this);
+        return *this;
+    }
+
+    EventPtr &operator=(EventPtr &&arOther) noexcept
+    {
+        EventPtr(std::move(arOther)).swap(*this);
+        return *this;
+    }
+
+    Event *Get() const { return mpEvent; }
+    Event &operator*() const { return *mpEvent; }
+    Event *operator->() const { return mpEvent; }
+    explicit operator bool() const { return mpEvent != nullptr; }
+
+    void swap(EventPtr &arOther) noexcept { std::swap(mpEvent, arOther.mpEvent); }
+
+  protected:
+    Event *mpEvent = nullptr;
+
+    void reset();
+};
+
 class Event
 {
   public:
-    Event(std::size_t aHash) : mTypeHash(aHash) {}
+    using Clone_t = EventPtr(*)(const Event &arEvent);
+    using Release_t = void(*)(Event *apEvent);
+
+    explicit Event(std::uint32_t aTypeId, Clone_t apClone = nullptr) : mTypeId(aTypeId), mpClone(apClone) {}
+
+    /**
+     * \brief Copies only the content of the event, a copy is never owned by anyone.
+     */
+    Event(const Event &arOther) : mTypeId(arOther.mTypeId), mpClone(arOther.mpClone) {}
+    Event &operator=(const Event &arOther)
+    {
+        mTypeId = arOther.mTypeId;
+        mpClone = arOther.mpClone;
+        return *this;
+    }
     virtual ~Event() {}
 
+    /**
+     * \brief Get the compile time id of the event type.
+     * \return crc32 hash of the type name
+     */
+    std::uint32_t GetTypeId() const { return mTypeId; }
+
+    /**
+     * \brief Check if the event is of the templated type
+     * \return True if type matches
+     */
+    template <class T>
+    bool Is() const
+    {
+        return mTypeId == cEventTypeId<T>;
+    }
+
     /**
      * \brief Casts the event to the templated type
      * \return A reference to the object after casting
@@ -30,21 +124,184 @@ class Event
     template <class T>
     T &GetAs()
     {
-        if (typeid(T).hash_code() != mTypeHash) {
+        if (!Is<T>()) {
             THROW_WITH_BACKTRACE(std::bad_alloc);
         }
-        return *reinterpret_cast<T *>(this);
+        return static_cast<T &>(*this);
+    }
+
+    /**
+     * \brief Make a pooled copy of the event.
+     *
+     * Used by the broker to hand events published by reference to queued subscribers.
+     *
+     * \return Owning pointer to the copy
+     */
+    EventPtr Clone() const
+    {
+        if (!mpClone) {
+            THROW_WITH_BACKTRACE1(rsp::utils::NotImplementedException, "Event type can not be copied.");
+        }
+        return mpClone(*this);
     }
 
 protected:
-    std::size_t mTypeHash;
+    template <class T> friend class EventPool;
+    friend EventPtr;
+
+    std::uint32_t mTypeId;
+    Clone_t mpClone;
+    std::atomic<std::uint32_t> mRefCount{0};
+    Release_t mpRelease = nullptr;
 };
 
+inline EventPtr::EventPtr(Event *apEvent)
+    : mpEvent(apEvent)
+{
+    if (mpEvent) {
+        mpEvent->mRefCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+inline void EventPtr::reset()
+{
+    if (mpEvent && (mpEvent->mRefCount.fetch_sub(1, std::memory_order_acq_rel) == 1) && mpEvent->mpRelease) {
+        mpEvent->mpRelease(mpEvent);
+    }
+    mpEvent = nullptr;
+}
+
+/**
+ * \class EventPool
+ * \brief Recycles the memory of events of one type.
+ *
+ * Released events are destroyed and their memory kept on a lock free free list, ready for
+ * the next event of the same type. Once the pool has warmed up, making an event costs a pop
+ * from the free list, and no heap allocation. Events released while the free list is full are
+ * deleted. The size of the free list can be set by an event type with a static constexpr
+ * cPoolCapacity member.
+ *
+ * \tparam T Event type
+ */
+template <class T>
+class EventPool
+{
+  public:
+    static constexpr std::size_t cDefaultCapacity = 256;
+
+    /**
+     * \brief Get the pool for the event type. The pool lives until program exit.
+     * \return EventPool
+     */
+    static EventPool &Get()
+    {
+        // Never destroyed, events may be released by other static objects during exit.
+        static EventPool *pool = new EventPool(getCapacity());
+        return *pool;
+    }
+
+    EventPool(const EventPool &) = delete;
+    EventPool &operator=(const EventPool &) = delete;
+
+    /**
+     * \brief Construct an event in pooled memory.
+     * \param aArgs Arguments for the event constructor
+     * \return Owning pointer to the event
+     */
+    template <class... Args>
+    EventPtr Make(Args &&...aArgs)
+    {
+        void *memory = nullptr;
+        if (!mFree.TryPop(memory)) {
+            memory = ::operator new(sizeof(T), std::align_val_t(alignof(T)));
+            mAllocated.fetch_add(1, std::memory_order_relaxed);
+        }
+        T *event;
+        try {
+            event = ::new (memory) T(std::forward<Args>(aArgs)...);
+        }
+        catch (...) {
+            giveBack(memory);
+            throw;
+        }
+        event->mpRelease = &release;
+        return EventPtr(event);
+    }
+
+    /**
+     * \brief Allocate memory for events up front, so the first events do not allocate.
+     * \param aCount Number of events, limited by the pool capacity
+     */
+    void Reserve(std::size_t aCount)
+    {
+        while (mFree.GetSize() < std::min(aCount, mFree.GetCapacity())) {
+            mAllocated.fetch_add(1, std::memory_order_relaxed);
+            giveBack(::operator new(sizeof(T), std::align_val_t(alignof(T))));
+        }
+    }
+
+    std::size_t GetAvailable() const { return mFree.GetSize(); }
+    std::size_t GetAllocatedCount() const { return mAllocated.load(std::memory_order_relaxed); }
+
+  protected:
+    rsp::utils::BoundedQueue<void *> mFree;
+    std::atomic<std::size_t> mAllocated{0};
+
+    explicit EventPool(std::size_t aCapacity) : mFree(aCapacity) {}
+
+    static constexpr std::size_t getCapacity()
+    {
+        if constexpr (requires { T::cPoolCapacity; }) {
+            return T::cPoolCapacity;
+        }
+        else {
+            return cDefaultCapacity;
+        }
+    }
+
+    void giveBack(void *apMemory)
+    {
+        if (!mFree.TryPush(apMemory)) {
+            ::operator delete(apMemory, std::align_val_t(alignof(T)));
+        }
+    }
+
+    static void release(Event *apEvent)
+    {
+        T *event = static_cast<T *>(apEvent);
+        event->~T();
+        Get().giveBack(event);
+    }
+};
+
+/**
+ * \brief Construct a pooled event.
+ * \tparam T Event type
+ * \param aArgs Arguments for the event constructor
+ * \return Owning pointer to the event
+ */
+template <class T, class... Args>
+EventPtr MakeEvent(Args &&...aArgs)
+{
+    return EventPool<T>::Get().Make(std::forward<Args>(aArgs)...);
+}
+
 template <class T>
 class EventType : public Event
 {
   public:
-    EventType() : Event(typeid(T).hash_code()) {}
+    EventType() : Event(cEventTypeId<T>, &clone) {}
+
+  protected:
+    static EventPtr clone(const Event &arEvent)
+    {
+        if constexpr (std::is_copy_constructible_v<T>) {
+            return MakeEvent<T>(static_cast<const T &>(arEvent));
+        }
+        else {
+            THROW_WITH_BACKTRACE1(rsp::utils::NotImplementedException, "Event type can not be copied.");
+        }
+    }
 };
 
 } // namespace rsp::messaging
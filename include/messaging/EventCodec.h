@@ -0,0 +1,180 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+#ifndef EVENTCODEC_H
+#define EVENTCODEC_H
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utils/CoreException.h>
+#include "messaging/Event.h"
+
+namespace rsp::messaging
+{
+
+/**
+ * \class EEventCodecError
+ * \brief Thrown on malformed event data or unregistered event types.
+ */
+class EEventCodecError : public rsp::utils::CoreException
+{
+  public:
+    explicit EEventCodecError(const std::string &aMsg) : CoreException("Event Codec Error: " + aMsg) {}
+};
+
+/**
+ * \class EventWriter
+ * \brief Appends event members to a binary buffer.
+ *
+ * Arithmetic and enum values are written in host byte order with their exact size, strings
+ * are prefixed by their length. The format is only meant for processes on the same host.
+ */
+class EventWriter
+{
+  public:
+    explicit EventWriter(std::string &arBuffer) : mrBuffer(arBuffer) {}
+
+    template <class V, std::enable_if_t<std::is_arithmetic_v<V> || std::is_enum_v<V>, bool> = true>
+    EventWriter& Write(V aValue)
+    {
+        mrBuffer.append(reinterpret_cast<const char*>(&aValue), sizeof(aValue));
+        return *this;
+    }
+
+    EventWriter& Write(std::string_view aValue)
+    {
+        Write(static_cast<std::uint32_t>(aValue.size()));
+        mrBuffer.append(aValue);
+        return *this;
+    }
+
+  protected:
+    std::string &mrBuffer;
+};
+
+/**
+ * \class EventReader
+ * \brief Reads event members written by EventWriter, in the same order.
+ */
+class EventReader
+{
+  public:
+    explicit EventReader(std::string_view aData) : mData(aData) {}
+
+    template <class V, std::enable_if_t<std::is_arithmetic_v<V> || std::is_enum_v<V>, bool> = true>
+    V Read()
+    {
+        V result;
+        std::memcpy(&result, need(sizeof(V)), sizeof(V));
+        return result;
+    }
+
+    std::string_view ReadString()
+    {
+        auto size = Read<std::uint32_t>();
+        return std::string_view(need(size), size);
+    }
+
+    std::size_t GetPending() const { return mData.size() - mPos; }
+
+  protected:
+    std::string_view mData;
+    std::size_t mPos = 0;
+
+    const char* need(std::size_t aSize)
+    {
+        if (aSize > GetPending()) {
+            THROW_WITH_BACKTRACE1(EEventCodecError, "Unexpected end of event data.");
+        }
+        const char *result = mData.data() + mPos;
+        mPos += aSize;
+        return result;
+    }
+};
+
+/**
+ * \class EventCodec
+ * \brief Registry of event types that can be sent to other processes.
+ *
+ * An event type is made transferable by giving it a Serialize method and a constructor
+ * reading the members back in the same order, and registering it in every process:
+ * \code
+ * struct TemperatureEvent : public EventType<TemperatureEvent> {
+ *     explicit TemperatureEvent(EventReader &arReader) : mSensor(arReader.ReadString()), mValue(arReader.Read<double>()) {}
+ *     void Serialize(EventWriter &arWriter) const { arWriter.Write(mSensor).Write(mValue); }
+ *     std::string mSensor;
+ *     double mValue;
+ * };
+ * EventCodec::Get().Register<TemperatureEvent>();
+ * \endcode
+ *
+ * Encoded events start with the type id, so the receiver can make a pooled event of the
+ * same type. Registration is thread safe, and normally done once during startup.
+ */
+class EventCodec
+{
+  public:
+    using Encode_t = void(*)(const Event &arEvent, EventWriter &arWriter);
+    using Decode_t = EventPtr(*)(EventReader &arReader);
+
+    /**
+     * \brief Get the process wide codec.
+     * \return EventCodec
+     */
+    static EventCodec& Get();
+
+    template <class T>
+    EventCodec& Register()
+    {
+        add(cEventTypeId<T>,
+            [](const Event &arEvent, EventWriter &arWriter) { static_cast<const T&>(arEvent).Serialize(arWriter); },
+            [](EventReader &arReader) { return MakeEvent<T>(arReader); });
+        return *this;
+    }
+
+    bool IsRegistered(std::uint32_t aTypeId) const;
+
+    /**
+     * \brief Append the binary form of an event to a buffer.
+     * \param arEvent Event of a registered type
+     * \param arBuffer Buffer to append to
+     * \throws EEventCodecError if the type is not registered
+     */
+    void Encode(const Event &arEvent, std::string &arBuffer) const;
+
+    /**
+     * \brief Make a pooled event from its binary form.
+     * \param aData Data written by Encode
+     * \return Event
+     * \throws EEventCodecError if the data is malformed or the type is not registered
+     */
+    EventPtr Decode(std::string_view aData) const;
+
+  protected:
+    struct Entry {
+        Encode_t mpEncode;
+        Decode_t mpDecode;
+    };
+
+    mutable std::shared_mutex mMutex{};
+    std::unordered_map<std::uint32_t, Entry> mEntries{};
+
+    void add(std::uint32_t aTypeId, Encode_t apEncode, Decode_t apDecode);
+    Entry find(std::uint32_t aTypeId) const;
+};
+
+} // namespace rsp::messaging
+
+#endif // EVENTCODEC_H
@@ -0,0 +1,250 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+#ifndef IPCCHANNEL_H
+#define IPCCHANNEL_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <utils/CoreException.h>
+
+namespace rsp::messaging
+{
+
+/**
+ * \class EIpcError
+ * \brief Thrown when a channel can not be established, or the other end breaks its protocol.
+ */
+class EIpcError : public rsp::utils::CoreException
+{
+  public:
+    explicit EIpcError(const std::string &aMsg) : CoreException("IPC Error: " + aMsg) {}
+};
+
+/**
+ * \class IpcChannel
+ * \brief Bidirectional, message oriented connection to another process.
+ *
+ * Frames are delivered whole and in order. Send and Receive never block, Wait is used to
+ * sleep until frames arrive. Send may be called from one thread at a time, and Receive and
+ * Wait from one thread at a time, which can be another than the sending thread.
+ */
+class IpcChannel
+{
+  public:
+    virtual ~IpcChannel() {}
+
+    /**
+     * \brief Send a frame to the other end.
+     * \param aFrame Frame content
+     * \return False if there was no room for the frame or the connection is closed
+     */
+    virtual bool Send(std::string_view aFrame) = 0;
+
+    /**
+     * \brief Take the next received frame.
+     * \param arFrame Receives the frame content
+     * \return False if no frame is ready
+     */
+    virtual bool Receive(std::string &arFrame) = 0;
+
+    /**
+     * \brief Wait for frames to arrive or the connection to close.
+     * \param aTimeout Maximum time to wait
+     * \return True if Receive should be called
+     */
+    virtual bool Wait(std::chrono::milliseconds aTimeout) = 0;
+
+    /**
+     * \brief Get a file descriptor that becomes readable when Wait would return, for use in event loops.
+     * \return File descriptor
+     */
+    virtual int GetFd() const = 0;
+
+    /**
+     * \brief Check if the other end is still connected.
+     * \return False once the other end has closed the connection
+     */
+    bool IsOpen() const { return mOpen.load(std::memory_order_relaxed); }
+
+  protected:
+    std::atomic<bool> mOpen{true};
+};
+
+/**
+ * \class SocketChannel
+ * \brief IpcChannel over a Unix domain socket of type SOCK_SEQPACKET.
+ *
+ * Each frame is a single socket message, so frames are limited by the socket buffer size.
+ */
+class SocketChannel : public IpcChannel
+{
+  public:
+    /**
+     * \brief Take ownership of a connected socket.
+     * \param aFd File descriptor of socket
+     */
+    explicit SocketChannel(int aFd);
+    ~SocketChannel() override;
+
+    SocketChannel(const SocketChannel&) = delete;
+    SocketChannel& operator=(const SocketChannel&) = delete;
+
+    /**
+     * \brief Connect to a listening socket.
+     * \param arPath File system path of socket
+     * \return Connected channel
+     */
+    static std::unique_ptr<SocketChannel> Connect(const std::string &arPath);
+
+    /**
+     * \brief Make a pair of connected channels, e.g. to hand one to a forked child process.
+     * \return Pair of channels
+     */
+    static std::pair<std::unique_ptr<SocketChannel>, std::unique_ptr<SocketChannel>> Pair();
+
+    bool Send(std::string_view aFrame) override;
+    bool Receive(std::string &arFrame) override;
+    bool Wait(std::chrono::milliseconds aTimeout) override;
+    int GetFd() const override { return mFd; }
+
+    /**
+     * \brief Send a frame along with open file descriptors, which are duplicated into the receiver.
+     * \param aFrame Frame content, must not be empty
+     * \param apFds Array of file descriptors
+     * \param aCount Number of file descriptors
+     */
+    void SendWithFds(std::string_view aFrame, const int *apFds, std::size_t aCount);
+
+    /**
+     * \brief Wait for a frame sent by SendWithFds.
+     * \param arFrame Receives the frame content
+     * \param apFds Receives the file descriptors, the caller must close them
+     * \param aCount Number of file descriptors expected
+     * \param aTimeout Maximum time to wait
+     */
+    void ReceiveWithFds(std::string &arFrame, int *apFds, std::size_t aCount, std::chrono::milliseconds aTimeout);
+
+  protected:
+    int mFd;
+};
+
+/**
+ * \class IpcListener
+ * \brief Listening Unix domain socket, accepting SocketChannel connections.
+ */
+class IpcListener
+{
+  public:
+    /**
+     * \brief Create the socket, replacing any stale socket file at the path.
+     * \param arPath File system path of socket
+     */
+    explicit IpcListener(const std::string &arPath);
+    ~IpcListener();
+
+    IpcListener(const IpcListener&) = delete;
+    IpcListener& operator=(const IpcListener&) = delete;
+
+    /**
+     * \brief Wait for a process to connect.
+     * \param aTimeout Maximum time to wait
+     * \return Connected channel, or nullptr on timeout
+     */
+    std::unique_ptr<SocketChannel> Accept(std::chrono::milliseconds aTimeout);
+
+    int GetFd() const { return mFd; }
+
+  protected:
+    std::string mPath;
+    int mFd;
+};
+
+/**
+ * \class ShmChannel
+ * \brief IpcChannel over a pair of lock free ring buffers in shared memory.
+ *
+ * Sending copies the frame into the ring and only makes a system call, writing an eventfd,
+ * if the receiver is sleeping in Wait. A busy receiver picks up frames without any system
+ * call, and latency is dominated by the wake up of a sleeping receiver.
+ *
+ * The shared memory and eventfds are set up over a SocketChannel, one end calling Create
+ * and the other Attach. The socket is kept to detect the other end closing, and to carry
+ * frames too large for the ring. Those are marked in the ring, so all frames arrive in order.
+ *
+ * The other process can write anywhere in the shared memory. Records that do not fit the ring
+ * make Receive close the channel and throw EIpcError.
+ */
+class ShmChannel : public IpcChannel
+{
+  public:
+    static constexpr std::size_t cDefaultCapacity = 1024 * 1024;
+
+    ~ShmChannel() override;
+
+    ShmChannel(const ShmChannel&) = delete;
+    ShmChannel& operator=(const ShmChannel&) = delete;
+
+    /**
+     * \brief Set up shared memory and hand it to the other end of the socket.
+     * \param apSocket Connected socket
+     * \param aCapacity Size of each ring buffer, rounded up to a multiple of 8
+     * \return Channel
+     */
+    static std::unique_ptr<ShmChannel> Create(std::unique_ptr<SocketChannel> apSocket, std::size_t aCapacity = cDefaultCapacity);
+
+    /**
+     * \brief Attach to the shared memory set up by Create at the other end of the socket.
+     * \param apSocket Connected socket
+     * \param aTimeout Maximum time to wait for the other end
+     * \return Channel
+     */
+    static std::unique_ptr<ShmChannel> Attach(std::unique_ptr<SocketChannel> apSocket, std::chrono::milliseconds aTimeout = std::chrono::milliseconds(1000));
+
+    /**
+     * \brief Make a pair of connected channels, e.g. to hand one to a forked child process.
+     * \param aCapacity Size of each ring buffer
+     * \return Pair of channels
+     */
+    static std::pair<std::unique_ptr<ShmChannel>, std::unique_ptr<ShmChannel>> Pair(std::size_t aCapacity = cDefaultCapacity);
+
+    bool Send(std::string_view aFrame) override;
+    bool Receive(std::string &arFrame) override;
+    bool Wait(std::chrono::milliseconds aTimeout) override;
+    int GetFd() const override { return mReceiveFd; }
+
+    std::size_t GetCapacity() const { return mCapacity; }
+
+  protected:
+    struct Ring;
+
+    std::unique_ptr<SocketChannel> mpSocket;
+    std::size_t mCapacity;
+    std::size_t mMapSize;
+    void *mpMap;
+    Ring *mpSendRing;
+    Ring *mpReceiveRing;
+    int mSendFd;
+    int mReceiveFd;
+
+    ShmChannel(std::unique_ptr<SocketChannel> apSocket, std::size_t aCapacity, int aMemFd, int aSendFd, int aReceiveFd, bool aCreator);
+    bool arm();
+    bool hasFrames() const;
+    bool checkSocket();
+    [[noreturn]] void corrupted(const std::string &arWhat);
+};
+
+} // namespace rsp::messaging
+
+#endif // IPCCHANNEL_H
@@ -0,0 +1,160 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <utils/BoundedQueue.h>
+#include <utils/EventLoop.h>
+#include <utils/SharedSnapshot.h>
+#include "messaging/Event.h"
+
+namespace rsp::messaging
+{
+
+class SubscriberBase;
+
+/**
+ * \class Mailbox
+ * \brief Delivery point for events to a single subscriber, shared between the subscriber and brokers.
+ *
+ * A synchronous mailbox calls the subscriber on the publishing thread, one event at a time.
+ * A queued mailbox only adds the event to a bounded lock free queue, which the subscriber
+ * drains on its own thread. Events arriving to a full queue are dropped and counted.
+ *
+ * Events on latest value topics are not queued. Each such subscription has a slot holding
+ * only the newest undelivered event, which replaces any older one. The slots are handed to
+ * the subscriber by Process, also for synchronous mailboxes, so the subscriber is called at
+ * most once per topic each time it processes events, no matter how often the topic is published.
+ *
+ * The mailbox is detached when the subscriber is destroyed, brokers may still hold it
+ * for a short while but will no longer deliver to it. Synchronous deliveries are counted while
+ * they are in progress, no lock is held while the subscriber handles an event, so handlers may
+ * publish, subscribe and unsubscribe freely.
+ */
+class Mailbox
+{
+  public:
+    /**
+     * \brief Holder of the newest event of a latest value topic.
+     */
+    struct LatestSlot
+    {
+        std::mutex mMutex{};
+        EventPtr mpEvent{};
+
+        EventPtr Exchange(EventPtr apEvent)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mpEvent.swap(apEvent);
+            return apEvent;
+        }
+
+        EventPtr Get()
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            return mpEvent;
+        }
+    };
+
+    Mailbox(SubscriberBase &arSubscriber, std::size_t aQueueCapacity);
+    Mailbox(const Mailbox &) = delete;
+    Mailbox &operator=(const Mailbox &) = delete;
+
+    /**
+     * \brief Deliver an event, called by brokers on the publishing thread.
+     * \param arEvent Event to deliver
+     * \param arpOwned Owned copy of the event, made by the first queued mailbox if empty
+     */
+    void Deliver(Event &arEvent, EventPtr &arpOwned);
+
+    /**
+     * \brief Deliver the newest event of a latest value topic, replacing any undelivered event in the slot.
+     * \param arSlot Slot made by AddLatest
+     * \param arpEvent Event to deliver
+     */
+    void DeliverLatest(LatestSlot &arSlot, const EventPtr &arpEvent);
+
+    /**
+     * \brief Add a slot for a subscription to a latest value topic.
+     * \return New slot
+     */
+    std::shared_ptr<LatestSlot> AddLatest();
+
+    /**
+     * \brief Remove the slot of a subscription to a latest value topic, any undelivered event is dropped.
+     * \param arpSlot Slot made by AddLatest
+     */
+    void RemoveLatest(const std::shared_ptr<LatestSlot> &arpSlot);
+
+    /**
+     * \brief Handle queued events and latest values on the calling thread.
+     * \param aMaxCount Maximum number of events to handle
+     * \return Number of events handled
+     */
+    std::size_t Process(std::size_t aMaxCount);
+
+    /**
+     * \brief Wake an event loop whenever an event is queued or a latest value arrives.
+     *
+     * Lets the owner process events from a loop that sleeps until something happens.
+     * \param apLoop Event loop, or nullptr to stop waking it
+     */
+    void SetEventLoop(rsp::utils::EventLoop *apLoop) { mpLoop.store(apLoop, std::memory_order_release); }
+
+    /**
+     * \brief Wait for events to arrive in the queue or a latest value slot.
+     * \param aTimeout Maximum time to wait
+     * \return True if events are ready
+     */
+    bool Wait(std::chrono::milliseconds aTimeout);
+
+    /**
+     * \brief Stop delivery to the subscriber. Waits for synchronous deliveries in progress on
+     *        other threads to finish, so it may be called from the subscribers own event handler.
+     */
+    void Detach();
+
+    /**
+     * \brief Wait for synchronous deliveries in progress on other threads to finish.
+     */
+    void WaitForDeliveries() const;
+
+    bool IsQueued() const { return mpQueue != nullptr; }
+    std::size_t GetPending() const { return mpQueue ? mpQueue->GetSize() : 0; }
+    std::size_t GetDropped() const { return mDropped.load(std::memory_order_relaxed); }
+
+  protected:
+    using SlotList = std::vector<std::shared_ptr<LatestSlot>>;
+
+    std::atomic<SubscriberBase *> mpSubscriber;
+    std::atomic<std::size_t> mInFlight{0}; // Synchronous deliveries in progress
+    std::unique_ptr<rsp::utils::BoundedQueue<EventPtr>> mpQueue;
+    std::atomic<std::size_t> mDropped{0};
+    rsp::utils::SharedSnapshot<SlotList> mSlots{};
+    std::mutex mSlotMutex{};
+    std::atomic<bool> mLatestReady{false};
+    std::atomic<bool> mSleeping{false};
+    std::mutex mWaitMutex{};
+    std::condition_variable mWaitCondition{};
+    std::atomic<rsp::utils::EventLoop *> mpLoop{nullptr};
+
+    bool hasEvents() const;
+    void wakeUp();
+};
+
+} // namespace rsp::messaging
+
+#endif // MAILBOX_H
@@ -55,6 +55,16 @@ public:
         mrBroker.Publish(aTopic, arNewEvent);
     }
 
+    /**
+     * \brief Publish a pooled event through the registered broker.
+     * \param aTopic Topic to publish to
+     * \param apNewEvent Event made by MakeEvent
+     */
+    void PublishToBroker(T aTopic, EventPtr apNewEvent)
+    {
+        mrBroker.Publish(aTopic, std::move(apNewEvent));
+    }
+
 protected:
     Broker<T> &mrBroker;
 };
@@ -11,28 +11,113 @@
 #define SUBSCRIBER_H
 
 #include "Broker.h"
+#include "Mailbox.h"
+#include <chrono>
 #include <iostream>
+#include <limits>
+#include <memory>
 
 namespace rsp::messaging
 {
 
+/**
+ * \class SubscriberBase
+ * \brief Receiver of events published through a broker.
+ *
+ * By default events are handled synchronously on the publishing thread. If constructed with
+ * a queue capacity, events are instead queued without blocking the publisher, and handled
+ * when the owner of the subscriber calls ProcessEvents, e.g. from its own thread or event loop:
+ * \code
+ * MySubscriber sub(broker, 256);
+ * Thread worker("Worker");
+ * worker.GetExecute() = [&sub]() {
+ *     if (sub.WaitForEvents(std::chrono::milliseconds(100))) {
+ *         sub.ProcessEvents();
+ *     }
+ * };
+ * \endcode
+ *
+ * Subscriptions to latest value topics (see Broker::SetLatestValue) are always handled by
+ * ProcessEvents, also for synchronous subscribers. Calling it once per frame from a GUI
+ * control's UpdateData handles at most one event per topic per frame, however often the
+ * topic is published.
+ *
+ * A synchronous subscriber is called by any thread publishing to it. A queued subscriber is only
+ * called by its owner.
+ *
+ * The destructor of the most derived class must call Detach before destroying anything
+ * HandleEvent uses. This stops new deliveries and waits for those in progress on other threads.
+ * By the time the SubscriberBase destructor runs the derived parts are already gone.
+ * \code
+ * MySubscriber::~MySubscriber()
+ * {
+ *     Detach();
+ * }
+ * \endcode
+ */
 class SubscriberBase
 {
 public:
-    virtual ~SubscriberBase() {}
+    /**
+     * \brief Construct a subscriber.
+     * \param aQueueCapacity Size of event queue, 0 to handle events on the publishing thread
+     */
+    explicit SubscriberBase(std::size_t aQueueCapacity = 0) : mpMailbox(std::make_shared<Mailbox>(*this, aQueueCapacity)) {}
+    virtual ~SubscriberBase()
+    {
+        // Publishers may still hold the mailbox, make sure they no longer reach this object.
+        Detach();
+    }
+
+    SubscriberBase(const SubscriberBase &) = delete;
+    SubscriberBase &operator=(const SubscriberBase &) = delete;
 
     /**
      * \brief Abstract handle for receiving events
      * \param arNewEvent A reference to the event to handle
      */
     virtual void HandleEvent(Event &arNewEvent) = 0;
+
+    /**
+     * \brief Handle queued events and latest values on the calling thread.
+     * \param aMaxCount Maximum number of events to handle
+     * \return Number of events handled
+     */
+    std::size_t ProcessEvents(std::size_t aMaxCount = std::numeric_limits<std::size_t>::max()) { return mpMailbox->Process(aMaxCount); }
+
+    /**
+     * \brief Wait for queued events to arrive.
+     * \param aTimeout Maximum time to wait
+     * \return True if events are ready to be processed
+     */
+    bool WaitForEvents(std::chrono::milliseconds aTimeout) { return mpMailbox->Wait(aTimeout); }
+
+    /**
+     * \brief Stop delivery of events to this subscriber, and wait for deliveries in progress
+     *        on other threads to finish. May be called from HandleEvent.
+     */
+    void Detach() { mpMailbox->Detach(); }
+
+    /**
+     * \brief Wake an event loop when events arrive that must be handled by ProcessEvents.
+     * \param apLoop Event loop running the owner of this subscriber, or nullptr
+     */
+    void SetEventLoop(rsp::utils::EventLoop *apLoop) { mpMailbox->SetEventLoop(apLoop); }
+
+    bool IsQueued() const { return mpMailbox->IsQueued(); }
+    std::size_t GetPendingCount() const { return mpMailbox->GetPending(); }
+    std::size_t GetDroppedCount() const { return mpMailbox->GetDropped(); }
+
+protected:
+    friend BrokerBase;
+    std::shared_ptr<Mailbox> mpMailbox;
 };
 
 template <typename T>
 class Subscriber : public SubscriberBase
 {
   public:
-    Subscriber(Broker<T> &arBroker) : mrBroker(arBroker) {}
+    Subscriber(Broker<T> &arBroker, std::size_t aQueueCapacity = 0) : SubscriberBase(aQueueCapacity), mrBroker(arBroker) {}
     virtual ~Subscriber()
     {
         // Here we MUST unsubscribe from the broker, since our address is no longer valid.
@@ -58,6 +143,16 @@ class Subscriber : public SubscriberBase
         mrBroker.Unsubscribe(*this, aTopic);
     }
 
+    /**
+     * \brief Get the newest event of a latest value topic, without waiting for it to be processed.
+     * \param aTopic
+     * \return Event, or empty if none
+     */
+    EventPtr GetLatest(T aTopic) const
+    {
+        return mrBroker.GetLatest(aTopic);
+    }
+
   protected:
     Broker<T> &mrBroker;
 };
@@ -0,0 +1,69 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#ifndef INCLUDE_NETWORK_HTTPAWAITABLE_H_
+#define INCLUDE_NETWORK_HTTPAWAITABLE_H_
+
+#include <coroutine>
+#include <exception>
+#include <map>
+#include <string>
+#include <string_view>
+#include <network/IHttpSession.h>
+
+namespace rsp::network {
+
+/**
+ * \brief Copy of a response, it outlives the request it came from.
+ */
+struct HttpReply {
+    int StatusCode = 0;
+    std::map<std::string, std::string> Headers{};
+    std::string Body{};
+};
+
+/**
+ * \class HttpAwaitable
+ * \brief Awaitable performing a request in a session, co_await returns the HttpReply.
+ *
+ * With an event loop set on the session, the coroutine is resumed on the loop thread when the
+ * response arrives. Otherwise the request is performed before co_await returns.
+ * If the request fails, co_await throws its error.
+ * \code
+ * HttpReply reply = co_await HttpAwaitable(session, HttpRequestType::GET, "index.html");
+ * \endcode
+ */
+class HttpAwaitable
+{
+public:
+    HttpAwaitable(IHttpSession &arSession, HttpRequestType aType, std::string_view aUri, std::string aBody = {})
+        : mrSession(arSession), mType(aType), mUri(aUri), mBody(std::move(aBody))
+    {
+    }
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> aHandle);
+    HttpReply await_resume();
+
+protected:
+    IHttpSession &mrSession;
+    HttpRequestType mType;
+    std::string mUri;
+    std::string mBody;
+    HttpReply mReply{};
+    std::exception_ptr mpError = nullptr;
+    std::coroutine_handle<> mHandle{};
+    bool mDone = false;
+    bool mSuspended = false;
+};
+
+} /* namespace rsp::network */
+
+#endif /* INCLUDE_NETWORK_HTTPAWAITABLE_H_ */
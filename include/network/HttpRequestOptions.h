@@ -12,8 +12,10 @@
 #define HTTPREQUESTOPTIONS_H
 
 #include <network/ConnectionOptions.h>
+#include <functional>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <map>
 #include <posix/FileIO.h>
 #include <utils/StructElement.h>
@@ -54,6 +56,11 @@ public:
     std::string BasicAuthPassword{};
     rsp::utils::StructElement<rsp::posix::FileIO*> WriteFile{};
     rsp::utils::StructElement<rsp::posix::FileIO*> ReadFile{};
+    /**
+     * Optional receiver of the response body, called with each chunk as it arrives.
+     * The body is then not stored in the response. Return false to abort the transfer.
+     */
+    std::function<bool(std::string_view)> BodyReceiver{};
 
     void Clear() {
         Headers.clear();
@@ -61,6 +68,7 @@ public:
         Body.clear();
         WriteFile.Clear();
         ReadFile.Clear();
+        BodyReceiver = nullptr;
     }
 };
 
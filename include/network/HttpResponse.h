@@ -51,11 +51,17 @@ public:
         return mBody;
     }
 
+    std::exception_ptr GetError() const override
+    {
+        return mpError;
+    }
+
 protected:
     IHttpRequest &mrRequest;
     int mStatusCode = 0;
     std::map<std::string, std::string> mHeaders { };
     std::string mBody { };
+    std::exception_ptr mpError = nullptr;
 };
 
 }// namespace rsp::network
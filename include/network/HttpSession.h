@@ -20,6 +20,7 @@ class HttpSession: public IHttpSession
 public:
     HttpSession(std::size_t aSize);
     void ProcessRequests() override;
+    IHttpSession& SetEventLoop(rsp::utils::EventLoop *apLoop) override;
 
     IHttpSession& SetDefaultOptions(const HttpRequestOptions &arOptions) override;
     HttpRequestOptions& GetDefaultOptions() override;
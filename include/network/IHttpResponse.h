@@ -11,6 +11,7 @@
 #ifndef I_HTTPRESPONSE_H
 #define I_HTTPRESPONSE_H
 
+#include <exception>
 #include <ostream>
 #include <map>
 #include <string>
@@ -77,6 +78,14 @@ public:
      */
     virtual const std::string& GetBody() const = 0;
 
+    /**
+     * \fn std::exception_ptr GetError()const =0
+     * \brief Get the error the request failed with. A failed request has no other content.
+     *
+     * \return Pointer to the exception, nullptr if the request succeeded
+     */
+    virtual std::exception_ptr GetError() const = 0;
+
     virtual ~IHttpResponse()
     {
     }
@@ -14,6 +14,7 @@
 
 #include <network/IHttpRequest.h>
 #include <network/HttpRequestOptions.h>
+#include <utils/EventLoop.h>
 
 namespace rsp::network {
 
@@ -32,9 +33,20 @@ public:
 
     /**
      * \brief Process all requests currently queued in the session.
+     *
+     * Blocks until all requests are done, unless an event loop is set. Then the requests are
+     * started and this returns immediately. Response callbacks are called on the loop thread.
      */
     virtual void ProcessRequests() = 0;
 
+    /**
+     * \brief Let an event loop drive the network transfers of this session.
+     *
+     * \param apLoop Event loop, or nullptr to go back to blocking ProcessRequests
+     * \return self
+     */
+    virtual IHttpSession& SetEventLoop(rsp::utils::EventLoop *apLoop) = 0;
+
     /**
      * \brief Set the default options, including headers, to use in each request
      *
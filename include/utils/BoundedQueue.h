@@ -0,0 +1,161 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#ifndef INCLUDE_UTILS_BOUNDEDQUEUE_H_
+#define INCLUDE_UTILS_BOUNDEDQUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace rsp::utils {
+
+/**
+ * \class BoundedQueue
+ * \brief Lock free queue with a fixed capacity, for any number of producer and consumer threads.
+ *
+ * Every slot in the ring has a sequence number telling if it is ready to be written or read,
+ * so producers and consumers only compete on a single atomic position each, and never wait
+ * for each other. TryPush fails when the queue is full, TryPop fails when it is empty.
+ *
+ * \tparam T Default constructible and movable type
+ */
+template <class T>
+class BoundedQueue
+{
+public:
+    /**
+     * \brief Construct a queue.
+     * \param aCapacity Minimum number of elements, rounded up to a power of two
+     */
+    explicit BoundedQueue(std::size_t aCapacity)
+        : mMask(roundUp(aCapacity) - 1),
+          mpCells(std::make_unique<Cell[]>(mMask + 1))
+    {
+        for (std::size_t i = 0 ; i <= mMask ; ++i) {
+            mpCells[i].mSequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    /**
+     * \brief Add an element to the end of the queue.
+     * \param arValue Value to move into the queue, untouched if the queue is full
+     * \return False if the queue is full
+     */
+    bool TryPush(T &arValue)
+    {
+        std::size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+        Cell *cell;
+        for (;;) {
+            cell = &mpCells[pos & mMask];
+            std::size_t seq = cell->mSequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+            if (diff == 0) {
+                if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                pos = mEnqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->mValue = std::move(arValue);
+        cell->mSequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool TryPush(T &&arValue)
+    {
+        return TryPush(arValue);
+    }
+
+    /**
+     * \brief Remove the first element of the queue.
+     * \param arValue Receives the element
+     * \return False if the queue is empty
+     */
+    bool TryPop(T &arValue)
+    {
+        std::size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+        Cell *cell;
+        for (;;) {
+            cell = &mpCells[pos & mMask];
+            std::size_t seq = cell->mSequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq - (pos + 1));
+            if (diff == 0) {
+                if (mDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                pos = mDequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+        arValue = std::move(cell->mValue);
+        cell->mValue = T();
+        cell->mSequence.store(pos + mMask + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * \brief Get the number of elements the queue can hold.
+     * \return Capacity
+     */
+    std::size_t GetCapacity() const { return mMask + 1; }
+
+    /**
+     * \brief Get the number of elements in the queue. Only a snapshot if other threads are using the queue.
+     * \return Number of elements
+     */
+    std::size_t GetSize() const
+    {
+        std::size_t tail = mDequeuePos.load(std::memory_order_acquire);
+        std::size_t head = mEnqueuePos.load(std::memory_order_acquire);
+        return (head > tail) ? (head - tail) : 0;
+    }
+
+    bool IsEmpty() const { return GetSize() == 0; }
+
+protected:
+    static constexpr std::size_t cCacheLine = 64;
+
+    struct Cell {
+        std::atomic<std::size_t> mSequence{0};
+        T mValue{};
+    };
+
+    const std::size_t mMask;
+    std::unique_ptr<Cell[]> mpCells;
+    alignas(cCacheLine) std::atomic<std::size_t> mEnqueuePos{0};
+    alignas(cCacheLine) std::atomic<std::size_t> mDequeuePos{0};
+
+    static std::size_t roundUp(std::size_t aValue)
+    {
+        std::size_t result = 2;
+        while (result < aValue) {
+            result <<= 1;
+        }
+        return result;
+    }
+};
+
+} /* namespace rsp::utils */
+
+#endif /* INCLUDE_UTILS_BOUNDEDQUEUE_H_ */
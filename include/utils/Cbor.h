@@ -0,0 +1,360 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#ifndef INCLUDE_UTILS_CBOR_H_
+#define INCLUDE_UTILS_CBOR_H_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utils/CoreException.h>
+#include <utils/Variant.h>
+
+namespace rsp::utils {
+
+/**
+ * \class ECborError
+ * \brief Thrown on malformed or unsupported CBOR input.
+ */
+class ECborError : public CoreException {
+public:
+    explicit ECborError(const std::string &aMsg) : CoreException("Cbor Error: " + aMsg) {}
+};
+
+/**
+ * \brief Adapter giving CborEncoder and CborDecoder access to a value tree.
+ *
+ * Specialized for DynamicData in DynamicData.h and for JsonValue in JsonValue.h.
+ */
+template <class T>
+struct CborTree;
+
+/**
+ * \class CborEncoder
+ * \brief Binary encoding of DynamicData and JsonValue trees as CBOR (RFC 8949).
+ *
+ * The exact Variant type of every value is kept:
+ *  - Float and Double are written as single and double precision floats.
+ *  - Uint64 and negative Int64 values are written as plain integers.
+ *  - Int, Uint32, Uint16 and non negative Int64 values are written as integers
+ *    preceded by the tag cTypeTagBase + Variant::Types. The tags are in the first come first
+ *    served range of RFC 8949 but not registered, other decoders see them as unknown tags.
+ *  - Pointer values are not streamable, encoding one throws ECborError.
+ *
+ * Several values can be encoded after each other, forming a CBOR sequence (RFC 8742).
+ * Output is either appended to a string, or passed on to a sink in chunks of
+ * about cSinkBufferSize bytes, e.g. to write to a file or socket.
+ */
+class CborEncoder
+{
+public:
+    using Sink_t = std::function<void(std::string_view)>;
+
+    static constexpr std::size_t cSinkBufferSize = 16 * 1024;
+    static constexpr std::uint64_t cTypeTagBase = 0xA500;
+
+    /**
+     * \brief Construct an encoder appending to a string.
+     * \param arResult String to append to, must outlive the encoder
+     */
+    explicit CborEncoder(std::string &arResult) : mrResult(arResult) {}
+
+    /**
+     * \brief Construct an encoder passing its output to a sink.
+     * Call Flush when done to pass on the last chunk.
+     * \param aSink Receiver of output chunks
+     */
+    explicit CborEncoder(Sink_t aSink) : mrResult(mBuffer), mSink(std::move(aSink)) {}
+
+    CborEncoder(const CborEncoder&) = delete;
+    CborEncoder& operator=(const CborEncoder&) = delete;
+
+    /**
+     * \brief Encode a value tree and its children, after any values already written.
+     * \param arValue DynamicData or JsonValue
+     * \return Reference to this
+     */
+    template <class T>
+    CborEncoder& Write(const T &arValue)
+    {
+        encodeValue(arValue);
+        return *this;
+    }
+
+    /**
+     * \brief Pass any buffered output on to the sink.
+     * \return Reference to this
+     */
+    CborEncoder& Flush();
+
+    /**
+     * \brief Encode a value tree into a new string.
+     * \param arValue DynamicData or JsonValue
+     * \return CBOR bytes
+     */
+    template <class T>
+    static std::string Encode(const T &arValue)
+    {
+        std::string result;
+        Encode(arValue, result);
+        return result;
+    }
+
+    /**
+     * \brief Encode a value tree, appending to the given string.
+     * \param arValue DynamicData or JsonValue
+     * \param arResult String to append to
+     */
+    template <class T>
+    static void Encode(const T &arValue, std::string &arResult)
+    {
+        CborEncoder(arResult).Write(arValue);
+    }
+
+    /**
+     * \brief Encode a value tree, passing the output on to a sink in chunks.
+     * \param arValue DynamicData or JsonValue
+     * \param arSink Receiver of output chunks
+     */
+    template <class T>
+    static void EncodeToSink(const T &arValue, const Sink_t &arSink)
+    {
+        CborEncoder(arSink).Write(arValue).Flush();
+    }
+
+protected:
+    std::string mBuffer{};
+    std::string &mrResult;
+    Sink_t mSink{};
+
+    void writeHead(std::uint8_t aMajor, std::uint64_t aValue);
+    void writeInteger(std::int64_t aValue);
+    void writeTyped(Variant::Types aType, std::uint64_t aValue);
+    void writeFloat(float aValue);
+    void writeDouble(double aValue);
+    void writeString(std::string_view aValue);
+    void writeScalar(const Variant &arValue);
+
+    template <class T>
+    void encodeValue(const T &arValue)
+    {
+        if (CborTree<T>::IsObject(arValue)) {
+            const auto &items = CborTree<T>::GetItems(arValue);
+            writeHead(5, items.size());
+            for (const T &item : items) {
+                writeString(CborTree<T>::GetName(item));
+                encodeValue(item);
+            }
+        }
+        else if (CborTree<T>::IsArray(arValue)) {
+            const auto &items = CborTree<T>::GetItems(arValue);
+            writeHead(4, items.size());
+            for (const T &item : items) {
+                encodeValue(item);
+            }
+        }
+        else {
+            writeScalar(arValue);
+        }
+        if (mSink && (mBuffer.size() >= cSinkBufferSize)) {
+            Flush();
+        }
+    }
+};
+
+/**
+ * \class CborDecoder
+ * \brief Decoding of CBOR (RFC 8949) into DynamicData and JsonValue trees.
+ *
+ * Values written by CborEncoder are restored with their exact Variant type.
+ * Input from other encoders is mapped as follows: integers become Uint64 or Int64
+ * like numbers decoded from Json, half and single precision floats become Float,
+ * byte and text strings become String, undefined becomes Null, and unknown tags are ignored.
+ * Indefinite length strings, arrays and maps are supported. Map keys must be strings.
+ *
+ * Input can be given at once, or fed in chunks as it arrives, e.g. from a socket:
+ * \code
+ * CborDecoder decoder;
+ * decoder.Feed(chunk);
+ * DynamicData message;
+ * while (decoder.Next(message)) {
+ *     handle(message);
+ * }
+ * \endcode
+ */
+class CborDecoder
+{
+public:
+    static constexpr unsigned int cMaxDepth = 512;
+
+    /**
+     * \brief Construct a decoder without input, use Feed to add input.
+     */
+    CborDecoder() = default;
+
+    /**
+     * \brief Construct a decoder reading from the given buffer.
+     * \param aCbor View of CBOR bytes, must stay valid while decoding
+     */
+    explicit CborDecoder(std::string_view aCbor) : mData(aCbor) {}
+
+    CborDecoder(const CborDecoder&) = delete;
+    CborDecoder& operator=(const CborDecoder&) = delete;
+
+    /**
+     * \brief Add input. The chunk is copied, it does not need to stay valid.
+     * \param aChunk
+     * \return Reference to this
+     */
+    CborDecoder& Feed(std::string_view aChunk);
+
+    /**
+     * \brief Decode the next value, if it is complete.
+     * \param arValue DynamicData or JsonValue to decode into
+     * \return False if more input is needed, arValue is then untouched
+     */
+    template <class T>
+    bool Next(T &arValue)
+    {
+        if (!isComplete()) {
+            return false;
+        }
+        arValue = T();
+        decodeValue(arValue, 0);
+        return true;
+    }
+
+    /**
+     * \brief Get the number of input bytes not yet decoded.
+     * \return Number of bytes
+     */
+    std::size_t GetPending() const { return mData.size() - mPos; }
+
+    /**
+     * \brief Decode a buffer holding exactly one value.
+     * \param aCbor CBOR bytes
+     * \return DynamicData or JsonValue
+     */
+    template <class T>
+    static T Decode(std::string_view aCbor)
+    {
+        CborDecoder decoder(aCbor);
+        T result;
+        decoder.decodeValue(result, 0);
+        if (decoder.GetPending()) {
+            THROW_WITH_BACKTRACE1(ECborError, "Unexpected content after root value.");
+        }
+        return result;
+    }
+
+protected:
+    struct Head {
+        std::uint8_t mMajor;
+        std::uint8_t mInfo;
+        std::uint64_t mValue;
+    };
+    static constexpr std::uint64_t cTypeTagBase = CborEncoder::cTypeTagBase;
+    static constexpr std::uint64_t cIndefinite = ~std::uint64_t(0);
+
+    std::string_view mData{};
+    std::size_t mPos = 0;
+    std::string mBuffer{};
+    std::string mScratch{};
+    std::size_t mScanStart = 0;
+    std::size_t mScanPos = 0;
+    std::vector<std::uint64_t> mScanOpen{};
+
+    bool isComplete();
+    bool scanItemDone();
+    const char* need(std::size_t aSize);
+    Head readHead();
+    bool isBreak();
+    std::size_t countHint(std::uint64_t aCount) const;
+    std::string_view readString(const Head &arHead);
+    void readScalar(const Head &arHead, Variant &arValue);
+    [[noreturn]] void error(const std::string &arMsg) const;
+
+    template <class T>
+    void decodeValue(T &arValue, unsigned int aDepth)
+    {
+        Head head = readHead();
+        while (head.mMajor == 6) {
+            if (head.mValue == cTypeTagBase + static_cast<std::uint64_t>(Variant::Types::Pointer)) {
+                error("Pointer values are not streamable.");
+            }
+            if ((head.mValue >= cTypeTagBase) && ((head.mValue - cTypeTagBase) < static_cast<std::uint64_t>(Variant::Types::Pointer))) {
+                readTyped(static_cast<Variant::Types>(head.mValue - cTypeTagBase), arValue);
+                return;
+            }
+            head = readHead();
+        }
+
+        switch (head.mMajor) {
+            case 2:
+            case 3:
+                CborTree<T>::SetString(arValue, readString(head));
+                break;
+
+            case 4:
+            case 5:
+                if (++aDepth > cMaxDepth) {
+                    error("Maximum nesting depth exceeded.");
+                }
+                if (head.mMajor == 4) {
+                    decodeArray(arValue, head.mValue, aDepth);
+                }
+                else {
+                    decodeObject(arValue, head.mValue, aDepth);
+                }
+                break;
+
+            default:
+                readScalar(head, arValue);
+                break;
+        }
+    }
+
+    template <class T>
+    void decodeArray(T &arValue, std::uint64_t aCount, unsigned int aDepth)
+    {
+        CborTree<T>::MakeContainer(arValue, false, countHint(aCount));
+        if (aCount == cIndefinite) {
+            while (!isBreak()) {
+                decodeValue(CborTree<T>::AddItem(arValue), aDepth);
+            }
+            return;
+        }
+        for (std::uint64_t i = 0 ; i < aCount ; ++i) {
+            decodeValue(CborTree<T>::AddItem(arValue), aDepth);
+        }
+    }
+
+    template <class T>
+    void decodeObject(T &arValue, std::uint64_t aCount, unsigned int aDepth)
+    {
+        CborTree<T>::MakeContainer(arValue, true, countHint(aCount));
+        for (std::uint64_t i = 0 ; (aCount == cIndefinite) ? !isBreak() : (i < aCount) ; ++i) {
+            Head key = readHead();
+            if ((key.mMajor != 2) && (key.mMajor != 3)) {
+                error("Map key is not a string.");
+            }
+            decodeValue(CborTree<T>::AddMember(arValue, readString(key)), aDepth);
+        }
+        CborTree<T>::EndObject(arValue);
+    }
+
+    void readTyped(Variant::Types aType, Variant &arValue);
+};
+
+} /* namespace rsp::utils */
+
+#endif /* INCLUDE_UTILS_CBOR_H_ */
@@ -0,0 +1,407 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#ifndef INCLUDE_UTILS_COROUTINE_H_
+#define INCLUDE_UTILS_COROUTINE_H_
+
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include "EventLoop.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+
+namespace rsp::utils {
+
+template <class T = void>
+class Task;
+
+namespace detail {
+
+/**
+ * \brief Promise parts shared by all Task types.
+ *
+ * Tasks start suspended. When one finishes it transfers control directly to the coroutine
+ * awaiting it, so long chains of tasks completing at once do not grow the stack.
+ */
+class TaskPromiseBase
+{
+public:
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+
+        template <class P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> aHandle) noexcept
+        {
+            std::coroutine_handle<> next = aHandle.promise().mContinuation;
+            return next ? next : std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() noexcept { mpException = std::current_exception(); }
+
+    std::coroutine_handle<> mContinuation{};
+
+protected:
+    std::exception_ptr mpException = nullptr;
+
+    void rethrow() const
+    {
+        if (mpException) {
+            std::rethrow_exception(mpException);
+        }
+    }
+};
+
+template <class T>
+class TaskPromise : public TaskPromiseBase
+{
+public:
+    Task<T> get_return_object() noexcept;
+
+    template <class U>
+    void return_value(U &&aValue) { mValue.emplace(std::forward<U>(aValue)); }
+
+    T result()
+    {
+        rethrow();
+        return std::move(*mValue);
+    }
+
+protected:
+    std::optional<T> mValue{};
+};
+
+template <>
+class TaskPromise<void> : public TaskPromiseBase
+{
+public:
+    Task<void> get_return_object() noexcept;
+
+    void return_void() const noexcept {}
+
+    void result() { rethrow(); }
+};
+
+} /* namespace detail */
+
+/**
+ * \class Task
+ * \brief Coroutine returning a value of type T, run when it is awaited.
+ *
+ * Lets asynchronous flows be written as sequential code. Tasks awaiting the awaitables below
+ * run on an EventLoop, so they never block the thread running it:
+ * \code
+ * Task<std::string> fetchConfig(EventLoop &arLoop, IHttpSession &arSession)
+ * {
+ *     HttpReply reply = co_await HttpAwaitable(arSession, HttpRequestType::GET, "config.json");
+ *     co_await Delay(arLoop, std::chrono::milliseconds(100));
+ *     std::string text = co_await Offload(arLoop, [&reply]() { return decrypt(reply.Body); });
+ *     co_return text;
+ * }
+ *
+ * Task<> applyConfig(EventLoop &arLoop, IHttpSession &arSession)
+ * {
+ *     Apply(co_await fetchConfig(arLoop, arSession));
+ * }
+ *
+ * Spawn(loop, applyConfig(loop, session));
+ * \endcode
+ *
+ * A task is owned by its Task object and destroyed with it, so it must not be destroyed while
+ * suspended in an awaitable.
+ */
+template <class T>
+class Task
+{
+public:
+    using promise_type = detail::TaskPromise<T>;
+    using Handle_t = std::coroutine_handle<promise_type>;
+
+    Task() noexcept = default;
+    explicit Task(Handle_t aHandle) noexcept : mHandle(aHandle) {}
+    Task(Task &&arOther) noexcept : mHandle(std::exchange(arOther.mHandle, {})) {}
+    Task& operator=(Task &&arOther) noexcept
+    {
+        if (this != &arOther) {
+            destroy();
+            mHandle = std::exchange(arOther.mHandle, {});
+        }
+        return *this;
+    }
+    ~Task() { destroy(); }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    /**
+     * \brief Run the task on the calling thread until it first suspends.
+     *        Use instead of co_await when the caller is not a coroutine.
+     */
+    void Start()
+    {
+        if (mHandle && !mHandle.done()) {
+            mHandle.resume();
+        }
+    }
+
+    bool IsDone() const noexcept { return !mHandle || mHandle.done(); }
+
+    /**
+     * \brief Get the result of a finished task.
+     * \return Value of co_return
+     * \throws The exception thrown by the task
+     */
+    T Get() { return mHandle.promise().result(); }
+
+    auto operator co_await() && noexcept
+    {
+        struct Awaiter {
+            Handle_t mHandle;
+
+            bool await_ready() const noexcept { return !mHandle || mHandle.done(); }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> aAwaiting) noexcept
+            {
+                mHandle.promise().mContinuation = aAwaiting;
+                return mHandle;
+            }
+
+            T await_resume() { return mHandle.promise().result(); }
+        };
+        return Awaiter{mHandle};
+    }
+
+protected:
+    Handle_t mHandle{};
+
+    void destroy() noexcept
+    {
+        if (mHandle) {
+            mHandle.destroy();
+            mHandle = {};
+        }
+    }
+};
+
+namespace detail {
+
+template <class T>
+Task<T> TaskPromise<T>::get_return_object() noexcept
+{
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept
+{
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+} /* namespace detail */
+
+/**
+ * \brief Run a task on an event loop without waiting for it.
+ *
+ * The task starts from the loop, so this may be called from any thread. An exception
+ * escaping the task is rethrown from EventLoop::RunOnce.
+ *
+ * \param arLoop Event loop
+ * \param aTask Task, owned by the loop until it finishes
+ */
+void Spawn(EventLoop &arLoop, Task<> aTask);
+
+/**
+ * \brief Run an event loop until a task has finished. Must be called on the loop thread.
+ * \param arLoop Event loop
+ * \param aTask Task
+ * \return Result of the task
+ */
+template <class T>
+T SyncWait(EventLoop &arLoop, Task<T> aTask)
+{
+    aTask.Start();
+    while (!aTask.IsDone()) {
+        arLoop.RunOnce();
+    }
+    return aTask.Get();
+}
+
+/**
+ * \class SwitchToLoop
+ * \brief Awaitable resuming the coroutine on the thread running an event loop.
+ */
+class SwitchToLoop
+{
+public:
+    explicit SwitchToLoop(EventLoop &arLoop) noexcept : mrLoop(arLoop) {}
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> aHandle);
+    void await_resume() const noexcept {}
+
+protected:
+    EventLoop &mrLoop;
+};
+
+/**
+ * \class SwitchToPool
+ * \brief Awaitable resuming the coroutine on a thread pool worker.
+ */
+class SwitchToPool
+{
+public:
+    explicit SwitchToPool(ThreadPool &arPool) noexcept : mrPool(arPool) {}
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> aHandle);
+    void await_resume() const noexcept {}
+
+protected:
+    ThreadPool &mrPool;
+};
+
+inline SwitchToLoop SwitchTo(EventLoop &arLoop) noexcept { return SwitchToLoop(arLoop); }
+inline SwitchToPool SwitchTo(ThreadPool &arPool) noexcept { return SwitchToPool(arPool); }
+
+/**
+ * \class DelayAwaiter
+ * \brief Awaitable suspending the coroutine for a period of time, using a TimerQueue timer.
+ *
+ * The coroutine is resumed on the loop, which must poll the timers, see EventLoop::PollTimers.
+ */
+class DelayAwaiter
+{
+public:
+    DelayAwaiter(EventLoop &arLoop, std::chrono::milliseconds aDelay) : mrLoop(arLoop), mDelay(aDelay) {}
+
+    bool await_ready() const noexcept { return mDelay.count() <= 0; }
+    void await_suspend(std::coroutine_handle<> aHandle);
+    void await_resume() const noexcept {}
+
+protected:
+    EventLoop &mrLoop;
+    std::chrono::milliseconds mDelay;
+    Timer mTimer{};
+};
+
+inline DelayAwaiter Delay(EventLoop &arLoop, std::chrono::milliseconds aDelay)
+{
+    return DelayAwaiter(arLoop, aDelay);
+}
+
+/**
+ * \class FdAwaiter
+ * \brief Awaitable suspending the coroutine until a file descriptor is ready.
+ *
+ * co_await returns the ready events, see EventLoop::AddFd. The descriptor must not be watched
+ * by the loop already.
+ */
+class FdAwaiter
+{
+public:
+    FdAwaiter(EventLoop &arLoop, int aFd, std::uint32_t aEvents) : mrLoop(arLoop), mFd(aFd), mEvents(aEvents) {}
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> aHandle);
+    std::uint32_t await_resume() const noexcept { return mEvents; }
+
+protected:
+    EventLoop &mrLoop;
+    int mFd;
+    std::uint32_t mEvents;
+};
+
+inline FdAwaiter WaitFd(EventLoop &arLoop, int aFd, std::uint32_t aEvents = EventLoop::cReadable)
+{
+    return FdAwaiter(arLoop, aFd, aEvents);
+}
+
+/**
+ * \class OffloadAwaiter
+ * \brief Awaitable running a function on a thread pool, and resuming the coroutine with its
+ *        result on the loop.
+ *
+ * co_await returns the result of the function, or rethrows its exception.
+ */
+template <class F>
+class OffloadAwaiter
+{
+public:
+    using Result_t = std::invoke_result_t<F&>;
+
+    OffloadAwaiter(EventLoop &arLoop, ThreadPool &arPool, F aFunction)
+        : mrLoop(arLoop), mrPool(arPool), mFunction(std::move(aFunction))
+    {
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> aHandle)
+    {
+        mrPool.Post([this, aHandle]() {
+            try {
+                if constexpr (std::is_void_v<Result_t>) {
+                    mFunction();
+                }
+                else {
+                    mResult.template emplace<1>(mFunction());
+                }
+            }
+            catch (...) {
+                mResult.template emplace<2>(std::current_exception());
+            }
+            mrLoop.Post([aHandle]() { aHandle.resume(); });
+        });
+    }
+
+    Result_t await_resume()
+    {
+        if (mResult.index() == 2) {
+            std::rethrow_exception(std::get<2>(mResult));
+        }
+        if constexpr (!std::is_void_v<Result_t>) {
+            return std::move(std::get<1>(mResult));
+        }
+    }
+
+protected:
+    using Value_t = std::conditional_t<std::is_void_v<Result_t>, std::monostate, Result_t>;
+
+    EventLoop &mrLoop;
+    ThreadPool &mrPool;
+    F mFunction;
+    std::variant<std::monostate, Value_t, std::exception_ptr> mResult{};
+};
+
+/**
+ * \brief Run a function on a thread pool while the coroutine is suspended.
+ * \param arLoop Loop to resume the coroutine on
+ * \param aFunction Function without arguments
+ * \param arPool Thread pool to run the function on
+ * \return Awaitable
+ */
+template <class F>
+OffloadAwaiter<F> Offload(EventLoop &arLoop, F aFunction, ThreadPool &arPool = ThreadPool::GetDefault())
+{
+    return OffloadAwaiter<F>(arLoop, arPool, std::move(aFunction));
+}
+
+} /* namespace rsp::utils */
+
+#endif /* INCLUDE_UTILS_COROUTINE_H_ */
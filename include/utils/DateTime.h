@@ -101,7 +101,7 @@ public:
     /**
      * \brief Construct from the given string, using the given format.
      * \param arTimeString
-     * \param apFormat Same format as for std::get_time, if last format character is '.', then fractional seconds are parsed also.
+     * \param apFormat Same format as for strptime, if last format character is '.', then fractional seconds are parsed also.
      */
     DateTime(const std::string &arTimeString, const char *apFormat);
     /**
@@ -207,7 +207,7 @@ public:
 
     /**
      * \brief Format the timestamp to a string using the given format.
-     * \see std::put_time for format. Extension: If final character is a '.', a 3 digit millisecond part is appended.
+     * \see strftime for format. Extension: If final character is a '.', a 3 digit millisecond part is appended.
      * \param apFormat
      * \return string
      */
@@ -226,7 +226,22 @@ public:
     std::string ToHTTP() const;
 
     /**
-     * \brief Decode the given string, using the given format. \see std::get_time for supported format.
+     * \brief Length of the logging format "YYYY-MM-DD hh:mm:ss.mmm"
+     */
+    static constexpr std::size_t cLoggingLength = 23;
+
+    /**
+     * \brief Write the timestamp in logging format to the given buffer, without any allocations.
+     *
+     * Exactly cLoggingLength characters are written, no zero terminator is added.
+     *
+     * \param apBuffer Buffer with room for at least cLoggingLength characters
+     * \return Pointer to the character following the last written character
+     */
+    char* FormatLogging(char *apBuffer) const;
+
+    /**
+     * \brief Decode the given string, using the given format. \see strptime for supported format.
      * \param arTimeString
      * \param apFormat
      * \return self
@@ -248,7 +263,7 @@ protected:
     std::chrono::system_clock::time_point mTp{};
 
     std::chrono::system_clock::duration decodeFractions(uint64_t aFractions) const;
-    std::ostream& encodeFractions(std::ostream& os, std::chrono::system_clock::time_point aTp) const;
+    char* encodeFractions(char *apBuffer, std::chrono::system_clock::time_point aTp) const;
 
 private:
     std::chrono::seconds getTimezoneOffset(std::tm &arTm) const;
@@ -10,6 +10,7 @@
 #include <string>
 #include <string_view>
 #include <utils/CoreException.h>
+#include <utils/MemberIndex.h>
 #include "Variant.h"
 
 namespace rsp::utils {
@@ -33,6 +34,8 @@ public:
     explicit EDynamicTypeError(const std::string &aMsg) : EDynamicDataException("Json Type Error: " + aMsg) {}
 };
 
+template <class T>
+struct CborTree;
 
 /**
  * \class DynamicData
@@ -41,6 +44,8 @@ public:
  * Custom types needs to be added as Variant::Pointer elements, so they will have external ownership and are
  * not streamable.
  *
+ * Object members are kept in insertion order. Objects with many members maintain a hash index
+ * of the member names, so lookups stay O(1) on average.
  */
 class DynamicData: public Variant
 {
@@ -53,8 +58,14 @@ public:
      */
     DynamicData() : Variant() {}
 
+    /**
+     * \brief Constructs an empty object or array, other types give a null value
+     * \param aType Types::Object or Types::Array
+     */
+    explicit DynamicData(Types aType);
+
     DynamicData(const DynamicData&);
-    DynamicData(DynamicData&&);
+    DynamicData(DynamicData&&) noexcept;
     /**
      * \brief Construct a DynamicData holding the given value
      * \tparam T Type of value to contain
@@ -68,7 +79,7 @@ public:
     virtual ~DynamicData() {}
 
     DynamicData& operator=(const DynamicData&);
-    DynamicData& operator=(DynamicData&&);
+    DynamicData& operator=(DynamicData&&) noexcept;
     /**
      * \brief Assign all types supported by Variant class
      *
@@ -220,12 +231,16 @@ public:
         return !((*this) == arOther);
     }
 
-    const std::string GetName() const { return mName; }
+    const std::string& GetName() const { return mName; }
     const std::vector<DynamicData>& GetItems() const { return mItems; }
 
 protected:
+    friend CborTree<DynamicData>;
     std::string mName{}; // Name if this value is an object member
     std::vector<DynamicData> mItems{}; // Owned list, used if this is of type object or array.
+    MemberIndex mIndex{}; // Index of mItems by name, used if this is of type object.
+
+    std::size_t findMember(std::string_view aKey) const;
 
     void tryArray() const;
     void tryObject() const;
@@ -235,6 +250,43 @@ protected:
 
 std::ostream& operator<< (std::ostream& os, const DynamicData& arValue);
 
+/**
+ * \brief Direct access to the tree for CborEncoder and CborDecoder.
+ */
+template <>
+struct CborTree<DynamicData>
+{
+    static bool IsObject(const DynamicData &arData) { return arData.IsObject(); }
+    static bool IsArray(const DynamicData &arData) { return arData.IsArray(); }
+    static const std::vector<DynamicData>& GetItems(const DynamicData &arData) { return arData.mItems; }
+    static std::string_view GetName(const DynamicData &arData) { return arData.mName; }
+
+    static void SetString(DynamicData &arData, std::string_view aValue)
+    {
+        arData.setString(aValue);
+    }
+
+    static void MakeContainer(DynamicData &arData, bool aObject, std::size_t aReserve)
+    {
+        arData.mType = aObject ? Variant::Types::Object : Variant::Types::Array;
+        arData.mItems.reserve(aReserve);
+    }
+
+    static DynamicData& AddItem(DynamicData &arData) { return arData.mItems.emplace_back(); }
+
+    static DynamicData& AddMember(DynamicData &arData, std::string_view aName)
+    {
+        DynamicData &result = arData.mItems.emplace_back();
+        result.mName.assign(aName);
+        return result;
+    }
+
+    static void EndObject(DynamicData &arData)
+    {
+        arData.mIndex.Rebuild(arData.mItems.size(), [&arData](std::size_t i) -> std::string_view { return arData.mItems[i].mName; });
+    }
+};
+
 } /* namespace rsp::utils */
 
 #endif /* INCLUDE_UTILS_DYNAMICDATA_H_ */
@@ -0,0 +1,159 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#ifndef INCLUDE_UTILS_EVENTLOOP_H_
+#define INCLUDE_UTILS_EVENTLOOP_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "Function.h"
+
+namespace rsp::utils {
+
+/**
+ * \class EventLoop
+ * \brief Reactor dispatching file descriptor readiness, signals, timers and posted closures.
+ *
+ * The loop sleeps in epoll_wait until one of its file descriptors is ready, a TimerQueue timer
+ * expires, a signal arrives or another thread posts a closure, so an idle loop uses no CPU.
+ * All callbacks are called on the thread running the loop:
+ * \code
+ * EventLoop loop;
+ * loop.PollTimers();
+ * loop.AddSignal(SIGTERM, [&loop](int) { loop.Stop(); });
+ * loop.AddFd(socket, EventLoop::cReadable, [](std::uint32_t aEvents) { ... });
+ * worker = std::thread([&loop]() { loop.Post([]() { ... }); });
+ * loop.Run();
+ * \endcode
+ *
+ * Post, Wakeup and Stop may be called from any thread, all other methods only from the thread
+ * running the loop, or before it is started.
+ */
+class EventLoop
+{
+public:
+    using FdCallback_t = Function<void(std::uint32_t aEvents)>;
+    using SignalCallback_t = Function<void(int aSignal)>;
+    using Task_t = Function<void()>;
+
+    /**
+     * \brief Event flags, same values as the EPOLL flags.
+     */
+    static constexpr std::uint32_t cReadable = 0x001;
+    static constexpr std::uint32_t cWritable = 0x004;
+    static constexpr std::uint32_t cError = 0x008;
+    static constexpr std::uint32_t cHangup = 0x010;
+
+    static constexpr std::chrono::milliseconds cForever{-1};
+
+    EventLoop();
+    ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    /**
+     * \brief Call a function whenever a file descriptor is ready.
+     *
+     * Regular files can not be waited for and are rejected by the kernel with EPERM.
+     *
+     * \param aFd File descriptor, still owned by the caller
+     * \param aEvents Combination of cReadable and cWritable
+     * \param aCallback Called with the ready events, cError and cHangup are always reported
+     * \throws std::system_error if the descriptor can not be added
+     */
+    EventLoop& AddFd(int aFd, std::uint32_t aEvents, FdCallback_t aCallback);
+    EventLoop& ModifyFd(int aFd, std::uint32_t aEvents);
+
+    /**
+     * \brief Stop watching a file descriptor. Must be called before the descriptor is closed.
+     * \param aFd File descriptor
+     */
+    EventLoop& RemoveFd(int aFd);
+
+    /**
+     * \brief Handle a signal in the loop instead of in a signal handler.
+     *
+     * The signal is blocked for the calling thread, so this should be called before other
+     * threads are started, or those threads could still receive the signal.
+     *
+     * \param aSignal Signal number, e.g. SIGTERM
+     * \param aCallback Called on the loop thread each time the signal arrives
+     */
+    EventLoop& AddSignal(int aSignal, SignalCallback_t aCallback);
+
+    /**
+     * \brief Poll the TimerQueue singleton, sleeping exactly until the next timer expires.
+     * \param aOn False to stop polling timers
+     */
+    EventLoop& PollTimers(bool aOn = true);
+
+    /**
+     * \brief Run a closure on the loop thread. Safe to call from any thread.
+     * \param aTask Closure
+     */
+    void Post(Task_t aTask);
+
+    /**
+     * \brief Make the loop return from a blocking wait. Safe to call from any thread.
+     */
+    void Wakeup();
+
+    /**
+     * \brief Wait for events and dispatch them, at most once.
+     * \param aMaxWait Maximum time to wait, cForever to wait until something happens
+     * \return Number of file descriptor events, signals, timers and closures handled, plus one
+     *         if Wakeup was called
+     */
+    std::size_t RunOnce(std::chrono::milliseconds aMaxWait = cForever);
+
+    /**
+     * \brief Dispatch events until Stop is called.
+     */
+    void Run();
+
+    /**
+     * \brief Make Run return. Safe to call from any thread.
+     */
+    void Stop();
+
+    bool IsStopped() const { return mStopped; }
+
+protected:
+    static constexpr int cMaxEvents = 32;
+
+    int mEpollFd = -1;
+    int mWakeFd = -1;
+    int mSignalFd = -1;
+    std::unordered_map<int, FdCallback_t> mHandlers{};
+    std::unordered_map<int, SignalCallback_t> mSignalHandlers{};
+    std::vector<int> mBlockedSignals{};
+    bool mPollTimers = false;
+    std::atomic<bool> mStopped = false;
+
+    std::mutex mMutex{};
+    std::vector<Task_t> mTasks{};
+    std::vector<Task_t> mRunning{};
+    bool mSleeping = false;
+    bool mWoken = false;
+
+    int waitTimeout(std::chrono::milliseconds aMaxWait, bool &arWoken);
+    void signalWakeFd();
+    std::size_t dispatchSignals();
+    std::size_t runTasks();
+};
+
+} /* namespace rsp::utils */
+
+#endif /* INCLUDE_UTILS_EVENTLOOP_H_ */
@@ -12,127 +12,240 @@
 #define INCLUDE_UTILS_FUNCTION_H_
 
 #include <atomic>
+#include <cstddef>
 #include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 namespace rsp::utils {
 
 template<typename Res, typename ... ArgTypes>
 class Function;
 
-
+/**
+ * \class Function
+ * \brief Callable wrapper, lighter than std::function.
+ *
+ * Small trivially copyable callables that can be called as const, i.e. function pointers and
+ * lambdas capturing nothing or only a few pointers or references, are stored inside the object,
+ * so creating, copying and calling them never allocates. Copying them can not have side effects.
+ *
+ * Other callables, e.g. mutable lambdas, lambdas capturing objects with state, or move only
+ * objects, are stored on the heap and shared by all copies of the Function, through a
+ * reference count. Copies therefore always behave as the same callable.
+ *
+ * Null function pointers and empty std::function objects make an empty Function. Calling an
+ * empty Function does nothing and returns a default constructed result.
+ */
 template<typename Res, typename ... ArgTypes>
-class Function<Res(ArgTypes...)> : private std::function<Res(ArgTypes...)>
+class Function<Res(ArgTypes...)>
 {
-private:
-    struct WrapperBase
-    {
-        std::atomic_int refcount;
+public:
+    static constexpr std::size_t cInlineSize = 4 * sizeof(void*);
 
-        virtual Res Execute(ArgTypes ... args) = 0;
+    Function() noexcept
+    {
+    }
 
-        WrapperBase()
-            : refcount(1)
-        {
+    template<class F> requires (!std::is_same_v<std::decay_t<F>, Function> && std::is_invocable_v<std::decay_t<F>&, ArgTypes...>)
+    Function(F &&aFn)
+    {
+        using Fn = std::decay_t<F>;
+        if constexpr (std::is_pointer_v<Fn> || std::is_member_pointer_v<Fn>) {
+            if (aFn == nullptr) {
+                return;
+            }
         }
-        virtual ~WrapperBase()
-        {
+        else if constexpr (isStdFunction<Fn>::value) {
+            if (!aFn) {
+                return;
+            }
         }
-    };
-
-    template<class F>
-    struct Wrapper: WrapperBase
-    {
-        F fn;
-        virtual Res Execute(ArgTypes ... args)
-        {
-            return fn(args...);
+        if constexpr (isInline<Fn>()) {
+            ::new (static_cast<void*>(mStorage)) Fn(std::forward<F>(aFn));
+            mpOps = &cInlineOps<Fn>;
         }
-
-        Wrapper(F &&aFn)
-            : fn(std::move(aFn))
-        {
+        else {
+            setShared(new Shared<Fn>(std::forward<F>(aFn)));
+            mpOps = &cSharedOps<Fn>;
         }
-    };
+    }
 
-    WrapperBase *ptr = nullptr;
+    ~Function()
+    {
+        Clear();
+    }
 
-    static void _free(WrapperBase *aPtr)
+    Function(const Function &arOther)
     {
-        if (aPtr && --aPtr->refcount == 0) {
-            delete aPtr;
+        if (arOther.mpOps) {
+            arOther.mpOps->mCopy(arOther, *this);
+            mpOps = arOther.mpOps;
         }
     }
 
-    void _copy(const Function &arOther)
+    Function& operator=(const Function &arOther)
     {
-        ptr = arOther.ptr;
-        if (ptr) {
-            ptr->refcount++;
+        if (&arOther != this) {
+            Function copy(arOther);
+            *this = std::move(copy);
         }
+        return *this;
     }
 
-public:
-    Function()
+    Function(Function &&arOther) noexcept
     {
+        take(arOther);
     }
 
-    template<class F> Function(F fn)
+    Function& operator=(Function &&arOther) noexcept
     {
-        ptr = new Wrapper<F>(std::move(fn));
+        if (&arOther != this) {
+            Clear();
+            take(arOther);
+        }
+        return *this;
     }
 
-    ~Function()
+    Res operator()(ArgTypes ... args) const
     {
-        _free(ptr);
+        if (!mpOps) {
+            return Res();
+        }
+        return mpOps->mInvoke(*this, std::forward<ArgTypes>(args)...);
     }
 
-    Function(const Function &arOther) : std::function<Res(ArgTypes...)>(arOther)
+    operator bool() const
     {
-        _copy(arOther);
+        return (mpOps != nullptr);
     }
 
-    Function& operator=(const Function &arOther)
+    void Clear()
     {
-        if (&arOther != this) {
-            auto b = ptr;
-            _copy(arOther);
-            _free(b);
+        if (mpOps) {
+            mpOps->mDestroy(*this);
+            mpOps = nullptr;
         }
-        return *this;
     }
 
-    Function(Function &&arOther)
+protected:
+    /**
+     * \brief Type erased operations on the stored callable.
+     */
+    struct Ops {
+        Res (*mInvoke)(const Function &arSelf, ArgTypes&& ... args);
+        void (*mCopy)(const Function &arFrom, Function &arTo);
+        void (*mMove)(Function &arFrom, Function &arTo) noexcept;
+        void (*mDestroy)(Function &arSelf) noexcept;
+    };
+
+    template<class F>
+    struct Shared {
+        std::atomic_int mRefCount{1};
+        F mFn;
+
+        explicit Shared(F &&aFn) : mFn(std::move(aFn)) {}
+        explicit Shared(const F &arFn) : mFn(arFn) {}
+    };
+
+    alignas(void*) unsigned char mStorage[cInlineSize]{};
+    const Ops *mpOps = nullptr;
+
+    template<class F>
+    struct isStdFunction : std::false_type {};
+
+    template<class Sig>
+    struct isStdFunction<std::function<Sig>> : std::true_type {};
+
+    template<class F>
+    static constexpr bool isInline()
     {
-        if (&arOther != this) {
-            ptr = arOther.ptr;
-            arOther.ptr = nullptr;
-        }
+        constexpr bool captureless = std::is_empty_v<F> && std::is_convertible_v<F, Res(*)(ArgTypes...)>;
+        return sizeof(F) <= cInlineSize && alignof(F) <= alignof(void*)
+            && (std::is_trivially_copyable_v<F> || std::is_pointer_v<F> || captureless)
+            && std::is_nothrow_move_constructible_v<F> && std::is_copy_constructible_v<F>
+            && std::is_invocable_v<const F&, ArgTypes...>;
     }
 
-    Function& operator=(Function &&arOther)
+    template<class F>
+    static Res call(F &arFn, ArgTypes&& ... args)
     {
-        if (&arOther != this) {
-            _free(ptr);
-            ptr = arOther.ptr;
-            arOther.ptr = nullptr;
+        // std::invoke only for member pointers, its noexcept specification trips -Wnoexcept
+        if constexpr (std::is_member_pointer_v<std::remove_const_t<F>>) {
+            return static_cast<Res>(std::invoke(arFn, std::forward<ArgTypes>(args)...));
+        }
+        else if constexpr (std::is_void_v<Res>) {
+            arFn(std::forward<ArgTypes>(args)...);
+        }
+        else {
+            return arFn(std::forward<ArgTypes>(args)...);
         }
-        return *this;
     }
 
-    Res operator()(ArgTypes ... args) const
+    template<class F>
+    F& inlineFn() const noexcept
     {
-        return ptr ? ptr->Execute(args...) : Res();
+        return *std::launder(reinterpret_cast<F*>(const_cast<unsigned char*>(mStorage)));
     }
 
-    operator bool() const
+    template<class F>
+    Shared<F>*& sharedFn() const noexcept
     {
-        return (ptr != nullptr);
+        return *std::launder(reinterpret_cast<Shared<F>**>(const_cast<unsigned char*>(mStorage)));
     }
 
-    void Clear()
+    template<class F>
+    void setShared(Shared<F> *apShared) noexcept
     {
-        _free(ptr);
-        ptr = nullptr;
+        ::new (static_cast<void*>(mStorage)) Shared<F>*(apShared);
+    }
+
+    template<class F>
+    static constexpr Ops cInlineOps = {
+        [](const Function &arSelf, ArgTypes&& ... args) -> Res {
+            return call(std::as_const(arSelf.template inlineFn<F>()), std::forward<ArgTypes>(args)...);
+        },
+        [](const Function &arFrom, Function &arTo) {
+            ::new (static_cast<void*>(arTo.mStorage)) F(std::as_const(arFrom.template inlineFn<F>()));
+        },
+        [](Function &arFrom, Function &arTo) noexcept {
+            F &fn = arFrom.template inlineFn<F>();
+            ::new (static_cast<void*>(arTo.mStorage)) F(std::move(fn));
+            fn.~F();
+        },
+        [](Function &arSelf) noexcept {
+            arSelf.template inlineFn<F>().~F();
+        }
+    };
+
+    template<class F>
+    static constexpr Ops cSharedOps = {
+        [](const Function &arSelf, ArgTypes&& ... args) -> Res {
+            return call(arSelf.template sharedFn<F>()->mFn, std::forward<ArgTypes>(args)...);
+        },
+        [](const Function &arFrom, Function &arTo) {
+            Shared<F> *shared = arFrom.template sharedFn<F>();
+            shared->mRefCount++;
+            arTo.setShared(shared);
+        },
+        [](Function &arFrom, Function &arTo) noexcept {
+            arTo.setShared(arFrom.template sharedFn<F>());
+        },
+        [](Function &arSelf) noexcept {
+            Shared<F> *shared = arSelf.template sharedFn<F>();
+            if (--shared->mRefCount == 0) {
+                delete shared;
+            }
+        }
+    };
+
+    void take(Function &arOther) noexcept
+    {
+        if (arOther.mpOps) {
+            arOther.mpOps->mMove(arOther, *this);
+            mpOps = std::exchange(arOther.mpOps, nullptr);
+        }
     }
 };
 
@@ -141,7 +254,7 @@ Function<Res(ArgTypes...)> Method(Ptr object, Res (Class::*method)(ArgTypes...))
 {
     return [=](ArgTypes ... args)
     {
-        return (object->*method)(args...);
+        return (object->*method)(std::forward<ArgTypes>(args)...);
     };
 }
 
@@ -0,0 +1,135 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#ifndef INCLUDE_UTILS_MEMBERINDEX_H_
+#define INCLUDE_UTILS_MEMBERINDEX_H_
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "Fnv1a.h"
+
+namespace rsp::utils {
+
+/**
+ * \class MemberIndex
+ * \brief Hash index over the named members of an insertion ordered object.
+ *
+ * The members themselves are kept by the owner, e.g. in a vector, and are accessed through
+ * a NameOf functor returning the name of the member at a given position. Objects with fewer
+ * than cThreshold members are searched linearly, larger objects get an open addressing
+ * table of Fnv1a hashes and member positions, giving O(1) average lookup and insert.
+ *
+ * With duplicate names, the first member in insertion order is found, as with a linear search.
+ * The owner must call Append after adding a member and Rebuild after removing members.
+ */
+class MemberIndex
+{
+public:
+    static constexpr std::size_t cThreshold = 16;
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    /**
+     * \brief Find the position of the first member with the given name.
+     *
+     * \tparam NameOf Callable returning the name of the member at a position
+     * \param aKey Name to look for
+     * \param aCount Number of members
+     * \param aNameOf
+     * \return Position of member or npos
+     */
+    template <class NameOf>
+    std::size_t Find(std::string_view aKey, std::size_t aCount, NameOf aNameOf) const
+    {
+        if (mSlots.empty()) {
+            for (std::size_t i = 0 ; i < aCount ; ++i) {
+                if (aNameOf(i) == aKey) {
+                    return i;
+                }
+            }
+            return npos;
+        }
+
+        std::uint32_t hash = Fnv1a::Hash32(aKey);
+        for (std::size_t i = hash & mMask ; mSlots[i].mPosition ; i = (i + 1) & mMask) {
+            const Slot &slot = mSlots[i];
+            if ((slot.mHash == hash) && (aNameOf(slot.mPosition - 1) == aKey)) {
+                return slot.mPosition - 1;
+            }
+        }
+        return npos;
+    }
+
+    /**
+     * \brief Register the member just appended at the last position.
+     *
+     * \tparam NameOf
+     * \param aCount Number of members after the append
+     * \param aNameOf
+     */
+    template <class NameOf>
+    void Append(std::size_t aCount, NameOf aNameOf)
+    {
+        if (!mSlots.empty()) {
+            insert(Fnv1a::Hash32(aNameOf(aCount - 1)), aCount - 1);
+        }
+        else if (aCount >= cThreshold) {
+            Rebuild(aCount, aNameOf);
+        }
+    }
+
+    /**
+     * \brief Rebuild the index from all members.
+     *
+     * \tparam NameOf
+     * \param aCount Number of members
+     * \param aNameOf
+     */
+    template <class NameOf>
+    void Rebuild(std::size_t aCount, NameOf aNameOf)
+    {
+        Clear();
+        if (aCount < cThreshold) {
+            return;
+        }
+        resize(aCount);
+        for (std::size_t i = 0 ; i < aCount ; ++i) {
+            insert(Fnv1a::Hash32(aNameOf(i)), i);
+        }
+    }
+
+    /**
+     * \brief Drop the index, falling back to linear search.
+     */
+    void Clear() noexcept;
+
+    /**
+     * \brief Check if a hash table is in use.
+     * \return True if lookups are hashed
+     */
+    bool IsActive() const { return !mSlots.empty(); }
+
+protected:
+    struct Slot {
+        std::uint32_t mHash;
+        std::uint32_t mPosition; // Member position + 1, zero for empty slots
+    };
+
+    std::vector<Slot> mSlots{};
+    std::size_t mMask = 0;
+    std::size_t mUsed = 0;
+
+    void resize(std::size_t aCount);
+    void insert(std::uint32_t aHash, std::size_t aPosition);
+};
+
+} /* namespace rsp::utils */
+
+#endif /* INCLUDE_UTILS_MEMBERINDEX_H_ */
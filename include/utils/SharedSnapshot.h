@@ -0,0 +1,73 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#ifndef INCLUDE_UTILS_SHAREDSNAPSHOT_H_
+#define INCLUDE_UTILS_SHAREDSNAPSHOT_H_
+
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <utility>
+
+namespace rsp::utils {
+
+/**
+ * \class SharedSnapshot
+ * \brief Holder of an immutable value that is replaced as a whole.
+ *
+ * Readers get shared ownership of the current value and can use it for as long as they like,
+ * while writers build a new value and store it. The lock is only held while the pointer is
+ * copied or swapped, so readers never wait for each other, and only very briefly for a writer.
+ * The previous value is released outside the lock, when its last reader is done.
+ *
+ * Writers must serialize their read-modify-store sequences themselves.
+ *
+ * \tparam T Type of value
+ */
+template <class T>
+class SharedSnapshot
+{
+public:
+    explicit SharedSnapshot(std::shared_ptr<const T> apValue = std::make_shared<const T>())
+        : mpValue(std::move(apValue))
+    {
+    }
+
+    SharedSnapshot(const SharedSnapshot&) = delete;
+    SharedSnapshot& operator=(const SharedSnapshot&) = delete;
+
+    /**
+     * \brief Get the current value.
+     * \return Shared pointer to the value, never changed by later stores
+     */
+    std::shared_ptr<const T> Load() const
+    {
+        std::shared_lock<std::shared_mutex> lock(mMutex);
+        return mpValue;
+    }
+
+    /**
+     * \brief Replace the current value.
+     * \param apValue New value
+     */
+    void Store(std::shared_ptr<const T> apValue)
+    {
+        std::unique_lock<std::shared_mutex> lock(mMutex);
+        mpValue.swap(apValue);
+    }
+
+protected:
+    mutable std::shared_mutex mMutex{};
+    std::shared_ptr<const T> mpValue;
+};
+
+} /* namespace rsp::utils */
+
+#endif /* INCLUDE_UTILS_SHAREDSNAPSHOT_H_ */
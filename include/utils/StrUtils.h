@@ -11,9 +11,12 @@
 #ifndef SRC_UTILS_STRUTILS_H_
 #define SRC_UTILS_STRUTILS_H_
 
+#include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <chrono>
 #include <filesystem>
@@ -186,10 +189,17 @@ std::string Format(const char* apFormat, ...) __attribute__((__format__(__printf
 
 /**
  * \brief Convert a string to double. Always uses '.' as decimal point.
- * \param arString
+ * \param aString
  * \return double
  */
-double ToDouble(const std::string &arString);
+double ToDouble(std::string_view aString);
+
+/**
+ * \brief Append a unicode codepoint to a string as UTF-8.
+ * \param arResult String to append to
+ * \param aCodePoint Unicode codepoint, max. 0x10FFFF
+ */
+void AppendUtf8(std::string &arResult, std::uint32_t aCodePoint);
 
 /**
  * \brief Convert a double to string with the given precision. Always uses '.' as decimal point.
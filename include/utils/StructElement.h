@@ -8,6 +8,7 @@
  * \author      Steffen Brummer
  */
 
+#include <utility>
 #include "Nullable.h"
 
 #ifndef INCLUDE_UTILS_STRUCTELEMENT_H_
@@ -75,15 +76,15 @@ public:
      * \fn void Clear()
      * \brief Clears the content and set the type to null.
      */
-    void Clear() override        { mIsNull = true; mData = static_cast<T>(0); }
+    void Clear() override        { mIsNull = true; mData = T{}; }
 
     /**
-     * \fn T Get()const
+     * \fn const T& Get()const
      * \brief Getter that throws if content is null.
      *
      * \return T
      */
-    T Get() const {
+    const T& Get() const {
         if (mIsNull) {
             THROW_WITH_BACKTRACE(ENullValueError);
         }
@@ -115,7 +116,7 @@ public:
      *
      * \param aValue
      */
-    void Set(T aValue) { mData = aValue; mIsNull = false; }
+    void Set(T aValue) { mData = std::move(aValue); mIsNull = false; }
     /**
      * \fn StructElement<T> operator =&(const T&)
      * \brief Assignment operator that changes the content and the type.
@@ -191,6 +192,10 @@ protected:
     bool differs(bool aVal1, bool aVal2, bool) const {
         return (aVal1 != aVal2);
     }
+
+    bool differs(const std::string &arVal1, const std::string &arVal2, const std::string&) const {
+        return (arVal1 != arVal2);
+    }
 };
 
 
@@ -0,0 +1,265 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#ifndef INCLUDE_UTILS_THREADPOOL_H_
+#define INCLUDE_UTILS_THREADPOOL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "Function.h"
+
+namespace rsp::utils {
+
+/**
+ * \class ThreadPool
+ * \brief Work stealing executor running short tasks on a fixed set of worker threads.
+ *
+ * Every worker has its own queues. Tasks posted from a worker go to the worker's own queues
+ * and are run last in first out, while idle workers steal the oldest tasks from the others.
+ * Tasks posted from other threads are shared by all workers. Within each queue, tasks of
+ * higher priority are always taken first.
+ *
+ * Tasks must not block waiting for other tasks with std::future::wait, use Await or a
+ * TaskGroup, which run pending tasks while waiting.
+ *
+ * \code
+ * auto &pool = ThreadPool::GetDefault();
+ * auto bitmap = pool.Submit([]() { return Bitmap("splash.png"); });
+ * pool.ParallelFor(0, rows, [&](std::size_t aFirst, std::size_t aLast) { ... });
+ * Bitmap splash = pool.Await(bitmap);
+ * \endcode
+ */
+class ThreadPool
+{
+public:
+    using Task_t = Function<void()>;
+
+    enum class Priority { High, Normal, Low };
+
+    /**
+     * \brief Start the worker threads.
+     * \param aThreads Number of workers, 0 for one per CPU core
+     * \param aPinToCores Bind each worker to its own core
+     */
+    explicit ThreadPool(std::size_t aThreads = 0, bool aPinToCores = false);
+
+    /**
+     * \brief Run all queued tasks and stop the workers.
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * \brief Get the pool used by the library, with one worker per CPU core.
+     *        It is created on first use.
+     * \return Reference to ThreadPool
+     */
+    static ThreadPool& GetDefault();
+
+    std::size_t GetSize() const { return mWorkers.size(); }
+
+    /**
+     * \brief Check if the calling thread is one of the workers of this pool.
+     */
+    bool IsWorkerThread() const;
+
+    /**
+     * \brief Queue a task. Exceptions must not escape the task.
+     * \param aTask Function to run
+     * \param aPriority Priority of task
+     */
+    void Post(Task_t aTask, Priority aPriority = Priority::Normal);
+
+    /**
+     * \brief Queue a function and get a future for its result, or the exception it throws.
+     * \tparam F Type of function without arguments
+     * \param aFunction Function to run
+     * \param aPriority Priority of task
+     * \return Future for result
+     */
+    template <class F>
+    auto Submit(F aFunction, Priority aPriority = Priority::Normal) -> std::future<std::invoke_result_t<F&>>
+    {
+        using R = std::invoke_result_t<F&>;
+        auto task = std::make_shared<std::packaged_task<R()>>(std::move(aFunction));
+        auto result = task->get_future();
+        Post([task]() { (*task)(); }, aPriority);
+        return result;
+    }
+
+    /**
+     * \brief Wait for a future, running pending tasks meanwhile. Safe to call from a task.
+     * \param arFuture Future from Submit
+     * \return Result of the future
+     */
+    template <class R>
+    R Await(std::future<R> &arFuture)
+    {
+        while (arFuture.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            if (!RunPending()) {
+                arFuture.wait_for(cIdleWait);
+            }
+        }
+        return arFuture.get();
+    }
+
+    /**
+     * \brief Call a function for all indexes in a range, split into chunks run in parallel.
+     *
+     * The calling thread runs chunks as well, and returns when all are done. The first
+     * exception thrown by the function is rethrown.
+     *
+     * \tparam F Type of function taking the first and one past the last index of a chunk
+     * \param aBegin First index
+     * \param aEnd One past the last index
+     * \param aFunction Function to call for each chunk
+     * \param aGrain Minimum number of indexes per chunk, 0 to split evenly over the workers
+     */
+    template <class F>
+    void ParallelFor(std::size_t aBegin, std::size_t aEnd, F aFunction, std::size_t aGrain = 0);
+
+    /**
+     * \brief Run one queued task on the calling thread.
+     * \return False if no task was queued
+     */
+    bool RunPending();
+
+protected:
+    friend class TaskGroup;
+
+    static constexpr std::size_t cPriorities = 3;
+    static constexpr std::chrono::milliseconds cIdleWait{1};
+
+    struct Queues {
+        std::mutex mMutex{};
+        std::deque<Task_t> mTasks[cPriorities]{};
+    };
+
+    struct Worker {
+        Queues mQueues{};
+        std::thread mThread{};
+    };
+
+    std::vector<std::unique_ptr<Worker>> mWorkers{};
+    Queues mShared{};
+    std::atomic<std::size_t> mPending{0};
+    std::atomic<std::size_t> mSleeping{0};
+    std::atomic<bool> mStopping{false};
+    std::mutex mSleepMutex{};
+    std::condition_variable mWake{};
+
+    void run(std::size_t aIndex, bool aPin);
+    bool take(std::size_t aIndex, Task_t &arTask);
+    static bool popBack(Queues &arQueues, std::size_t aPriority, Task_t &arTask);
+    static bool popFront(Queues &arQueues, std::size_t aPriority, Task_t &arTask);
+};
+
+/**
+ * \class TaskGroup
+ * \brief Set of tasks to wait for together.
+ *
+ * Waiting runs pending tasks of the pool, so groups may be waited for inside tasks, e.g. to
+ * split work recursively.
+ */
+class TaskGroup
+{
+public:
+    explicit TaskGroup(ThreadPool &arPool = ThreadPool::GetDefault()) : mrPool(arPool) {}
+
+    /**
+     * \brief Waits for the tasks still running, any exception they throw is discarded.
+     */
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    /**
+     * \brief Queue a task in the group.
+     * \tparam F Type of function without arguments
+     * \param aFunction Function to run
+     * \param aPriority Priority of task
+     */
+    template <class F>
+    void Run(F aFunction, ThreadPool::Priority aPriority = ThreadPool::Priority::Normal)
+    {
+        mPending.fetch_add(1);
+        mrPool.Post([this, fn = std::move(aFunction)]() mutable {
+            try {
+                fn();
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(mMutex);
+                if (!mpException) {
+                    mpException = std::current_exception();
+                }
+            }
+            finish();
+        }, aPriority);
+    }
+
+    /**
+     * \brief Wait for all tasks in the group, running pending tasks meanwhile.
+     * \throws The first exception thrown by a task in the group
+     */
+    void Wait();
+
+protected:
+    ThreadPool &mrPool;
+    std::atomic<std::size_t> mPending{0};
+    std::mutex mMutex{};
+    std::condition_variable mDone{};
+    std::exception_ptr mpException = nullptr;
+
+    void finish();
+    void waitAll();
+};
+
+template <class F>
+void ThreadPool::ParallelFor(std::size_t aBegin, std::size_t aEnd, F aFunction, std::size_t aGrain)
+{
+    if (aEnd <= aBegin) {
+        return;
+    }
+    std::size_t size = aEnd - aBegin;
+    std::size_t max_chunks = GetSize() * 4;
+    std::size_t grain = std::max<std::size_t>(1, (aGrain == 0) ? (size + max_chunks - 1) / max_chunks : aGrain);
+    std::size_t chunks = std::min((size + grain - 1) / grain, max_chunks);
+    if (chunks <= 1) {
+        aFunction(aBegin, aEnd);
+        return;
+    }
+    std::size_t chunk_size = (size + chunks - 1) / chunks;
+
+    TaskGroup group(*this);
+    for (std::size_t first = aBegin + chunk_size; first < aEnd; first += chunk_size) {
+        std::size_t last = std::min(first + chunk_size, aEnd);
+        group.Run([&aFunction, first, last]() { aFunction(first, last); });
+    }
+    aFunction(aBegin, aBegin + chunk_size);
+    group.Wait();
+}
+
+} /* namespace rsp::utils */
+
+#endif /* INCLUDE_UTILS_THREADPOOL_H_ */
@@ -11,7 +11,14 @@
 #ifndef INCLUDE_UTILS_TIMER_H_
 #define INCLUDE_UTILS_TIMER_H_
 
-#include <list>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
 #include "Function.h"
 #include "Singleton.h"
 #include "RunTime.h"
@@ -23,6 +30,10 @@ class TimerQueue;
 /**
  * \class Timer
  * \brief Helper class to hold callback to be triggered after a given time.
+ *
+ * Timers can be enabled, disabled and given new timeouts from any thread, one thread at a time
+ * per timer. The callback is always called by the thread polling the TimerQueue. A timer being
+ * triggered on another thread is waited for before it is disabled or destroyed.
  */
 class Timer
 {
@@ -33,6 +44,9 @@ public:
     Timer(int aId, std::chrono::milliseconds aTimeout) : mId(aId), mTimeout(aTimeout) {}
     virtual ~Timer();
 
+    Timer(const Timer&) = delete;
+    Timer& operator=(const Timer&) = delete;
+
     Timer& SetId(int aId) { mId = aId; return *this; }
     int GetId() const { return mId; }
 
@@ -45,39 +59,103 @@ public:
     TimerCallback_t& Callback() { return mCallback; }
 
 protected:
+    static constexpr std::size_t cNotQueued = static_cast<std::size_t>(-1);
+
     int mId = 0;
-    bool mEnabled = false;
+    std::atomic<bool> mEnabled = false;
+    std::atomic<bool> mTriggering = false;
     std::chrono::milliseconds mTimeout{};
     TimerCallback_t mCallback{};
 
     friend TimerQueue;
     RunTime mTimeoutAt{};
+    std::size_t mQueueIndex = cNotQueued;
     virtual void trigger();
 };
 
 /**
  * \class TimerQueue
  * \brief Singleton class with queue for Timer objects.
+ *
+ * Enabled timers are kept in a binary min heap ordered by expiry time, and every timer knows its
+ * position in the heap. Enabling, disabling and changing the timeout of a timer are therefore
+ * O(log n), and polling costs O(log n) per expired timer. Polling never allocates memory.
+ *
+ * All methods are thread safe. Timers enabled by a callback during Poll are not triggered
+ * before the next Poll, even with a zero timeout.
  */
 class TimerQueue : public rsp::utils::Singleton<TimerQueue>
 {
 public:
     TimerQueue();
+    ~TimerQueue();
+
+    TimerQueue(const TimerQueue&) = delete;
+    TimerQueue& operator=(const TimerQueue&) = delete;
 
     /**
      * \brief Poll the timer queue to trigger expired timers
+     * \return Number of timers triggered
      */
-    void Poll();
+    std::size_t Poll();
 
     /**
      * \brief Register a Timer object in the callback queue.
      *
+     * A timer already in the queue is moved to its new expiry time.
+     *
      * \param apTimer Pointer to *Timer object
      */
     void RegisterTimer(Timer *apTimer);
     void UnregisterTimer(Timer *apTimer);
+
+    /**
+     * \brief Get the expiry time of the first timer to expire.
+     * \return Expiry time as RunTime milliseconds, or empty if no timers are enabled
+     */
+    std::optional<std::chrono::milliseconds> NextDeadline() const;
+
+    /**
+     * \brief Get the time until the first timer expires, e.g. to sleep exactly until then.
+     * \param aMax Value to return if no timer expires before
+     * \return Time to wait, zero if a timer has already expired
+     */
+    std::chrono::milliseconds TimeUntilNext(std::chrono::milliseconds aMax) const;
+
+    std::size_t GetSize() const;
+
+    /**
+     * \brief Set a function to call when a timer is armed to expire before all others, e.g. to
+     *        wake up a thread sleeping until the previous first deadline.
+     * \param aWakeup Function, called with the queue locked
+     */
+    void SetWakeup(Function<void()> aWakeup);
+
 protected:
-    std::list<Timer*> mQueue{};
+    friend Timer;
+
+    struct Entry {
+        std::int64_t mDeadline;
+        std::uint64_t mSequence;
+        Timer *mpTimer;
+    };
+
+    mutable std::mutex mMutex{};
+    std::condition_variable mTriggered{};
+    std::vector<Entry> mHeap{};
+    std::uint64_t mSequence = 0;
+    Timer *mpTriggering = nullptr;
+    std::thread::id mTriggeringThread{};
+    Function<void()> mWakeup{};
+
+    void setTimeout(Timer &arTimer, std::chrono::milliseconds aTimeout);
+    void insert(Timer &arTimer);
+    void remove(Timer &arTimer);
+    void waitForTrigger(std::unique_lock<std::mutex> &arLock, const Timer &arTimer);
+    static bool isBefore(const Entry &arA, const Entry &arB);
+    void place(std::size_t aIndex, const Entry &arEntry);
+    void siftUp(std::size_t aIndex);
+    void siftDown(std::size_t aIndex);
 };
 
 } /* namespace rsp::graphics */
@@ -13,6 +13,7 @@
 
 #include <utils/Nullable.h>
 #include <string>
+#include <string_view>
 #include "CoreException.h"
 #include <utils/StructElement.h>
 
@@ -42,6 +43,10 @@ public:
  * \class Variant
  * \brief Generic type class. Can hold all native types in the same object and often convert between them.
  *
+ * The value is a tagged union. Strings of up to cInlineCapacity characters are stored inline,
+ * longer strings in an immutable heap block shared by reference count between copies.
+ * So copying a Variant never allocates, and apart from the Nullable vtable pointer
+ * a Variant takes 24 bytes.
  */
 class Variant : public Nullable
 {
@@ -50,7 +55,7 @@ public:
      * \enum Types
      * \brief Type declaration used for each native type.
      */
-    enum class Types : std::uint32_t {Null, Bool, Int, Int64, Uint64, Uint32, Uint16, Float, Double, Pointer, String, Object, Array};
+    enum class Types : std::uint8_t {Null, Bool, Int, Int64, Uint64, Uint32, Uint16, Float, Double, Pointer, String, Object, Array};
 
     /**
      * \fn  Variant()
@@ -59,13 +64,13 @@ public:
     Variant();
 
     Variant(const Variant &arOther);
-    Variant(Variant &&arOther);
+    Variant(Variant &&arOther) noexcept;
 
     template<class T>
     Variant(const rsp::utils::StructElement<T>& arOther) : Variant(ToVariant(arOther)) {}
 
     Variant& operator=(const Variant &arOther);
-    Variant& operator=(Variant &&arOther);
+    Variant& operator=(Variant &&arOther) noexcept;
 
     template<class T>
     Variant& operator=(const rsp::utils::StructElement<T>& arOther) {
@@ -120,7 +125,7 @@ public:
      * \fn void Clear()
      * \brief Resets the Variant content to null
      */
-    void Clear() override { mType = Types::Null; }
+    void Clear() override { reset(Types::Null); }
     /**
      * \fn Types GetType()const
      * \brief Returns the current type of the Variant content.
@@ -149,7 +154,7 @@ public:
     operator double() const            { return AsDouble(); }
     operator void*() const             { return AsPointer(); }
     operator const std::string() const { return AsString(); }
-    operator const char*() const       { return AsString().c_str(); }
+    operator const char*() const;
 
     /**
      * \fn Variant operator =&(T)
@@ -184,17 +189,40 @@ public:
     void* AsPointer() const;
 
     std::int64_t RawAsInt() const { return mInt; }
+    std::string_view RawAsString() const;
+
+    static constexpr std::size_t cInlineCapacity = 15;
 
 protected:
-    Types mType;
+    struct SharedString;
+    static constexpr std::uint8_t cShared = 0xFF; // mSize value if the string is in mpShared
+
     union {
         bool mBool;
         std::int64_t mInt{0};
         float mFloat;
         double mDouble;
         uintptr_t mPointer;
+        SharedString *mpShared;
+        char mInline[cInlineCapacity + 1]; // Zero terminated
     };
-    std::string mString{};
+    std::uint8_t mSize = 0; // Length of mInline, or cShared
+    Types mType;
+
+    /**
+     * \brief Release any string storage and set a new type.
+     * \param aType
+     */
+    void reset(Types aType);
+
+    /**
+     * \brief Release any string storage and store a copy of the given string.
+     * \param aValue
+     */
+    void setString(std::string_view aValue);
+
+    void copyFrom(const Variant &arOther);
+    void moveFrom(Variant &arOther) noexcept;
 };
 
 std::ostream& operator<< (std::ostream& os, const Variant& arValue);
@@ -10,6 +10,7 @@
 
 #include <graphics/GraphicsMain.h>
 #include <chrono>
+#include <system_error>
 #include <thread>
 #include <utils/StopWatch.h>
 #include <utils/Timer.h>
@@ -50,37 +51,102 @@ void GraphicsMain::Run(int aMaxFPS, bool aPollTimers)
             rsp::utils::TimerQueue::Get().Poll();
         }
 
-        // New scene requested?
-        if (mNextScene) {
-            mrTouchParser.Flush(); // New scene should not inherit un-handled touch events...
-            mrScenes.SetActiveScene(mNextScene);
-            mNextScene = 0;
-        }
-
-        // New inputs?
         if (mrTouchParser.Poll(event)) {
-            Logger::GetDefault().Debug() << "Touch Event: " << event;
-            mrScenes.ActiveScene().ProcessInput(event);
+            processInput(event);
         }
 
-        mrScenes.ActiveScene().UpdateData();
-//        mrScenes.ActiveScene().Invalidate();
+        renderFrame();
+
+        std::chrono::milliseconds delay(std::max(std::int64_t(0), frame_time - sw.Elapsed<std::chrono::milliseconds>()));
+        if (aPollTimers) {
+            delay = rsp::utils::TimerQueue::Get().TimeUntilNext(delay);
+        }
+        std::this_thread::sleep_for(delay);
+        mFps = 1000 / std::max(std::int64_t(1), sw.Elapsed<std::chrono::milliseconds>());
+    }
+}
 
-        // Render invalidated things
-        bool changed = mrScenes.ActiveScene().Render(mrBufferedCanvas);
-        if (mpOverlay) {
-            mpOverlay->UpdateData();
-            changed |= mpOverlay->Render(mrBufferedCanvas);
-            mrBufferedCanvas.SetClipRect(mrScenes.ActiveScene().GetArea());
+void GraphicsMain::Run(rsp::utils::EventLoop &arLoop, int aMaxFPS)
+{
+    rsp::utils::StopWatch sw;
+    std::chrono::milliseconds frame_time(1000 / aMaxFPS);
+
+    int fd = mrTouchParser.GetFd();
+    bool poll_touch = (fd < 0);
+    if (!poll_touch) {
+        try {
+            arLoop.AddFd(fd, rsp::utils::EventLoop::cReadable, [this](std::uint32_t) {
+                TouchEvent event;
+                while (mrTouchParser.Poll(event)) {
+                    processInput(event);
+                }
+            });
         }
-        if (changed) {
-            mrBufferedCanvas.SwapBuffer(BufferedCanvas::SwapOperations::Copy);
+        catch (const std::system_error &) {
+            // Regular files, e.g. recorded input, can not be waited for
+            poll_touch = true;
+        }
+    }
+
+    mpLoop = &arLoop;
+    while (!mTerminated) {
+        sw.Reset();
+
+        if (poll_touch) {
+            TouchEvent event;
+            while (mrTouchParser.Poll(event)) {
+                processInput(event);
+            }
         }
 
-        int64_t delay = std::max(std::int64_t(0), frame_time - sw.Elapsed<std::chrono::milliseconds>());
-        std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+        renderFrame();
+
+        // Handle events for the rest of the frame, then sleep until something happens
+        bool active = poll_touch;
+        std::chrono::milliseconds remaining;
+        while (!mTerminated && (remaining = frame_time - std::chrono::milliseconds(sw.Elapsed<std::chrono::milliseconds>())) > std::chrono::milliseconds(0)) {
+            active |= (arLoop.RunOnce(remaining) > 0);
+        }
+        if (!active && !mTerminated) {
+            arLoop.RunOnce(rsp::utils::EventLoop::cForever);
+        }
         mFps = 1000 / std::max(std::int64_t(1), sw.Elapsed<std::chrono::milliseconds>());
     }
+    mpLoop = nullptr;
+
+    if (!poll_touch) {
+        arLoop.RemoveFd(fd);
+    }
+}
+
+void GraphicsMain::processInput(TouchEvent &arEvent)
+{
+    Logger::GetDefault().Debug() << "Touch Event: " << arEvent;
+    mrScenes.ActiveScene().ProcessInput(arEvent);
+}
+
+void GraphicsMain::renderFrame()
+{
+    // New scene requested?
+    if (mNextScene) {
+        mrTouchParser.Flush(); // New scene should not inherit un-handled touch events...
+        mrScenes.SetActiveScene(mNextScene);
+        mNextScene = 0;
+    }
+
+    mrScenes.ActiveScene().UpdateData();
+//    mrScenes.ActiveScene().Invalidate();
+
+    // Render invalidated things
+    bool changed = mrScenes.ActiveScene().Render(mrBufferedCanvas);
+    if (mpOverlay) {
+        mpOverlay->UpdateData();
+        changed |= mpOverlay->Render(mrBufferedCanvas);
+        mrBufferedCanvas.SetClipRect(mrScenes.ActiveScene().GetArea());
+    }
+    if (changed) {
+        mrBufferedCanvas.SwapBuffer(BufferedCanvas::SwapOperations::Copy);
+    }
 }
 
 } // namespace rsp::graphics
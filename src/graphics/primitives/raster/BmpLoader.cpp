@@ -14,9 +14,11 @@
 #include <string>
 #include <logging/Logger.h>
 #include <utils/CoreException.h>
+#include <utils/ThreadPool.h>
 #include "BmpLoader.h"
 
 using namespace rsp::logging;
+using namespace rsp::utils;
 
 namespace rsp::graphics
 {
@@ -161,24 +163,18 @@ void BmpLoader::ReadData(rsp::posix::FileIO &arFile)
     std::size_t h = static_cast<std::size_t>(abs(mBmpHeader.v1.heigth));
     std::size_t w = static_cast<std::size_t>(mBmpHeader.v1.width);
 
-    std::uint8_t *data = pixelRows.data();
-    if (mBmpHeader.v1.heigth < 0) { // If height is negative, then image is stored top to bottom.
-        for (std::uint32_t y = 0; y < h ; y++) {
+    // Rows are independent, so decode them in parallel. mPixelData is already sized by initAfterLoad.
+    const std::uint8_t *data = pixelRows.data();
+    bool top_down = (mBmpHeader.v1.heigth < 0); // If height is negative, then image is stored top to bottom.
+    ThreadPool::GetDefault().ParallelFor(0, h, [&](std::size_t aFirst, std::size_t aLast) {
+        for (std::size_t y = aFirst; y < aLast ; y++) {
+            auto row = static_cast<std::uint32_t>(top_down ? y : h-1-y);
             for (std::uint32_t x = 0; x < w; x++) {
-                Color color(ReadPixel(data, x, y, paddedRowSize));
+                Color color(ReadPixel(data, x, row, paddedRowSize));
                 mPixelData.SetPixelAt(GuiUnit_t(x), GuiUnit_t(y), color);
             }
         }
-    }
-    else { // Image is stored from bottom to top
-        for (std::uint32_t y = 0; y < h ; y++) {
-            for (std::uint32_t x = 0; x < w; x++) {
-                Color color(ReadPixel(data, x, h-1-y, paddedRowSize));
-                mPixelData.SetPixelAt(GuiUnit_t(x), GuiUnit_t(y), color);
-            }
-//            std::cout << std::endl;
-        }
-    }
+    });
 
     std::cout << "Loaded " << arFile.GetFileName() << " into PixelData (" << w << "x" << h << ")," << std::endl;
     mPixelData.GetPixelAt(0, 0, Color::White);
@@ -8,507 +8,399 @@
  * \author      Steffen Brummer
  */
 
+#include <charconv>
 #include <json/JsonDecoder.h>
 #include <json/JsonExceptions.h>
-#include <sstream>
-#include <logging/Logger.h>
 #include <utils/StrUtils.h>
 
 using namespace rsp::json;
 
-//#define JLOG(a) DLOG(a)
-#define JLOG(a)
+static inline bool isDigit(char c)
+{
+    return (c >= '0') && (c <= '9');
+}
 
 JsonDecoder::JsonDecoder(std::string_view aJson)
-    : std::string(aJson),
-      mIt(begin()),
-      mEnd(end())
+    : mJson(aJson)
 {
-//    JLOG("JsonString Created: " << std::distance(begin(), mIt) << ", " << getLength());
 }
 
-JsonDecoder::JsonDecoder(const JsonDecoder &arJson)
-    : std::string(arJson),
-      mIt(begin()),
-      mEnd(end())
+JsonValue JsonDecoder::GetValue()
 {
-//    JLOG("JsonString Copied: " << std::distance(begin(), mIt) << ", " << getLength());
+    JsonValue result;
+    getValue(result);
+    return result;
 }
 
-JsonDecoder& JsonDecoder::operator=(const JsonDecoder &arJson)
+void JsonDecoder::skipWhiteSpace()
 {
-    if (&arJson != this) {
-        std::string::operator=(arJson);
-        mIt = begin();
-        mEnd = end();
+    while (mPos < mJson.size()) {
+        switch (mJson[mPos]) {
+            case ' ':
+            case '\n':
+            case '\r':
+            case '\t':
+                mPos++;
+                break;
+
+            default:
+                return;
+        }
     }
-    return *this;
 }
 
-/**
- * Traverse the string to locate start and end of a substring.
- *
- * \param aToken1
- * \param aToken2
- */
-void JsonDecoder::findSubString(const char aToken1, const char aToken2)
+void JsonDecoder::expectLiteral(std::string_view aLiteral)
 {
-    JLOG("findSubString(" << aToken1 << ", " << aToken2 << "), " << debug());
-    skipWhiteSpace();
-
-    auto it = mIt;
-
-    if (it == mEnd) {
-        THROW_WITH_BACKTRACE1(EJsonParseError, "Substring was only whitespace");
+    if (mJson.substr(mPos, aLiteral.size()) != aLiteral) {
+        THROW_WITH_BACKTRACE1(EJsonParseError, "Expected " + std::string(aLiteral) + ". " + debug());
     }
+    mPos += aLiteral.size();
+}
 
-    if (*it != aToken1) {
-        THROW_WITH_BACKTRACE1(EJsonParseError, "Substring start token was not found. " + debug(false, true));
+unsigned int JsonDecoder::getHex4()
+{
+    if ((mJson.size() - mPos) < 4) {
+        THROW_WITH_BACKTRACE1(EJsonFormatError, "Unicode escape is truncated. " + debug());
     }
-    it++;
-    mIt = it;
-
-    int indent = 0;
 
-    while (it != mEnd) {
-        if (*it == aToken2) {
-            if (indent == 0) {
-                push();
-                mEnd = it;
-                JLOG("findSubString stacked: " << std::string(mIt, mEnd));
-                return;
-            }
-            else {
-                indent--;
-            }
+    unsigned int result = 0;
+    for (std::size_t end = mPos + 4 ; mPos < end ; ++mPos) {
+        char c = mJson[mPos];
+        unsigned int digit;
+        if (isDigit(c)) {
+            digit = static_cast<unsigned int>(c - '0');
         }
-        else if (*it == aToken1) {
-            indent++;
+        else if ((c >= 'a') && (c <= 'f')) {
+            digit = static_cast<unsigned int>(c - 'a') + 10;
         }
-        else if (*it == '\\') {
-            it++;
-            if (*it == 'u') {
-                it += 4; // Advance u + 4 hex digits
-            }
+        else if ((c >= 'A') && (c <= 'F')) {
+            digit = static_cast<unsigned int>(c - 'A') + 10;
+        }
+        else {
+            THROW_WITH_BACKTRACE1(EJsonFormatError, "Unicode escape is not hexadecimal. " + debug());
         }
-        it++;
+        result = (result << 4) | digit;
     }
-
-    THROW_WITH_BACKTRACE1(EJsonParseError, "End token was not found. " + aToken2);
+    return result;
 }
 
-void JsonDecoder::push()
+void JsonDecoder::getString(std::string &arResult)
 {
-    mStack.emplace_back(mEnd);
-}
+    const char *begin = mJson.data();
+    const char *end = begin + mJson.size();
+    const char *p = begin + mPos + 1; // Skip start quote
+
+    for (;;) {
+        const char *run = p;
+        while ((p < end) && (*p != '"') && (*p != '\\')) {
+            p++;
+        }
+        arResult.append(run, p);
 
-void JsonDecoder::pop()
-{
-    mEnd = mStack.back();
-    mStack.pop_back();
-}
+        if (p == end) {
+            mPos = mJson.size();
+            THROW_WITH_BACKTRACE1(EJsonParseError, "End token was not found. \"");
+        }
+        if (*p == '"') {
+            mPos = std::size_t(p - begin) + 1;
+            return;
+        }
 
-void JsonDecoder::skipWhiteSpace()
-{
-    while (mIt != mEnd) {
-        switch (*mIt) {
-            case ' ':
-            case '\n':
-            case '\r':
-            case '\t':
-                mIt++;
+        if (++p == end) {
+            mPos = mJson.size();
+            THROW_WITH_BACKTRACE1(EJsonParseError, "End token was not found. \"");
+        }
+        switch (*p) {
+            case 'u':
+            {
+                mPos = std::size_t(p - begin) + 1;
+                unsigned int u = getHex4();
+                if ((u >= 0xD800) && (u <= 0xDBFF)) { // High surrogate, must be followed by a low surrogate
+                    if (mJson.substr(mPos, 2) != "\\u") {
+                        THROW_WITH_BACKTRACE1(EJsonFormatError, "High surrogate is not followed by a low surrogate. " + debug());
+                    }
+                    mPos += 2;
+                    unsigned int low = getHex4();
+                    if ((low < 0xDC00) || (low > 0xDFFF)) {
+                        THROW_WITH_BACKTRACE1(EJsonFormatError, "High surrogate is not followed by a low surrogate. " + debug());
+                    }
+                    u = 0x10000 + ((u - 0xD800) << 10) + (low - 0xDC00);
+                }
+                else if ((u >= 0xDC00) && (u <= 0xDFFF)) {
+                    THROW_WITH_BACKTRACE1(EJsonFormatError, "Low surrogate without high surrogate. " + debug());
+                }
+                rsp::utils::StrUtils::AppendUtf8(arResult, u);
+                p = begin + mPos;
+                continue;
+            }
+
+            case '"':
+            case '\\':
+            case '/':
+                arResult += *p;
+                break;
+            case 'b':
+                arResult += '\b';
+                break;
+            case 'f':
+                arResult += '\f';
+                break;
+            case 'n':
+                arResult += '\n';
+                break;
+            case 'r':
+                arResult += '\r';
+                break;
+            case 't':
+                arResult += '\t';
                 break;
 
             default:
-                return;
+                mPos = std::size_t(p - begin);
+                THROW_WITH_BACKTRACE1(EJsonFormatError, "String contains illegal escape character. " + debug());
                 break;
         }
+        p++;
     }
 }
 
-std::string JsonDecoder::getString()
+void JsonDecoder::getObject(JsonValue &arResult)
 {
-    JLOG("getString: " << debug(false, true));
-    findSubString('"', '"');
-
-    std::string result;
-
-    while (mIt != mEnd) {
-        if (*mIt == '\\') {
-            mIt++;
-            switch (*mIt) {
-                case 'u':
-                {
-                    /**
-                     * Decoding UCS codepoint to UTF-8.
-                     * \see https://stackoverflow.com/questions/6240055/manually-converting-unicode-codepoints-into-utf-8-and-utf-16
-                     */
-                    int u = std::stoi(substr(getOffset() + 1, 4), nullptr, 16);
-                    if (u < 0x80) { // one byte binary 0xxxxxxx
-                        result += static_cast<char>(u);
-                    }
-                    else if (u < 0x800) { // two byte binary 110xxxxx 10xxxxxx
-                        result += static_cast<char>(0xC0 + ((u >> 6) & 0x1F));
-                        result += static_cast<char>(0x80 + (u & 0x3F));
-                    }
-                    else { // Three byte binary 1110xxxx 10xxxxxx 10xxxxxx
-                        result += static_cast<char>(0xE0 + ((u >> 12) & 0x0F));
-                        result += static_cast<char>(0x80 + ((u >> 6) & 0x3F));
-                        result += static_cast<char>(0x80 + (u & 0x3F));
-                    }
-                    mIt += 4;
-                    break;
-                }
+    arResult.forceObject();
+    mPos++; // Skip '{'
+    skipWhiteSpace();
 
-                case '"':
-                case '\\':
-                case '/':
-                    result += *mIt;
-                    break;
-                case 'b':
-                    result += '\b';
-                    break;
-                case 'f':
-                    result += '\f';
-                    break;
-                case 'n':
-                    result += '\n';
-                    break;
-                case 'r':
-                    result += '\r';
-                    break;
-                case 't':
-                    result += '\t';
-                    break;
-
-                default:
-                    THROW_WITH_BACKTRACE1(EJsonFormatError, "String contains illegal escape character. " + debug(false, true));
-                    break;
+    if ((mPos < mJson.size()) && (mJson[mPos] == '}')) {
+        mPos++;
+        return;
+    }
+
+    for (;;) {
+        if ((mPos >= mJson.size()) || (mJson[mPos] != '"')) {
+            if (arResult.mItems.empty()) {
+                THROW_WITH_BACKTRACE1(EJsonParseError, "Object member name was not found. " + debug());
             }
+            THROW_WITH_BACKTRACE1(EJsonParseError, "Excessive key/value delimiter found after " + arResult.mItems.back().mName + ". " + debug());
+        }
+
+        JsonValue &member = arResult.mItems.emplace_back();
+        getString(member.mName);
+        skipWhiteSpace();
+        if ((mPos >= mJson.size()) || (mJson[mPos] != ':')) {
+            THROW_WITH_BACKTRACE1(EJsonParseError, "Object key/value delimiter not found. " + debug());
+        }
+        mPos++;
+        getValue(member);
+
+        if ((mPos < mJson.size()) && (mJson[mPos] == ',')) {
+            mPos++;
+            skipWhiteSpace();
+        }
+        else if ((mPos < mJson.size()) && (mJson[mPos] == '}')) {
+            mPos++;
+            arResult.rebuildIndex();
+            return;
         }
         else {
-            result += *mIt;
+            THROW_WITH_BACKTRACE1(EJsonParseError, "End token was not found. } " + debug());
         }
-        mIt++;
     }
-    mIt = mEnd + 1;
-
-    pop();
-    JLOG("getString exit (" << result << "): " << debug());
-    return result;
 }
 
-JsonValue JsonDecoder::getObject()
+void JsonDecoder::getArray(JsonValue &arResult)
 {
-    JLOG("getObject: " << debug(false, true));
-    findSubString('{', '}');
-
-    bool element_required = false;
-
+    arResult.forceArray();
+    mPos++; // Skip '['
     skipWhiteSpace();
 
-    JsonValue result(JsonTypes::Object);
+    if ((mPos < mJson.size()) && (mJson[mPos] == ']')) {
+        mPos++;
+        return;
+    }
 
-    while (mIt != mEnd) {
-        auto name = getString();
-        skipWhiteSpace();
-//        JLOG("Object Name: " << name << ", next: " << *mIt);
-        if (*mIt != ':') {
-            THROW_WITH_BACKTRACE1(EJsonParseError, "Object key/value delimiter not found." + debug(false, true));
+    for (;;) {
+        if ((mPos < mJson.size()) && (mJson[mPos] == ']')) {
+            THROW_WITH_BACKTRACE1(EJsonParseError, "Excessive array delimiter found. " + debug());
         }
-        mIt++;
-        result.Add(name, GetValue());
-        skipWhiteSpace();
-        element_required = false;
-        if (mIt != mEnd && *mIt == ',') {
-            element_required = true;
-            mIt++;
+        getValue(arResult.mItems.emplace_back());
+
+        if ((mPos < mJson.size()) && (mJson[mPos] == ',')) {
+            mPos++;
+            skipWhiteSpace();
+        }
+        else if ((mPos < mJson.size()) && (mJson[mPos] == ']')) {
+            mPos++;
+            return;
+        }
+        else {
+            THROW_WITH_BACKTRACE1(EJsonParseError, "End token was not found. ] " + debug());
         }
     }
-    if (element_required) {
-        THROW_WITH_BACKTRACE1(EJsonParseError, "Excessive key/value delimiter found after " + result.mItems.back().mName + ":" + result.mItems.back().AsString());
-    }
-    JLOG("Skip next char: " << *mIt);
-    mIt++;
-
-    pop();
-
-    JLOG("getObject exit (" << result << "): " << debug());
-    return result;
 }
 
-JsonValue JsonDecoder::getArray()
+/*
+ * Validate the number at the current position and move past it.
+ *
+ * Exceptions are thrown if content has illegal number formatting.
+ */
+std::string_view JsonDecoder::scanNumber(bool &arIsFloat)
 {
-    JLOG("getArray: " << debug(false, true));
-    findSubString('[', ']');
-
-    bool element_required = false;
+    const char *begin = mJson.data();
+    const char *end = begin + mJson.size();
+    const char *start = begin + mPos;
+    const char *p = start;
+    arIsFloat = false;
+
+    if (*p == '-') {
+        p++;
+    }
+    if ((p == end) || !isDigit(*p)) {
+        THROW_WITH_BACKTRACE1(EJsonNumberError, "First character is not a sign or numeric.");
+    }
+    if (*p == '0') {
+        p++;
+    }
+    else {
+        while ((p < end) && isDigit(*p)) {
+            p++;
+        }
+    }
+    if ((p < end) && (*p == '.')) {
+        arIsFloat = true;
+        p++;
+        if ((p == end) || !isDigit(*p)) {
+            THROW_WITH_BACKTRACE1(EJsonNumberError, "Floating point decimal digit is not numeric.");
+        }
+        while ((p < end) && isDigit(*p)) {
+            p++;
+        }
+    }
+    if ((p < end) && ((*p == 'e') || (*p == 'E'))) {
+        arIsFloat = true;
+        p++;
+        if ((p < end) && ((*p == '+') || (*p == '-'))) {
+            p++;
+        }
+        if ((p == end) || !isDigit(*p)) {
+            THROW_WITH_BACKTRACE1(EJsonNumberError, "Floating point exponent is not numeric.");
+        }
+        while ((p < end) && isDigit(*p)) {
+            p++;
+        }
+    }
 
+    mPos = std::size_t(p - begin);
     skipWhiteSpace();
-
-    JsonValue result(JsonTypes::Array);
-
-    while (mIt != mEnd) {
-        result.Add(GetValue());
-        skipWhiteSpace();
-//        JLOG("getArray: " << debug());
-        element_required = false;
-        if (mIt != mEnd && *mIt == ',') {
-            element_required = true;
-            mIt++;
+    if (mPos < mJson.size()) {
+        char c = mJson[mPos];
+        if ((c != ',') && (c != ']') && (c != '}')) {
+            THROW_WITH_BACKTRACE1(EJsonNumberError, std::string("Numeric value has non numeric ending: '") + c + "'");
         }
     }
-    if (element_required) {
-        THROW_WITH_BACKTRACE1(EJsonParseError, std::string("Excessive array delimiter found after ") +  std::string(result.GetCount() ? result[result.GetCount()-1].AsString() : ""));
-    }
-    mIt++;
-    pop();
-    JLOG("getArray exit (" << result << "): " << debug());
-    return result;
+    return std::string_view(start, std::size_t(p - start));
 }
 
 /*
  * Parse the JSON content and extract it as a number,
  * stored in one of three supported native types.
- *
- * Exceptions are thrown if content has illegal number formatting.
  */
-JsonValue JsonDecoder::getNumber()
+void JsonDecoder::getNumber(JsonValue &arResult)
 {
-    JLOG("getNumber: " << debug(false, true));
-    bool is_float = false;
-    bool is_negative = false;
-    int i = 0;
-    std::string result;
-
-    skipWhiteSpace();
-
-    while (mIt != mEnd) {
-        char c = *mIt;
-        int skip = 0;
-        JLOG("c: " << c << ", i: " << i);
-        switch (i) {
-            case 0:
-                if (c == '-') {
-                    is_negative = true;
-                    i = 1;
-                }
-                else {
-                    skip = 1;
-                }
-                break;
-
-            case 1:
-                if (c == '0') {
-                    i = 3;
-                }
-                else if (c >= '0' && c <= '9') {
-                    i = 2;
-                }
-                else {
-                    THROW_WITH_BACKTRACE1(EJsonNumberError, "First character is not a sign or numeric.");
-                }
-                break;
-
-            case 2:
-                if (!(c >= '0' && c <= '9')) {
-                    skip = 3;
-                }
-                break;
-
-            case 3:
-                if (c == '.') {
-                    is_float = true;
-                    i = 4;
-                }
-                else {
-                    skip = 6;
-                }
-                break;
-
-            case 4:
-                if (!(c >= '0' && c <= '9')) {
-                    THROW_WITH_BACKTRACE1(EJsonNumberError, "Floating point decimal digit is not numeric.");
-                }
-                else {
-                    i = 5;
-                }
-                break;
-
-            case 5:
-                if (!(c >= '0' && c <= '9')) {
-                    skip = 6;
-                }
-                break;
-
-            case 6:
-                if (c == 'e' || c == 'E') {
-                    is_float = true;
-                    i = 7;
-                }
-                else {
-                    skip = 10;
-                }
-                break;
-
-            case 7:
-                if (c == '+' || c == '-') {
-                    i = 8;
-                }
-                else {
-                    skip = 8;
-                }
-                break;
-
-            case 8:
-                if (!(c >= '0' && c <= '9')) {
-                    THROW_WITH_BACKTRACE1(EJsonNumberError, "Floating point exponent is not numeric.");
-                }
-                else {
-                    i = 9;
-                }
-                break;
-
-            case 9:
-                if (!(c >= '0' && c <= '9')) {
-                    skip = 10;
-                }
-                break;
-
-            case 10: // delimiter
-                skipWhiteSpace();
-                if (c == ',' || mIt == mEnd) {
-                    skip = 100;
-                }
-                else {
-                    THROW_WITH_BACKTRACE1(EJsonNumberError, std::string("Numeric value has non numeric ending: '") + c + "'");
-                }
-                break;
-
-            default:
-                break;
-        }
-        if (i < 100) {
-            if (skip > 0) {
-                i = skip;
-            }
-            else {
-                mIt++;
-                result += c;
+    bool is_float;
+    std::string_view number = scanNumber(is_float);
+    const char *start = number.data();
+    const char *end = start + number.size();
+
+    if (!is_float) {
+        if (*start == '-') {
+            std::int64_t value;
+            if (std::from_chars(start, end, value).ec == std::errc()) {
+                arResult = value;
+                return;
             }
         }
         else {
-            break;
+            std::uint64_t value;
+            if (std::from_chars(start, end, value).ec == std::errc()) {
+                arResult = value;
+                return;
+            }
         }
+        // Integer out of range, fall back to double
     }
 
-    if (is_float) {
-        return JsonValue(rsp::utils::StrUtils::ToDouble(result));
-    }
-    else if (is_negative) {
-        return JsonValue(static_cast<std::int64_t>(std::strtoll(result.c_str(), nullptr, 10)));
-    }
-    else {
-        return JsonValue(static_cast<std::uint64_t>(std::strtoull(result.c_str(), nullptr, 10)));
+    double value;
+    if (std::from_chars(start, end, value).ec != std::errc()) {
+        THROW_WITH_BACKTRACE1(EJsonNumberError, "Numeric value is out of range: " + std::string(number));
     }
+    arResult = value;
 }
 
-JsonValue JsonDecoder::GetValue()
+void JsonDecoder::getValue(JsonValue &arResult)
 {
-    JLOG("GetValue: " << debug(false, true));
-    JsonValue result;
-
     skipWhiteSpace();
 
-    if (mIt != mEnd) {
-        switch (*mIt) {
-            case '{':
-                JLOG("Object detected: " << getOffset() << ", " << getLength() << "; " << substr(getOffset(), getLength()));
-                result = getObject();
-                JLOG("Result Type: " << result << ", Count: " << result.GetCount());
-                break;
+    if (mPos >= mJson.size()) {
+        return;
+    }
 
-            case '[':
-                JLOG("Array detected: " << substr(getOffset(), getLength()));
-                result = getArray();
-                JLOG("Result Type: " << result << ", Count: " << result.GetCount());
-                break;
+    switch (mJson[mPos]) {
+        case '{':
+        case '[':
+            if (++mDepth > cMaxDepth) {
+                THROW_WITH_BACKTRACE1(EJsonParseError, "Maximum nesting depth exceeded. " + debug());
+            }
+            if (mJson[mPos] == '{') {
+                getObject(arResult);
+            }
+            else {
+                getArray(arResult);
+            }
+            mDepth--;
+            break;
 
-            case '"':
-                JLOG("String detected: " << substr(getOffset(), getLength()));
-                result = getString();
-                JLOG("Result Type: " << result << ", Length: " << result.AsString().size());
-                break;
+        case '"':
+            mStringBuffer.clear();
+            getString(mStringBuffer);
+            arResult.setString(mStringBuffer);
+            break;
 
-            case '0':
-            case '1':
-            case '2':
-            case '3':
-            case '4':
-            case '5':
-            case '6':
-            case '7':
-            case '8':
-            case '9':
-            case '-':
-                JLOG("Number detected: " << substr(getOffset(), getLength()));
-                result = getNumber();
-                JLOG("Result Type: " << *result);
-                break;
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+        case '8':
+        case '9':
+        case '-':
+            getNumber(arResult);
+            break;
 
-            case 't':
-                JLOG("true detected: " << substr(getOffset(), getLength()));
-                if (substr(getOffset(), 4) == "true") {
-                    mIt += 4;
-                    result = true;
-                }
-                else {
-                    THROW_WITH_BACKTRACE1(EJsonParseError, "True is not formatted correctly. " + debug(false, true));
-                }
-                break;
+        case 't':
+            expectLiteral("true");
+            arResult = true;
+            break;
 
-            case 'f':
-                JLOG("false detected: " << substr(getOffset(), getLength()));
-                if (substr(getOffset(), 5) == "false") {
-                    mIt += 5;
-                    result = false;
-                }
-                else {
-                    THROW_WITH_BACKTRACE1(EJsonParseError, "False is not formatted correctly. " + debug(false, true));
-                }
-                break;
+        case 'f':
+            expectLiteral("false");
+            arResult = false;
+            break;
 
-            case 'n':
-                JLOG("null detected: " << substr(getOffset(), getLength()));
-                if (substr(getOffset(), 4) == "null") {
-                    mIt += 4;
-//                    result;
-                }
-                else {
-                    THROW_WITH_BACKTRACE1(EJsonParseError, "Null is not formatted correctly. " + debug(false, true));
-                }
-                break;
+        case 'n':
+            expectLiteral("null");
+            break;
 
-            default:
-                THROW_WITH_BACKTRACE1(EJsonParseError, "Illegal start character: " + debug(false, true));
-                break;
-        }
-        skipWhiteSpace();
+        default:
+            THROW_WITH_BACKTRACE1(EJsonParseError, "Illegal start character: " + debug());
+            break;
     }
-
-    JLOG("getValue exit (" << result << "): " << debug());
-    return result;
+    skipWhiteSpace();
 }
 
-std::string JsonDecoder::debug(bool aIncludeText, bool aIncludeSubstr)
+std::string JsonDecoder::debug() const
 {
-    std::stringstream ss;
-    if (aIncludeText) {
-        ss << *this << "; ";
-    }
-    ss << "Iterators: " << getOffset() << "(" << *mIt << "), " << getLength() << "(" << *mEnd << ");\n";
-    if (aIncludeSubstr) {
-        ss << " Substr: " << substr(getOffset(), getLength()) << ";";
-    }
-    return ss.str();
+    return "Offset " + std::to_string(mPos) + ": '" + std::string(mJson.substr(mPos, 40)) + "'";
 }
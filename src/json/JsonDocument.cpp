@@ -0,0 +1,556 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#include <charconv>
+#include <limits>
+#include <json/JsonDecoder.h>
+#include <json/JsonDocument.h>
+#include <json/JsonExceptions.h>
+#include <magic_enum.hpp>
+
+using namespace rsp::utils;
+
+namespace rsp::json {
+
+/**
+ * \brief Decoder that appends nodes to a document instead of building JsonValue objects.
+ *
+ * Token scanning is shared with JsonDecoder.
+ */
+class JsonDocument::Parser : public JsonDecoder
+{
+public:
+    explicit Parser(JsonDocument &arDocument)
+        : JsonDecoder(arDocument.mSource),
+          mrDocument(arDocument)
+    {
+    }
+
+    void Parse()
+    {
+        if (mJson.size() > UINT32_MAX) {
+            THROW_WITH_BACKTRACE1(EJsonParseError, "Document exceeds 4 GB.");
+        }
+        mrDocument.mNodes.reserve(mJson.size() / 8);
+        value(cNoKey);
+        if (mPos < mJson.size()) {
+            THROW_WITH_BACKTRACE1(EJsonParseError, "Unexpected content after document. " + debug());
+        }
+    }
+
+protected:
+    JsonDocument &mrDocument;
+    std::string mKeyBuffer{};
+
+    std::uint32_t position() const { return static_cast<std::uint32_t>(mrDocument.mNodes.size()); }
+
+    /*
+     * Strings without escapes are referenced in the source, others are decoded into the pool.
+     */
+    StringRef string()
+    {
+        const char *begin = mJson.data();
+        const char *end = begin + mJson.size();
+        const char *start = begin + mPos + 1;
+        const char *p = start;
+        while ((p < end) && (*p != '"') && (*p != '\\')) {
+            p++;
+        }
+        if ((p < end) && (*p == '"')) {
+            mPos = std::size_t(p - begin) + 1;
+            return StringRef{static_cast<std::uint32_t>(start - begin), static_cast<std::uint32_t>(p - start)};
+        }
+
+        std::size_t offset = mrDocument.mPool.size();
+        getString(mrDocument.mPool);
+        return StringRef{static_cast<std::uint32_t>(offset), static_cast<std::uint32_t>(mrDocument.mPool.size() - offset)};
+    }
+
+    std::uint32_t key()
+    {
+        std::size_t before = mrDocument.mPool.size();
+        StringRef ref = string();
+        if (mrDocument.mPool.size() == before) {
+            return mrDocument.addKey(std::string_view(mJson.data() + ref.mOffset, ref.mLength));
+        }
+        // Escaped key was decoded into the pool, move it out before interning
+        mKeyBuffer.assign(mrDocument.mPool, ref.mOffset, ref.mLength);
+        mrDocument.mPool.resize(before);
+        return mrDocument.addKey(mKeyBuffer);
+    }
+
+    void number(std::uint32_t aIndex)
+    {
+        bool is_float;
+        std::string_view number = scanNumber(is_float);
+        const char *start = number.data();
+        const char *end = start + number.size();
+        Node &node = mrDocument.mNodes[aIndex];
+
+        if (!is_float) {
+            if (*start == '-') {
+                if (std::from_chars(start, end, node.mInt).ec == std::errc()) {
+                    node.mType = Types::Int;
+                    return;
+                }
+            }
+            else if (std::from_chars(start, end, node.mUint).ec == std::errc()) {
+                node.mType = Types::Uint;
+                return;
+            }
+            // Integer out of range, fall back to double
+        }
+
+        if (std::from_chars(start, end, node.mDouble).ec != std::errc()) {
+            THROW_WITH_BACKTRACE1(EJsonNumberError, "Numeric value is out of range: " + std::string(number));
+        }
+        node.mType = Types::Double;
+    }
+
+    void value(std::uint32_t aKey)
+    {
+        skipWhiteSpace();
+
+        std::uint32_t index = position();
+        mrDocument.mNodes.push_back(Node{Types::Null, 0, 0, aKey, {}});
+
+        if (mPos >= mJson.size()) {
+            return;
+        }
+
+        switch (mJson[mPos]) {
+            case '{':
+            case '[':
+                if (++mDepth > cMaxDepth) {
+                    THROW_WITH_BACKTRACE1(EJsonParseError, "Maximum nesting depth exceeded. " + debug());
+                }
+                if (mJson[mPos] == '{') {
+                    object(index);
+                }
+                else {
+                    array(index);
+                }
+                mDepth--;
+                break;
+
+            case '"':
+            {
+                std::size_t before = mrDocument.mPool.size();
+                StringRef ref = string();
+                Node &node = mrDocument.mNodes[index];
+                node.mType = Types::String;
+                node.mFlags = (mrDocument.mPool.size() != before) ? cPooled : 0;
+                node.mString = ref;
+                break;
+            }
+
+            case '0':
+            case '1':
+            case '2':
+            case '3':
+            case '4':
+            case '5':
+            case '6':
+            case '7':
+            case '8':
+            case '9':
+            case '-':
+                number(index);
+                break;
+
+            case 't':
+                expectLiteral("true");
+                mrDocument.mNodes[index].mType = Types::Bool;
+                mrDocument.mNodes[index].mBool = true;
+                break;
+
+            case 'f':
+                expectLiteral("false");
+                mrDocument.mNodes[index].mType = Types::Bool;
+                mrDocument.mNodes[index].mBool = false;
+                break;
+
+            case 'n':
+                expectLiteral("null");
+                break;
+
+            default:
+                THROW_WITH_BACKTRACE1(EJsonParseError, "Illegal start character: " + debug());
+                break;
+        }
+        skipWhiteSpace();
+    }
+
+    void object(std::uint32_t aIndex)
+    {
+        mrDocument.mNodes[aIndex].mType = Types::Object;
+        mPos++; // Skip '{'
+        skipWhiteSpace();
+
+        std::uint32_t count = 0;
+        if ((mPos < mJson.size()) && (mJson[mPos] == '}')) {
+            mPos++;
+        }
+        else {
+            for (;;) {
+                if ((mPos >= mJson.size()) || (mJson[mPos] != '"')) {
+                    THROW_WITH_BACKTRACE1(EJsonParseError, "Object member name was not found. " + debug());
+                }
+                std::uint32_t key_index = key();
+                skipWhiteSpace();
+                if ((mPos >= mJson.size()) || (mJson[mPos] != ':')) {
+                    THROW_WITH_BACKTRACE1(EJsonParseError, "Object key/value delimiter not found. " + debug());
+                }
+                mPos++;
+                value(key_index);
+                count++;
+
+                if ((mPos < mJson.size()) && (mJson[mPos] == ',')) {
+                    mPos++;
+                    skipWhiteSpace();
+                }
+                else if ((mPos < mJson.size()) && (mJson[mPos] == '}')) {
+                    mPos++;
+                    break;
+                }
+                else {
+                    THROW_WITH_BACKTRACE1(EJsonParseError, "End token was not found. } " + debug());
+                }
+            }
+        }
+        mrDocument.mNodes[aIndex].mRange = Range{count, position()};
+    }
+
+    void array(std::uint32_t aIndex)
+    {
+        mrDocument.mNodes[aIndex].mType = Types::Array;
+        mPos++; // Skip '['
+        skipWhiteSpace();
+
+        std::uint32_t count = 0;
+        if ((mPos < mJson.size()) && (mJson[mPos] == ']')) {
+            mPos++;
+        }
+        else {
+            for (;;) {
+                if ((mPos < mJson.size()) && (mJson[mPos] == ']')) {
+                    THROW_WITH_BACKTRACE1(EJsonParseError, "Excessive array delimiter found. " + debug());
+                }
+                value(cNoKey);
+                count++;
+
+                if ((mPos < mJson.size()) && (mJson[mPos] == ',')) {
+                    mPos++;
+                    skipWhiteSpace();
+                }
+                else if ((mPos < mJson.size()) && (mJson[mPos] == ']')) {
+                    mPos++;
+                    break;
+                }
+                else {
+                    THROW_WITH_BACKTRACE1(EJsonParseError, "End token was not found. ] " + debug());
+                }
+            }
+        }
+        mrDocument.mNodes[aIndex].mRange = Range{count, position()};
+    }
+};
+
+
+JsonDocument::JsonDocument()
+    : mNodes(1, Node{Types::Null, 0, 0, cNoKey, {}})
+{
+}
+
+JsonDocument::JsonDocument(std::string aJson)
+    : mSource(std::move(aJson))
+{
+    Parser(*this).Parse();
+    mNodes.shrink_to_fit();
+}
+
+JsonDocument::JsonDocument(const DynamicData &arData)
+{
+    fromDynamicData(arData, cNoKey);
+}
+
+std::uint32_t JsonDocument::next(std::uint32_t aIndex) const
+{
+    const Node &node = mNodes[aIndex];
+    if ((node.mType == Types::Object) || (node.mType == Types::Array)) {
+        return node.mRange.mEnd;
+    }
+    return aIndex + 1;
+}
+
+std::string_view JsonDocument::getString(const Node &arNode) const
+{
+    const std::string &buffer = (arNode.mFlags & cPooled) ? mPool : mSource;
+    return std::string_view(buffer.data() + arNode.mString.mOffset, arNode.mString.mLength);
+}
+
+std::string_view JsonDocument::getKey(std::uint32_t aKey) const
+{
+    if (aKey == cNoKey) {
+        return {};
+    }
+    return std::string_view(mPool.data() + mKeys[aKey].mOffset, mKeys[aKey].mLength);
+}
+
+std::uint32_t JsonDocument::findKey(std::string_view aKey) const
+{
+    std::size_t pos = mKeyIndex.Find(aKey, mKeys.size(), [this](std::size_t i) { return getKey(static_cast<std::uint32_t>(i)); });
+    return (pos == MemberIndex::npos) ? cNoKey : static_cast<std::uint32_t>(pos);
+}
+
+std::uint32_t JsonDocument::addKey(std::string_view aKey)
+{
+    std::uint32_t result = findKey(aKey);
+    if (result == cNoKey) {
+        result = static_cast<std::uint32_t>(mKeys.size());
+        mKeys.push_back(addToPool(aKey));
+        mKeyIndex.Append(mKeys.size(), [this](std::size_t i) { return getKey(static_cast<std::uint32_t>(i)); });
+    }
+    return result;
+}
+
+JsonDocument::StringRef JsonDocument::addToPool(std::string_view aString)
+{
+    StringRef result{static_cast<std::uint32_t>(mPool.size()), static_cast<std::uint32_t>(aString.size())};
+    mPool.append(aString);
+    return result;
+}
+
+void JsonDocument::fromDynamicData(const DynamicData &arData, std::uint32_t aKey)
+{
+    auto index = static_cast<std::uint32_t>(mNodes.size());
+    mNodes.push_back(Node{Types::Null, 0, 0, aKey, {}});
+
+    switch (arData.GetType()) {
+        case DynamicData::Types::Null:
+            break;
+
+        case DynamicData::Types::Bool:
+            mNodes[index].mType = Types::Bool;
+            mNodes[index].mBool = arData.AsBool();
+            break;
+
+        case DynamicData::Types::Int:
+        case DynamicData::Types::Int64:
+            mNodes[index].mType = Types::Int;
+            mNodes[index].mInt = arData.RawAsInt();
+            break;
+
+        case DynamicData::Types::Uint64:
+        case DynamicData::Types::Uint32:
+        case DynamicData::Types::Uint16:
+            mNodes[index].mType = Types::Uint;
+            mNodes[index].mUint = static_cast<std::uint64_t>(arData.RawAsInt());
+            break;
+
+        case DynamicData::Types::Float:
+        case DynamicData::Types::Double:
+            mNodes[index].mType = Types::Double;
+            mNodes[index].mDouble = arData.AsDouble();
+            break;
+
+        case DynamicData::Types::String:
+            mNodes[index].mType = Types::String;
+            mNodes[index].mFlags = cPooled;
+            mNodes[index].mString = addToPool(arData.RawAsString());
+            break;
+
+        case DynamicData::Types::Object:
+        case DynamicData::Types::Array:
+        {
+            bool is_object = arData.IsObject();
+            for (const DynamicData &item : arData.GetItems()) {
+                fromDynamicData(item, is_object ? addKey(item.GetName()) : cNoKey);
+            }
+            mNodes[index].mType = is_object ? Types::Object : Types::Array;
+            mNodes[index].mRange = Range{static_cast<std::uint32_t>(arData.GetItems().size()), static_cast<std::uint32_t>(mNodes.size())};
+            break;
+        }
+
+        default:
+            THROW_WITH_BACKTRACE1(EJsonTypeError, "DynamicData of type " + arData.TypeToText() + " is not a valid JSON type");
+    }
+}
+
+
+bool JsonDocument::Value::AsBool() const
+{
+    if (GetType() != Types::Bool) {
+        THROW_WITH_BACKTRACE1(EJsonTypeError, "Value of type " + std::string(magic_enum::enum_name(GetType())) + " is not a boolean");
+    }
+    return node().mBool;
+}
+
+std::int64_t JsonDocument::Value::AsInt() const
+{
+    switch (GetType()) {
+        case Types::Int:
+            return node().mInt;
+        case Types::Uint:
+            return static_cast<std::int64_t>(node().mUint);
+        case Types::Double:
+            return static_cast<std::int64_t>(node().mDouble);
+        default:
+            THROW_WITH_BACKTRACE1(EJsonTypeError, "Value of type " + std::string(magic_enum::enum_name(GetType())) + " is not a number");
+    }
+}
+
+double JsonDocument::Value::AsDouble() const
+{
+    switch (GetType()) {
+        case Types::Int:
+            return static_cast<double>(node().mInt);
+        case Types::Uint:
+            return static_cast<double>(node().mUint);
+        case Types::Double:
+            return node().mDouble;
+        default:
+            THROW_WITH_BACKTRACE1(EJsonTypeError, "Value of type " + std::string(magic_enum::enum_name(GetType())) + " is not a number");
+    }
+}
+
+std::string_view JsonDocument::Value::AsString() const
+{
+    if (GetType() != Types::String) {
+        THROW_WITH_BACKTRACE1(EJsonTypeError, "Value of type " + std::string(magic_enum::enum_name(GetType())) + " is not a string");
+    }
+    return mpDocument->getString(node());
+}
+
+std::string_view JsonDocument::Value::GetName() const
+{
+    return mpDocument->getKey(node().mKey);
+}
+
+std::size_t JsonDocument::Value::GetCount() const
+{
+    if (IsObject() || IsArray()) {
+        return node().mRange.mCount;
+    }
+    return 0;
+}
+
+bool JsonDocument::Value::MemberExists(std::string_view aKey) const
+{
+    tryObject();
+    std::uint32_t key = mpDocument->findKey(aKey);
+    if (key == cNoKey) {
+        return false;
+    }
+    for (std::uint32_t i = mIndex + 1 ; i < node().mRange.mEnd ; i = mpDocument->next(i)) {
+        if (mpDocument->mNodes[i].mKey == key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+JsonDocument::Value JsonDocument::Value::operator[](std::string_view aKey) const
+{
+    tryObject();
+    std::uint32_t key = mpDocument->findKey(aKey);
+    if (key != cNoKey) {
+        for (std::uint32_t i = mIndex + 1 ; i < node().mRange.mEnd ; i = mpDocument->next(i)) {
+            if (mpDocument->mNodes[i].mKey == key) {
+                return Value(*mpDocument, i);
+            }
+        }
+    }
+    THROW_WITH_BACKTRACE1(EMemberNotExisting, std::string(aKey));
+}
+
+JsonDocument::Value JsonDocument::Value::operator[](std::size_t aIndex) const
+{
+    tryContainer();
+    if (aIndex >= node().mRange.mCount) {
+        THROW_WITH_BACKTRACE1(std::out_of_range, "Index " + std::to_string(aIndex) + " is out of range");
+    }
+    std::uint32_t i = mIndex + 1;
+    while (aIndex--) {
+        i = mpDocument->next(i);
+    }
+    return Value(*mpDocument, i);
+}
+
+JsonDocument::Iterator JsonDocument::Value::begin() const
+{
+    if (IsObject() || IsArray()) {
+        return Iterator(*mpDocument, mIndex + 1);
+    }
+    return end();
+}
+
+JsonDocument::Iterator JsonDocument::Value::end() const
+{
+    return Iterator(*mpDocument, mpDocument->next(mIndex));
+}
+
+DynamicData JsonDocument::Value::ToDynamicData() const
+{
+    switch (GetType()) {
+        case Types::Null:
+        default:
+            return DynamicData();
+
+        case Types::Bool:
+            return DynamicData(node().mBool);
+
+        case Types::Int:
+            return DynamicData(node().mInt);
+
+        case Types::Uint:
+            return DynamicData(node().mUint);
+
+        case Types::Double:
+            return DynamicData(node().mDouble);
+
+        case Types::String:
+            return DynamicData(std::string(AsString()));
+
+        case Types::Object:
+        {
+            DynamicData result(DynamicData::Types::Object);
+            for (Value member : *this) {
+                result.Add(member.GetName(), member.ToDynamicData());
+            }
+            return result;
+        }
+
+        case Types::Array:
+        {
+            DynamicData result(DynamicData::Types::Array);
+            for (Value member : *this) {
+                result.Add(member.ToDynamicData());
+            }
+            return result;
+        }
+    }
+}
+
+void JsonDocument::Value::tryObject() const
+{
+    if (!IsObject()) {
+        THROW_WITH_BACKTRACE1(EJsonTypeError, "Value of type " + std::string(magic_enum::enum_name(GetType())) + " is not an object");
+    }
+}
+
+void JsonDocument::Value::tryContainer() const
+{
+    if (!IsObject() && !IsArray()) {
+        THROW_WITH_BACKTRACE1(EJsonTypeError, "Value of type " + std::string(magic_enum::enum_name(GetType())) + " is not an object or array");
+    }
+}
+
+} /* namespace rsp::json */
@@ -3,7 +3,11 @@
  * \author      steffen
  */
 
-#include <iomanip>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <limits>
 #include <json/JsonEncoder.h>
 #include <logging/Logger.h>
 
@@ -14,8 +18,181 @@ using namespace rsp::utils;
 
 namespace rsp::json {
 
+static constexpr std::uint64_t cOnes = 0x0101010101010101ull;
+static constexpr std::uint64_t cHighBits = 0x8080808080808080ull;
+static constexpr char cHexDigits[] = "0123456789abcdef";
+
+/**
+ * Get a mask with the high bit set in each byte that may need escaping.
+ * The lowest set bit is exact, bits above it may be false positives.
+ */
+static inline std::uint64_t escapeMask(std::uint64_t aWord, bool aForceToUCS2)
+{
+    std::uint64_t quote = aWord ^ (cOnes * '"');
+    std::uint64_t backslash = aWord ^ (cOnes * '\\');
+    std::uint64_t mask = ((aWord - cOnes * 0x20) & ~aWord)
+                       | ((quote - cOnes) & ~quote)
+                       | ((backslash - cOnes) & ~backslash);
+    if (aForceToUCS2) {
+        mask |= aWord;
+    }
+    return mask & cHighBits;
+}
+
+static inline bool needsEscape(char c, bool aForceToUCS2)
+{
+    auto uc = static_cast<std::uint8_t>(c);
+    return (uc < 0x20) || (c == '"') || (c == '\\') || (aForceToUCS2 && (uc > 127));
+}
+
+/**
+ * Find the first character needing escape, scanning a word at a time.
+ */
+static const char* findEscape(const char *apBegin, const char *apEnd, bool aForceToUCS2)
+{
+    const char *p = apBegin;
+    if constexpr (std::endian::native == std::endian::little) {
+        while ((apEnd - p) >= 8) {
+            std::uint64_t word;
+            std::memcpy(&word, p, sizeof(word));
+            std::uint64_t mask = escapeMask(word, aForceToUCS2);
+            if (mask) {
+                return p + (std::countr_zero(mask) / 8);
+            }
+            p += 8;
+        }
+    }
+    while ((p < apEnd) && !needsEscape(*p, aForceToUCS2)) {
+        p++;
+    }
+    return p;
+}
+
+static void appendUnicodeEscape(std::string &arResult, std::uint32_t aCodeUnit)
+{
+    char buf[6] = { '\\', 'u',
+        cHexDigits[(aCodeUnit >> 12) & 0xF], cHexDigits[(aCodeUnit >> 8) & 0xF],
+        cHexDigits[(aCodeUnit >> 4) & 0xF], cHexDigits[aCodeUnit & 0xF] };
+    arResult.append(buf, sizeof(buf));
+}
+
+/**
+ * Append the escape sequence for the character at apPos.
+ * \return Pointer to the character following the escaped character or UTF-8 sequence
+ */
+static const char* escapeCharacter(std::string &arResult, const char *apPos, const char *apEnd)
+{
+    auto c = static_cast<std::uint8_t>(*apPos);
+    switch (c) {
+        case '"':  arResult.append("\\\"", 2); return apPos + 1;
+        case '\\': arResult.append("\\\\", 2); return apPos + 1;
+        case '\b': arResult.append("\\b", 2); return apPos + 1;
+        case '\f': arResult.append("\\f", 2); return apPos + 1;
+        case '\n': arResult.append("\\n", 2); return apPos + 1;
+        case '\r': arResult.append("\\r", 2); return apPos + 1;
+        case '\t': arResult.append("\\t", 2); return apPos + 1;
+        default:
+            break;
+    }
+    if (c < 0x20) {
+        appendUnicodeEscape(arResult, c);
+        return apPos + 1;
+    }
+
+    // Non ASCII character, convert UTF-8 sequence to UCS2
+    std::ptrdiff_t length;
+    std::uint32_t code_point;
+    if ((c & 0xE0) == 0xC0) {
+        length = 2;
+        code_point = c & 0x1Fu;
+    }
+    else if ((c & 0xF0) == 0xE0) {
+        length = 3;
+        code_point = c & 0x0Fu;
+    }
+    else if ((c & 0xF8) == 0xF0) {
+        length = 4;
+        code_point = c & 0x07u;
+    }
+    else {
+        THROW_WITH_BACKTRACE1(EJsonParseError, "String has illegal UTF-8 lead byte: " + std::to_string(unsigned(c)));
+    }
+    if ((apEnd - apPos) < length) {
+        THROW_WITH_BACKTRACE1(EJsonParseError, "String has truncated UTF-8 sequence");
+    }
+    for (std::ptrdiff_t i = 1 ; i < length ; ++i) {
+        code_point = (code_point << 6) | (static_cast<std::uint8_t>(apPos[i]) & 0x3Fu);
+    }
+
+    if (code_point > 0xFFFF) {
+        code_point -= 0x10000;
+        appendUnicodeEscape(arResult, 0xD800 + (code_point >> 10));
+        appendUnicodeEscape(arResult, 0xDC00 + (code_point & 0x3FF));
+    }
+    else {
+        appendUnicodeEscape(arResult, code_point);
+    }
+    return apPos + length;
+}
+
+void JsonEncoder::EscapeString(std::string &arResult, std::string_view aString, bool aForceToUCS2)
+{
+    const char *p = aString.data();
+    const char *end = p + aString.size();
+    while (p < end) {
+        const char *run = findEscape(p, end, aForceToUCS2);
+        arResult.append(p, run);
+        if (run == end) {
+            break;
+        }
+        p = escapeCharacter(arResult, run, end);
+    }
+}
+
 std::string JsonEncoder::Encode(const rsp::utils::DynamicData &arData, bool aPrettyPrint, bool aForceToUCS2,
     unsigned int aArrayLineLength)
+{
+    std::string result;
+    Encode(arData, result, aPrettyPrint, aForceToUCS2, aArrayLineLength);
+    return result;
+}
+
+void JsonEncoder::Encode(const rsp::utils::DynamicData &arData, std::string &arResult, bool aPrettyPrint,
+    bool aForceToUCS2, unsigned int aArrayLineLength)
+{
+    PrintFormat pf = makePrintFormat(aPrettyPrint, aArrayLineLength);
+    JsonEncoder je(pf, arResult, aForceToUCS2);
+    je.toResult(arData, 0);
+}
+
+void JsonEncoder::Encode(const rsp::utils::DynamicData &arData, rsp::posix::FileIO &arFile, bool aPrettyPrint,
+    bool aForceToUCS2, unsigned int aArrayLineLength)
+{
+    EncodeToSink(arData, [&arFile](std::string_view aChunk) {
+        arFile.ExactWrite(aChunk.data(), aChunk.size());
+    }, aPrettyPrint, aForceToUCS2, aArrayLineLength);
+}
+
+void JsonEncoder::EncodeToSink(const rsp::utils::DynamicData &arData, const Sink_t &arSink, bool aPrettyPrint,
+    bool aForceToUCS2, unsigned int aArrayLineLength)
+{
+    PrintFormat pf = makePrintFormat(aPrettyPrint, aArrayLineLength);
+    std::string buffer;
+    buffer.reserve(cSinkBufferSize * 2);
+    JsonEncoder je(pf, buffer, aForceToUCS2, &arSink);
+    je.toResult(arData, 0);
+    je.flush();
+}
+
+JsonEncoder::JsonEncoder(const PrintFormat &arPf, std::string &arResult, bool aForceToUCS2, const Sink_t *apSink)
+    : mrPf(arPf),
+      mrResult(arResult),
+      mpSink(apSink),
+      mForceToUCS2(aForceToUCS2)
+{
+}
+
+JsonEncoder::PrintFormat JsonEncoder::makePrintFormat(bool aPrettyPrint, unsigned int aArrayLineLength)
 {
     PrintFormat pf;
     if (aPrettyPrint) {
@@ -24,182 +201,188 @@ std::string JsonEncoder::Encode(const rsp::utils::DynamicData &arData, bool aPre
         pf.nl = "\n";
         pf.sp = " ";
     }
+    return pf;
+}
 
-    JsonEncoder je(pf, aForceToUCS2);
-    je.toStringStream(arData, 0);
-    return je.getResult();
+void JsonEncoder::flush()
+{
+    if (mpSink && !mrResult.empty()) {
+        (*mpSink)(mrResult);
+        mrResult.clear();
+    }
+}
 
+void JsonEncoder::indent(unsigned int aLevel)
+{
+    mrResult.append(static_cast<std::string::size_type>(mrPf.indent) * aLevel, ' ');
 }
 
-JsonEncoder::JsonEncoder(const PrintFormat &arPf, bool aForceToUCS2)
-    : mrPf(arPf),
-      mForceToUCS2(aForceToUCS2)
+void JsonEncoder::stringToResult(std::string_view aString)
 {
+    mrResult += '"';
+    EscapeString(mrResult, aString, mForceToUCS2);
+    mrResult += '"';
 }
 
-void JsonEncoder::stringToStringStream(const DynamicData &arData, unsigned int aLevel)
+void JsonEncoder::scalarToResult(const DynamicData &arData, int aMinWidth)
 {
-    std::string s = arData.AsString();
-    std::size_t i = 0;
-    while (i < s.length()) {
-        auto c = s[i];
-        switch (c) {
-            case '\"':
-                s.replace(i, 1, "\\\"");
-                break;
-            case '\\':
-                s.replace(i, 1, "\\\\");
-                break;
-            case '\b':
-                s.replace(i, 1, "\\b");
-                break;
-            case '\f':
-                s.replace(i, 1, "\\f");
-                break;
-            case '\n':
-                s.replace(i, 1, "\\n");
-                break;
-            case '\r':
-                s.replace(i, 1, "\\r");
-                break;
-            case '\t':
-                s.replace(i, 1, "\\t");
-                break;
-            default:
-                if (mForceToUCS2 && static_cast<uint8_t>(c) > 127) {
-                    int v = 0;
-                    char buf[12];
-                    switch (static_cast<uint8_t>(c) & 0xE0) {
-                        case 0xE0:
-                            v =   ((static_cast<int>(s[i]) & 0x0F) << 12)
-                                + ((static_cast<int>(s[i+1]) & 0x3F) << 6)
-                                + (static_cast<int>(s[i+2]) & 0x3F);
-                            sprintf(buf, "\\u%04x", v);
-                            s.replace(i, 3, buf);
-                            i += 4;
-                            break;
-
-                        case 0xC0:
-                            v =   ((static_cast<int>(s[i]) & 0x1F) << 6)
-                                + (static_cast<int>(s[i+1]) & 0x3F);
-                            sprintf(buf, "\\u%04x", v);
-                            s.replace(i, 2, buf);
-                            i += 4;
-                            break;
-
-                        default:
-                            THROW_WITH_BACKTRACE1(EJsonParseError, "DynamicData of type string has illegal character: " + c);
-                            break;
-                    }
-                }
-                break;
+    std::array<char, 32> buf;
+    char *first = buf.data();
+    char *last = buf.data() + buf.size();
+    std::string_view text;
+
+    switch (arData.GetType()) {
+        case DynamicData::Types::Null:
+            text = "null";
+            break;
+
+        case DynamicData::Types::Bool:
+            text = arData.AsBool() ? "true" : "false";
+            break;
+
+        case DynamicData::Types::Int:
+        case DynamicData::Types::Int64:
+            text = std::string_view(first, std::size_t(std::to_chars(first, last, arData.RawAsInt()).ptr - first));
+            break;
+
+        case DynamicData::Types::Uint64:
+        case DynamicData::Types::Uint32:
+        case DynamicData::Types::Uint16:
+            text = std::string_view(first, std::size_t(std::to_chars(first, last, static_cast<std::uint64_t>(arData.RawAsInt())).ptr - first));
+            break;
+
+        case DynamicData::Types::Float:
+            text = std::string_view(first, std::size_t(std::to_chars(first, last, arData.AsDouble(), std::chars_format::general,
+                std::numeric_limits<float>::max_digits10).ptr - first));
+            break;
+
+        case DynamicData::Types::Double:
+            text = std::string_view(first, std::size_t(std::to_chars(first, last, arData.AsDouble(), std::chars_format::general,
+                std::numeric_limits<double>::max_digits10).ptr - first));
+            break;
+
+        default:
+        {
+            std::string s = arData.AsString();
+            if (aMinWidth > int(s.size())) {
+                mrResult.append(std::size_t(aMinWidth) - s.size(), ' ');
+            }
+            mrResult += s;
+            return;
         }
-        i++;
     }
-    mResult << "\"" << s << "\"";
+
+    if (aMinWidth > int(text.size())) {
+        mrResult.append(std::size_t(aMinWidth) - text.size(), ' ');
+    }
+    mrResult += text;
 }
 
-void JsonEncoder::arrayToStringStream(const DynamicData &arData, unsigned int aLevel)
+void JsonEncoder::arrayToResult(const DynamicData &arData, unsigned int aLevel)
 {
-    std::string in(static_cast<std::string::size_type>(mrPf.indent) * (aLevel + 1), ' ');
-    std::string c = ",";
-    int min_witdh = 0;
-
-    mResult << "[" << mrPf.nl;
-
     auto& items = arData.GetItems();
-    auto rest = items.size();
-    mResult << in;
-    unsigned int item_count = 0;
+    int min_width = 0;
 
-    if (mrPf.arll && mrPf.indent && rest) {
+    if (mrPf.arll && mrPf.indent && !items.empty()) {
         switch (items[0].GetType()) {
             case DynamicData::Types::Int:
             case DynamicData::Types::Uint32:
-                min_witdh = 10;
+                min_width = 10;
                 break;
 
             case DynamicData::Types::Int64:
             case DynamicData::Types::Uint64:
-                min_witdh = 20;
+                min_width = 20;
                 break;
 
             case DynamicData::Types::Uint16:
-                min_witdh = 5;
+                min_width = 5;
                 break;
 
             default:
-                min_witdh = 7;
+                min_width = 7;
                 break;
         }
     }
 
+    mrResult += '[';
+    mrResult += mrPf.nl;
+    indent(aLevel + 1);
+
+    auto rest = items.size();
+    unsigned int item_count = 0;
     for (const DynamicData &el : items) {
-        if (min_witdh) {
-            mResult << std::setw(min_witdh) << std::setfill(' ');
+        toResult(el, aLevel + 1, min_width);
+        bool last = (--rest == 0);
+        if (!last) {
+            mrResult += ',';
         }
-        toStringStream(el, aLevel + 1);
-        if (--rest == 0) {
-            c = "";
-            in.clear();
-        }
-        mResult << c;
-        if ((rest == 0) || (++item_count >= mrPf.arll)) {
-            mResult << mrPf.nl << in;
+        if (last || (++item_count >= mrPf.arll)) {
+            mrResult += mrPf.nl;
+            if (!last) {
+                indent(aLevel + 1);
+            }
             item_count = 0;
         }
         else {
-            mResult << " ";
+            mrResult += ' ';
         }
     }
-    std::string in1(static_cast<std::string::size_type>(mrPf.indent) * aLevel, ' ');
-    mResult << in1 << "]";
+    indent(aLevel);
+    mrResult += ']';
 }
 
-void JsonEncoder::objectToStringStream(const DynamicData &arData, unsigned int aLevel)
+void JsonEncoder::objectToResult(const DynamicData &arData, unsigned int aLevel)
 {
-    std::string in(static_cast<std::string::size_type>(mrPf.indent) * (aLevel+1), ' ');
-    std::string c = ",";
-
-    mResult << "{" << mrPf.nl;
+    mrResult += '{';
+    mrResult += mrPf.nl;
 
     auto& items = arData.GetItems();
-
-    JLOG("Members:");
-
     auto rest = items.size();
     for (const DynamicData &value : items) {
-        JLOG("  " << value.mName << ": " << value.AsString());
-        mResult << in << "\"" << value.GetName() << "\":" << mrPf.sp;
+        JLOG("  " << value.GetName() << ": " << value.AsString());
+        indent(aLevel + 1);
+        stringToResult(value.GetName());
+        mrResult += ':';
+        mrResult += mrPf.sp;
 
-        toStringStream(value, aLevel+1);
-        if (--rest == 0) {
-            c = "";
+        toResult(value, aLevel + 1);
+        if (--rest) {
+            mrResult += ',';
         }
-        mResult << c << mrPf.nl;
+        mrResult += mrPf.nl;
     }
-    std::string in1(static_cast<std::string::size_type>(mrPf.indent) * aLevel, ' ');
-    mResult << in1 << "}";
+    indent(aLevel);
+    mrResult += '}';
 }
 
-void JsonEncoder::toStringStream(const DynamicData &arData, unsigned int aLevel)
+void JsonEncoder::toResult(const DynamicData &arData, unsigned int aLevel, int aMinWidth)
 {
+    if (mpSink && (mrResult.size() >= cSinkBufferSize)) {
+        flush();
+    }
+
+    // Minimum width only pads the first character of strings and containers
+    if ((aMinWidth > 1) && (arData.GetType() >= DynamicData::Types::String)) {
+        mrResult.append(std::size_t(aMinWidth - 1), ' ');
+    }
+
     switch(arData.GetType()) {
         case DynamicData::Types::String:
-            stringToStringStream(arData, aLevel);
+            stringToResult(arData.RawAsString());
             break;
 
         case DynamicData::Types::Array:
-            arrayToStringStream(arData, aLevel);
+            arrayToResult(arData, aLevel);
             break;
 
         case DynamicData::Types::Object:
-            objectToStringStream(arData, aLevel);
+            objectToResult(arData, aLevel);
             break;
 
         default:
-            mResult << arData.AsString();
-        break;
+            scalarToResult(arData, aMinWidth);
+            break;
     }
 }
 
@@ -0,0 +1,260 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#include <cstring>
+#include <json/JsonExceptions.h>
+#include <json/JsonIndexedDecoder.h>
+
+namespace rsp::json {
+
+static inline bool isWhiteSpace(char c)
+{
+    return (c == ' ') || (c == '\n') || (c == '\r') || (c == '\t');
+}
+
+JsonIndexedDecoder::JsonIndexedDecoder(std::string_view aJson, JsonStructuralIndex::Kernels aKernel)
+    : JsonDecoder(aJson),
+      mIndex(aJson, aKernel)
+{
+    countMembers();
+}
+
+JsonValue JsonIndexedDecoder::GetValue()
+{
+    JsonValue result;
+    getIndexedValue(result);
+    if (mNext < mIndex.GetCount()) {
+        mPos = peekToken();
+        THROW_WITH_BACKTRACE1(EJsonParseError, "Unexpected content after root value. " + debug());
+    }
+    return result;
+}
+
+/*
+ * Count the members of all objects and arrays, as the number of delimiters plus one if not empty.
+ * The counts are only used to reserve memory, malformed text is detected while building the tree.
+ */
+void JsonIndexedDecoder::countMembers()
+{
+    std::vector<std::size_t> open;
+    char previous = '\0';
+    for (std::uint32_t pos : mIndex.GetPositions()) {
+        char c = mJson[pos];
+        switch (c) {
+            case '{':
+            case '[':
+                open.push_back(mCounts.size());
+                mCounts.push_back(0);
+                break;
+
+            case ',':
+                if (!open.empty()) {
+                    mCounts[open.back()]++;
+                }
+                break;
+
+            case '}':
+            case ']':
+                if (!open.empty()) {
+                    if ((previous != '{') && (previous != '[')) {
+                        mCounts[open.back()]++;
+                    }
+                    open.pop_back();
+                }
+                break;
+
+            default:
+                break;
+        }
+        previous = c;
+    }
+}
+
+char JsonIndexedDecoder::nextToken()
+{
+    mPos = peekToken();
+    if (mPos >= mJson.size()) {
+        return '\0';
+    }
+    mNext++;
+    return mJson[mPos];
+}
+
+/*
+ * Position after the last non whitespace character before the next token.
+ * Only whitespace can follow a scalar before the next token, anything else is a token itself.
+ */
+std::size_t JsonIndexedDecoder::scalarEnd() const
+{
+    std::size_t end = peekToken();
+    while ((end > mPos) && isWhiteSpace(mJson[end - 1])) {
+        end--;
+    }
+    return end;
+}
+
+/*
+ * A number or literal must be followed by whitespace and the next token.
+ */
+void JsonIndexedDecoder::endOfScalar()
+{
+    skipWhiteSpace();
+    if (mPos != peekToken()) {
+        THROW_WITH_BACKTRACE1(EJsonParseError, "Unexpected character after value. " + debug());
+    }
+}
+
+void JsonIndexedDecoder::getIndexedString(std::string &arResult)
+{
+    // The first stage guarantees that every string is terminated, so the
+    // closing quote is the last character before the next token.
+    std::size_t close = scalarEnd() - 1;
+    const char *begin = mJson.data() + mPos + 1;
+    std::size_t length = close - mPos - 1;
+
+    if ((close > mPos) && (mJson[close] == '"') && !std::memchr(begin, '\\', length)) {
+        arResult.assign(begin, length);
+        mPos = close + 1;
+    }
+    else {
+        getString(arResult);
+    }
+}
+
+void JsonIndexedDecoder::getIndexedObject(JsonValue &arResult)
+{
+    arResult.forceObject();
+    arResult.mItems.reserve(nextCount());
+
+    if (peekChar() == '}') {
+        nextToken();
+        return;
+    }
+
+    for (;;) {
+        if (nextToken() != '"') {
+            if (arResult.mItems.empty()) {
+                THROW_WITH_BACKTRACE1(EJsonParseError, "Object member name was not found. " + debug());
+            }
+            THROW_WITH_BACKTRACE1(EJsonParseError, "Excessive key/value delimiter found after " + arResult.mItems.back().mName + ". " + debug());
+        }
+
+        JsonValue &member = arResult.mItems.emplace_back();
+        getIndexedString(member.mName);
+        if (nextToken() != ':') {
+            THROW_WITH_BACKTRACE1(EJsonParseError, "Object key/value delimiter not found. " + debug());
+        }
+        getIndexedValue(member);
+
+        char c = nextToken();
+        if (c == '}') {
+            arResult.rebuildIndex();
+            return;
+        }
+        if (c != ',') {
+            THROW_WITH_BACKTRACE1(EJsonParseError, "End token was not found. } " + debug());
+        }
+    }
+}
+
+void JsonIndexedDecoder::getIndexedArray(JsonValue &arResult)
+{
+    arResult.forceArray();
+    arResult.mItems.reserve(nextCount());
+
+    if (peekChar() == ']') {
+        nextToken();
+        return;
+    }
+
+    for (;;) {
+        if (peekChar() == ']') {
+            mPos = peekToken();
+            THROW_WITH_BACKTRACE1(EJsonParseError, "Excessive array delimiter found. " + debug());
+        }
+        getIndexedValue(arResult.mItems.emplace_back());
+
+        char c = nextToken();
+        if (c == ']') {
+            return;
+        }
+        if (c != ',') {
+            THROW_WITH_BACKTRACE1(EJsonParseError, "End token was not found. ] " + debug());
+        }
+    }
+}
+
+void JsonIndexedDecoder::getIndexedValue(JsonValue &arResult)
+{
+    char c = nextToken();
+    if (mPos >= mJson.size()) {
+        return;
+    }
+
+    switch (c) {
+        case '{':
+        case '[':
+            if (++mDepth > cMaxDepth) {
+                THROW_WITH_BACKTRACE1(EJsonParseError, "Maximum nesting depth exceeded. " + debug());
+            }
+            if (c == '{') {
+                getIndexedObject(arResult);
+            }
+            else {
+                getIndexedArray(arResult);
+            }
+            mDepth--;
+            break;
+
+        case '"':
+            mStringBuffer.clear();
+            getIndexedString(mStringBuffer);
+            arResult.setString(mStringBuffer);
+            break;
+
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+        case '8':
+        case '9':
+        case '-':
+            getNumber(arResult);
+            endOfScalar();
+            break;
+
+        case 't':
+            expectLiteral("true");
+            arResult = true;
+            endOfScalar();
+            break;
+
+        case 'f':
+            expectLiteral("false");
+            arResult = false;
+            endOfScalar();
+            break;
+
+        case 'n':
+            expectLiteral("null");
+            endOfScalar();
+            break;
+
+        default:
+            THROW_WITH_BACKTRACE1(EJsonParseError, "Illegal start character: " + debug());
+            break;
+    }
+}
+
+} /* namespace rsp::json */
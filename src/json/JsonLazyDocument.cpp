@@ -0,0 +1,513 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <json/JsonDecoder.h>
+#include <json/JsonExceptions.h>
+#include <json/JsonLazyDocument.h>
+#include <magic_enum.hpp>
+
+namespace rsp::json {
+
+static inline bool isWhiteSpace(char c)
+{
+    return (c == ' ') || (c == '\n') || (c == '\r') || (c == '\t');
+}
+
+/**
+ * \brief Walks the structural index once to validate the text and record the end token of every container.
+ *
+ * Token scanning is shared with JsonDecoder, the grammar checks follow JsonIndexedDecoder.
+ */
+class JsonLazyDocument::Validator : public JsonDecoder
+{
+public:
+    explicit Validator(const JsonLazyDocument &arDocument)
+        : JsonDecoder(arDocument.mSource),
+          mrIndex(arDocument.mIndex)
+    {
+    }
+    Validator(const Validator&) = delete;
+    Validator& operator=(const Validator&) = delete;
+
+    void Validate(std::vector<std::uint32_t> &arEnds)
+    {
+        if (mrIndex.GetCount() == 0) {
+            mPos = mJson.size();
+            THROW_WITH_BACKTRACE1(EJsonParseError, "No Json value found. " + debug());
+        }
+        arEnds.resize(mrIndex.GetCount());
+        mpEnds = &arEnds;
+        value();
+        if (mNext < mrIndex.GetCount()) {
+            mPos = peekToken();
+            THROW_WITH_BACKTRACE1(EJsonParseError, "Unexpected content after root value. " + debug());
+        }
+    }
+
+    /**
+     * \brief Decode the string starting at the given text position.
+     */
+    void String(std::size_t aPos, std::string &arResult)
+    {
+        mPos = aPos;
+        getString(arResult);
+    }
+
+protected:
+    const JsonStructuralIndex &mrIndex;
+    std::vector<std::uint32_t> *mpEnds = nullptr;
+    std::uint32_t mNext = 0; // Position in mrIndex of the next token
+    std::string mScratch{};
+
+    std::size_t peekToken() const { return (mNext < mrIndex.GetCount()) ? mrIndex[mNext] : mJson.size(); }
+    char peekChar() const { std::size_t pos = peekToken(); return (pos < mJson.size()) ? mJson[pos] : '\0'; }
+
+    char nextToken()
+    {
+        mPos = peekToken();
+        if (mPos >= mJson.size()) {
+            return '\0';
+        }
+        mNext++;
+        return mJson[mPos];
+    }
+
+    void endOfScalar()
+    {
+        skipWhiteSpace();
+        if (mPos != peekToken()) {
+            THROW_WITH_BACKTRACE1(EJsonParseError, "Unexpected character after value. " + debug());
+        }
+    }
+
+    /*
+     * Integers always fit in one of the number types, only floats
+     * and very long integers need to be converted to check their range.
+     */
+    void number()
+    {
+        bool is_float;
+        std::string_view number = scanNumber(is_float);
+        if (is_float || (number.size() > 20)) {
+            double value;
+            if (std::from_chars(number.data(), number.data() + number.size(), value).ec != std::errc()) {
+                THROW_WITH_BACKTRACE1(EJsonNumberError, "Numeric value is out of range: " + std::string(number));
+            }
+        }
+    }
+
+    /*
+     * The first stage guarantees that every string is terminated,
+     * only strings with escapes need to be decoded to be validated.
+     */
+    void string()
+    {
+        std::size_t end = peekToken();
+        const char *begin = mJson.data() + mPos + 1;
+        if (std::memchr(begin, '\\', end - mPos - 1)) {
+            mScratch.clear();
+            getString(mScratch);
+        }
+    }
+
+    void object(std::uint32_t aToken)
+    {
+        if (peekChar() == '}') {
+            nextToken();
+            (*mpEnds)[aToken] = mNext - 1;
+            return;
+        }
+
+        for (;;) {
+            if (nextToken() != '"') {
+                THROW_WITH_BACKTRACE1(EJsonParseError, "Object member name was not found. " + debug());
+            }
+            string();
+            if (nextToken() != ':') {
+                THROW_WITH_BACKTRACE1(EJsonParseError, "Object key/value delimiter not found. " + debug());
+            }
+            value();
+
+            char c = nextToken();
+            if (c == '}') {
+                (*mpEnds)[aToken] = mNext - 1;
+                return;
+            }
+            if (c != ',') {
+                THROW_WITH_BACKTRACE1(EJsonParseError, "End token was not found. } " + debug());
+            }
+        }
+    }
+
+    void array(std::uint32_t aToken)
+    {
+        if (peekChar() == ']') {
+            nextToken();
+            (*mpEnds)[aToken] = mNext - 1;
+            return;
+        }
+
+        for (;;) {
+            if (peekChar() == ']') {
+                mPos = peekToken();
+                THROW_WITH_BACKTRACE1(EJsonParseError, "Excessive array delimiter found. " + debug());
+            }
+            value();
+
+            char c = nextToken();
+            if (c == ']') {
+                (*mpEnds)[aToken] = mNext - 1;
+                return;
+            }
+            if (c != ',') {
+                THROW_WITH_BACKTRACE1(EJsonParseError, "End token was not found. ] " + debug());
+            }
+        }
+    }
+
+    void value()
+    {
+        char c = nextToken();
+        if (mPos >= mJson.size()) {
+            return;
+        }
+
+        switch (c) {
+            case '{':
+            case '[':
+                if (++mDepth > cMaxDepth) {
+                    THROW_WITH_BACKTRACE1(EJsonParseError, "Maximum nesting depth exceeded. " + debug());
+                }
+                if (c == '{') {
+                    object(mNext - 1);
+                }
+                else {
+                    array(mNext - 1);
+                }
+                mDepth--;
+                break;
+
+            case '"':
+                string();
+                break;
+
+            case '0':
+            case '1':
+            case '2':
+            case '3':
+            case '4':
+            case '5':
+            case '6':
+            case '7':
+            case '8':
+            case '9':
+            case '-':
+                number();
+                endOfScalar();
+                break;
+
+            case 't':
+                expectLiteral("true");
+                endOfScalar();
+                break;
+
+            case 'f':
+                expectLiteral("false");
+                endOfScalar();
+                break;
+
+            case 'n':
+                expectLiteral("null");
+                endOfScalar();
+                break;
+
+            default:
+                THROW_WITH_BACKTRACE1(EJsonParseError, "Illegal start character: " + debug());
+                break;
+        }
+    }
+};
+
+
+JsonLazyDocument::JsonLazyDocument(std::string aJson)
+    : mSource(std::move(aJson)),
+      mIndex(mSource)
+{
+    Validator(*this).Validate(mEnds);
+}
+
+std::uint32_t JsonLazyDocument::next(std::uint32_t aToken) const
+{
+    char c = tokenChar(aToken);
+    if ((c == '{') || (c == '[')) {
+        return mEnds[aToken] + 1;
+    }
+    return aToken + 1;
+}
+
+/*
+ * Position after the last character of the value starting at aToken.
+ */
+std::size_t JsonLazyDocument::textEnd(std::uint32_t aToken) const
+{
+    char c = tokenChar(aToken);
+    if ((c == '{') || (c == '[')) {
+        return mIndex[mEnds[aToken]] + 1;
+    }
+    std::size_t end = (aToken + 1 < mIndex.GetCount()) ? mIndex[aToken + 1] : mSource.size();
+    while ((end > mIndex[aToken]) && isWhiteSpace(mSource[end - 1])) {
+        end--;
+    }
+    return end;
+}
+
+bool JsonLazyDocument::keyEquals(std::uint32_t aToken, std::string_view aKey) const
+{
+    std::size_t start = mIndex[aToken] + 1;
+    std::string_view raw(mSource.data() + start, textEnd(aToken) - 1 - start);
+    if (raw.find('\\') == std::string_view::npos) {
+        return raw == aKey;
+    }
+    std::string key;
+    Validator(*this).String(mIndex[aToken], key);
+    return key == aKey;
+}
+
+
+JsonTypes JsonLazyDocument::Value::GetType() const
+{
+    switch (firstChar()) {
+        case '{':
+            return JsonTypes::Object;
+        case '[':
+            return JsonTypes::Array;
+        case '"':
+            return JsonTypes::String;
+        case 't':
+        case 'f':
+            return JsonTypes::Bool;
+        case 'n':
+        case '\0':
+            return JsonTypes::Null;
+        default:
+            return JsonTypes::Number;
+    }
+}
+
+JsonValue JsonLazyDocument::Value::GetValue() const
+{
+    return JsonDecoder(GetText()).GetValue();
+}
+
+std::string JsonLazyDocument::Value::AsString() const
+{
+    if (GetType() != JsonTypes::String) {
+        return GetValue().AsString();
+    }
+    std::string_view text = GetText();
+    std::string_view raw = text.substr(1, text.size() - 2);
+    if (raw.find('\\') == std::string_view::npos) {
+        return std::string(raw);
+    }
+    std::string result;
+    Validator(*mpDocument).String(mpDocument->mIndex[mToken], result);
+    return result;
+}
+
+std::string_view JsonLazyDocument::Value::GetText() const
+{
+    if (mToken >= mpDocument->mIndex.GetCount()) {
+        return {};
+    }
+    std::size_t start = mpDocument->mIndex[mToken];
+    return std::string_view(mpDocument->mSource).substr(start, mpDocument->textEnd(mToken) - start);
+}
+
+std::size_t JsonLazyDocument::Value::GetCount() const
+{
+    if (!IsObject() && !IsArray()) {
+        return 0;
+    }
+    std::uint32_t skip = IsObject() ? 2 : 0;
+    char end = IsObject() ? '}' : ']';
+    std::uint32_t token = mToken + 1;
+    if (mpDocument->tokenChar(token) == end) {
+        return 0;
+    }
+    std::size_t result = 1;
+    for (token = mpDocument->next(token + skip); mpDocument->tokenChar(token) == ','; token = mpDocument->next(token + 1 + skip)) {
+        result++;
+    }
+    return result;
+}
+
+bool JsonLazyDocument::Value::MemberExists(std::string_view aKey) const
+{
+    std::uint32_t token;
+    return find(aKey, token);
+}
+
+JsonLazyDocument::Value JsonLazyDocument::Value::operator[](std::string_view aKey) const
+{
+    std::uint32_t token;
+    if (!find(aKey, token)) {
+        THROW_WITH_BACKTRACE1(EMemberNotExisting, std::string(aKey));
+    }
+    return Value(*mpDocument, token);
+}
+
+JsonLazyDocument::Value JsonLazyDocument::Value::operator[](std::size_t aIndex) const
+{
+    std::uint32_t token;
+    if (!index(aIndex, token)) {
+        THROW_WITH_BACKTRACE1(std::out_of_range, "Index " + std::to_string(aIndex) + " is out of range");
+    }
+    return Value(*mpDocument, token);
+}
+
+JsonLazyDocument::Value JsonLazyDocument::Value::At(std::string_view aPointer) const
+{
+    std::uint32_t token;
+    if (!resolve(aPointer, token)) {
+        THROW_WITH_BACKTRACE1(EMemberNotExisting, std::string(aPointer));
+    }
+    return Value(*mpDocument, token);
+}
+
+bool JsonLazyDocument::Value::Contains(std::string_view aPointer) const
+{
+    std::uint32_t token;
+    return resolve(aPointer, token);
+}
+
+/*
+ * Members are key, ':' and value tokens followed by ',' or '}'.
+ * Nested containers are skipped in one step by their end token.
+ */
+bool JsonLazyDocument::Value::find(std::string_view aKey, std::uint32_t &arToken) const
+{
+    tryObject();
+    std::uint32_t token = mToken + 1;
+    while (mpDocument->tokenChar(token) == '"') {
+        if (mpDocument->keyEquals(token, aKey)) {
+            arToken = token + 2;
+            return true;
+        }
+        token = mpDocument->next(token + 2);
+        if (mpDocument->tokenChar(token) != ',') {
+            break;
+        }
+        token++;
+    }
+    return false;
+}
+
+bool JsonLazyDocument::Value::index(std::size_t aIndex, std::uint32_t &arToken) const
+{
+    tryContainer();
+    std::size_t skip = IsObject() ? 2 : 0;
+    char end = IsObject() ? '}' : ']';
+    std::uint32_t token = mToken + 1;
+    if (mpDocument->tokenChar(token) == end) {
+        return false;
+    }
+    for (std::size_t i = 0 ; ; ++i) {
+        token += skip;
+        if (i == aIndex) {
+            arToken = token;
+            return true;
+        }
+        token = mpDocument->next(token);
+        if (mpDocument->tokenChar(token) != ',') {
+            return false;
+        }
+        token++;
+    }
+}
+
+/*
+ * RFC 6901: Reference tokens are separated by '/', with "~1" for '/' and "~0" for '~'.
+ * Array indexes are decimal without leading zeros, "-" (past the end) never refers to a value.
+ */
+bool JsonLazyDocument::Value::resolve(std::string_view aPointer, std::uint32_t &arToken) const
+{
+    if (!aPointer.empty() && (aPointer[0] != '/')) {
+        THROW_WITH_BACKTRACE1(EJsonParseError, "JSON Pointer must start with '/': " + std::string(aPointer));
+    }
+
+    Value current(*this);
+    std::string key;
+    std::size_t pos = 0;
+    while (pos < aPointer.size()) {
+        std::size_t end = aPointer.find('/', pos + 1);
+        if (end == std::string_view::npos) {
+            end = aPointer.size();
+        }
+        std::string_view token = aPointer.substr(pos + 1, end - pos - 1);
+        pos = end;
+
+        if (token.find('~') != std::string_view::npos) {
+            key.clear();
+            for (std::size_t i = 0 ; i < token.size() ; ++i) {
+                if (token[i] != '~') {
+                    key += token[i];
+                }
+                else if ((i + 1 < token.size()) && ((token[i + 1] == '0') || (token[i + 1] == '1'))) {
+                    key += (token[++i] == '0') ? '~' : '/';
+                }
+                else {
+                    THROW_WITH_BACKTRACE1(EJsonParseError, "JSON Pointer has invalid escape: " + std::string(aPointer));
+                }
+            }
+            token = key;
+        }
+
+        std::uint32_t found;
+        if (current.IsObject()) {
+            if (!current.find(token, found)) {
+                return false;
+            }
+        }
+        else if (current.IsArray()) {
+            std::size_t i = 0;
+            const char *last = token.data() + token.size();
+            if (token.empty() || ((token[0] == '0') && (token.size() > 1))
+                || (std::from_chars(token.data(), last, i).ptr != last)
+                || !current.index(i, found)) {
+                return false;
+            }
+        }
+        else {
+            return false;
+        }
+        current.mToken = found;
+    }
+    arToken = current.mToken;
+    return true;
+}
+
+void JsonLazyDocument::Value::tryObject() const
+{
+    if (!IsObject()) {
+        THROW_WITH_BACKTRACE1(EJsonTypeError, "Value of type " + std::string(magic_enum::enum_name(GetType())) + " is not an object");
+    }
+}
+
+void JsonLazyDocument::Value::tryContainer() const
+{
+    if (!IsObject() && !IsArray()) {
+        THROW_WITH_BACKTRACE1(EJsonTypeError, "Value of type " + std::string(magic_enum::enum_name(GetType())) + " is not an object or array");
+    }
+}
+
+} /* namespace rsp::json */
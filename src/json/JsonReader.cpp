@@ -0,0 +1,440 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#include <cstring>
+#include <json/JsonDecoder.h>
+#include <json/JsonExceptions.h>
+#include <json/JsonReader.h>
+#include <utils/StrUtils.h>
+
+namespace rsp::json {
+
+static inline bool isWhiteSpace(char c)
+{
+    return (c == ' ') || (c == '\n') || (c == '\r') || (c == '\t');
+}
+
+static inline bool isNumberChar(char c)
+{
+    return ((c >= '0') && (c <= '9')) || (c == '-') || (c == '+') || (c == '.') || (c == 'e') || (c == 'E');
+}
+
+static int hexValue(char c)
+{
+    if ((c >= '0') && (c <= '9')) {
+        return c - '0';
+    }
+    if ((c >= 'a') && (c <= 'f')) {
+        return c - 'a' + 10;
+    }
+    if ((c >= 'A') && (c <= 'F')) {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+JsonReader::JsonReader(std::size_t aMaxStringLength, unsigned int aMaxDepth)
+    : mMaxStringLength(aMaxStringLength),
+      mMaxDepth(aMaxDepth)
+{
+}
+
+JsonReader& JsonReader::Feed(std::string_view aChunk)
+{
+    if (mPos < mInput.size()) {
+        THROW_WITH_BACKTRACE1(EJsonParseError, "Previous chunk was not consumed.");
+    }
+    mInput = aChunk;
+    mPos = 0;
+    return *this;
+}
+
+JsonReader& JsonReader::Finish()
+{
+    mFinished = true;
+    return *this;
+}
+
+void JsonReader::Reset()
+{
+    mInput = {};
+    mPos = 0;
+    mFinished = false;
+    mStarted = false;
+    mStack.clear();
+    mState = State::Value;
+    mToken = Token::None;
+    mText.clear();
+    mHighSurrogate = 0;
+    mTextValue = false;
+    mValue.Clear();
+}
+
+rsp::utils::Variant JsonReader::GetValue() const
+{
+    if (mTextValue) {
+        return rsp::utils::Variant(mText);
+    }
+    return mValue;
+}
+
+JsonReader::Event JsonReader::Next(rsp::posix::FileIO &arFile)
+{
+    Event result = Next();
+    while (result == Event::NeedInput) {
+        mReadBuffer.resize(cReadChunkSize);
+        std::size_t len = arFile.Read(mReadBuffer.data(), mReadBuffer.size());
+        if (len == 0) {
+            Finish();
+        }
+        else {
+            Feed(std::string_view(mReadBuffer.data(), len));
+        }
+        result = Next();
+    }
+    return result;
+}
+
+JsonReader::Event JsonReader::Next()
+{
+    for (;;) {
+        if (mPos >= mInput.size()) {
+            if (!mFinished) {
+                return Event::NeedInput;
+            }
+            return endOfInput();
+        }
+
+        if (mToken != Token::None) {
+            if (scanToken()) {
+                return finishToken();
+            }
+            continue;
+        }
+
+        char c = mInput[mPos];
+        if (isWhiteSpace(c)) {
+            mPos++;
+            continue;
+        }
+
+        switch (mState) {
+            case State::Done:
+                THROW_WITH_BACKTRACE1(EJsonParseError, std::string("Unexpected content after document: '") + c + "'");
+                break;
+
+            case State::Colon:
+                if (c != ':') {
+                    THROW_WITH_BACKTRACE1(EJsonParseError, "Object key/value delimiter not found.");
+                }
+                mPos++;
+                mState = State::Value;
+                break;
+
+            case State::CommaOrEnd:
+                if (c == ',') {
+                    mPos++;
+                    mState = (mStack.back() == '{') ? State::Key : State::Value;
+                    break;
+                }
+                return closeContainer(c);
+
+            case State::KeyOrEnd:
+                if (c == '}') {
+                    return closeContainer(c);
+                }
+                [[fallthrough]];
+            case State::Key:
+                if (c != '"') {
+                    THROW_WITH_BACKTRACE1(EJsonParseError, "Object member name was not found.");
+                }
+                mPos++;
+                mIsKey = true;
+                mTextValue = false;
+                mText.clear();
+                mToken = Token::String;
+                break;
+
+            case State::ValueOrEnd:
+                if (c == ']') {
+                    return closeContainer(c);
+                }
+                [[fallthrough]];
+            case State::Value:
+            {
+                auto event = startValue(c);
+                if (event) {
+                    return *event;
+                }
+                break;
+            }
+        }
+    }
+}
+
+std::optional<JsonReader::Event> JsonReader::startValue(char c)
+{
+    mStarted = true;
+    mIsKey = false;
+    mTextValue = false;
+    mText.clear();
+    mValue.Clear();
+
+    switch (c) {
+        case '{':
+        case '[':
+            if (mStack.size() >= mMaxDepth) {
+                THROW_WITH_BACKTRACE1(EJsonParseError, "Maximum nesting depth exceeded.");
+            }
+            mStack.push_back(c);
+            mPos++;
+            if (c == '{') {
+                mState = State::KeyOrEnd;
+                return Event::StartObject;
+            }
+            mState = State::ValueOrEnd;
+            return Event::StartArray;
+
+        case '"':
+            mPos++;
+            mToken = Token::String;
+            break;
+
+        case 't':
+            mLiteral = "true";
+            mLiteralPos = 0;
+            mToken = Token::Literal;
+            break;
+
+        case 'f':
+            mLiteral = "false";
+            mLiteralPos = 0;
+            mToken = Token::Literal;
+            break;
+
+        case 'n':
+            mLiteral = "null";
+            mLiteralPos = 0;
+            mToken = Token::Literal;
+            break;
+
+        default:
+            if (((c >= '0') && (c <= '9')) || (c == '-')) {
+                mToken = Token::Number;
+                break;
+            }
+            THROW_WITH_BACKTRACE1(EJsonParseError, std::string("Illegal start character: '") + c + "'");
+            break;
+    }
+    return std::nullopt;
+}
+
+JsonReader::Event JsonReader::closeContainer(char c)
+{
+    char open = (c == '}') ? '{' : '[';
+    if (((c != '}') && (c != ']')) || mStack.empty() || (mStack.back() != open)) {
+        THROW_WITH_BACKTRACE1(EJsonParseError, std::string("Unexpected character: '") + c + "'");
+    }
+    mStack.pop_back();
+    mPos++;
+    afterValue();
+    return (c == '}') ? Event::EndObject : Event::EndArray;
+}
+
+JsonReader::Event JsonReader::endOfInput()
+{
+    if (mToken == Token::Number) {
+        return finishToken();
+    }
+    if ((mToken == Token::None) && ((mState == State::Done) || !mStarted)) {
+        return Event::EndOfDocument;
+    }
+    THROW_WITH_BACKTRACE1(EJsonParseError, "Unexpected end of input.");
+}
+
+void JsonReader::afterValue()
+{
+    mState = mStack.empty() ? State::Done : State::CommaOrEnd;
+}
+
+void JsonReader::append(const char *apBegin, const char *apEnd)
+{
+    if ((mText.size() + std::size_t(apEnd - apBegin)) > mMaxStringLength) {
+        THROW_WITH_BACKTRACE1(EJsonParseError, "String exceeds maximum length of " + std::to_string(mMaxStringLength));
+    }
+    mText.append(apBegin, apEnd);
+}
+
+/**
+ * Consume input for the current token.
+ * \return True if the token is complete
+ */
+bool JsonReader::scanToken()
+{
+    const char *begin = mInput.data() + mPos;
+    const char *end = mInput.data() + mInput.size();
+    char c = *begin;
+
+    switch (mToken) {
+        case Token::String:
+        {
+            const char *p = begin;
+            while ((p < end) && (*p != '"') && (*p != '\\')) {
+                p++;
+            }
+            append(begin, p);
+            mPos += std::size_t(p - begin);
+            if (p < end) {
+                mPos++;
+                if (*p == '"') {
+                    return true;
+                }
+                mToken = Token::Escape;
+            }
+            return false;
+        }
+
+        case Token::Escape:
+        {
+            mPos++;
+            char decoded;
+            switch (c) {
+                case '"':
+                case '\\':
+                case '/': decoded = c; break;
+                case 'b': decoded = '\b'; break;
+                case 'f': decoded = '\f'; break;
+                case 'n': decoded = '\n'; break;
+                case 'r': decoded = '\r'; break;
+                case 't': decoded = '\t'; break;
+                case 'u':
+                    mCodePoint = 0;
+                    mHexDigits = 0;
+                    mToken = Token::Unicode;
+                    return false;
+                default:
+                    THROW_WITH_BACKTRACE1(EJsonFormatError, "String contains illegal escape character.");
+            }
+            append(&decoded, &decoded + 1);
+            mToken = Token::String;
+            return false;
+        }
+
+        case Token::Unicode:
+            mPos++;
+            scanUnicode(c);
+            return false;
+
+        case Token::SurrogateEscape:
+        case Token::SurrogateU:
+            if (c != ((mToken == Token::SurrogateEscape) ? '\\' : 'u')) {
+                THROW_WITH_BACKTRACE1(EJsonFormatError, "High surrogate is not followed by a low surrogate.");
+            }
+            mPos++;
+            if (mToken == Token::SurrogateEscape) {
+                mToken = Token::SurrogateU;
+            }
+            else {
+                mCodePoint = 0;
+                mHexDigits = 0;
+                mToken = Token::Unicode;
+            }
+            return false;
+
+        case Token::Number:
+        {
+            const char *p = begin;
+            while ((p < end) && isNumberChar(*p)) {
+                p++;
+            }
+            append(begin, p);
+            mPos += std::size_t(p - begin);
+            return (p < end);
+        }
+
+        case Token::Literal:
+            if (c != mLiteral[mLiteralPos]) {
+                THROW_WITH_BACKTRACE1(EJsonParseError, "Expected " + std::string(mLiteral) + ".");
+            }
+            mPos++;
+            return (++mLiteralPos == mLiteral.size());
+
+        case Token::None:
+            break;
+    }
+    return false;
+}
+
+void JsonReader::scanUnicode(char c)
+{
+    int digit = hexValue(c);
+    if (digit < 0) {
+        THROW_WITH_BACKTRACE1(EJsonFormatError, "Unicode escape is not hexadecimal.");
+    }
+    mCodePoint = (mCodePoint << 4) | static_cast<unsigned int>(digit);
+    if (++mHexDigits < 4) {
+        return;
+    }
+
+    mToken = Token::String;
+    if (mHighSurrogate) {
+        if ((mCodePoint < 0xDC00) || (mCodePoint > 0xDFFF)) {
+            THROW_WITH_BACKTRACE1(EJsonFormatError, "High surrogate is not followed by a low surrogate.");
+        }
+        mCodePoint = 0x10000 + ((mHighSurrogate - 0xD800) << 10) + (mCodePoint - 0xDC00);
+        mHighSurrogate = 0;
+    }
+    else if ((mCodePoint >= 0xD800) && (mCodePoint <= 0xDBFF)) {
+        mHighSurrogate = mCodePoint;
+        mToken = Token::SurrogateEscape;
+        return;
+    }
+    else if ((mCodePoint >= 0xDC00) && (mCodePoint <= 0xDFFF)) {
+        THROW_WITH_BACKTRACE1(EJsonFormatError, "Low surrogate without high surrogate.");
+    }
+
+    if ((mText.size() + 4) > mMaxStringLength) {
+        THROW_WITH_BACKTRACE1(EJsonParseError, "String exceeds maximum length of " + std::to_string(mMaxStringLength));
+    }
+    rsp::utils::StrUtils::AppendUtf8(mText, mCodePoint);
+}
+
+JsonReader::Event JsonReader::finishToken()
+{
+    Token token = mToken;
+    mToken = Token::None;
+
+    switch (token) {
+        case Token::String:
+            if (mIsKey) {
+                mState = State::Colon;
+                return Event::Key;
+            }
+            mTextValue = true;
+            afterValue();
+            return Event::String;
+
+        case Token::Number:
+            // Reuse the decoder for number validation and conversion
+            mValue = JsonDecoder(mText).GetValue();
+            afterValue();
+            return Event::Number;
+
+        default: // Literal
+            afterValue();
+            if (mLiteral[0] == 'n') {
+                return Event::Null;
+            }
+            mValue = (mLiteral[0] == 't');
+            return Event::Bool;
+    }
+}
+
+} /* namespace rsp::json */
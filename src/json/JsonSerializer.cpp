@@ -0,0 +1,89 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#include <array>
+#include <limits>
+#include <json/JsonSerializer.h>
+#include <magic_enum.hpp>
+
+namespace rsp::json {
+
+template <class T>
+static void appendChars(std::string &arResult, T aValue)
+{
+    std::array<char, 32> buf;
+    char *end;
+    if constexpr (std::is_floating_point_v<T>) {
+        end = std::to_chars(buf.data(), buf.data() + buf.size(), aValue, std::chars_format::general, std::numeric_limits<T>::max_digits10).ptr;
+    }
+    else {
+        end = std::to_chars(buf.data(), buf.data() + buf.size(), aValue).ptr;
+    }
+    arResult.append(buf.data(), end);
+}
+
+void JsonSerializer::appendNumber(std::string &arResult, std::int64_t aValue)
+{
+    appendChars(arResult, aValue);
+}
+
+void JsonSerializer::appendNumber(std::string &arResult, std::uint64_t aValue)
+{
+    appendChars(arResult, aValue);
+}
+
+void JsonSerializer::appendNumber(std::string &arResult, float aValue)
+{
+    appendChars(arResult, aValue);
+}
+
+void JsonSerializer::appendNumber(std::string &arResult, double aValue)
+{
+    appendChars(arResult, aValue);
+}
+
+void JsonSerializer::appendString(std::string &arResult, std::string_view aValue)
+{
+    arResult += '"';
+    JsonEncoder::EscapeString(arResult, aValue);
+    arResult += '"';
+}
+
+void JsonSerializer::typeError(std::string_view aExpected, JsonReader::Event aEvent)
+{
+    THROW_WITH_BACKTRACE1(EJsonTypeError, "Expected " + std::string(aExpected) + ", found " + std::string(magic_enum::enum_name(aEvent)));
+}
+
+void JsonSerializer::numberError(std::string_view aText, std::string_view aType)
+{
+    THROW_WITH_BACKTRACE1(EJsonNumberError, "Value " + std::string(aText) + " is not a valid " + std::string(aType));
+}
+
+JsonReader::Event JsonSerializer::Input::Next()
+{
+    JsonReader::Event result = mpFile ? mrReader.Next(*mpFile) : mrReader.Next();
+    if (result == JsonReader::Event::NeedInput) {
+        THROW_WITH_BACKTRACE1(EJsonParseError, "Json value is incomplete, more input is needed.");
+    }
+    return result;
+}
+
+void JsonSerializer::skipValue(Input &arInput, JsonReader::Event aEvent)
+{
+    if ((aEvent != JsonReader::Event::StartObject) && (aEvent != JsonReader::Event::StartArray)) {
+        return;
+    }
+    std::size_t depth = arInput.mrReader.GetDepth();
+    while (arInput.mrReader.GetDepth() >= depth) {
+        arInput.Next();
+    }
+}
+
+} /* namespace rsp::json */
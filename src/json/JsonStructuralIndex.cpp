@@ -0,0 +1,322 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#include <array>
+#include <bit>
+#include <cstring>
+#include <json/JsonExceptions.h>
+#include <json/JsonStructuralIndex.h>
+#include <magic_enum.hpp>
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#define JSON_INDEX_X86
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define JSON_INDEX_NEON
+#include <arm_neon.h>
+#endif
+
+namespace rsp::json {
+
+using Kernels = JsonStructuralIndex::Kernels;
+
+/**
+ * \brief Classification of a 64 byte block, bit n represents byte n.
+ */
+struct BlockMasks {
+    std::uint64_t mQuote;
+    std::uint64_t mBackslash;
+    std::uint64_t mWhiteSpace;
+    std::uint64_t mOperator;
+};
+
+using Classifier_t = void (*)(const char *apBlock, BlockMasks &arMasks);
+
+static constexpr std::size_t cBlockSize = 64;
+
+static constexpr std::uint8_t cQuote = 0x01;
+static constexpr std::uint8_t cBackslash = 0x02;
+static constexpr std::uint8_t cWhiteSpace = 0x04;
+static constexpr std::uint8_t cOperator = 0x08;
+
+static constexpr std::array<std::uint8_t, 256> makeClassTable()
+{
+    std::array<std::uint8_t, 256> table{};
+    table[std::size_t('"')] = cQuote;
+    table[std::size_t('\\')] = cBackslash;
+    for (char c : {' ', '\t', '\n', '\r'}) {
+        table[std::size_t(c)] = cWhiteSpace;
+    }
+    for (char c : {'{', '}', '[', ']', ':', ','}) {
+        table[std::size_t(c)] = cOperator;
+    }
+    return table;
+}
+
+static constexpr std::array<std::uint8_t, 256> cClassTable = makeClassTable();
+
+static void classifyScalar(const char *apBlock, BlockMasks &arMasks)
+{
+    arMasks = BlockMasks();
+    for (unsigned int i = 0 ; i < cBlockSize ; ++i) {
+        std::uint64_t c = cClassTable[static_cast<unsigned char>(apBlock[i])];
+        arMasks.mQuote |= (c & 1) << i;
+        arMasks.mBackslash |= ((c >> 1) & 1) << i;
+        arMasks.mWhiteSpace |= ((c >> 2) & 1) << i;
+        arMasks.mOperator |= ((c >> 3) & 1) << i;
+    }
+}
+
+/*
+ * '[' and '{', and ']' and '}', only differ in bit 5, so the vector classifiers
+ * match brackets and braces with two compares on the byte or'ed with 0x20.
+ */
+#ifdef JSON_INDEX_X86
+static inline std::uint64_t movemask(__m128i aMask)
+{
+    return static_cast<std::uint16_t>(_mm_movemask_epi8(aMask));
+}
+
+static void classifySse2(const char *apBlock, BlockMasks &arMasks)
+{
+    arMasks = BlockMasks();
+    for (unsigned int i = 0 ; i < 4 ; ++i) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(apBlock + (16 * i)));
+        __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+                                  _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+        __m128i op = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(lower, _mm_set1_epi8('{')), _mm_cmpeq_epi8(lower, _mm_set1_epi8('}'))),
+                                  _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(':')), _mm_cmpeq_epi8(v, _mm_set1_epi8(','))));
+
+        unsigned int shift = 16 * i;
+        arMasks.mQuote |= movemask(_mm_cmpeq_epi8(v, _mm_set1_epi8('"'))) << shift;
+        arMasks.mBackslash |= movemask(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))) << shift;
+        arMasks.mWhiteSpace |= movemask(ws) << shift;
+        arMasks.mOperator |= movemask(op) << shift;
+    }
+}
+
+__attribute__((target("avx2")))
+static inline std::uint64_t movemask256(__m256i aMask)
+{
+    return static_cast<std::uint32_t>(_mm256_movemask_epi8(aMask));
+}
+
+__attribute__((target("avx2")))
+static void classifyAvx2(const char *apBlock, BlockMasks &arMasks)
+{
+    arMasks = BlockMasks();
+    for (unsigned int i = 0 ; i < 2 ; ++i) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(apBlock + (32 * i)));
+        __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        __m256i ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+                                     _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+        __m256i op = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(lower, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('}'))),
+                                     _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(','))));
+
+        unsigned int shift = 32 * i;
+        arMasks.mQuote |= movemask256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'))) << shift;
+        arMasks.mBackslash |= movemask256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))) << shift;
+        arMasks.mWhiteSpace |= movemask256(ws) << shift;
+        arMasks.mOperator |= movemask256(op) << shift;
+    }
+}
+#endif /* JSON_INDEX_X86 */
+
+#ifdef JSON_INDEX_NEON
+/*
+ * NEON has no movemask, so the compare results are weighted by bit position and
+ * reduced with pairwise additions. Only 64 bit vpadd is used, it exists on ARMv7 as well as AArch64.
+ */
+static inline std::uint64_t movemask(const std::array<uint8x16_t, 4> &arMasks)
+{
+    static const std::uint8_t cWeights[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+    const uint8x16_t weights = vld1q_u8(cWeights);
+
+    std::array<uint8x8_t, 4> sums;
+    for (std::size_t i = 0 ; i < 4 ; ++i) {
+        uint8x16_t t = vandq_u8(arMasks[i], weights);
+        sums[i] = vpadd_u8(vget_low_u8(t), vget_high_u8(t));
+    }
+    uint8x8_t result = vpadd_u8(vpadd_u8(sums[0], sums[1]), vpadd_u8(sums[2], sums[3]));
+    return vget_lane_u64(vreinterpret_u64_u8(result), 0);
+}
+
+static void classifyNeon(const char *apBlock, BlockMasks &arMasks)
+{
+    std::array<uint8x16_t, 4> quote, backslash, ws, op;
+    for (std::size_t i = 0 ; i < 4 ; ++i) {
+        uint8x16_t v = vld1q_u8(reinterpret_cast<const std::uint8_t*>(apBlock) + (16 * i));
+        uint8x16_t lower = vorrq_u8(v, vdupq_n_u8(0x20));
+        quote[i] = vceqq_u8(v, vdupq_n_u8('"'));
+        backslash[i] = vceqq_u8(v, vdupq_n_u8('\\'));
+        ws[i] = vorrq_u8(vorrq_u8(vceqq_u8(v, vdupq_n_u8(' ')), vceqq_u8(v, vdupq_n_u8('\t'))),
+                         vorrq_u8(vceqq_u8(v, vdupq_n_u8('\n')), vceqq_u8(v, vdupq_n_u8('\r'))));
+        op[i] = vorrq_u8(vorrq_u8(vceqq_u8(lower, vdupq_n_u8('{')), vceqq_u8(lower, vdupq_n_u8('}'))),
+                         vorrq_u8(vceqq_u8(v, vdupq_n_u8(':')), vceqq_u8(v, vdupq_n_u8(','))));
+    }
+    arMasks.mQuote = movemask(quote);
+    arMasks.mBackslash = movemask(backslash);
+    arMasks.mWhiteSpace = movemask(ws);
+    arMasks.mOperator = movemask(op);
+}
+#endif /* JSON_INDEX_NEON */
+
+static Classifier_t getClassifier(Kernels aKernel)
+{
+    switch (aKernel) {
+        case Kernels::Scalar:
+            return &classifyScalar;
+
+#ifdef JSON_INDEX_X86
+        case Kernels::Sse2:
+            return &classifySse2;
+
+        case Kernels::Avx2:
+            if (__builtin_cpu_supports("avx2")) {
+                return &classifyAvx2;
+            }
+            break;
+#endif
+
+#ifdef JSON_INDEX_NEON
+        case Kernels::Neon:
+            return &classifyNeon;
+#endif
+
+        default:
+            break;
+    }
+    return nullptr;
+}
+
+/*
+ * Bit n of the result is the xor of bits 0 to n, so it is set from an opening quote
+ * up to, but not including, the closing quote.
+ */
+static inline std::uint64_t prefixXor(std::uint64_t aBits)
+{
+    aBits ^= aBits << 1;
+    aBits ^= aBits << 2;
+    aBits ^= aBits << 4;
+    aBits ^= aBits << 8;
+    aBits ^= aBits << 16;
+    aBits ^= aBits << 32;
+    return aBits;
+}
+
+/*
+ * Find the characters escaped by a backslash. A character is escaped if it is preceded by
+ * an odd length run of backslashes. Runs starting on odd and even bits are separated by
+ * adding the run starts to the runs, the carry ripples through each run.
+ * arPrevEscaped carries an escape over the block boundary.
+ */
+static inline std::uint64_t findEscaped(std::uint64_t aBackslash, std::uint64_t &arPrevEscaped)
+{
+    constexpr std::uint64_t cEvenBits = 0x5555555555555555ULL;
+
+    if (!aBackslash && !arPrevEscaped) {
+        return 0;
+    }
+
+    aBackslash &= ~arPrevEscaped;
+    std::uint64_t follows_escape = (aBackslash << 1) | arPrevEscaped;
+    std::uint64_t odd_starts = aBackslash & ~cEvenBits & ~follows_escape;
+    std::uint64_t even_runs = odd_starts + aBackslash;
+    arPrevEscaped = (even_runs < odd_starts) ? 1 : 0;
+    std::uint64_t invert_mask = even_runs << 1;
+
+    return (cEvenBits ^ invert_mask) & follows_escape;
+}
+
+JsonStructuralIndex::JsonStructuralIndex(std::string_view aJson, Kernels aKernel)
+{
+    Classifier_t classify = getClassifier(aKernel);
+    if (!classify) {
+        THROW_WITH_BACKTRACE1(EJsonException, "Structural index kernel is not supported: " + std::string(magic_enum::enum_name(aKernel)));
+    }
+    if (aJson.size() >= UINT32_MAX) {
+        THROW_WITH_BACKTRACE1(EJsonParseError, "Json text is too large to index.");
+    }
+
+    std::uint64_t prev_escaped = 0;
+    std::uint64_t prev_in_string = 0;
+    std::uint64_t prev_scalar = 0;
+    std::size_t count = 0;
+    mPositions.resize((aJson.size() / 8) + cBlockSize);
+
+    std::array<char, cBlockSize> tail;
+    const std::size_t full_blocks_end = aJson.size() & ~(cBlockSize - 1);
+
+    for (std::size_t pos = 0 ; pos < aJson.size() ; pos += cBlockSize) {
+        const char *block = aJson.data() + pos;
+        if (pos == full_blocks_end) {
+            // Pad the last block with whitespace, it does not change any tokens
+            tail.fill(' ');
+            std::memcpy(tail.data(), block, aJson.size() - pos);
+            block = tail.data();
+        }
+
+        BlockMasks masks;
+        classify(block, masks);
+
+        std::uint64_t escaped = findEscaped(masks.mBackslash, prev_escaped);
+        std::uint64_t quote = masks.mQuote & ~escaped;
+        std::uint64_t in_string = prefixXor(quote) ^ prev_in_string;
+        prev_in_string = static_cast<std::uint64_t>(static_cast<std::int64_t>(in_string) >> 63);
+        std::uint64_t string_tail = in_string ^ quote; // String content and closing quote
+
+        // A scalar starts at any non whitespace, non operator character not following another one.
+        // Opening quotes are scalar starts, the rest of the string is masked out.
+        std::uint64_t scalar = ~(masks.mOperator | masks.mWhiteSpace);
+        std::uint64_t nonquote_scalar = scalar & ~quote;
+        std::uint64_t follows_scalar = (nonquote_scalar << 1) | prev_scalar;
+        prev_scalar = nonquote_scalar >> 63;
+
+        std::uint64_t structurals = (masks.mOperator | (scalar & ~follows_scalar)) & ~string_tail;
+
+        if ((count + cBlockSize) > mPositions.size()) {
+            mPositions.resize(mPositions.size() * 2);
+        }
+        std::uint32_t *out = mPositions.data() + count;
+        auto base = static_cast<std::uint32_t>(pos);
+        while (structurals) {
+            *out++ = base + static_cast<std::uint32_t>(std::countr_zero(structurals));
+            structurals &= structurals - 1;
+        }
+        count = std::size_t(out - mPositions.data());
+    }
+
+    mPositions.resize(count);
+
+    if (prev_in_string) {
+        THROW_WITH_BACKTRACE1(EJsonParseError, "End token was not found. \"");
+    }
+}
+
+JsonStructuralIndex::Kernels JsonStructuralIndex::GetBestKernel()
+{
+    static const Kernels best = [] {
+        for (Kernels kernel : { Kernels::Avx2, Kernels::Neon, Kernels::Sse2 }) {
+            if (IsSupported(kernel)) {
+                return kernel;
+            }
+        }
+        return Kernels::Scalar;
+    }();
+    return best;
+}
+
+bool JsonStructuralIndex::IsSupported(Kernels aKernel)
+{
+    return getClassifier(aKernel) != nullptr;
+}
+
+} /* namespace rsp::json */
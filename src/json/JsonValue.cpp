@@ -9,6 +9,8 @@
  */
 
 #include <json/JsonDecoder.h>
+#include <json/JsonEncoder.h>
+#include <json/JsonIndexedDecoder.h>
 #include <json/JsonExceptions.h>
 #include <json/JsonValue.h>
 #include <iomanip>
@@ -56,15 +58,17 @@ JsonValue::JsonValue(JsonTypes aType)
 JsonValue::JsonValue(const JsonValue& arOther)
     : Variant(arOther),
       mName(arOther.mName),
-      mItems(arOther.mItems)
+      mItems(arOther.mItems),
+      mIndex(arOther.mIndex)
 {
     JLOG("JsonValue copy constructor");
 }
 
-JsonValue::JsonValue(JsonValue&& arOther)
+JsonValue::JsonValue(JsonValue&& arOther) noexcept
     : Variant(std::move(arOther)),
       mName(std::move(arOther.mName)),
-      mItems(std::move(arOther.mItems))
+      mItems(std::move(arOther.mItems)),
+      mIndex(std::move(arOther.mIndex))
 {
     JLOG("JsonValue move constructor");
 }
@@ -79,18 +83,20 @@ JsonValue& JsonValue::operator=(const JsonValue& arOther)
         Variant::operator=(arOther);
         mName = arOther.mName;
         mItems = arOther.mItems;
+        mIndex = arOther.mIndex;
         JLOG("JsonValue copy assignment");
     }
     return *this;
 }
 
 
-JsonValue& JsonValue::operator=(JsonValue&& arOther)
+JsonValue& JsonValue::operator=(JsonValue&& arOther) noexcept
 {
     if (&arOther != this) {
         Variant::operator=(std::move(arOther));
         mName = std::move(arOther.mName);
         mItems = std::move(arOther.mItems);
+        mIndex = std::move(arOther.mIndex);
         JLOG("JsonValue move assignment");
     }
     return *this;
@@ -114,8 +120,12 @@ std::string JsonValue::Encode(bool aPrettyPrint, bool aForceToUCS2, unsigned int
     return result.str();
 }
 
-JsonValue JsonValue::Decode(std::string_view aJson)
+JsonValue JsonValue::Decode(std::string_view aJson, bool aUseStructuralIndex)
 {
+    if (aUseStructuralIndex) {
+        return JsonIndexedDecoder(aJson).GetValue();
+    }
+
     JsonDecoder js(aJson);
 
     JsonValue result;
@@ -127,10 +137,9 @@ JsonValue& JsonValue::operator [](std::string_view aKey)
 {
     JLOG("Access member " << aKey);
     forceObject();
-    for (JsonValue &v : mItems) {
-        if (v.mName == aKey) {
-            return v;
-        }
+    std::size_t pos = findMember(aKey);
+    if (pos != rsp::utils::MemberIndex::npos) {
+        return mItems[pos];
     }
     THROW_WITH_BACKTRACE1(EMemberNotExisting, std::string(aKey));
 }
@@ -139,10 +148,9 @@ const JsonValue& JsonValue::operator [](std::string_view aKey) const
 {
     JLOG("Getting member " << aKey);
     tryObject();
-    for (const JsonValue &v : mItems) {
-        if (v.mName == aKey) {
-            return v;
-        }
+    std::size_t pos = findMember(aKey);
+    if (pos != rsp::utils::MemberIndex::npos) {
+        return mItems[pos];
     }
     THROW_WITH_BACKTRACE1(EMemberNotExisting, std::string(aKey));
 }
@@ -189,28 +197,24 @@ std::vector<std::string> JsonValue::GetMemberNames() const
 bool JsonValue::MemberExists(std::string_view aKey) const
 {
     tryObject();
-    for (const JsonValue &v : mItems) {
-        if (v.mName == aKey) {
-            return true;
-        }
-    }
-    return false;
+    return (findMember(aKey) != rsp::utils::MemberIndex::npos);
 }
 
 JsonValue& JsonValue::Add(JsonValue aValue)
 {
     forceArray();
-    Logger::GetDefault().Info() << "JsonArray::Add(): " << aValue.Encode();
-    mItems.emplace_back(aValue);
+    JLOG("JsonArray::Add(): " << aValue.Encode());
+    mItems.emplace_back(std::move(aValue));
     return *this;
 }
 
 JsonValue& JsonValue::Add(std::string_view aKey, JsonValue aValue)
 {
     forceObject();
-    Logger::GetDefault().Info() << "JsonObject::Add(): \"" << aKey << "\": " << aValue.Encode();
+    JLOG("JsonObject::Add(): \"" << aKey << "\": " << aValue.Encode());
     aValue.mName = aKey;
-    mItems.push_back(aValue);
+    mItems.push_back(std::move(aValue));
+    mIndex.Append(mItems.size(), [this](std::size_t i) -> std::string_view { return mItems[i].mName; });
     return *this;
 }
 
@@ -224,13 +228,12 @@ JsonValue& JsonValue::Remove(int aIndex)
 JsonValue& JsonValue::Remove(std::string_view aKey)
 {
     tryObject();
-    auto it = std::find_if(mItems.begin(), mItems.end(), [&aKey](const JsonValue& arValue) {
-        if (arValue.mName == aKey) {
-            return true;
-        }
-        return false;
-    });
-    mItems.erase(it);
+    std::size_t pos = findMember(aKey);
+    if (pos == rsp::utils::MemberIndex::npos) {
+        THROW_WITH_BACKTRACE1(EMemberNotExisting, std::string(aKey));
+    }
+    mItems.erase(mItems.begin() + static_cast<std::ptrdiff_t>(pos));
+    rebuildIndex();
     return *this;
 }
 
@@ -238,9 +241,20 @@ void JsonValue::Clear()
 {
     mName.clear();
     mItems.clear();
-    mType = Types::Null;
+    mIndex.Clear();
+    reset(Types::Null);
+}
+
+
+std::size_t JsonValue::findMember(std::string_view aKey) const
+{
+    return mIndex.Find(aKey, mItems.size(), [this](std::size_t i) -> std::string_view { return mItems[i].mName; });
 }
 
+void JsonValue::rebuildIndex()
+{
+    mIndex.Rebuild(mItems.size(), [this](std::size_t i) -> std::string_view { return mItems[i].mName; });
+}
 
 void JsonValue::tryArray() const
 {
@@ -337,68 +351,13 @@ JsonTypes JsonValue::GetJsonType() const
 void JsonValue::stringToStringStream(std::stringstream &arResult, PrintFormat &arPf, unsigned int aLevel,
     bool aForceToUCS2) const
 {
-    std::string s = AsString();
-    std::size_t i = 0;
-    while (i < s.length()) {
-        auto c = s[i];
-        switch (c) {
-            case '\"':
-                s.replace(i, 1, "\\\"");
-                break;
-            case '\\':
-                s.replace(i, 1, "\\\\");
-                break;
-            case '\b':
-                s.replace(i, 1, "\\b");
-                break;
-            case '\f':
-                s.replace(i, 1, "\\f");
-                break;
-            case '\n':
-                s.replace(i, 1, "\\n");
-                break;
-            case '\r':
-                s.replace(i, 1, "\\r");
-                break;
-            case '\t':
-                s.replace(i, 1, "\\t");
-                break;
-            default:
-                if (aForceToUCS2 && static_cast<uint8_t>(c) > 127) {
-                    int v = 0;
-                    char buf[12];
-                    switch (static_cast<uint8_t>(c) & 0xE0) {
-                        case 0xE0:
-                            v =   ((static_cast<int>(s[i]) & 0x0F) << 12)
-                                + ((static_cast<int>(s[i+1]) & 0x3F) << 6)
-                                + (static_cast<int>(s[i+2]) & 0x3F);
-                            sprintf(buf, "\\u%04x", v);
-                            s.replace(i, 3, buf);
-                            i += 4;
-                            break;
-
-                        case 0xC0:
-                            v =   ((static_cast<int>(s[i]) & 0x1F) << 6)
-                                + (static_cast<int>(s[i+1]) & 0x3F);
-                            sprintf(buf, "\\u%04x", v);
-                            s.replace(i, 2, buf);
-                            i += 4;
-                            break;
-
-                        default:
-                            THROW_WITH_BACKTRACE1(EJsonParseError, "JsonValue of type string has illegal character: " + c);
-                            break;
-                    }
-                }
-                break;
-        }
-        i++;
-    }
-    arResult << "\"" << s << "\"";
-//        DLOG("toStringSteam: " << s);
-//        for (auto c : s) {
-//            DLOG("toStringSteam: " << std::setfill('0') << std::setw(2) << std::hex << static_cast<int>(c) << std::dec << " " << c);
-//        }
+    std::string_view value = RawAsString();
+    std::string s;
+    s.reserve(value.size() + 2);
+    s += '"';
+    JsonEncoder::EscapeString(s, value, aForceToUCS2);
+    s += '"';
+    arResult << s;
 }
 
 void JsonValue::arrayToStringStream(std::stringstream &arResult, PrintFormat &arPf, unsigned int aLevel,
@@ -517,7 +476,7 @@ bool JsonValue::operator ==(const JsonValue &arOther) const
         case JsonTypes::Array: {
             int i = 0;
             for (const JsonValue &jv : mItems) {
-                if (!(jv == arOther[i])) {
+                if (!(jv == arOther[i++])) {
                     return false;
                 }
             }
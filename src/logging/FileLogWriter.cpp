@@ -10,9 +10,6 @@
 
 #include <iostream>
 #include <fstream>
-#include <sstream>
-#include <iomanip>
-#include <utils/DateTime.h>
 #include <logging/FileLogWriter.h>
 #include <json/JsonEncoder.h>
 
@@ -40,8 +37,7 @@ FileLogWriter::~FileLogWriter()
 void FileLogWriter::Write(const std::string &arMsg, LogLevel aCurrentLevel, const std::string &arChannel, const rsp::utils::DynamicData &arContext)
 {
     if (arMsg.length() && (mAcceptLevel >= aCurrentLevel)) {
-        DateTime dt;
-        mOutput << "[" << dt.ToLogging() << "] ";
+        mOutput << "[" << mTimestamp.Now() << "] ";
         if (arChannel.length()) {
             mOutput << "<" << arChannel << "> ";
         }
@@ -0,0 +1,336 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <logging/FlightRecorderLogWriter.h>
+#include <utils/CoreException.h>
+#include <utils/DateTime.h>
+#include <utils/ExceptionHelper.h>
+
+namespace rsp::logging {
+
+static constexpr std::array<int, 5> cFatalSignals = { SIGSEGV, SIGABRT, SIGBUS, SIGFPE, SIGILL };
+static constexpr std::size_t cMaxRecordSize = 4096;
+static constexpr std::size_t cSignalStackSize = 64 * 1024;
+
+static constexpr std::array<const char*, std::size_t(LogLevel::__END__)> cLevelNames = {
+    "Emergency", "Alert", "Critical", "Error", "Warning", "Notice", "Info", "Debug"
+};
+
+static std::array<struct sigaction, cFatalSignals.size()> sOldActions{};
+static std::atomic<const FlightRecorderLogWriter*> spSignalInstance{nullptr};
+
+/**
+ * \brief Buffered writer to a file descriptor, using only async-signal-safe calls.
+ */
+class FdWriter
+{
+public:
+    explicit FdWriter(int aFd) : mFd(aFd) {}
+
+    void Put(const char *apData, std::size_t aSize)
+    {
+        while (aSize) {
+            std::size_t len = std::min(aSize, mBuffer.size() - mLength);
+            std::memcpy(&mBuffer[mLength], apData, len);
+            mLength += len;
+            apData += len;
+            aSize -= len;
+            if (mLength == mBuffer.size()) {
+                Flush();
+            }
+        }
+    }
+
+    void Put(const char *apCStr) { Put(apCStr, std::strlen(apCStr)); }
+
+    bool Flush()
+    {
+        std::size_t done = 0;
+        while (done < mLength) {
+            ssize_t res = ::write(mFd, &mBuffer[done], mLength - done);
+            if (res <= 0) {
+                mOk = false;
+                break;
+            }
+            done += static_cast<std::size_t>(res);
+        }
+        mLength = 0;
+        return mOk;
+    }
+
+protected:
+    int mFd;
+    bool mOk = true;
+    std::size_t mLength = 0;
+    std::array<char, 4096> mBuffer{};
+};
+
+/**
+ * \brief Alternate signal stack of a thread, released again when the thread exits.
+ */
+class SignalStack
+{
+public:
+    SignalStack()
+    {
+        stack_t current{};
+        sigaltstack(nullptr, &current);
+        if (!(current.ss_flags & SS_DISABLE)) {
+            return; // Keep the stack already given to this thread
+        }
+        mStack.resize(std::max(cSignalStackSize, static_cast<std::size_t>(SIGSTKSZ)));
+        stack_t stack{};
+        stack.ss_sp = mStack.data();
+        stack.ss_size = mStack.size();
+        if (sigaltstack(&stack, nullptr) != 0) {
+            THROW_SYSTEM("sigaltstack() failed");
+        }
+    }
+
+    ~SignalStack()
+    {
+        stack_t current{};
+        sigaltstack(nullptr, &current);
+        if (!mStack.empty() && (current.ss_sp == mStack.data())) {
+            stack_t disable{};
+            disable.ss_flags = SS_DISABLE;
+            sigaltstack(&disable, nullptr);
+        }
+    }
+
+    SignalStack(const SignalStack&) = delete;
+    SignalStack& operator=(const SignalStack&) = delete;
+
+protected:
+    std::vector<char> mStack{};
+};
+
+void FlightRecorderLogWriter::InstallSignalStack()
+{
+    thread_local SignalStack stack;
+}
+
+FlightRecorderLogWriter::FlightRecorderLogWriter(std::size_t aCapacity, std::string aDumpFileName, bool aHandleSignals)
+    : mBuffer(std::bit_ceil(std::max(aCapacity, std::size_t(1024)))),
+      mMask(mBuffer.size() - 1),
+      mDumpFileName(std::move(aDumpFileName)),
+      mHandleSignals(aHandleSignals)
+{
+    mAcceptLevel = LogLevel::Debug;
+
+    if (mHandleSignals) {
+        const FlightRecorderLogWriter *expected = nullptr;
+        if (!spSignalInstance.compare_exchange_strong(expected, this)) {
+            THROW_WITH_BACKTRACE1(rsp::utils::CoreException, "Fatal signals are already handled by another flight recorder");
+        }
+
+        // Let the handler run even if the signal was caused by a stack overflow
+        InstallSignalStack();
+
+        struct sigaction action{};
+        action.sa_handler = &FlightRecorderLogWriter::signalHandler;
+        action.sa_flags = SA_ONSTACK;
+        sigemptyset(&action.sa_mask);
+        for (std::size_t i = 0 ; i < cFatalSignals.size() ; ++i) {
+            sigaction(cFatalSignals[i], &action, &sOldActions[i]);
+        }
+    }
+}
+
+FlightRecorderLogWriter::~FlightRecorderLogWriter()
+{
+    if (mHandleSignals) {
+        for (std::size_t i = 0 ; i < cFatalSignals.size() ; ++i) {
+            sigaction(cFatalSignals[i], &sOldActions[i], nullptr);
+        }
+        spSignalInstance = nullptr;
+    }
+}
+
+void FlightRecorderLogWriter::Write(const std::string &arMsg, LogLevel aCurrentLevel, const std::string &arChannel, const rsp::utils::DynamicData&)
+{
+    if (!arMsg.length() || (mAcceptLevel < aCurrentLevel)) {
+        return;
+    }
+
+    // Keep every record well below the capacity, so a dump always contains a couple of records,
+    // and small enough to be copied to the stack of the dump.
+    constexpr std::size_t cOverhead = sizeof(RecordHeader) + sizeof(std::uint32_t);
+    std::size_t max_payload = std::min(mBuffer.size() / 4, cMaxRecordSize) - cOverhead;
+    std::size_t channel_length = std::min(arChannel.length(), std::min(max_payload / 2, std::size_t(UINT16_MAX)));
+    std::size_t message_length = std::min(arMsg.length(), max_payload - channel_length);
+
+    RecordHeader header{};
+    header.mSize = static_cast<std::uint32_t>((cOverhead + channel_length + message_length + 7) & ~std::size_t(7));
+    header.mLevel = static_cast<std::uint8_t>(aCurrentLevel);
+    header.mChannelLength = static_cast<std::uint16_t>(channel_length);
+    header.mMessageLength = static_cast<std::uint32_t>(message_length);
+    header.mTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+    std::uint64_t start = mReserved.fetch_add(header.mSize, std::memory_order_relaxed);
+    header.mSequence = start;
+    put(start, &header, sizeof(header));
+    put(start + sizeof(header), arChannel.data(), channel_length);
+    put(start + sizeof(header) + channel_length, arMsg.data(), message_length);
+    put(start + header.mSize - sizeof(std::uint32_t), &header.mSize, sizeof(std::uint32_t));
+
+    // Records are published in reservation order. Writes are normally serialized by the logger, so this never spins.
+    while (mCommitted.load(std::memory_order_acquire) != start) {
+        std::this_thread::yield();
+    }
+    mCommitted.store(start + header.mSize, std::memory_order_release);
+
+    if (aCurrentLevel <= LogLevel::Critical) {
+        Dump();
+    }
+}
+
+bool FlightRecorderLogWriter::Dump() const
+{
+    return dumpToFile(mDumpFileName.c_str());
+}
+
+bool FlightRecorderLogWriter::Dump(const std::string &arFileName) const
+{
+    return dumpToFile(arFileName.c_str());
+}
+
+void FlightRecorderLogWriter::put(std::uint64_t aPos, const void *apData, std::size_t aSize)
+{
+    std::size_t offset = aPos & mMask;
+    std::size_t first = std::min(aSize, mBuffer.size() - offset);
+    std::memcpy(&mBuffer[offset], apData, first);
+    std::memcpy(&mBuffer[0], static_cast<const char*>(apData) + first, aSize - first);
+}
+
+void FlightRecorderLogWriter::get(std::uint64_t aPos, void *apData, std::size_t aSize) const
+{
+    std::size_t offset = aPos & mMask;
+    std::size_t first = std::min(aSize, mBuffer.size() - offset);
+    std::memcpy(apData, &mBuffer[offset], first);
+    std::memcpy(static_cast<char*>(apData) + first, &mBuffer[0], aSize - first);
+}
+
+bool FlightRecorderLogWriter::isIntact(std::uint64_t aPos) const
+{
+    // Writers reserve before they write, so no record at or after a position is overwritten
+    // until a reservation reaches a full capacity past it.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return mReserved.load(std::memory_order_relaxed) <= (aPos + mBuffer.size());
+}
+
+std::uint64_t FlightRecorderLogWriter::findOldest(std::uint64_t aEnd) const
+{
+    constexpr std::uint32_t cMinSize = sizeof(RecordHeader) + sizeof(std::uint32_t);
+
+    // Records a capacity before the latest reservation may be overwritten at any moment, skip them.
+    std::uint64_t reserved = mReserved.load(std::memory_order_acquire);
+    std::uint64_t lower = (reserved > mBuffer.size()) ? (reserved - mBuffer.size()) : 0;
+    if (aEnd <= lower) {
+        return aEnd;
+    }
+
+    // Walk backwards over the size trailers to find the oldest complete record.
+    std::uint64_t pos = aEnd;
+    while ((pos - lower) >= cMinSize) {
+        std::uint32_t size;
+        get(pos - sizeof(size), &size, sizeof(size));
+        if ((size < cMinSize) || (size > (pos - lower))) {
+            break;
+        }
+        pos -= size;
+    }
+    return pos;
+}
+
+bool FlightRecorderLogWriter::dumpToFile(const char *apFileName) const
+{
+    constexpr std::uint32_t cMinSize = sizeof(RecordHeader) + sizeof(std::uint32_t);
+
+    int fd = ::open(apFileName, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    std::uint64_t end = mCommitted.load(std::memory_order_acquire);
+    std::uint64_t pos = findOldest(end);
+
+    FdWriter out(fd);
+    std::array<char, cMaxRecordSize> record;
+    while (pos < end) {
+        // Copy the record before using it, writers may overwrite the oldest records meanwhile.
+        RecordHeader header;
+        get(pos, &header, sizeof(header));
+        bool valid = (header.mSequence == pos) && (header.mSize >= cMinSize) && (header.mSize <= std::min(end - pos, record.size()))
+            && (header.mLevel < cLevelNames.size()) && ((sizeof(header) + header.mChannelLength + header.mMessageLength) <= header.mSize);
+        if (valid) {
+            get(pos, record.data(), header.mSize);
+        }
+        if (!valid || !isIntact(pos)) {
+            // Torn record, continue from the oldest record not overwritten yet
+            std::uint64_t next = findOldest(end);
+            if (next <= pos) {
+                break;
+            }
+            pos = next;
+            continue;
+        }
+
+        std::array<char, rsp::utils::DateTime::cLoggingLength> timestamp;
+        rsp::utils::DateTime(std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(header.mTime)))).FormatLogging(timestamp.data());
+
+        out.Put("[");
+        out.Put(timestamp.data(), timestamp.size());
+        out.Put("] ");
+        const char *payload = record.data() + sizeof(header);
+        if (header.mChannelLength) {
+            out.Put("<");
+            out.Put(payload, header.mChannelLength);
+            out.Put("> ");
+        }
+        out.Put("(");
+        out.Put(cLevelNames[header.mLevel]);
+        out.Put(") ");
+        out.Put(payload + header.mChannelLength, header.mMessageLength);
+        out.Put("\n");
+
+        pos += header.mSize;
+    }
+
+    bool result = out.Flush();
+    ::close(fd);
+    return result;
+}
+
+void FlightRecorderLogWriter::signalHandler(int aSignal)
+{
+    const FlightRecorderLogWriter *instance = spSignalInstance.load();
+    if (instance) {
+        instance->dumpToFile(instance->mDumpFileName.c_str());
+    }
+
+    // Restore the previous handlers and let the signal do its job.
+    for (std::size_t i = 0 ; i < cFatalSignals.size() ; ++i) {
+        sigaction(cFatalSignals[i], &sOldActions[i], nullptr);
+    }
+    ::raise(aSignal);
+}
+
+} /* namespace rsp::logging */
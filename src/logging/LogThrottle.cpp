@@ -0,0 +1,188 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#include <algorithm>
+#include <logging/LogThrottle.h>
+
+namespace rsp::logging {
+
+LogThrottle& LogThrottle::SetRateLimit(LogLevel aLevel, double aRecordsPerSecond, unsigned aBurst, const std::string &arChannel)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    Limit limit{aRecordsPerSecond, std::max(1.0, double(aBurst))};
+    auto index = std::size_t(aLevel);
+    if (arChannel.empty()) {
+        mDefaultLimits[index] = limit;
+        for (auto &[name, state] : mChannels) {
+            state.mBuckets[index] = Bucket();
+        }
+    }
+    else {
+        ChannelState &state = mChannels[arChannel];
+        state.mLimits[index] = limit;
+        state.mBuckets[index] = Bucket();
+    }
+    updateActive();
+
+    return *this;
+}
+
+LogThrottle& LogThrottle::RemoveRateLimit(LogLevel aLevel, const std::string &arChannel)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    auto index = std::size_t(aLevel);
+    if (arChannel.empty()) {
+        mDefaultLimits[index].reset();
+    }
+    else {
+        auto it = mChannels.find(arChannel);
+        if (it != mChannels.end()) {
+            it->second.mLimits[index].reset();
+            it->second.mBuckets[index] = Bucket();
+        }
+    }
+    updateActive();
+
+    return *this;
+}
+
+LogThrottle& LogThrottle::SetFolding(bool aEnable, std::chrono::milliseconds aInterval)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    mFolding = aEnable;
+    mFoldInterval = aInterval;
+    updateActive();
+
+    return *this;
+}
+
+LogThrottle::Counters LogThrottle::GetCounters() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    Counters result;
+    for (auto &[name, state] : mChannels) {
+        result.mRateLimited += state.mCounters.mRateLimited;
+        result.mFolded += state.mCounters.mFolded;
+    }
+    return result;
+}
+
+LogThrottle::Counters LogThrottle::GetCounters(const std::string &arChannel) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    auto it = mChannels.find(arChannel);
+    if (it == mChannels.end()) {
+        return Counters();
+    }
+    return it->second.mCounters;
+}
+
+void LogThrottle::ResetCounters()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    for (auto &[name, state] : mChannels) {
+        state.mCounters = Counters();
+    }
+}
+
+bool LogThrottle::Accept(LogLevel aLevel, const std::string &arChannel, const std::string &arMsg,
+                         std::vector<Summary> &arSummaries, Clock_t::time_point aNow)
+{
+    if (!mActive.load(std::memory_order_relaxed)) {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    auto it = mChannels.find(arChannel);
+    if (it == mChannels.end()) {
+        it = mChannels.emplace(arChannel, ChannelState()).first;
+    }
+    ChannelState &state = it->second;
+
+    if (mFolding && !fold(state, aLevel, arChannel, arMsg, arSummaries, aNow)) {
+        return false;
+    }
+
+    return limit(state, aLevel, arChannel, arSummaries, aNow);
+}
+
+void LogThrottle::updateActive()
+{
+    auto is_set = [](const std::optional<Limit> &arLimit) { return arLimit.has_value(); };
+
+    bool active = mFolding || std::any_of(mDefaultLimits.begin(), mDefaultLimits.end(), is_set);
+    for (auto it = mChannels.begin() ; !active && (it != mChannels.end()) ; ++it) {
+        active = std::any_of(it->second.mLimits.begin(), it->second.mLimits.end(), is_set);
+    }
+    mActive = active;
+}
+
+bool LogThrottle::fold(ChannelState &arState, LogLevel aLevel, const std::string &arChannel, const std::string &arMsg,
+                       std::vector<Summary> &arSummaries, Clock_t::time_point aNow)
+{
+    if ((arState.mLastLevel == aLevel) && (arState.mLastMessage == arMsg) && ((aNow - arState.mRepeatStart) < mFoldInterval)) {
+        arState.mRepeats++;
+        arState.mCounters.mFolded++;
+        return false;
+    }
+
+    if (arState.mRepeats) {
+        arSummaries.push_back({arState.mLastLevel, arChannel, "Last message repeated " + std::to_string(arState.mRepeats) + " times"});
+        arState.mRepeats = 0;
+    }
+    arState.mLastLevel = aLevel;
+    arState.mLastMessage = arMsg;
+    arState.mRepeatStart = aNow;
+
+    return true;
+}
+
+bool LogThrottle::limit(ChannelState &arState, LogLevel aLevel, const std::string &arChannel,
+                        std::vector<Summary> &arSummaries, Clock_t::time_point aNow)
+{
+    auto index = std::size_t(aLevel);
+    const std::optional<Limit> &limit = arState.mLimits[index] ? arState.mLimits[index] : mDefaultLimits[index];
+    if (!limit) {
+        return true;
+    }
+
+    Bucket &bucket = arState.mBuckets[index];
+    if (bucket.mLast == Clock_t::time_point()) {
+        bucket.mTokens = limit->mBurst;
+    }
+    else {
+        std::chrono::duration<double> elapsed = aNow - bucket.mLast;
+        bucket.mTokens = std::min(limit->mBurst, bucket.mTokens + (elapsed.count() * limit->mRate));
+    }
+    bucket.mLast = aNow;
+
+    if (bucket.mTokens < 1.0) {
+        bucket.mSuppressed++;
+        arState.mCounters.mRateLimited++;
+        return false;
+    }
+    bucket.mTokens -= 1.0;
+
+    if (bucket.mSuppressed) {
+        arSummaries.push_back({aLevel, arChannel, std::to_string(bucket.mSuppressed) + " records suppressed by rate limit"});
+        bucket.mSuppressed = 0;
+    }
+
+    return true;
+}
+
+} /* namespace rsp::logging */
@@ -0,0 +1,35 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#include <logging/LogTimestamp.h>
+
+using namespace std::chrono;
+using namespace rsp::utils;
+
+namespace rsp::logging {
+
+std::string_view LogTimestamp::Format(std::chrono::system_clock::time_point aTp)
+{
+    auto secs = floor<seconds>(aTp);
+    if (secs.time_since_epoch().count() != mCachedSecond) {
+        DateTime(system_clock::time_point(secs)).FormatLogging(mBuffer.data());
+        mCachedSecond = secs.time_since_epoch().count();
+    }
+
+    auto msecs = duration_cast<milliseconds>(aTp - secs).count();
+    char *p = &mBuffer[DateTime::cLoggingLength - 3];
+    p[0] = static_cast<char>('0' + (msecs / 100));
+    p[1] = static_cast<char>('0' + ((msecs / 10) % 10));
+    p[2] = static_cast<char>('0' + (msecs % 10));
+
+    return std::string_view(mBuffer.data(), mBuffer.size());
+}
+
+} /* namespace rsp::logging */
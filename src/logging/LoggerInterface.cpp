@@ -8,6 +8,7 @@
  * \author      Steffen Brummer
  */
 
+#include <algorithm>
 #include <logging/LoggerInterface.h>
 
 namespace rsp::logging {
@@ -43,10 +44,29 @@ bool LoggerInterface::HasWriters() const
 void LoggerInterface::write(const LogStream &arStream, const std::string &arMsg, const std::string &arChannel, const rsp::utils::DynamicData &arContext)
 {
     LogLevel current_level = arStream.GetLevel();
+
+    // Suppression is decided before taking the writer lock, so a log storm does not contend with the writers.
+    std::vector<LogThrottle::Summary> summaries;
+    bool accepted = mThrottle.Accept(current_level, arChannel, arMsg, summaries);
+    if (!accepted && summaries.empty()) {
+        return;
+    }
+
     std::lock_guard<std::recursive_mutex> lock(mMutex);
 
-    for (std::shared_ptr<LogWriterInterface> &w : mWriters) {
-        w->Write(arMsg, current_level, arChannel, arContext);
+    if (!summaries.empty()) {
+        rsp::utils::DynamicData no_context;
+        for (LogThrottle::Summary &summary : summaries) {
+            for (std::shared_ptr<LogWriterInterface> &w : mWriters) {
+                w->Write(summary.mMessage, summary.mLevel, summary.mChannel, no_context);
+            }
+        }
+    }
+
+    if (accepted) {
+        for (std::shared_ptr<LogWriterInterface> &w : mWriters) {
+            w->Write(arMsg, current_level, arChannel, arContext);
+        }
     }
 }
 
@@ -8,54 +8,136 @@
  * \author      Steffen Brummer
  */
 
-#include <thread>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
 #include <logging/OutStreamBuffer.h>
 #include <logging/Logger.h>
 
 namespace rsp::logging {
 
+struct PendingLine {
+    std::uint64_t mId = 0;
+    std::string mText{};
+    LogLevel mLevel = LogLevel::Info;
+};
+
+static std::atomic<std::uint64_t> sNextBufferId{1};
+
+/*
+ * Unfinished lines of the calling thread, one per buffer it has written to. Only ever touched
+ * by its own thread. A thread rarely writes to more than one buffer, so the entry used last is
+ * checked first and the rest are searched linearly. Entries are allocated separately, so a line
+ * stays in place if the logger writes to another buffer while it is handed off.
+ */
+static thread_local std::vector<std::unique_ptr<PendingLine>> tlLines;
+static thread_local std::size_t tlLastLine = 0;
+
+static PendingLine* findLine(std::uint64_t aId)
+{
+    if ((tlLastLine < tlLines.size()) && (tlLines[tlLastLine]->mId == aId)) {
+        return tlLines[tlLastLine].get();
+    }
+    for (std::size_t i = 0 ; i < tlLines.size() ; ++i) {
+        if (tlLines[i]->mId == aId) {
+            tlLastLine = i;
+            return tlLines[i].get();
+        }
+    }
+    return nullptr;
+}
+
 OutStreamBuffer::OutStreamBuffer(LoggerInterface *apLogger, LogLevel aLevel)
     : std::streambuf(),
-      LogStream(apLogger, aLevel, std::string(), rsp::utils::DynamicData())
+      LogStream(apLogger, aLevel, std::string(), rsp::utils::DynamicData()),
+      mLineLevel(aLevel),
+      mId(sNextBufferId++)
 {
 }
 
-int OutStreamBuffer::overflow(int c)
+OutStreamBuffer::~OutStreamBuffer()
 {
-    if (c != EOF) {
-        mBuffer << static_cast<char>(c);
+    try {
+        PendingLine *line = findLine(mId);
+        if (line) {
+            std::lock_guard<std::mutex> lock(mMutex);
+            writeLine(line->mText, line->mLevel);
+            tlLines.erase(std::find_if(tlLines.begin(), tlLines.end(), [line](const auto &arEntry) { return arEntry.get() == line; }));
+        }
     }
-    else {
-        mBuffer << '#';
-        sync();
+    catch (...) {
     }
+}
 
-    return c;
+void OutStreamBuffer::SetLevel(LogLevel aLevel)
+{
+    mLineLevel = aLevel;
+    PendingLine *line = findLine(mId);
+    if (line) {
+        line->mLevel = aLevel;
+    }
 }
 
-int OutStreamBuffer::sync()
+int OutStreamBuffer::overflow(int c)
 {
-    if (mMutex.try_lock()) {
-        DEBUG("mutex was not locked!!! " << std::this_thread::get_id());
+    if (c != traits_type::eof()) {
+        char ch = traits_type::to_char_type(c);
+        append(&ch, &ch + 1);
     }
+    return traits_type::not_eof(c);
+}
+
+std::streamsize OutStreamBuffer::xsputn(const char *apData, std::streamsize aSize)
+{
+    append(apData, apData + aSize);
+    return aSize;
+}
 
-    // Remove one ending newline, writeToLogger enforces a newline on every write
-    std::string result = mBuffer.str();
-    if (result[result.length()-1] == '\n') {
-        result.pop_back();
+/**
+ * Add characters to the line of the calling thread, and write every line completed by them
+ * to the logger. The lock is only held while writing.
+ */
+void OutStreamBuffer::append(const char *apBegin, const char *apEnd)
+{
+    PendingLine *line = findLine(mId);
+    if (!line) {
+        tlLastLine = tlLines.size();
+        line = tlLines.emplace_back(std::make_unique<PendingLine>(PendingLine{mId, std::string(), mLineLevel.load()})).get();
     }
 
-    if (result.length() > 0) {
-        DEBUG("Message: (" << result.length() << ") " << result);
-        writeToLogger(result);
+    while (apBegin < apEnd) {
+        auto nl = static_cast<const char*>(std::memchr(apBegin, '\n', std::size_t(apEnd - apBegin)));
+        if (!nl) {
+            line->mText.append(apBegin, apEnd);
+            break;
+        }
+        line->mText.append(apBegin, nl);
+        apBegin = nl + 1;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            writeLine(line->mText, line->mLevel);
+        }
+        line->mText.clear(); // Keeps the capacity for the next line
+        line->mLevel = mLineLevel.load();
     }
-    mBuffer.str(std::string());
+}
 
-    mMutex.unlock();
-    DEBUG("Unlocked by " << std::this_thread::get_id());
-    return 0;
+/**
+ * Must be called with the lock held, mLevel is borrowed for the line.
+ */
+void OutStreamBuffer::writeLine(const std::string &arText, LogLevel aLevel)
+{
+    if (arText.empty()) {
+        return;
+    }
+    DEBUG("Message: (" << arText.length() << ") " << arText);
+    LogLevel level = mLevel;
+    mLevel = aLevel;
+    writeToLogger(arText);
+    mLevel = level;
 }
 
 
 } /* namespace rsp::logging */
-
@@ -8,7 +8,6 @@
  * \author      Steffen Brummer
  */
 
-#include <thread>
 #include <logging/SetLevel.h>
 #include <logging/OutStreamBuffer.h>
 #include <logging/Logger.h>
@@ -20,8 +19,6 @@ std::ostream& SetLevel::operator ()(std::ostream &o) const
     OutStreamBuffer *stream = dynamic_cast<OutStreamBuffer*>(o.rdbuf());
 
     if (stream) {
-        stream->Lock();
-        DEBUG("Locked by " << std::this_thread::get_id());
         stream->SetLevel(mValue);
     }
     else {
@@ -8,52 +8,219 @@
  * \author      Simon Glashoff
  */
 #include <algorithm>
+#include <string>
 #include <utility>
 
 #include <messaging/Broker.h>
+#include <messaging/Mailbox.h>
 #include <messaging/Publisher.h>
 #include <messaging/Subscriber.h>
+#include <utils/CoreException.h>
 
 namespace rsp::messaging
 {
 void BrokerBase::subscribe(SubscriberBase &arSubscriber, int aTopic)
 {
-    mSubscriberMap[aTopic].push_back(&arSubscriber);
+    std::size_t index = topicIndex(aTopic);
+
+    std::lock_guard<std::mutex> lock(mWriteMutex);
+    auto table = std::make_shared<TopicTable>(*mTopics.Load());
+    if (table->size() <= index) {
+        table->resize(index + 1);
+    }
+    auto &topic = (*table)[index];
+    auto result = topic ? std::make_shared<Topic>(*topic) : std::make_shared<Topic>();
+
+    Subscription subscription{arSubscriber.mpMailbox, nullptr};
+    if (result->mpLatest) {
+        subscription.mpSlot = subscription.mpMailbox->AddLatest();
+        EventPtr current = result->mpLatest->Get();
+        if (current) {
+            subscription.mpMailbox->DeliverLatest(*subscription.mpSlot, current);
+        }
+    }
+    result->mSubscribers.push_back(std::move(subscription));
+    topic = std::move(result);
+    mTopics.Store(std::move(table));
 }
 
 void BrokerBase::unsubscribe(SubscriberBase &arSubscriber, int aTopic)
 {
-    auto topic_it = mSubscriberMap.find(aTopic);
-    if (topic_it == mSubscriberMap.end()) {
-        return; // No subscribers for this topic, so nothing to remove
-    }
+    {
+        std::lock_guard<std::mutex> lock(mWriteMutex);
+        auto current = mTopics.Load();
+        const Topic *topic = findTopic(*current, aTopic);
+        if (!topic) {
+            return; // No subscribers for this topic, so nothing to remove
+        }
 
-    auto sub_it = std::find(topic_it->second.begin(), topic_it->second.end(), &arSubscriber);
-    if (sub_it != topic_it->second.end()) {
-        topic_it->second.erase(sub_it);
+        const SubscriberList &list = topic->mSubscribers;
+        auto sub_it = std::find_if(list.begin(), list.end(), [&arSubscriber](const Subscription &arSub) {
+            return arSub.mpMailbox == arSubscriber.mpMailbox;
+        });
+        if (sub_it == list.end()) {
+            return;
+        }
+        if (sub_it->mpSlot) {
+            sub_it->mpMailbox->RemoveLatest(sub_it->mpSlot);
+        }
+        auto result = std::make_shared<Topic>(*topic);
+        result->mSubscribers.erase(result->mSubscribers.begin() + (sub_it - list.begin()));
+        auto table = std::make_shared<TopicTable>(*current);
+        (*table)[static_cast<std::size_t>(aTopic)] = std::move(result);
+        mTopics.Store(std::move(table));
     }
+    // Not while holding the lock, the subscriber being called may subscribe
+    arSubscriber.mpMailbox->WaitForDeliveries();
 }
 
 void BrokerBase::removeSubscriber(SubscriberBase &arSubscriber)
 {
-    for (auto &pair : mSubscriberMap) {
-        auto sub_it = std::find(pair.second.begin(), pair.second.end(), &arSubscriber);
-        if (sub_it != pair.second.end()) {
-            pair.second.erase(sub_it);
+    auto matches = [&arSubscriber](const Subscription &arSub) {
+        return arSub.mpMailbox == arSubscriber.mpMailbox;
+    };
+
+    std::unique_lock<std::mutex> lock(mWriteMutex);
+    auto current = mTopics.Load();
+    std::shared_ptr<TopicTable> table;
+    for (std::size_t i = 0 ; i < current->size() ; ++i) {
+        const auto &topic = (*current)[i];
+        if (!topic || std::none_of(topic->mSubscribers.begin(), topic->mSubscribers.end(), matches)) {
+            continue;
+        }
+        if (!table) {
+            table = std::make_shared<TopicTable>(*current);
         }
+        auto result = std::make_shared<Topic>(*topic);
+        auto &list = result->mSubscribers;
+        for (const auto &sub : list) {
+            if (matches(sub) && sub.mpSlot) {
+                sub.mpMailbox->RemoveLatest(sub.mpSlot);
+            }
+        }
+        list.erase(std::remove_if(list.begin(), list.end(), matches), list.end());
+        (*table)[i] = std::move(result);
+    }
+    if (table) {
+        mTopics.Store(std::move(table));
+    }
+    lock.unlock();
+    arSubscriber.mpMailbox->WaitForDeliveries();
+}
+
+void BrokerBase::setLatestValue(int aTopic, bool aEnable)
+{
+    std::size_t index = topicIndex(aTopic);
+
+    std::lock_guard<std::mutex> lock(mWriteMutex);
+    auto table = std::make_shared<TopicTable>(*mTopics.Load());
+    if (table->size() <= index) {
+        table->resize(index + 1);
+    }
+    auto &topic = (*table)[index];
+    if ((topic && topic->mpLatest) == aEnable) {
+        return; // Already configured
+    }
+
+    auto result = topic ? std::make_shared<Topic>(*topic) : std::make_shared<Topic>();
+    result->mpLatest = aEnable ? std::make_shared<Mailbox::LatestSlot>() : nullptr;
+    for (auto &sub : result->mSubscribers) {
+        if (aEnable) {
+            sub.mpSlot = sub.mpMailbox->AddLatest();
+        }
+        else {
+            sub.mpMailbox->RemoveLatest(sub.mpSlot);
+            sub.mpSlot = nullptr;
+        }
+    }
+    topic = std::move(result);
+    mTopics.Store(std::move(table));
+}
+
+bool BrokerBase::isLatestValue(int aTopic) const
+{
+    auto table = mTopics.Load();
+    const Topic *topic = findTopic(*table, aTopic);
+    return topic && topic->mpLatest;
+}
+
+EventPtr BrokerBase::getLatest(int aTopic) const
+{
+    auto table = mTopics.Load();
+    const Topic *topic = findTopic(*table, aTopic);
+    if (!topic || !topic->mpLatest) {
+        return nullptr;
+    }
+    return topic->mpLatest->Get();
+}
+
+std::size_t BrokerBase::getSubscriberCount(int aTopic) const
+{
+    auto table = mTopics.Load();
+    const Topic *topic = findTopic(*table, aTopic);
+    return topic ? topic->mSubscribers.size() : 0;
+}
+
+const BrokerBase::Topic* BrokerBase::findTopic(const TopicTable &arTable, int aTopic)
+{
+    auto index = static_cast<std::size_t>(aTopic);
+    if ((aTopic < 0) || (index >= arTable.size())) {
+        return nullptr;
+    }
+    return arTable[index].get();
+}
+
+std::size_t BrokerBase::topicIndex(int aTopic)
+{
+    if ((aTopic < 0) || (aTopic > cMaxTopic)) {
+        THROW_WITH_BACKTRACE1(std::out_of_range, "Topic " + std::to_string(aTopic) + " is out of range");
     }
+    return static_cast<std::size_t>(aTopic);
 }
 
 void BrokerBase::doPublish(int aTopic, Event &arNewEvent)
 {
-    auto it = mSubscriberMap.find(aTopic);
-    if (it == mSubscriberMap.end()) {
+    // The table keeps every topic in it alive until this publication is done
+    auto table = mTopics.Load();
+    const Topic *topic = findTopic(*table, aTopic);
+    if (!topic) {
         return; // No subscribers for this topic
     }
+    if (topic->mpLatest) {
+        publishLatest(*topic, arNewEvent.Clone());
+        return;
+    }
+
+    EventPtr owned;
+    for (const auto &sub : topic->mSubscribers) {
+        sub.mpMailbox->Deliver(arNewEvent, owned);
+    }
+}
 
-    // foreach sub in multimap for a given key, do->update
-    for (SubscriberBase* sub : it->second) {
-        sub->HandleEvent(arNewEvent);
+void BrokerBase::doPublish(int aTopic, EventPtr apNewEvent)
+{
+    auto table = mTopics.Load();
+    const Topic *topic = findTopic(*table, aTopic);
+    if (!topic) {
+        return; // No subscribers for this topic
+    }
+    if (topic->mpLatest) {
+        publishLatest(*topic, std::move(apNewEvent));
+        return;
+    }
+
+    Event &event = *apNewEvent;
+    for (const auto &sub : topic->mSubscribers) {
+        sub.mpMailbox->Deliver(event, apNewEvent);
+    }
+}
+
+void BrokerBase::publishLatest(const Topic &arTopic, EventPtr apNewEvent)
+{
+    // Store the value first, so subscribers joining meanwhile start from it
+    arTopic.mpLatest->Exchange(apNewEvent);
+    for (const auto &sub : arTopic.mSubscribers) {
+        sub.mpMailbox->DeliverLatest(*sub.mpSlot, apNewEvent);
     }
 }
 
@@ -0,0 +1,65 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+#include <messaging/BrokerBridge.h>
+
+namespace rsp::messaging
+{
+
+bool BrokerBridgeBase::send(int aTopic, const Event &arEvent)
+{
+    std::lock_guard<std::mutex> lock(mSendMutex);
+    mSendBuffer.clear();
+    EventWriter(mSendBuffer).Write(static_cast<std::int32_t>(aTopic));
+    try {
+        EventCodec::Get().Encode(arEvent, mSendBuffer);
+    }
+    catch (const EEventCodecError &) {
+        mDropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    if (!mrChannel.Send(mSendBuffer)) {
+        mDropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    mSent.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+std::size_t BrokerBridgeBase::receive(std::chrono::milliseconds aTimeout)
+{
+    std::size_t result = 0;
+    bool waited = (aTimeout.count() == 0);
+    for (;;) {
+        while (mrChannel.Receive(mReceiveBuffer)) {
+            std::int32_t topic;
+            EventPtr event;
+            try {
+                EventReader reader(mReceiveBuffer);
+                topic = reader.Read<std::int32_t>();
+                event = EventCodec::Get().Decode(std::string_view(mReceiveBuffer).substr(sizeof(topic)));
+            }
+            catch (const EEventCodecError &) {
+                mDropped.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            mReceived.fetch_add(1, std::memory_order_relaxed);
+            deliver(topic, std::move(event));
+            ++result;
+        }
+        if (result || waited || !mrChannel.IsOpen()) {
+            return result;
+        }
+        mrChannel.Wait(aTimeout);
+        waited = true;
+    }
+}
+
+} // namespace rsp::messaging
@@ -0,0 +1,62 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+#include <messaging/EventCodec.h>
+
+namespace rsp::messaging
+{
+
+EventCodec& EventCodec::Get()
+{
+    static EventCodec codec;
+    return codec;
+}
+
+bool EventCodec::IsRegistered(std::uint32_t aTypeId) const
+{
+    std::shared_lock<std::shared_mutex> lock(mMutex);
+    return mEntries.find(aTypeId) != mEntries.end();
+}
+
+void EventCodec::Encode(const Event &arEvent, std::string &arBuffer) const
+{
+    Entry entry = find(arEvent.GetTypeId());
+    EventWriter writer(arBuffer);
+    writer.Write(arEvent.GetTypeId());
+    entry.mpEncode(arEvent, writer);
+}
+
+EventPtr EventCodec::Decode(std::string_view aData) const
+{
+    EventReader reader(aData);
+    Entry entry = find(reader.Read<std::uint32_t>());
+    EventPtr result = entry.mpDecode(reader);
+    if (reader.GetPending()) {
+        THROW_WITH_BACKTRACE1(EEventCodecError, "Unexpected content after event data.");
+    }
+    return result;
+}
+
+void EventCodec::add(std::uint32_t aTypeId, Encode_t apEncode, Decode_t apDecode)
+{
+    std::unique_lock<std::shared_mutex> lock(mMutex);
+    mEntries[aTypeId] = Entry{apEncode, apDecode};
+}
+
+EventCodec::Entry EventCodec::find(std::uint32_t aTypeId) const
+{
+    std::shared_lock<std::shared_mutex> lock(mMutex);
+    auto it = mEntries.find(aTypeId);
+    if (it == mEntries.end()) {
+        THROW_WITH_BACKTRACE1(EEventCodecError, "Event type " + std::to_string(aTypeId) + " is not registered.");
+    }
+    return it->second;
+}
+
+} // namespace rsp::messaging
@@ -0,0 +1,517 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <messaging/IpcChannel.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <utils/ExceptionHelper.h>
+
+namespace rsp::messaging
+{
+
+static int waitForFd(int aFd, std::chrono::milliseconds aTimeout)
+{
+    pollfd pfd{aFd, POLLIN, 0};
+    int result = ::poll(&pfd, 1, static_cast<int>(aTimeout.count()));
+    if ((result < 0) && (errno != EINTR)) {
+        THROW_SYSTEM("Error waiting for socket");
+    }
+    return (result > 0) ? pfd.revents : 0;
+}
+
+static sockaddr_un makeAddress(const std::string &arPath)
+{
+    sockaddr_un address{};
+    if (arPath.size() >= sizeof(address.sun_path)) {
+        THROW_WITH_BACKTRACE1(EIpcError, "Socket path is too long: " + arPath);
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, arPath.c_str(), arPath.size() + 1);
+    return address;
+}
+
+SocketChannel::SocketChannel(int aFd)
+    : mFd(aFd)
+{
+}
+
+SocketChannel::~SocketChannel()
+{
+    ::close(mFd);
+}
+
+std::unique_ptr<SocketChannel> SocketChannel::Connect(const std::string &arPath)
+{
+    sockaddr_un address = makeAddress(arPath);
+    int fd = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        THROW_SYSTEM("Error creating socket");
+    }
+    auto result = std::make_unique<SocketChannel>(fd);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        THROW_SYSTEM("Error connecting to " + arPath);
+    }
+    return result;
+}
+
+std::pair<std::unique_ptr<SocketChannel>, std::unique_ptr<SocketChannel>> SocketChannel::Pair()
+{
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) < 0) {
+        THROW_SYSTEM("Error creating socket pair");
+    }
+    return {std::make_unique<SocketChannel>(fds[0]), std::make_unique<SocketChannel>(fds[1])};
+}
+
+bool SocketChannel::Send(std::string_view aFrame)
+{
+    if (::send(mFd, aFrame.data(), aFrame.size(), MSG_DONTWAIT | MSG_NOSIGNAL) >= 0) {
+        return true;
+    }
+    switch (errno) {
+        case EAGAIN:
+        case ENOBUFS:
+        case EMSGSIZE:
+            return false;
+
+        case EPIPE:
+        case ECONNRESET:
+        case ENOTCONN:
+            mOpen = false;
+            return false;
+
+        default:
+            THROW_SYSTEM("Error sending on socket");
+    }
+}
+
+bool SocketChannel::Receive(std::string &arFrame)
+{
+    ssize_t size = ::recv(mFd, nullptr, 0, MSG_PEEK | MSG_TRUNC | MSG_DONTWAIT);
+    if (size < 0) {
+        if ((errno == EAGAIN) || (errno == EINTR)) {
+            return false;
+        }
+        if (errno == ECONNRESET) {
+            mOpen = false;
+            return false;
+        }
+        THROW_SYSTEM("Error receiving from socket");
+    }
+    if (size == 0) {
+        mOpen = false; // Frames are never empty, so this is the end of the connection
+        return false;
+    }
+
+    arFrame.resize(static_cast<std::size_t>(size));
+    if (::recv(mFd, arFrame.data(), arFrame.size(), MSG_DONTWAIT) != size) {
+        THROW_SYSTEM("Error receiving from socket");
+    }
+    return true;
+}
+
+bool SocketChannel::Wait(std::chrono::milliseconds aTimeout)
+{
+    return waitForFd(mFd, aTimeout) != 0;
+}
+
+void SocketChannel::SendWithFds(std::string_view aFrame, const int *apFds, std::size_t aCount)
+{
+    iovec iov{const_cast<char*>(aFrame.data()), aFrame.size()};
+    std::string control(CMSG_SPACE(aCount * sizeof(int)), '\0');
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+
+    cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(aCount * sizeof(int));
+    std::memcpy(CMSG_DATA(cmsg), apFds, aCount * sizeof(int));
+
+    if (::sendmsg(mFd, &msg, MSG_NOSIGNAL) < 0) {
+        THROW_SYSTEM("Error sending file descriptors");
+    }
+}
+
+void SocketChannel::ReceiveWithFds(std::string &arFrame, int *apFds, std::size_t aCount, std::chrono::milliseconds aTimeout)
+{
+    if (!waitForFd(mFd, aTimeout)) {
+        THROW_WITH_BACKTRACE1(EIpcError, "Timeout waiting for file descriptors");
+    }
+
+    arFrame.resize(256);
+    iovec iov{arFrame.data(), arFrame.size()};
+    std::string control(CMSG_SPACE(aCount * sizeof(int)), '\0');
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+
+    ssize_t size = ::recvmsg(mFd, &msg, MSG_CMSG_CLOEXEC);
+    if (size < 0) {
+        THROW_SYSTEM("Error receiving file descriptors");
+    }
+    arFrame.resize(static_cast<std::size_t>(size));
+
+    cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || (cmsg->cmsg_type != SCM_RIGHTS) || (cmsg->cmsg_len != CMSG_LEN(aCount * sizeof(int)))) {
+        THROW_WITH_BACKTRACE1(EIpcError, "Expected " + std::to_string(aCount) + " file descriptors");
+    }
+    std::memcpy(apFds, CMSG_DATA(cmsg), aCount * sizeof(int));
+}
+
+IpcListener::IpcListener(const std::string &arPath)
+    : mPath(arPath),
+      mFd(::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0))
+{
+    if (mFd < 0) {
+        THROW_SYSTEM("Error creating socket");
+    }
+    sockaddr_un address = makeAddress(arPath);
+    ::unlink(arPath.c_str());
+    if ((::bind(mFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) || (::listen(mFd, 8) < 0)) {
+        int error = errno;
+        ::close(mFd);
+        errno = error;
+        THROW_SYSTEM("Error listening on " + arPath);
+    }
+}
+
+IpcListener::~IpcListener()
+{
+    ::close(mFd);
+    ::unlink(mPath.c_str());
+}
+
+std::unique_ptr<SocketChannel> IpcListener::Accept(std::chrono::milliseconds aTimeout)
+{
+    if (!waitForFd(mFd, aTimeout)) {
+        return nullptr;
+    }
+    int fd = ::accept4(mFd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) {
+        THROW_SYSTEM("Error accepting connection on " + mPath);
+    }
+    return std::make_unique<SocketChannel>(fd);
+}
+
+/**
+ * Control block of a single producer, single consumer ring in shared memory, followed by the data.
+ * Positions only grow, each record in the data starts with a RecordHeader and is padded to 8 bytes.
+ */
+struct ShmChannel::Ring
+{
+    static constexpr std::size_t cCacheLine = 64;
+
+    alignas(cCacheLine) std::atomic<std::uint64_t> mHead{0};
+    alignas(cCacheLine) std::atomic<std::uint64_t> mTail{0};
+    alignas(cCacheLine) std::atomic<std::uint32_t> mArmed{0};
+
+    char* GetData() { return reinterpret_cast<char*>(this) + sizeof(Ring); }
+};
+
+namespace {
+
+struct RecordHeader
+{
+    std::uint32_t mSize;
+    std::uint32_t mKind;
+};
+
+enum RecordKinds : std::uint32_t { cData, cPadding, cOnSocket };
+
+struct Hello
+{
+    std::uint32_t mMagic;
+    std::uint32_t mVersion;
+    std::uint64_t mCapacity;
+};
+
+constexpr std::uint32_t cHelloMagic = 0x52535049; // "RSPI"
+constexpr std::uint32_t cHelloVersion = 1;
+
+constexpr std::size_t align8(std::size_t aSize)
+{
+    return (aSize + 7) & ~std::size_t(7);
+}
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "Shared memory rings need lock free 64 bit atomics");
+
+} // namespace
+
+ShmChannel::ShmChannel(std::unique_ptr<SocketChannel> apSocket, std::size_t aCapacity, int aMemFd, int aSendFd, int aReceiveFd, bool aCreator)
+    : mpSocket(std::move(apSocket)),
+      mCapacity(aCapacity),
+      mMapSize(2 * (sizeof(Ring) + aCapacity)),
+      mpMap(::mmap(nullptr, mMapSize, PROT_READ | PROT_WRITE, MAP_SHARED, aMemFd, 0)),
+      mpSendRing(nullptr),
+      mpReceiveRing(nullptr),
+      mSendFd(aSendFd),
+      mReceiveFd(aReceiveFd)
+{
+    ::close(aMemFd);
+    if (mpMap == MAP_FAILED) {
+        ::close(mSendFd);
+        ::close(mReceiveFd);
+        THROW_SYSTEM("Error mapping shared memory");
+    }
+
+    char *base = static_cast<char*>(mpMap);
+    Ring *first = reinterpret_cast<Ring*>(base);
+    Ring *second = reinterpret_cast<Ring*>(base + sizeof(Ring) + mCapacity);
+    if (aCreator) {
+        mpSendRing = new (first) Ring();
+        mpReceiveRing = new (second) Ring();
+    }
+    else {
+        mpSendRing = second;
+        mpReceiveRing = first;
+    }
+}
+
+ShmChannel::~ShmChannel()
+{
+    ::munmap(mpMap, mMapSize);
+    ::close(mSendFd);
+    ::close(mReceiveFd);
+}
+
+std::unique_ptr<ShmChannel> ShmChannel::Create(std::unique_ptr<SocketChannel> apSocket, std::size_t aCapacity)
+{
+    std::size_t capacity = align8(aCapacity);
+    int fds[3] = {
+        ::memfd_create("rsp-ipc", MFD_CLOEXEC),
+        ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC),
+        ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)
+    };
+    if ((fds[0] < 0) || (fds[1] < 0) || (fds[2] < 0) || (::ftruncate(fds[0], static_cast<off_t>(2 * (sizeof(Ring) + capacity))) < 0)) {
+        int error = errno;
+        for (int fd : fds) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+        errno = error;
+        THROW_SYSTEM("Error creating shared memory channel");
+    }
+
+    // The first ring carries frames from creator to attacher, the second the opposite way.
+    std::unique_ptr<ShmChannel> result(new ShmChannel(std::move(apSocket), capacity, ::dup(fds[0]), fds[1], fds[2], true));
+    Hello hello{cHelloMagic, cHelloVersion, capacity};
+    result->mpSocket->SendWithFds(std::string_view(reinterpret_cast<const char*>(&hello), sizeof(hello)), fds, 3);
+    ::close(fds[0]);
+    return result;
+}
+
+std::unique_ptr<ShmChannel> ShmChannel::Attach(std::unique_ptr<SocketChannel> apSocket, std::chrono::milliseconds aTimeout)
+{
+    std::string frame;
+    int fds[3];
+    apSocket->ReceiveWithFds(frame, fds, 3, aTimeout);
+
+    Hello hello{};
+    if (frame.size() == sizeof(hello)) {
+        std::memcpy(&hello, frame.data(), sizeof(hello));
+    }
+    if ((hello.mMagic != cHelloMagic) || (hello.mVersion != cHelloVersion)) {
+        for (int fd : fds) {
+            ::close(fd);
+        }
+        THROW_WITH_BACKTRACE1(EIpcError, "Unexpected shared memory channel handshake");
+    }
+
+    // Both rings must fit in the shared memory, or the peer could make us read past the mapping
+    struct stat st{};
+    bool valid = (::fstat(fds[0], &st) == 0) && (st.st_size > 0) && (hello.mCapacity > 0) && (hello.mCapacity == align8(hello.mCapacity))
+        && (hello.mCapacity <= (static_cast<std::uint64_t>(st.st_size) / 2)) && ((2 * (sizeof(Ring) + hello.mCapacity)) <= static_cast<std::uint64_t>(st.st_size));
+    if (!valid) {
+        for (int fd : fds) {
+            ::close(fd);
+        }
+        THROW_WITH_BACKTRACE1(EIpcError, "Shared memory channel capacity " + std::to_string(hello.mCapacity) + " does not fit the shared memory");
+    }
+    return std::unique_ptr<ShmChannel>(new ShmChannel(std::move(apSocket), hello.mCapacity, fds[0], fds[2], fds[1], false));
+}
+
+std::pair<std::unique_ptr<ShmChannel>, std::unique_ptr<ShmChannel>> ShmChannel::Pair(std::size_t aCapacity)
+{
+    auto sockets = SocketChannel::Pair();
+    auto first = Create(std::move(sockets.first), aCapacity);
+    auto second = Attach(std::move(sockets.second));
+    return {std::move(first), std::move(second)};
+}
+
+bool ShmChannel::Send(std::string_view aFrame)
+{
+    if (!IsOpen()) {
+        return false;
+    }
+
+    bool on_socket = (sizeof(RecordHeader) + align8(aFrame.size())) > (mCapacity / 2);
+    std::size_t need = sizeof(RecordHeader) + (on_socket ? 0 : align8(aFrame.size()));
+
+    std::uint64_t head = mpSendRing->mHead.load(std::memory_order_relaxed);
+    std::uint64_t tail = mpSendRing->mTail.load(std::memory_order_acquire);
+    std::size_t pos = head % mCapacity;
+    std::size_t padding = ((mCapacity - pos) < need) ? (mCapacity - pos) : 0;
+    if ((mCapacity - (head - tail)) < (padding + need)) {
+        return false; // Ring is full
+    }
+
+    // Only this thread adds to the ring, so the room found stays available.
+    if (on_socket && !mpSocket->Send(aFrame)) {
+        mOpen = mpSocket->IsOpen();
+        return false;
+    }
+
+    char *data = mpSendRing->GetData();
+    if (padding) {
+        RecordHeader header{static_cast<std::uint32_t>(padding), cPadding};
+        std::memcpy(data + pos, &header, sizeof(header));
+        pos = 0;
+    }
+    RecordHeader header{static_cast<std::uint32_t>(aFrame.size()), on_socket ? cOnSocket : cData};
+    std::memcpy(data + pos, &header, sizeof(header));
+    if (!on_socket) {
+        std::memcpy(data + pos + sizeof(header), aFrame.data(), aFrame.size());
+    }
+    mpSendRing->mHead.store(head + padding + need, std::memory_order_release);
+
+    // Pairs with the fence in arm, either the receiver sees the frame or we see it armed.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (mpSendRing->mArmed.load(std::memory_order_relaxed)) {
+        std::uint64_t one = 1;
+        if (::write(mSendFd, &one, sizeof(one)) < 0) {
+            THROW_SYSTEM("Error signalling shared memory channel");
+        }
+    }
+    return true;
+}
+
+bool ShmChannel::Receive(std::string &arFrame)
+{
+    Ring &ring = *mpReceiveRing;
+    char *data = ring.GetData();
+    for (;;) {
+        std::uint64_t tail = ring.mTail.load(std::memory_order_relaxed);
+        std::uint64_t head = ring.mHead.load(std::memory_order_acquire);
+        if (head == tail) {
+            if (!arm()) {
+                return false;
+            }
+            continue;
+        }
+        ring.mArmed.store(0, std::memory_order_relaxed);
+
+        // The ring is writable by the other process, so nothing in it is trusted
+        std::uint64_t available = head - tail;
+        std::size_t pos = tail % mCapacity;
+        if ((available > mCapacity) || (available < sizeof(RecordHeader)) || ((mCapacity - pos) < sizeof(RecordHeader))) {
+            corrupted("ring positions");
+        }
+        RecordHeader header;
+        std::memcpy(&header, data + pos, sizeof(header));
+        std::size_t room = std::min<std::uint64_t>(available, mCapacity - pos);
+        switch (header.mKind) {
+            case cPadding:
+                if ((header.mSize != (mCapacity - pos)) || (header.mSize > available)) {
+                    corrupted("padding record");
+                }
+                ring.mTail.store(tail + header.mSize, std::memory_order_release);
+                continue;
+
+            case cOnSocket: {
+                ring.mTail.store(tail + sizeof(header), std::memory_order_release);
+                // The frame was sent before the marker was added, so it is ready.
+                bool result = mpSocket->Receive(arFrame);
+                mOpen = mpSocket->IsOpen();
+                return result;
+            }
+
+            case cData:
+                if ((sizeof(header) + align8(header.mSize)) > room) {
+                    corrupted("frame size " + std::to_string(header.mSize));
+                }
+                arFrame.assign(data + pos + sizeof(header), header.mSize);
+                ring.mTail.store(tail + sizeof(header) + align8(header.mSize), std::memory_order_release);
+                return true;
+
+            default:
+                corrupted("record kind " + std::to_string(header.mKind));
+        }
+    }
+}
+
+void ShmChannel::corrupted(const std::string &arWhat)
+{
+    mOpen = false;
+    THROW_WITH_BACKTRACE1(EIpcError, "Corrupt shared memory channel, invalid " + arWhat);
+}
+
+bool ShmChannel::Wait(std::chrono::milliseconds aTimeout)
+{
+    if (hasFrames() || arm()) {
+        return true;
+    }
+
+    pollfd pfds[2] = {{mReceiveFd, POLLIN, 0}, {mpSocket->GetFd(), POLLIN, 0}};
+    if ((::poll(pfds, 2, static_cast<int>(aTimeout.count())) < 0) && (errno != EINTR)) {
+        THROW_SYSTEM("Error waiting for shared memory channel");
+    }
+    if (pfds[1].revents && !hasFrames()) {
+        return checkSocket();
+    }
+    return hasFrames();
+}
+
+bool ShmChannel::arm()
+{
+    Ring &ring = *mpReceiveRing;
+    if (!ring.mArmed.load(std::memory_order_relaxed)) {
+        // Clear old signals and ask the sender for a new one, then look again to close the race.
+        std::uint64_t count;
+        while (::read(mReceiveFd, &count, sizeof(count)) > 0) {
+        }
+        ring.mArmed.store(1, std::memory_order_relaxed);
+        // Pairs with the fence in Send, either the sender sees us armed or we see its frame.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+    return hasFrames();
+}
+
+bool ShmChannel::hasFrames() const
+{
+    return mpReceiveRing->mHead.load(std::memory_order_acquire) != mpReceiveRing->mTail.load(std::memory_order_relaxed);
+}
+
+bool ShmChannel::checkSocket()
+{
+    char byte;
+    ssize_t result = ::recv(mpSocket->GetFd(), &byte, sizeof(byte), MSG_PEEK | MSG_DONTWAIT);
+    if ((result == 0) || ((result < 0) && (errno == ECONNRESET))) {
+        mOpen = false;
+        return true;
+    }
+    return false; // A large frame is on its way, its marker follows shortly
+}
+
+} // namespace rsp::messaging
@@ -0,0 +1,205 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+#include <algorithm>
+#include <messaging/Mailbox.h>
+#include <messaging/Subscriber.h>
+
+namespace rsp::messaging
+{
+
+/*
+ * Synchronous deliveries in progress on the calling thread, innermost first.
+ */
+struct DeliveryFrame {
+    const Mailbox *mpMailbox;
+    DeliveryFrame *mpOuter;
+};
+
+static thread_local DeliveryFrame *tlpDeliveries = nullptr;
+
+/*
+ * Counts a synchronous delivery for as long as it is in progress.
+ */
+class DeliveryGuard
+{
+public:
+    DeliveryGuard(const Mailbox &arMailbox, std::atomic<std::size_t> &arInFlight)
+        : mFrame{&arMailbox, tlpDeliveries},
+          mrInFlight(arInFlight)
+    {
+        mrInFlight.fetch_add(1, std::memory_order_seq_cst);
+        tlpDeliveries = &mFrame;
+    }
+    ~DeliveryGuard()
+    {
+        tlpDeliveries = mFrame.mpOuter;
+        mrInFlight.fetch_sub(1, std::memory_order_release);
+        mrInFlight.notify_all();
+    }
+    DeliveryGuard(const DeliveryGuard&) = delete;
+    DeliveryGuard& operator=(const DeliveryGuard&) = delete;
+
+protected:
+    DeliveryFrame mFrame;
+    std::atomic<std::size_t> &mrInFlight;
+};
+
+Mailbox::Mailbox(SubscriberBase &arSubscriber, std::size_t aQueueCapacity)
+    : mpSubscriber(&arSubscriber),
+      mpQueue(aQueueCapacity ? std::make_unique<rsp::utils::BoundedQueue<EventPtr>>(aQueueCapacity) : nullptr)
+{
+}
+
+void Mailbox::Deliver(Event &arEvent, EventPtr &arpOwned)
+{
+    if (!mpQueue) {
+        // Counted before the subscriber is read, so Detach either sees the delivery or we see it detached
+        DeliveryGuard guard(*this, mInFlight);
+        SubscriberBase *subscriber = mpSubscriber.load(std::memory_order_seq_cst);
+        if (subscriber) {
+            subscriber->HandleEvent(arEvent);
+        }
+        return;
+    }
+
+    if (!mpSubscriber.load(std::memory_order_relaxed)) {
+        return;
+    }
+    if (!arpOwned) {
+        arpOwned = arEvent.Clone();
+    }
+    EventPtr event = arpOwned;
+    if (!mpQueue->TryPush(event)) {
+        mDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    wakeUp();
+}
+
+void Mailbox::DeliverLatest(LatestSlot &arSlot, const EventPtr &arpEvent)
+{
+    if (!mpSubscriber.load(std::memory_order_relaxed)) {
+        return;
+    }
+    if (arSlot.Exchange(arpEvent)) {
+        return; // The consumer has not taken the previous event yet, so it is already woken.
+    }
+    mLatestReady.store(true, std::memory_order_release);
+    wakeUp();
+}
+
+std::shared_ptr<Mailbox::LatestSlot> Mailbox::AddLatest()
+{
+    auto slot = std::make_shared<LatestSlot>();
+    std::lock_guard<std::mutex> lock(mSlotMutex);
+    auto slots = std::make_shared<SlotList>(*mSlots.Load());
+    slots->push_back(slot);
+    mSlots.Store(std::move(slots));
+    return slot;
+}
+
+void Mailbox::RemoveLatest(const std::shared_ptr<LatestSlot> &arpSlot)
+{
+    std::lock_guard<std::mutex> lock(mSlotMutex);
+    auto slots = std::make_shared<SlotList>(*mSlots.Load());
+    slots->erase(std::remove(slots->begin(), slots->end(), arpSlot), slots->end());
+    mSlots.Store(std::move(slots));
+}
+
+std::size_t Mailbox::Process(std::size_t aMaxCount)
+{
+    std::size_t result = 0;
+    SubscriberBase *subscriber = mpSubscriber.load(std::memory_order_relaxed);
+    if (!subscriber) {
+        return result;
+    }
+    EventPtr event;
+    while (mpQueue && (result < aMaxCount) && mpQueue->TryPop(event)) {
+        subscriber->HandleEvent(*event);
+        event = nullptr;
+        ++result;
+    }
+
+    if ((result < aMaxCount) && mLatestReady.exchange(false, std::memory_order_acq_rel)) {
+        auto slots = mSlots.Load();
+        for (const auto &slot : *slots) {
+            if (result == aMaxCount) {
+                mLatestReady.store(true, std::memory_order_release); // Leave the rest for next time
+                break;
+            }
+            event = slot->Exchange(nullptr);
+            if (event) {
+                subscriber->HandleEvent(*event);
+                event = nullptr;
+                ++result;
+            }
+        }
+    }
+    return result;
+}
+
+bool Mailbox::Wait(std::chrono::milliseconds aTimeout)
+{
+    if (hasEvents()) {
+        return true;
+    }
+
+    std::unique_lock<std::mutex> lock(mWaitMutex);
+    mSleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool result = mWaitCondition.wait_for(lock, aTimeout, [this]() { return hasEvents(); });
+    mSleeping.store(false, std::memory_order_relaxed);
+    return result;
+}
+
+void Mailbox::Detach()
+{
+    mpSubscriber.store(nullptr, std::memory_order_seq_cst);
+    WaitForDeliveries();
+}
+
+void Mailbox::WaitForDeliveries() const
+{
+    // Deliveries on this thread are further up the call stack, they can not be waited for
+    std::size_t own = 0;
+    for (const DeliveryFrame *frame = tlpDeliveries ; frame ; frame = frame->mpOuter) {
+        if (frame->mpMailbox == this) {
+            ++own;
+        }
+    }
+
+    std::size_t count = mInFlight.load(std::memory_order_acquire);
+    while (count > own) {
+        mInFlight.wait(count, std::memory_order_acquire);
+        count = mInFlight.load(std::memory_order_acquire);
+    }
+}
+
+bool Mailbox::hasEvents() const
+{
+    return (mpQueue && !mpQueue->IsEmpty()) || mLatestReady.load(std::memory_order_acquire);
+}
+
+void Mailbox::wakeUp()
+{
+    rsp::utils::EventLoop *loop = mpLoop.load(std::memory_order_acquire);
+    if (loop) {
+        loop->Wakeup();
+    }
+
+    // Pairs with the fence in Wait, either the consumer sees the event or we see it sleeping.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (mSleeping.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(mWaitMutex);
+        mWaitCondition.notify_one();
+    }
+}
+
+} // namespace rsp::messaging
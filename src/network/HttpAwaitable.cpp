@@ -0,0 +1,49 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#include <network/HttpAwaitable.h>
+
+namespace rsp::network {
+
+bool HttpAwaitable::await_suspend(std::coroutine_handle<> aHandle)
+{
+    mHandle = aHandle;
+    IHttpRequest &request = mrSession.Request(mType, mUri, [this](IHttpResponse &arResponse) {
+        // The response is reused by the session once this returns
+        mpError = arResponse.GetError();
+        if (!mpError) {
+            mReply.StatusCode = arResponse.GetStatusCode();
+            mReply.Headers = arResponse.GetHeaders();
+            mReply.Body = arResponse.GetBody();
+        }
+        mDone = true;
+        if (mSuspended) {
+            mHandle.resume();
+        }
+    });
+    if (!mBody.empty()) {
+        request.SetBody(mBody);
+    }
+    mrSession.ProcessRequests();
+
+    // Without an event loop the response has already arrived, so continue at once
+    mSuspended = !mDone;
+    return mSuspended;
+}
+
+HttpReply HttpAwaitable::await_resume()
+{
+    if (mpError) {
+        std::rethrow_exception(mpError);
+    }
+    return std::move(mReply);
+}
+
+} /* namespace rsp::network */
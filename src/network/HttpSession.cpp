@@ -22,6 +22,12 @@ void HttpSession::ProcessRequests()
     mPimpl->ProcessRequests();
 }
 
+IHttpSession& HttpSession::SetEventLoop(rsp::utils::EventLoop *apLoop)
+{
+    mPimpl->SetEventLoop(apLoop);
+    return *this;
+}
+
 IHttpSession& HttpSession::SetDefaultOptions(const HttpRequestOptions &arOptions)
 {
     mPimpl->SetDefaultOptions(arOptions);
@@ -43,6 +43,12 @@ void CurlHttpRequest::writeToFile(rsp::posix::FileIO* apFile)
     setCurlOption(CURLOPT_WRITEDATA, apFile);
 }
 
+void CurlHttpRequest::writeToReceiver()
+{
+    setCurlOption(CURLOPT_WRITEFUNCTION, receiverWriteFunction);
+    setCurlOption(CURLOPT_WRITEDATA, this);
+}
+
 void CurlHttpRequest::readFromFile(rsp::posix::FileIO* apFile)
 {
     setCurlOption(CURLOPT_UPLOAD, 1L);
@@ -72,6 +78,19 @@ size_t CurlHttpRequest::fileWriteFunction(void *ptr, size_t size, size_t nmemb,
     return apFile->Write(ptr, size * nmemb);
 }
 
+size_t CurlHttpRequest::receiverWriteFunction(void *ptr, size_t size, size_t nmemb, CurlHttpRequest *apRequest)
+{
+    try {
+        if (apRequest->mRequestOptions.BodyReceiver(std::string_view(static_cast<char*>(ptr), size * nmemb))) {
+            return size * nmemb;
+        }
+    }
+    catch (...) {
+        // Exceptions must not propagate through libcurl, abort the transfer instead.
+    }
+    return 0;
+}
+
 size_t CurlHttpRequest::fileReadFunction(void *ptr, size_t size, size_t nmemb, rsp::posix::FileIO *apFile)
 {
     return apFile->Read(ptr, size * nmemb);
@@ -215,6 +234,12 @@ void CurlHttpRequest::requestDone()
     EasyCurl::requestDone();
 }
 
+void CurlHttpRequest::requestFailed(std::exception_ptr apError)
+{
+    mResponse.setError(apError);
+    requestDone();
+}
+
 std::uintptr_t CurlHttpRequest::GetHandle()
 {
     return std::uintptr_t(mpCurl);
@@ -270,6 +295,9 @@ void CurlHttpRequest::populateOptions()
     if (!mRequestOptions.WriteFile.IsNull()) {
         writeToFile(mRequestOptions.WriteFile.Get());
     }
+    else if (mRequestOptions.BodyReceiver) {
+        writeToReceiver();
+    }
     if (!mRequestOptions.ReadFile.IsNull()) {
         readFromFile(mRequestOptions.ReadFile.Get());
     }
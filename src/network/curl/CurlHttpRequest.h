@@ -62,16 +62,19 @@ protected:
     UploadBuffer mUploadBuffer{};
 
     void writeToFile(rsp::posix::FileIO *apFile);
+    void writeToReceiver();
     void readFromFile(rsp::posix::FileIO *apFile);
     void readFromString(const std::string &arString);
 
     void prepareRequest() override;
     void requestDone() override;
+    void requestFailed(std::exception_ptr apError) override;
 
 private:
 
     static size_t writeFunction(void *ptr, size_t size, size_t nmemb, CurlHttpResponse *data);
     static size_t fileWriteFunction(void *ptr, size_t size, size_t nmemb, rsp::posix::FileIO *apFile);
+    static size_t receiverWriteFunction(void *ptr, size_t size, size_t nmemb, CurlHttpRequest *apRequest);
     static size_t fileReadFunction(void *ptr, size_t size, size_t nmemb, rsp::posix::FileIO *apFile);
     static size_t stringReadFunction(void *ptr, size_t size, size_t nmemb, UploadBuffer *apBuf);
     static size_t headerFunction(char *data, size_t size, size_t nmemb, CurlHttpResponse *apResponse);
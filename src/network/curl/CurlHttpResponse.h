@@ -42,11 +42,16 @@ protected:
     {
         return mBody;
     }
+    void setError(std::exception_ptr apError)
+    {
+        mpError = apError;
+    }
     void clear()
     {
         mHeaders.clear();
         mStatusCode = 0;
         mBody.clear();
+        mpError = nullptr;
     }
 
 
@@ -30,6 +30,12 @@ void CurlSession::ProcessRequests()
     mMulti.Execute();
 }
 
+IHttpSession& CurlSession::SetEventLoop(rsp::utils::EventLoop *apLoop)
+{
+    mMulti.Attach(apLoop);
+    return *this;
+}
+
 IHttpSession& CurlSession::SetDefaultOptions(const HttpRequestOptions &arOptions)
 {
     mDefaultOptions = arOptions;
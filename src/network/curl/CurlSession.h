@@ -25,6 +25,7 @@ class CurlSession: public IHttpSession
 public:
     CurlSession(std::size_t aSize) : mPool(aSize) {}
     void ProcessRequests() override;
+    IHttpSession& SetEventLoop(rsp::utils::EventLoop *apLoop) override;
     IHttpSession& SetDefaultOptions(const HttpRequestOptions &arOptions) override;
     HttpRequestOptions& GetDefaultOptions() override { return mDefaultOptions; }
     const HttpRequestOptions& GetDefaultOptions() const override { return mDefaultOptions; }
@@ -11,6 +11,7 @@
 #ifndef SRC_NETWORK_CURL_EASYCURL_H_
 #define SRC_NETWORK_CURL_EASYCURL_H_
 
+#include <exception>
 #include <string>
 #include "CurlLibrary.h"
 #include "Exceptions.h"
@@ -50,6 +51,7 @@ protected:
 
     virtual void prepareRequest();
     virtual void requestDone() {};
+    virtual void requestFailed(std::exception_ptr /*apError*/) { requestDone(); };
 
     template <typename T>
     void setCurlOption(CURLoption aOption, T aArg) {
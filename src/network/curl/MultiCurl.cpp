@@ -9,9 +9,12 @@
  */
 
 #include <functional>
+#include <sys/timerfd.h>
+#include <unistd.h>
 #include "MultiCurl.h"
 #include <logging/Logger.h>
 #include <network/HttpRequest.h>
+#include <utils/ExceptionHelper.h>
 
 using namespace rsp::logging;
 
@@ -25,9 +28,48 @@ MultiCurl::MultiCurl()
 
 MultiCurl::~MultiCurl()
 {
+    Attach(nullptr);
     curl_multi_cleanup(mpMultiHandle);
 }
 
+MultiCurl& MultiCurl::Attach(rsp::utils::EventLoop *apLoop)
+{
+    if (mpLoop) {
+        for (curl_socket_t socket : mSockets) {
+            mpLoop->RemoveFd(socket);
+            curl_multi_assign(mpMultiHandle, socket, nullptr);
+        }
+        mSockets.clear();
+        mpLoop->RemoveFd(mTimerFd);
+        close(mTimerFd);
+        mTimerFd = -1;
+        setCurlOption(CURLMOPT_SOCKETFUNCTION, static_cast<curl_socket_callback>(nullptr));
+        setCurlOption(CURLMOPT_TIMERFUNCTION, static_cast<curl_multi_timer_callback>(nullptr));
+        mpLoop = nullptr;
+    }
+    if (!apLoop) {
+        return *this;
+    }
+
+    mTimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (mTimerFd < 0) {
+        THROW_SYSTEM("timerfd_create() failed");
+    }
+    apLoop->AddFd(mTimerFd, rsp::utils::EventLoop::cReadable, [this](std::uint32_t) {
+        std::uint64_t expirations;
+        if (read(mTimerFd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+            socketAction(CURL_SOCKET_TIMEOUT, 0);
+        }
+    });
+    mpLoop = apLoop;
+
+    setCurlOption(CURLMOPT_SOCKETFUNCTION, &MultiCurl::socketCallback);
+    setCurlOption(CURLMOPT_SOCKETDATA, this);
+    setCurlOption(CURLMOPT_TIMERFUNCTION, &MultiCurl::timerCallback);
+    setCurlOption(CURLMOPT_TIMERDATA, this);
+    return *this;
+}
+
 MultiCurl& MultiCurl::Add(CurlSessionHttpRequest &arRequest)
 {
     static_cast<EasyCurl*>(&arRequest)->prepareRequest(); // EasyCurl is friendly
@@ -56,6 +98,10 @@ MultiCurl& MultiCurl::Remove(CurlSessionHttpRequest &arRequest)
 
 void MultiCurl::Execute()
 {
+    if (mpLoop) {
+        return; // Transfers are driven by the event loop
+    }
+
     long timeout = 0;
     CURLMcode mc = curl_multi_timeout(mpMultiHandle, &timeout);
     if (mc != CURLM_OK) {
@@ -66,15 +112,24 @@ void MultiCurl::Execute()
     Logger::GetDefault().Debug() << "Executing MultiCurl with timeout: " << timeout;
 
     int count = 0;
+    std::exception_ptr error = nullptr;
     do {
         count = perform();
         if (count > 0 && poll(timeout) == 0) {
             continue;
         }
 
-        processMessages();
+        std::exception_ptr failed = processMessages();
+        if (!error) {
+            error = failed;
+        }
     }
     while(count > 0);
+
+    // Failed requests have been given their error, let the other requests finish before throwing
+    if (error) {
+        std::rethrow_exception(error);
+    }
 }
 
 int MultiCurl::poll(int aTimeoutMs)
@@ -98,21 +153,116 @@ int MultiCurl::perform()
     return still_running;
 }
 
-void MultiCurl::processMessages()
+int MultiCurl::socketCallback(CURL *, curl_socket_t aSocket, int aWhat, void *apUser, void *apSocketData)
+{
+    // Called from within libcurl, which exceptions must not pass through
+    try {
+        static_cast<MultiCurl*>(apUser)->watchSocket(aSocket, aWhat, apSocketData != nullptr);
+    }
+    catch (const std::exception &e) {
+        Logger::GetDefault().Error() << "Watching curl socket " << aSocket << " failed: " << e.what();
+        return -1;
+    }
+    catch (...) {
+        return -1;
+    }
+    return 0;
+}
+
+void MultiCurl::watchSocket(curl_socket_t aSocket, int aWhat, bool aWatched)
 {
+    if (aWhat == CURL_POLL_REMOVE) {
+        mSockets.erase(aSocket);
+        mpLoop->RemoveFd(aSocket);
+        return;
+    }
+
+    std::uint32_t events = 0;
+    if (aWhat & CURL_POLL_IN) {
+        events |= rsp::utils::EventLoop::cReadable;
+    }
+    if (aWhat & CURL_POLL_OUT) {
+        events |= rsp::utils::EventLoop::cWritable;
+    }
+
+    if (aWatched) {
+        mpLoop->ModifyFd(aSocket, events);
+    }
+    else {
+        mpLoop->AddFd(aSocket, events, [this, aSocket](std::uint32_t aEvents) {
+            int flags = 0;
+            if (aEvents & rsp::utils::EventLoop::cReadable) {
+                flags |= CURL_CSELECT_IN;
+            }
+            if (aEvents & rsp::utils::EventLoop::cWritable) {
+                flags |= CURL_CSELECT_OUT;
+            }
+            if (aEvents & (rsp::utils::EventLoop::cError | rsp::utils::EventLoop::cHangup)) {
+                flags |= CURL_CSELECT_ERR;
+            }
+            socketAction(aSocket, flags);
+        });
+        mSockets.insert(aSocket);
+        // Any non-null pointer marks the socket as added to the loop
+        curl_multi_assign(mpMultiHandle, aSocket, this);
+    }
+}
+
+int MultiCurl::timerCallback(CURLM *, long aTimeoutMs, void *apUser)
+{
+    auto self = static_cast<MultiCurl*>(apUser);
+    struct itimerspec spec{};
+    if (aTimeoutMs >= 0) {
+        // Zero disarms a timerfd, so expire immediately after one nanosecond instead
+        spec.it_value.tv_sec = aTimeoutMs / 1000;
+        spec.it_value.tv_nsec = (aTimeoutMs % 1000) * 1000000 + ((aTimeoutMs == 0) ? 1 : 0);
+    }
+    return (timerfd_settime(self->mTimerFd, 0, &spec, nullptr) < 0) ? -1 : 0;
+}
+
+void MultiCurl::socketAction(curl_socket_t aSocket, int aEvents)
+{
+    int running;
+    CURLMcode mc = curl_multi_socket_action(mpMultiHandle, aSocket, aEvents, &running);
+    if (mc != CURLM_OK) {
+        THROW_WITH_BACKTRACE2(ECurlMError, "curl_multi_socket_action() failed.", mc);
+    }
+    processMessages(); // Errors are given to the failed requests
+}
+
+std::exception_ptr MultiCurl::processMessages()
+{
+    std::exception_ptr first_error = nullptr;
     int msgs_in_queue = 0;
     do {
         CURLMsg *msg = curl_multi_info_read(mpMultiHandle, &msgs_in_queue);
         if (msg && msg->msg == CURLMSG_DONE) {
-            if (msg->data.result > 0 && msg->data.result < 100) {
-                THROW_WITH_BACKTRACE2(ECurlError, "curl_multi failed.", msg->data.result);
-            }
+            // The message is invalid once the handle is removed
+            CURLcode result = msg->data.result;
             auto req = EasyCurl::GetFromHandle(msg->easy_handle);
             Remove(*static_cast<CurlSessionHttpRequest*>(req));
-            req->requestDone();
+
+            if (result > 0 && result < 100) {
+                std::exception_ptr error;
+                try {
+                    THROW_WITH_BACKTRACE2(ECurlError, "curl_multi failed.", result);
+                }
+                catch (...) {
+                    error = std::current_exception();
+                }
+                if (!first_error) {
+                    first_error = error;
+                }
+                req->requestFailed(error);
+            }
+            else {
+                req->requestDone();
+            }
         }
     }
     while(msgs_in_queue > 0);
+
+    return first_error;
 }
 
 } /* namespace rsp::network::curl */
@@ -11,8 +11,11 @@
 #ifndef SRC_NETWORK_CURL_MULTICURL_H_
 #define SRC_NETWORK_CURL_MULTICURL_H_
 
+#include <exception>
 #include <map>
+#include <set>
 #include <curl/curl.h>
+#include <utils/EventLoop.h>
 #include "Exceptions.h"
 #include "CurlSessionHttpRequest.h"
 
@@ -23,6 +26,10 @@ namespace rsp::network::curl {
  * \brief Reduced wrapper for libcurls multi interface.
  * This implementation is intended for queing multiple requests and let libcurl execute them all.
  * This allows for utilizing HTTP 1.1 keepalive and http2 transport optimizations.
+ *
+ * Requests are either executed by blocking in Execute, or, once attached to an event loop,
+ * driven by the loop through libcurls socket interface. The sockets and a timerfd for curls
+ * timeouts are then watched by the loop, and requests complete on the loop thread.
  */
 class MultiCurl
 {
@@ -40,12 +47,31 @@ public:
 
     void Execute();
 
+    /**
+     * \brief Let an event loop drive the transfers, instead of Execute.
+     * \param apLoop Event loop, or nullptr to detach. Must not have transfers in progress.
+     * \return self
+     */
+    MultiCurl& Attach(rsp::utils::EventLoop *apLoop);
+
 protected:
     CURLM *mpMultiHandle = nullptr;
+    rsp::utils::EventLoop *mpLoop = nullptr;
+    int mTimerFd = -1;
+    std::set<curl_socket_t> mSockets{}; // Sockets watched by mpLoop
+
+    static int socketCallback(CURL *apEasy, curl_socket_t aSocket, int aWhat, void *apUser, void *apSocketData);
+    void watchSocket(curl_socket_t aSocket, int aWhat, bool aWatched);
+    static int timerCallback(CURLM *apMulti, long aTimeoutMs, void *apUser);
+    void socketAction(curl_socket_t aSocket, int aEvents);
 
     int poll(int aTimeoutMs);
     int perform();
-    void processMessages();
+    /**
+     * \brief Complete the finished requests, failed requests are given their error.
+     * \return The first error, nullptr if all requests succeeded
+     */
+    std::exception_ptr processMessages();
 
     template <typename T>
     void setCurlOption(CURLMoption aOption, T aArg) {
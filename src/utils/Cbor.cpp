@@ -0,0 +1,511 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utils/Cbor.h>
+
+namespace rsp::utils {
+
+static constexpr std::uint8_t cMajorUnsigned = 0;
+static constexpr std::uint8_t cMajorNegative = 1;
+static constexpr std::uint8_t cMajorText = 3;
+static constexpr std::uint8_t cMajorTag = 6;
+static constexpr std::uint8_t cIndefiniteInfo = 31;
+static constexpr char cBreak = '\xFF';
+
+/*
+ * Read an initial byte and its argument. Returns false if the input ends within the head.
+ * Reserved additional information values (28-30) are returned without argument.
+ */
+static bool parseHead(std::string_view aData, std::size_t &arPos, std::uint8_t &arMajor, std::uint8_t &arInfo, std::uint64_t &arValue)
+{
+    if (arPos >= aData.size()) {
+        return false;
+    }
+    auto initial = static_cast<std::uint8_t>(aData[arPos++]);
+    arMajor = static_cast<std::uint8_t>(initial >> 5);
+    arInfo = initial & 0x1F;
+    arValue = arInfo;
+    if ((arInfo < 24) || (arInfo > 27)) {
+        return true;
+    }
+    std::size_t size = std::size_t(1) << (arInfo - 24);
+    if (aData.size() - arPos < size) {
+        return false;
+    }
+    arValue = 0;
+    for (std::size_t i = 0 ; i < size ; ++i) {
+        arValue = (arValue << 8) | static_cast<std::uint8_t>(aData[arPos++]);
+    }
+    return true;
+}
+
+static float halfToFloat(std::uint16_t aHalf)
+{
+    int exponent = (aHalf >> 10) & 0x1F;
+    double mantissa = aHalf & 0x3FF;
+    double value;
+    if (exponent == 0) {
+        value = std::ldexp(mantissa, -24);
+    }
+    else if (exponent != 31) {
+        value = std::ldexp(mantissa + 1024, exponent - 25);
+    }
+    else {
+        value = (mantissa == 0) ? std::numeric_limits<double>::infinity() : std::numeric_limits<double>::quiet_NaN();
+    }
+    return static_cast<float>((aHalf & 0x8000) ? -value : value);
+}
+
+CborEncoder& CborEncoder::Flush()
+{
+    if (mSink && !mBuffer.empty()) {
+        mSink(mBuffer);
+        mBuffer.clear();
+    }
+    return *this;
+}
+
+void CborEncoder::writeHead(std::uint8_t aMajor, std::uint64_t aValue)
+{
+    char buf[9];
+    std::size_t size;
+    if (aValue < 24) {
+        buf[0] = static_cast<char>((aMajor << 5) | aValue);
+        mrResult.append(buf, 1);
+        return;
+    }
+    if (aValue <= 0xFF) {
+        size = 1;
+        buf[0] = static_cast<char>((aMajor << 5) | 24);
+    }
+    else if (aValue <= 0xFFFF) {
+        size = 2;
+        buf[0] = static_cast<char>((aMajor << 5) | 25);
+    }
+    else if (aValue <= 0xFFFFFFFF) {
+        size = 4;
+        buf[0] = static_cast<char>((aMajor << 5) | 26);
+    }
+    else {
+        size = 8;
+        buf[0] = static_cast<char>((aMajor << 5) | 27);
+    }
+    for (std::size_t i = size ; i > 0 ; --i) {
+        buf[i] = static_cast<char>(aValue & 0xFF);
+        aValue >>= 8;
+    }
+    mrResult.append(buf, size + 1);
+}
+
+void CborEncoder::writeInteger(std::int64_t aValue)
+{
+    if (aValue < 0) {
+        writeHead(cMajorNegative, static_cast<std::uint64_t>(-1 - aValue));
+    }
+    else {
+        writeHead(cMajorUnsigned, static_cast<std::uint64_t>(aValue));
+    }
+}
+
+void CborEncoder::writeTyped(Variant::Types aType, std::uint64_t aValue)
+{
+    writeHead(cMajorTag, cTypeTagBase + static_cast<std::uint64_t>(aType));
+    writeHead(cMajorUnsigned, aValue);
+}
+
+void CborEncoder::writeFloat(float aValue)
+{
+    std::uint32_t bits;
+    std::memcpy(&bits, &aValue, sizeof(bits));
+    char buf[5] = { '\xFA',
+        static_cast<char>(bits >> 24), static_cast<char>(bits >> 16), static_cast<char>(bits >> 8), static_cast<char>(bits) };
+    mrResult.append(buf, sizeof(buf));
+}
+
+void CborEncoder::writeDouble(double aValue)
+{
+    std::uint64_t bits;
+    std::memcpy(&bits, &aValue, sizeof(bits));
+    char buf[9];
+    buf[0] = '\xFB';
+    for (std::size_t i = 8 ; i > 0 ; --i) {
+        buf[i] = static_cast<char>(bits & 0xFF);
+        bits >>= 8;
+    }
+    mrResult.append(buf, sizeof(buf));
+}
+
+void CborEncoder::writeString(std::string_view aValue)
+{
+    writeHead(cMajorText, aValue.size());
+    mrResult.append(aValue);
+}
+
+void CborEncoder::writeScalar(const Variant &arValue)
+{
+    switch (arValue.GetType()) {
+        case Variant::Types::Bool:
+            mrResult += arValue.AsBool() ? '\xF5' : '\xF4';
+            break;
+
+        case Variant::Types::Int:
+            writeHead(cMajorTag, cTypeTagBase + static_cast<std::uint64_t>(Variant::Types::Int));
+            writeInteger(arValue.RawAsInt());
+            break;
+
+        case Variant::Types::Int64:
+            if (arValue.RawAsInt() < 0) {
+                writeInteger(arValue.RawAsInt());
+            }
+            else {
+                writeTyped(Variant::Types::Int64, static_cast<std::uint64_t>(arValue.RawAsInt()));
+            }
+            break;
+
+        case Variant::Types::Uint64:
+            writeHead(cMajorUnsigned, static_cast<std::uint64_t>(arValue.RawAsInt()));
+            break;
+
+        case Variant::Types::Uint32:
+        case Variant::Types::Uint16:
+            writeTyped(arValue.GetType(), static_cast<std::uint64_t>(arValue.RawAsInt()));
+            break;
+
+        case Variant::Types::Pointer:
+            THROW_WITH_BACKTRACE1(ECborError, "Pointer values are not streamable.");
+
+        case Variant::Types::Float:
+            writeFloat(arValue.AsFloat());
+            break;
+
+        case Variant::Types::Double:
+            writeDouble(arValue.AsDouble());
+            break;
+
+        case Variant::Types::String:
+            writeString(arValue.RawAsString());
+            break;
+
+        default:
+            mrResult += '\xF6';
+            break;
+    }
+}
+
+CborDecoder& CborDecoder::Feed(std::string_view aChunk)
+{
+    if (mData.data() == mBuffer.data()) {
+        mBuffer.erase(0, mPos);
+    }
+    else {
+        mBuffer.assign(mData.substr(mPos));
+    }
+    mBuffer.append(aChunk);
+    mData = mBuffer;
+    if (mScanStart == mPos) {
+        mScanPos -= mPos;
+    }
+    else {
+        mScanPos = 0;
+        mScanOpen.clear();
+    }
+    mScanStart = 0;
+    mPos = 0;
+    return *this;
+}
+
+/*
+ * Check if the value at mPos is complete without decoding it. The scan resumes where the
+ * previous call stopped, so a large value fed in small chunks is only scanned once.
+ * mScanOpen holds the number of items left in each open container, cIndefinite until a break.
+ * Malformed values are only scanned as far as needed, the error is reported when decoding.
+ */
+bool CborDecoder::isComplete()
+{
+    if (mScanStart != mPos) {
+        mScanStart = mPos;
+        mScanPos = mPos;
+        mScanOpen.clear();
+    }
+
+    while (mScanPos < mData.size()) {
+        if (!mScanOpen.empty() && (mScanOpen.back() == cIndefinite) && (mData[mScanPos] == cBreak)) {
+            mScanPos++;
+            mScanOpen.pop_back();
+            if (scanItemDone()) {
+                return true;
+            }
+            continue;
+        }
+
+        std::size_t pos = mScanPos;
+        std::uint8_t major;
+        std::uint8_t info;
+        std::uint64_t value;
+        if (!parseHead(mData, pos, major, info, value)) {
+            return false;
+        }
+        if ((info > 27) && (info < cIndefiniteInfo)) {
+            return true;
+        }
+
+        switch (major) {
+            case 2:
+            case 3:
+                if (info == cIndefiniteInfo) {
+                    mScanOpen.push_back(cIndefinite);
+                    mScanPos = pos;
+                    continue;
+                }
+                if (mData.size() - pos < value) {
+                    return false;
+                }
+                pos += static_cast<std::size_t>(value);
+                break;
+
+            case 4:
+            case 5:
+                if (mScanOpen.size() >= cMaxDepth) {
+                    return true;
+                }
+                if (info == cIndefiniteInfo) {
+                    mScanOpen.push_back(cIndefinite);
+                    mScanPos = pos;
+                    continue;
+                }
+                if (value) {
+                    mScanOpen.push_back((major == 5) ? 2 * value : value);
+                    mScanPos = pos;
+                    continue;
+                }
+                break;
+
+            case cMajorTag:
+                mScanPos = pos;
+                continue;
+
+            default:
+                break;
+        }
+
+        mScanPos = pos;
+        if (scanItemDone()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * An item ended at mScanPos, close the containers it completes.
+ * Returns true when the root value is complete.
+ */
+bool CborDecoder::scanItemDone()
+{
+    while (!mScanOpen.empty()) {
+        if ((mScanOpen.back() == cIndefinite) || (--mScanOpen.back() != 0)) {
+            return false;
+        }
+        mScanOpen.pop_back();
+    }
+    return true;
+}
+
+const char* CborDecoder::need(std::size_t aSize)
+{
+    if (mData.size() - mPos < aSize) {
+        error("Unexpected end of input.");
+    }
+    const char *result = mData.data() + mPos;
+    mPos += aSize;
+    return result;
+}
+
+CborDecoder::Head CborDecoder::readHead()
+{
+    Head head{};
+    if (!parseHead(mData, mPos, head.mMajor, head.mInfo, head.mValue)) {
+        error("Unexpected end of input.");
+    }
+    if (head.mInfo == cIndefiniteInfo) {
+        if ((head.mMajor < 2) || (head.mMajor == cMajorTag)) {
+            error("Indefinite length not allowed for major type " + std::to_string(static_cast<unsigned int>(head.mMajor)) + ".");
+        }
+        head.mValue = cIndefinite;
+    }
+    else if (head.mInfo > 27) {
+        error("Reserved additional information value " + std::to_string(static_cast<unsigned int>(head.mInfo)) + ".");
+    }
+    return head;
+}
+
+bool CborDecoder::isBreak()
+{
+    if (*need(1) == cBreak) {
+        return true;
+    }
+    mPos--;
+    return false;
+}
+
+std::size_t CborDecoder::countHint(std::uint64_t aCount) const
+{
+    // Every item takes at least one byte, so a count can not exceed the remaining input
+    if (aCount == cIndefinite) {
+        return 0;
+    }
+    if (aCount > GetPending()) {
+        error("Item count exceeds input size.");
+    }
+    return static_cast<std::size_t>(aCount);
+}
+
+std::string_view CborDecoder::readString(const Head &arHead)
+{
+    if (arHead.mValue != cIndefinite) {
+        if (arHead.mValue > GetPending()) {
+            error("Unexpected end of input.");
+        }
+        auto size = static_cast<std::size_t>(arHead.mValue);
+        return std::string_view(need(size), size);
+    }
+
+    mScratch.clear();
+    while (!isBreak()) {
+        Head chunk = readHead();
+        if ((chunk.mMajor != arHead.mMajor) || (chunk.mValue == cIndefinite)) {
+            error("Invalid chunk in indefinite length string.");
+        }
+        if (chunk.mValue > GetPending()) {
+            error("Unexpected end of input.");
+        }
+        auto size = static_cast<std::size_t>(chunk.mValue);
+        mScratch.append(need(size), size);
+    }
+    return mScratch;
+}
+
+void CborDecoder::readScalar(const Head &arHead, Variant &arValue)
+{
+    switch (arHead.mMajor) {
+        case cMajorUnsigned:
+            arValue = arHead.mValue;
+            return;
+
+        case cMajorNegative:
+            if (arHead.mValue > static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max())) {
+                error("Negative integer out of range.");
+            }
+            arValue = -1 - static_cast<std::int64_t>(arHead.mValue);
+            return;
+
+        default:
+            break;
+    }
+
+    switch (arHead.mInfo) {
+        case 20:
+            arValue = false;
+            break;
+
+        case 21:
+            arValue = true;
+            break;
+
+        case 22:
+        case 23:
+            arValue = Variant();
+            break;
+
+        case 25:
+            arValue = halfToFloat(static_cast<std::uint16_t>(arHead.mValue));
+            break;
+
+        case 26: {
+            auto bits = static_cast<std::uint32_t>(arHead.mValue);
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            arValue = value;
+            break;
+        }
+
+        case 27: {
+            double value;
+            std::memcpy(&value, &arHead.mValue, sizeof(value));
+            arValue = value;
+            break;
+        }
+
+        default:
+            if (arHead.mValue == cIndefinite) {
+                error("Unexpected break.");
+            }
+            error("Unsupported simple value " + std::to_string(arHead.mValue) + ".");
+    }
+}
+
+void CborDecoder::readTyped(Variant::Types aType, Variant &arValue)
+{
+    Head head = readHead();
+    if ((head.mMajor > cMajorNegative) || (head.mValue > static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max()))) {
+        if ((head.mMajor != cMajorUnsigned) || (aType != Variant::Types::Uint64)) {
+            error("Invalid content of type tag.");
+        }
+    }
+    std::int64_t value = (head.mMajor == cMajorNegative) ? (-1 - static_cast<std::int64_t>(head.mValue)) : static_cast<std::int64_t>(head.mValue);
+
+    switch (aType) {
+        case Variant::Types::Int:
+            if ((value < std::numeric_limits<int>::min()) || (value > std::numeric_limits<int>::max())) {
+                error("Int out of range.");
+            }
+            arValue = static_cast<int>(value);
+            break;
+
+        case Variant::Types::Int64:
+            arValue = value;
+            break;
+
+        case Variant::Types::Uint64:
+            if (head.mMajor != cMajorUnsigned) {
+                error("Uint64 out of range.");
+            }
+            arValue = head.mValue;
+            break;
+
+        case Variant::Types::Uint32:
+            if ((value < 0) || (value > std::numeric_limits<std::uint32_t>::max())) {
+                error("Uint32 out of range.");
+            }
+            arValue = static_cast<std::uint32_t>(value);
+            break;
+
+        case Variant::Types::Uint16:
+            if ((value < 0) || (value > std::numeric_limits<std::uint16_t>::max())) {
+                error("Uint16 out of range.");
+            }
+            arValue = static_cast<std::uint16_t>(value);
+            break;
+
+        default:
+            error("Invalid type tag.");
+    }
+}
+
+void CborDecoder::error(const std::string &arMsg) const
+{
+    THROW_WITH_BACKTRACE1(ECborError, arMsg + " Offset: " + std::to_string(mPos));
+}
+
+} /* namespace rsp::utils */
@@ -0,0 +1,76 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#include <utils/Coroutine.h>
+
+namespace rsp::utils {
+
+/**
+ * \brief Coroutine owning its own frame, destroyed when it finishes.
+ */
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+};
+
+static Detached runDetached(EventLoop &arLoop, Task<> aTask)
+{
+    co_await SwitchTo(arLoop);
+    try {
+        co_await std::move(aTask);
+    }
+    catch (...) {
+        arLoop.Post([exception = std::current_exception()]() {
+            std::rethrow_exception(exception);
+        });
+    }
+}
+
+void Spawn(EventLoop &arLoop, Task<> aTask)
+{
+    runDetached(arLoop, std::move(aTask));
+}
+
+void SwitchToLoop::await_suspend(std::coroutine_handle<> aHandle)
+{
+    mrLoop.Post([aHandle]() { aHandle.resume(); });
+}
+
+void SwitchToPool::await_suspend(std::coroutine_handle<> aHandle)
+{
+    mrPool.Post([aHandle]() { aHandle.resume(); });
+}
+
+void DelayAwaiter::await_suspend(std::coroutine_handle<> aHandle)
+{
+    // Resume from the loop, the timer is destroyed with this awaiter, and must not be while
+    // its callback runs
+    mTimer.SetTimeout(mDelay);
+    mTimer.Callback() = [this, aHandle](Timer &) {
+        mrLoop.Post([aHandle]() { aHandle.resume(); });
+    };
+    mTimer.Enable();
+}
+
+void FdAwaiter::await_suspend(std::coroutine_handle<> aHandle)
+{
+    mrLoop.AddFd(mFd, mEvents, [this, aHandle](std::uint32_t aEvents) {
+        mrLoop.RemoveFd(mFd);
+        mEvents = aEvents;
+        aHandle.resume();
+    });
+}
+
+} /* namespace rsp::utils */
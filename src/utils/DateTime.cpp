@@ -8,11 +8,12 @@
  * \author      Steffen Brummer
  */
 
+#include <array>
+#include <charconv>
+#include <cstdlib>
 #include <string>
-#include <sstream>
+#include <string_view>
 #include <ctime>
-#include <iostream>
-#include <iomanip>
 #include <utils/DateTime.h>
 
 using namespace std::literals::chrono_literals;
@@ -20,6 +21,20 @@ using namespace std::chrono;
 
 namespace rsp::utils {
 
+/**
+ * \brief Write the given value as exactly N zero padded decimal digits.
+ * \return Pointer to the character following the last digit
+ */
+template <std::size_t N>
+static char* writeDigits(char *apDst, std::uint64_t aValue)
+{
+    for (std::size_t i = N ; i > 0 ; --i) {
+        apDst[i - 1] = static_cast<char>('0' + (aValue % 10));
+        aValue /= 10;
+    }
+    return apDst + N;
+}
+
 DateTime::DateTime()
     : mTp(std::chrono::system_clock::now())
 {
@@ -162,18 +177,32 @@ timespec DateTime::GetTimeSpec() const
     return timepointToTimespec(mTp);
 }
 
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
 std::string DateTime::ToString(const char *apFormat) const
 {
     std::tm tm = *this;
-    std::stringstream ss;
-    ss << std::put_time(&tm, apFormat);
+    std::string result;
+    std::size_t len = 0;
+
+    if (*apFormat) {
+        // strftime returns 0 if the buffer is too small, so grow it a few times before giving up.
+        for (std::size_t size = 64 ; (len == 0) && (size <= 4096) ; size *= 4) {
+            result.resize(size);
+            len = std::strftime(result.data(), result.size(), apFormat, &tm);
+        }
+    }
 
-    if (std::string(apFormat).back() == '.') {
-        encodeFractions(ss, mTp);
+    if (std::string_view(apFormat).ends_with('.')) {
+        result.resize(len + 3);
+        encodeFractions(result.data() + len, mTp);
+        len += 3;
     }
+    result.resize(len);
 
-    return ss.str();
+    return result;
 }
+#pragma GCC diagnostic pop
 
 std::string DateTime::ToString(Formats aFormat) const
 {
@@ -218,7 +247,29 @@ std::string DateTime::ToISO8601UTC() const
 
 std::string DateTime::ToLogging() const
 {
-    return ToString("%F %T.");
+    std::array<char, cLoggingLength> buffer;
+    return std::string(buffer.data(), FormatLogging(buffer.data()));
+}
+
+char* DateTime::FormatLogging(char *apBuffer) const
+{
+    sys_days sd = floor<days>(mTp);
+    Date date(sd);
+    Time time(floor<milliseconds>(mTp - sd));
+
+    char *p = writeDigits<4>(apBuffer, static_cast<std::uint64_t>(std::abs(static_cast<int>(date.year()))));
+    *p++ = '-';
+    p = writeDigits<2>(p, static_cast<unsigned>(date.month()));
+    *p++ = '-';
+    p = writeDigits<2>(p, static_cast<unsigned>(date.day()));
+    *p++ = ' ';
+    p = writeDigits<2>(p, static_cast<std::uint64_t>(time.hours().count()));
+    *p++ = ':';
+    p = writeDigits<2>(p, static_cast<std::uint64_t>(time.minutes().count()));
+    *p++ = ':';
+    p = writeDigits<2>(p, static_cast<std::uint64_t>(time.seconds().count()));
+    *p++ = '.';
+    return writeDigits<3>(p, static_cast<std::uint64_t>(time.subseconds().count()));
 }
 
 std::string DateTime::ToHTTP() const
@@ -229,16 +280,17 @@ std::string DateTime::ToHTTP() const
 DateTime& DateTime::FromString(const std::string &arTimeString, const char *apFormat)
 {
     std::tm tm = {};
-    unsigned int msecs = 0;
-    std::stringstream ss(arTimeString);
-    ss >> std::get_time(&tm, apFormat);
-    tm.tm_isdst = 0;
-    if (std::string(apFormat).back() == '.') {
-        ss >> msecs;
+    std::uint64_t fractions = 0;
+    const char *rest = strptime(arTimeString.c_str(), apFormat, &tm);
+    if (rest && std::string_view(apFormat).ends_with('.')) {
+        std::from_chars(rest, arTimeString.data() + arTimeString.size(), fractions);
     }
+    // A parsed %z offset is stored in tm_gmtoff, mktime overwrites it.
+    seconds utc_offset(tm.tm_gmtoff);
+    tm.tm_isdst = 0;
 
     mTp = std::chrono::system_clock::from_time_t(std::mktime(&tm));
-    mTp += decodeFractions(msecs) - getTimezoneOffset(tm);
+    mTp += decodeFractions(fractions) - getTimezoneOffset(tm) - utc_offset;
 
     return *this;
 }
@@ -342,27 +394,34 @@ DateTime::Time DateTime::GetTime() const
 
 std::ostream& operator <<(std::ostream &os, const DateTime::Date &arDate)
 {
-    os << std::setfill('0') << std::setw(4) << static_cast<int>(arDate.year()) << "-"
-        << std::setw(2) << static_cast<uint32_t>(arDate.month()) << "-"
-        << std::setw(2) << static_cast<uint32_t>(arDate.day());
-    return os;
+    std::array<char, 10> buffer;
+    char *p = writeDigits<4>(buffer.data(), static_cast<std::uint64_t>(std::abs(static_cast<int>(arDate.year()))));
+    *p++ = '-';
+    p = writeDigits<2>(p, static_cast<unsigned>(arDate.month()));
+    *p++ = '-';
+    writeDigits<2>(p, static_cast<unsigned>(arDate.day()));
+    return os.write(buffer.data(), buffer.size());
 }
 
 std::ostream& operator <<(std::ostream &os, const DateTime::Time &arTime)
 {
+    std::array<char, 12> buffer;
     milliseconds msecs = duration_cast<milliseconds>(arTime.subseconds());
 
-    os << std::setfill('0') << std::setw(2) << arTime.hours().count() << ":"
-        << std::setw(2) << arTime.minutes().count() << ":"
-        << std::setw(2) << arTime.seconds().count() << "."
-        << std::setw(3) << msecs.count();
-    return os;
+    char *p = writeDigits<2>(buffer.data(), static_cast<std::uint64_t>(arTime.hours().count()));
+    *p++ = ':';
+    p = writeDigits<2>(p, static_cast<std::uint64_t>(arTime.minutes().count()));
+    *p++ = ':';
+    p = writeDigits<2>(p, static_cast<std::uint64_t>(arTime.seconds().count()));
+    *p++ = '.';
+    writeDigits<3>(p, static_cast<std::uint64_t>(msecs.count()));
+    return os.write(buffer.data(), buffer.size());
 }
 
 std::ostream& operator <<(std::ostream &os, const DateTime &arDateTime)
 {
-    os << arDateTime.GetDate() << " " << arDateTime.GetTime();
-    return os;
+    std::array<char, DateTime::cLoggingLength> buffer;
+    return os.write(buffer.data(), arDateTime.FormatLogging(buffer.data()) - buffer.data());
 }
 
 std::chrono::system_clock::duration DateTime::decodeFractions(uint64_t aFractions) const
@@ -376,13 +435,12 @@ std::chrono::system_clock::duration DateTime::decodeFractions(uint64_t aFraction
     return milliseconds(aFractions);
 }
 
-std::ostream& DateTime::encodeFractions(std::ostream& os, std::chrono::system_clock::time_point aTp) const
+char* DateTime::encodeFractions(char *apBuffer, std::chrono::system_clock::time_point aTp) const
 {
     time_point<system_clock, milliseconds> msd = time_point_cast<milliseconds>(aTp);
-    unsigned msecs = msd.time_since_epoch().count() % 1000;
+    auto msecs = msd.time_since_epoch().count() % 1000;
 
-    os << std::setfill('0') << std::setw(3) << msecs;
-    return os;
+    return writeDigits<3>(apBuffer, static_cast<std::uint64_t>(msecs));
 }
 
 } /* namespace rsp::utils */
@@ -19,18 +19,28 @@ std::ostream& operator<< (std::ostream& os, const DynamicData& arValue)
     return os;
 }
 
+DynamicData::DynamicData(Types aType)
+    : Variant()
+{
+    if ((aType == Types::Object) || (aType == Types::Array)) {
+        mType = aType;
+    }
+}
+
 DynamicData::DynamicData(const DynamicData& arOther)
     : Variant(arOther),
       mName(arOther.mName),
-      mItems(arOther.mItems)
+      mItems(arOther.mItems),
+      mIndex(arOther.mIndex)
 {
     DDLOG("DynamicData copy constructor");
 }
 
-DynamicData::DynamicData(DynamicData&& arOther)
+DynamicData::DynamicData(DynamicData&& arOther) noexcept
     : Variant(std::move(arOther)),
       mName(std::move(arOther.mName)),
-      mItems(std::move(arOther.mItems))
+      mItems(std::move(arOther.mItems)),
+      mIndex(std::move(arOther.mIndex))
 {
     DDLOG("DynamicData move constructor");
 }
@@ -41,16 +51,18 @@ DynamicData& DynamicData::operator =(const DynamicData& arOther)
         Variant::operator=(arOther);
         mName = arOther.mName;
         mItems = arOther.mItems;
+        mIndex = arOther.mIndex;
         DDLOG("DynamicData copy assignment");
     }
     return *this;}
 
-DynamicData& DynamicData::operator =(DynamicData&& arOther)
+DynamicData& DynamicData::operator =(DynamicData&& arOther) noexcept
 {
     if (&arOther != this) {
         Variant::operator=(std::move(arOther));
         mName = std::move(arOther.mName);
         mItems = std::move(arOther.mItems);
+        mIndex = std::move(arOther.mIndex);
         DDLOG("DynamicData move assignment");
     }
     return *this;
@@ -60,10 +72,9 @@ DynamicData& DynamicData::operator [](std::string_view aKey)
 {
     DDLOG("DynamicData - Access member " << aKey);
     forceObject();
-    for (DynamicData &v : mItems) {
-        if (v.mName == aKey) {
-            return v;
-        }
+    std::size_t pos = findMember(aKey);
+    if (pos != MemberIndex::npos) {
+        return mItems[pos];
     }
     THROW_WITH_BACKTRACE1(EMemberNotExisting, std::string(aKey));
 }
@@ -72,10 +83,9 @@ const DynamicData& DynamicData::operator [](std::string_view aKey) const
 {
     DDLOG("DynamicData - Getting member " << aKey);
     tryObject();
-    for (const DynamicData &v : mItems) {
-        if (v.mName == aKey) {
-            return v;
-        }
+    std::size_t pos = findMember(aKey);
+    if (pos != MemberIndex::npos) {
+        return mItems[pos];
     }
     THROW_WITH_BACKTRACE1(EMemberNotExisting, std::string(aKey));
 }
@@ -119,28 +129,24 @@ std::vector<std::string> DynamicData::GetMemberNames() const
 bool DynamicData::MemberExists(std::string_view aKey) const
 {
     tryObject();
-    for (const DynamicData &v : mItems) {
-        if (v.mName == aKey) {
-            return true;
-        }
-    }
-    return false;
+    return (findMember(aKey) != MemberIndex::npos);
 }
 
 DynamicData& DynamicData::Add(DynamicData aValue)
 {
     forceArray();
-    Logger::GetDefault().Info() << "DynamicData::Add(): " << aValue;
-    mItems.emplace_back(aValue);
+    DDLOG("DynamicData::Add(): " << aValue);
+    mItems.emplace_back(std::move(aValue));
     return *this;
 }
 
 DynamicData& DynamicData::Add(std::string_view aKey, DynamicData aValue)
 {
     forceObject();
-    Logger::GetDefault().Info() << "JsonObject::Add(): \"" << aKey << "\": " << aValue;
+    DDLOG("DynamicData::Add(): \"" << aKey << "\": " << aValue);
     aValue.mName = aKey;
-    mItems.push_back(aValue);
+    mItems.push_back(std::move(aValue));
+    mIndex.Append(mItems.size(), [this](std::size_t i) -> std::string_view { return mItems[i].mName; });
     return *this;
 }
 
@@ -154,13 +160,12 @@ DynamicData& DynamicData::Remove(size_type aIndex)
 DynamicData& DynamicData::Remove(std::string_view aKey)
 {
     tryObject();
-    auto it = std::find_if(mItems.begin(), mItems.end(), [&aKey](const DynamicData& arValue) {
-        if (arValue.mName == aKey) {
-            return true;
-        }
-        return false;
-    });
-    mItems.erase(it);
+    std::size_t pos = findMember(aKey);
+    if (pos == MemberIndex::npos) {
+        THROW_WITH_BACKTRACE1(EMemberNotExisting, std::string(aKey));
+    }
+    mItems.erase(mItems.begin() + static_cast<std::ptrdiff_t>(pos));
+    mIndex.Rebuild(mItems.size(), [this](std::size_t i) -> std::string_view { return mItems[i].mName; });
     return *this;
 }
 
@@ -168,7 +173,8 @@ void DynamicData::Clear()
 {
     mName.clear();
     mItems.clear();
-    mType = Types::Null;
+    mIndex.Clear();
+    reset(Types::Null);
 }
 
 bool DynamicData::operator ==(const DynamicData &arOther) const
@@ -203,7 +209,7 @@ bool DynamicData::operator ==(const DynamicData &arOther) const
             return mPointer == arOther.mPointer;
 
         case Types::String:
-            return mString == arOther.mString;
+            return RawAsString() == arOther.RawAsString();
 
         case Types::Array:
         case Types::Object: {
@@ -223,6 +229,11 @@ bool DynamicData::operator ==(const DynamicData &arOther) const
     return false;
 }
 
+std::size_t DynamicData::findMember(std::string_view aKey) const
+{
+    return mIndex.Find(aKey, mItems.size(), [this](std::size_t i) -> std::string_view { return mItems[i].mName; });
+}
+
 void DynamicData::tryArray() const
 {
     if (!IsArray()) {
@@ -0,0 +1,325 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <limits>
+#include <string>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
+#include <utils/EventLoop.h>
+#include <utils/ExceptionHelper.h>
+#include <utils/Timer.h>
+
+namespace rsp::utils {
+
+static_assert(EventLoop::cReadable == EPOLLIN);
+static_assert(EventLoop::cWritable == EPOLLOUT);
+static_assert(EventLoop::cError == EPOLLERR);
+static_assert(EventLoop::cHangup == EPOLLHUP);
+
+EventLoop::EventLoop()
+{
+    mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (mEpollFd < 0) {
+        THROW_SYSTEM("epoll_create1() failed");
+    }
+    mWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (mWakeFd < 0) {
+        int err = errno;
+        close(mEpollFd);
+        errno = err;
+        THROW_SYSTEM("eventfd() failed");
+    }
+    struct epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = mWakeFd;
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mWakeFd, &ev) < 0) {
+        int err = errno;
+        close(mWakeFd);
+        close(mEpollFd);
+        errno = err;
+        THROW_SYSTEM("epoll_ctl() failed");
+    }
+}
+
+EventLoop::~EventLoop()
+{
+    if (mPollTimers) {
+        try {
+            TimerQueue::Get().SetWakeup({});
+        }
+        catch (const ENoInstance &) {
+        }
+    }
+    if (!mBlockedSignals.empty()) {
+        sigset_t mask;
+        sigemptyset(&mask);
+        for (int signal : mBlockedSignals) {
+            sigaddset(&mask, signal);
+        }
+        pthread_sigmask(SIG_UNBLOCK, &mask, nullptr);
+    }
+    if (mSignalFd >= 0) {
+        close(mSignalFd);
+    }
+    close(mWakeFd);
+    close(mEpollFd);
+}
+
+EventLoop& EventLoop::AddFd(int aFd, std::uint32_t aEvents, FdCallback_t aCallback)
+{
+    struct epoll_event ev{};
+    ev.events = aEvents;
+    ev.data.fd = aFd;
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, aFd, &ev) < 0) {
+        THROW_SYSTEM("Could not add file descriptor " + std::to_string(aFd) + " to event loop");
+    }
+    mHandlers[aFd] = std::move(aCallback);
+    return *this;
+}
+
+EventLoop& EventLoop::ModifyFd(int aFd, std::uint32_t aEvents)
+{
+    struct epoll_event ev{};
+    ev.events = aEvents;
+    ev.data.fd = aFd;
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_MOD, aFd, &ev) < 0) {
+        THROW_SYSTEM("Could not modify file descriptor " + std::to_string(aFd) + " in event loop");
+    }
+    return *this;
+}
+
+EventLoop& EventLoop::RemoveFd(int aFd)
+{
+    if (mHandlers.erase(aFd)) {
+        epoll_ctl(mEpollFd, EPOLL_CTL_DEL, aFd, nullptr);
+    }
+    return *this;
+}
+
+EventLoop& EventLoop::AddSignal(int aSignal, SignalCallback_t aCallback)
+{
+    sigset_t mask;
+    sigemptyset(&mask);
+    for (auto &pair : mSignalHandlers) {
+        sigaddset(&mask, pair.first);
+    }
+    sigaddset(&mask, aSignal);
+
+    sigset_t old;
+    if (pthread_sigmask(SIG_BLOCK, &mask, &old) != 0) {
+        THROW_SYSTEM("pthread_sigmask() failed");
+    }
+    if (!sigismember(&old, aSignal)) {
+        mBlockedSignals.push_back(aSignal);
+    }
+
+    int fd = signalfd(mSignalFd, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (fd < 0) {
+        THROW_SYSTEM("signalfd() failed");
+    }
+    if (mSignalFd < 0) {
+        mSignalFd = fd;
+        struct epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = mSignalFd;
+        if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mSignalFd, &ev) < 0) {
+            THROW_SYSTEM("epoll_ctl() failed");
+        }
+    }
+    mSignalHandlers[aSignal] = std::move(aCallback);
+    return *this;
+}
+
+EventLoop& EventLoop::PollTimers(bool aOn)
+{
+    if (aOn != mPollTimers) {
+        if (aOn) {
+            TimerQueue::Get().SetWakeup([this]() { Wakeup(); });
+        }
+        else {
+            TimerQueue::Get().SetWakeup({});
+        }
+        mPollTimers = aOn;
+    }
+    return *this;
+}
+
+void EventLoop::Post(Task_t aTask)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTasks.push_back(std::move(aTask));
+        if (!mSleeping) {
+            // The loop checks for tasks before it goes to sleep
+            return;
+        }
+        mSleeping = false;
+    }
+    signalWakeFd();
+}
+
+void EventLoop::Wakeup()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mSleeping) {
+            // The loop checks mWoken before it goes to sleep
+            mWoken = true;
+            return;
+        }
+        mSleeping = false;
+    }
+    signalWakeFd();
+}
+
+void EventLoop::signalWakeFd()
+{
+    std::uint64_t one = 1;
+    while (write(mWakeFd, &one, sizeof(one)) < 0 && errno == EINTR) {
+    }
+}
+
+std::size_t EventLoop::RunOnce(std::chrono::milliseconds aMaxWait)
+{
+    struct epoll_event events[cMaxEvents];
+    bool woken = false;
+    int timeout = waitTimeout(aMaxWait, woken);
+
+    int count = epoll_wait(mEpollFd, events, cMaxEvents, timeout);
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mSleeping = false;
+    }
+    if (count < 0) {
+        if (errno != EINTR) {
+            THROW_SYSTEM("epoll_wait() failed");
+        }
+        count = 0;
+    }
+
+    std::size_t result = 0;
+    for (int i = 0; i < count; ++i) {
+        int fd = events[i].data.fd;
+        if (fd == mWakeFd) {
+            std::uint64_t value;
+            while (read(mWakeFd, &value, sizeof(value)) < 0 && errno == EINTR) {
+            }
+            woken = true;
+        }
+        else if (fd == mSignalFd) {
+            result += dispatchSignals();
+        }
+        else {
+            auto it = mHandlers.find(fd);
+            if (it == mHandlers.end()) {
+                continue; // Removed by an earlier callback
+            }
+            FdCallback_t callback = it->second; // The callback may remove itself
+            callback(events[i].events);
+            ++result;
+        }
+    }
+
+    if (mPollTimers) {
+        result += TimerQueue::Get().Poll();
+    }
+
+    std::size_t tasks = runTasks();
+    if (woken && !tasks) {
+        ++result; // Bare Wakeup, the caller may have something to do
+    }
+    return result + tasks;
+}
+
+void EventLoop::Run()
+{
+    while (!mStopped) {
+        RunOnce(cForever);
+    }
+    mStopped = false;
+}
+
+void EventLoop::Stop()
+{
+    mStopped = true;
+    Wakeup();
+}
+
+int EventLoop::waitTimeout(std::chrono::milliseconds aMaxWait, bool &arWoken)
+{
+    std::chrono::milliseconds wait = aMaxWait;
+    if (mPollTimers) {
+        auto max = (aMaxWait < std::chrono::milliseconds(0)) ? std::chrono::milliseconds::max() : aMaxWait;
+        wait = TimerQueue::Get().TimeUntilNext(max);
+        if (wait == std::chrono::milliseconds::max()) {
+            wait = cForever;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mWoken || !mTasks.empty()) {
+        arWoken |= mWoken;
+        mWoken = false;
+        return 0;
+    }
+    mSleeping = (wait.count() != 0);
+    return static_cast<int>(std::min<std::chrono::milliseconds::rep>(wait.count(), std::numeric_limits<int>::max()));
+}
+
+std::size_t EventLoop::dispatchSignals()
+{
+    std::size_t result = 0;
+    struct signalfd_siginfo info;
+    while (read(mSignalFd, &info, sizeof(info)) == sizeof(info)) {
+        auto it = mSignalHandlers.find(static_cast<int>(info.ssi_signo));
+        if (it != mSignalHandlers.end()) {
+            SignalCallback_t callback = it->second;
+            callback(static_cast<int>(info.ssi_signo));
+            ++result;
+        }
+    }
+    return result;
+}
+
+std::size_t EventLoop::runTasks()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mTasks.empty()) {
+            return 0;
+        }
+        mRunning.swap(mTasks);
+    }
+
+    std::size_t index = 0;
+    try {
+        while (index < mRunning.size()) {
+            Task_t task = std::move(mRunning[index++]);
+            task();
+        }
+    }
+    catch (...) {
+        // Keep the tasks not run yet, ahead of those posted meanwhile
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTasks.insert(mTasks.begin(), std::make_move_iterator(mRunning.begin() + static_cast<std::ptrdiff_t>(index)), std::make_move_iterator(mRunning.end()));
+        mRunning.clear();
+        throw;
+    }
+    mRunning.clear();
+    return index;
+}
+
+} /* namespace rsp::utils */
@@ -0,0 +1,58 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#include <bit>
+#include <utils/MemberIndex.h>
+
+namespace rsp::utils {
+
+void MemberIndex::Clear() noexcept
+{
+    mSlots.clear();
+    mMask = 0;
+    mUsed = 0;
+}
+
+void MemberIndex::resize(std::size_t aCount)
+{
+    // Every member is indexed, so the positions are 0 to mUsed - 1. Reinsert in member order,
+    // so the first of duplicate names is still met first when probing, also if it wraps around.
+    std::vector<std::uint32_t> hashes(mUsed);
+    for (const Slot &slot : mSlots) {
+        if (slot.mPosition) {
+            hashes[slot.mPosition - 1] = slot.mHash;
+        }
+    }
+
+    // Keep the load factor at or below 50%
+    mSlots.assign(std::bit_ceil(aCount * 2), Slot{0, 0});
+    mMask = mSlots.size() - 1;
+    mUsed = 0;
+
+    for (std::size_t i = 0 ; i < hashes.size() ; ++i) {
+        insert(hashes[i], i);
+    }
+}
+
+void MemberIndex::insert(std::uint32_t aHash, std::size_t aPosition)
+{
+    if (((mUsed + 1) * 2) > mSlots.size()) {
+        resize(mUsed + 1);
+    }
+
+    std::size_t i = aHash & mMask;
+    while (mSlots[i].mPosition) {
+        i = (i + 1) & mMask;
+    }
+    mSlots[i] = Slot{aHash, static_cast<std::uint32_t>(aPosition + 1)};
+    mUsed++;
+}
+
+} /* namespace rsp::utils */
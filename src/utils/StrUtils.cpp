@@ -11,6 +11,8 @@
 #include <ctime>
 #include <chrono>
 #include <algorithm>
+#include <charconv>
+#include <cctype>
 #include <locale>
 #include <sstream>
 #include <iomanip>
@@ -196,29 +198,77 @@ std::string Format(const char* apFormat, ...)
     return result;
 }
 
-double ToDouble(const std::string &arString)
+double ToDouble(std::string_view aString)
 {
-    std::istringstream stream(arString);
-    stream.imbue(std::locale::classic());
+    // Same input as stream extraction: leading whitespace and an optional plus sign
+    const char *p = aString.data();
+    const char *end = p + aString.size();
+    while ((p < end) && std::isspace(static_cast<unsigned char>(*p))) {
+        p++;
+    }
+    if ((p < end) && (*p == '+') && ((end - p) > 1) && (p[1] != '-')) {
+        p++;
+    }
     double d;
-    // maybe use some manipulators
-    stream >> d;
-    if(!stream) {
-        THROW_WITH_BACKTRACE1(DecimalConversionError, std::string("StrUtils::ToDouble conversion error. From " + arString + " to double"));
+    if (std::from_chars(p, end, d).ec != std::errc()) {
+        THROW_WITH_BACKTRACE1(DecimalConversionError, std::string("StrUtils::ToDouble conversion error. From " + std::string(aString) + " to double"));
     }
     return d;
 }
 
+/**
+ * Encoding UCS codepoint to UTF-8.
+ * \see https://stackoverflow.com/questions/6240055/manually-converting-unicode-codepoints-into-utf-8-and-utf-16
+ */
+void AppendUtf8(std::string &arResult, std::uint32_t aCodePoint)
+{
+    if (aCodePoint < 0x80) { // one byte binary 0xxxxxxx
+        arResult += static_cast<char>(aCodePoint);
+    }
+    else if (aCodePoint < 0x800) { // two byte binary 110xxxxx 10xxxxxx
+        char buf[2] = {
+            static_cast<char>(0xC0 | (aCodePoint >> 6)),
+            static_cast<char>(0x80 | (aCodePoint & 0x3F))
+        };
+        arResult.append(buf, sizeof(buf));
+    }
+    else if (aCodePoint < 0x10000) { // three byte binary 1110xxxx 10xxxxxx 10xxxxxx
+        char buf[3] = {
+            static_cast<char>(0xE0 | (aCodePoint >> 12)),
+            static_cast<char>(0x80 | ((aCodePoint >> 6) & 0x3F)),
+            static_cast<char>(0x80 | (aCodePoint & 0x3F))
+        };
+        arResult.append(buf, sizeof(buf));
+    }
+    else { // four byte binary 11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
+        char buf[4] = {
+            static_cast<char>(0xF0 | (aCodePoint >> 18)),
+            static_cast<char>(0x80 | ((aCodePoint >> 12) & 0x3F)),
+            static_cast<char>(0x80 | ((aCodePoint >> 6) & 0x3F)),
+            static_cast<char>(0x80 | (aCodePoint & 0x3F))
+        };
+        arResult.append(buf, sizeof(buf));
+    }
+}
+
 std::string ToString(double aValue, int aDigits, bool aFixed)
 {
     if (aDigits == -1) {
         aDigits = std::numeric_limits<double>::max_digits10;
     }
+    int precision = (aDigits >= 0) ? aDigits : 6; // Default precision of streams
+
+    char buffer[128];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), aValue,
+        aFixed ? std::chars_format::fixed : std::chars_format::general, precision);
+    if (result.ec == std::errc()) {
+        return std::string(buffer, result.ptr);
+    }
+
+    // Too long for the buffer, e.g. large values in fixed notation
     std::ostringstream out;
     out.imbue(std::locale::classic());
-    if (aDigits >= 0) {
-        out.precision(aDigits);
-    }
+    out.precision(precision);
     if (aFixed) {
         out << std::fixed;
     }
@@ -0,0 +1,211 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+#include <utils/ThreadPool.h>
+
+namespace rsp::utils {
+
+// Pool and queue index of the calling thread, if it is a worker
+static thread_local ThreadPool *tlpPool = nullptr;
+static thread_local std::size_t tlIndex = 0;
+
+ThreadPool::ThreadPool(std::size_t aThreads, bool aPinToCores)
+{
+    if (aThreads == 0) {
+        aThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    mWorkers.reserve(aThreads);
+    for (std::size_t i = 0; i < aThreads; ++i) {
+        mWorkers.push_back(std::make_unique<Worker>());
+    }
+    // Start threads only when all queues exist, they steal from each other
+    for (std::size_t i = 0; i < aThreads; ++i) {
+        mWorkers[i]->mThread = std::thread(&ThreadPool::run, this, i, aPinToCores);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+        mStopping = true;
+    }
+    mWake.notify_all();
+    for (auto &worker : mWorkers) {
+        worker->mThread.join();
+    }
+}
+
+ThreadPool& ThreadPool::GetDefault()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+bool ThreadPool::IsWorkerThread() const
+{
+    return tlpPool == this;
+}
+
+void ThreadPool::Post(Task_t aTask, Priority aPriority)
+{
+    auto priority = static_cast<std::size_t>(aPriority);
+    Queues &queues = IsWorkerThread() ? mWorkers[tlIndex]->mQueues : mShared;
+
+    // Counted before it is queued, so mPending never drops below the number of queued tasks.
+    // A worker going to sleep increments mSleeping before it checks mPending, so either it
+    // sees this task, or this sees it sleeping.
+    mPending.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(queues.mMutex);
+        queues.mTasks[priority].push_back(std::move(aTask));
+    }
+    if (mSleeping.load() > 0) {
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+        mWake.notify_one();
+    }
+}
+
+bool ThreadPool::RunPending()
+{
+    Task_t task;
+    if (!take(IsWorkerThread() ? tlIndex : mWorkers.size(), task)) {
+        return false;
+    }
+    task();
+    return true;
+}
+
+void ThreadPool::run(std::size_t aIndex, bool aPin)
+{
+    tlpPool = this;
+    tlIndex = aIndex;
+
+    std::string name = "rsp-pool-" + std::to_string(aIndex);
+    pthread_setname_np(pthread_self(), name.c_str());
+    if (aPin) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(aIndex % std::max(1u, std::thread::hardware_concurrency()), &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
+
+    Task_t task;
+    for (;;) {
+        if (take(aIndex, task)) {
+            task();
+            task.Clear();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mSleepMutex);
+        mSleeping.fetch_add(1);
+        while (mPending.load() == 0 && !mStopping) {
+            mWake.wait(lock);
+        }
+        mSleeping.fetch_sub(1);
+        if (mStopping && mPending.load() == 0) {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::take(std::size_t aIndex, Task_t &arTask)
+{
+    if (mPending.load() == 0) {
+        return false;
+    }
+    std::size_t count = mWorkers.size();
+    for (std::size_t priority = 0; priority < cPriorities; ++priority) {
+        if ((aIndex < count && popBack(mWorkers[aIndex]->mQueues, priority, arTask))
+            || popFront(mShared, priority, arTask)) {
+            mPending.fetch_sub(1);
+            return true;
+        }
+        for (std::size_t i = 1; i <= count; ++i) {
+            std::size_t victim = (aIndex + i) % count;
+            if (victim != aIndex && popFront(mWorkers[victim]->mQueues, priority, arTask)) {
+                mPending.fetch_sub(1);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::popBack(Queues &arQueues, std::size_t aPriority, Task_t &arTask)
+{
+    std::lock_guard<std::mutex> lock(arQueues.mMutex);
+    auto &tasks = arQueues.mTasks[aPriority];
+    if (tasks.empty()) {
+        return false;
+    }
+    arTask = std::move(tasks.back());
+    tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::popFront(Queues &arQueues, std::size_t aPriority, Task_t &arTask)
+{
+    std::lock_guard<std::mutex> lock(arQueues.mMutex);
+    auto &tasks = arQueues.mTasks[aPriority];
+    if (tasks.empty()) {
+        return false;
+    }
+    arTask = std::move(tasks.front());
+    tasks.pop_front();
+    return true;
+}
+
+
+TaskGroup::~TaskGroup()
+{
+    waitAll();
+}
+
+void TaskGroup::Wait()
+{
+    waitAll();
+    std::exception_ptr exception;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::swap(exception, mpException);
+    }
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+}
+
+void TaskGroup::finish()
+{
+    // Decrement under the lock, the group may be destroyed as soon as the waiter sees zero
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mPending.fetch_sub(1) == 1) {
+        mDone.notify_all();
+    }
+}
+
+void TaskGroup::waitAll()
+{
+    while (mPending.load() > 0) {
+        if (mrPool.RunPending()) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mMutex);
+        mDone.wait_for(lock, ThreadPool::cIdleWait, [this]() { return mPending.load() == 0; });
+    }
+    // Let the last task release the lock before the group can be destroyed
+    std::lock_guard<std::mutex> lock(mMutex);
+}
+
+} /* namespace rsp::utils */
@@ -8,7 +8,7 @@
  * \author      Steffen Brummer
  */
 
-#include <vector>
+#include <algorithm>
 #include <logging/Logger.h>
 #include <utils/Timer.h>
 
@@ -24,24 +24,23 @@ Timer::~Timer()
 
 Timer& Timer::SetTimeout(std::chrono::milliseconds aTimeout)
 {
-    bool enabled = IsEnabled();
-    Enable(false);
-    mTimeout = aTimeout;
-    Enable(enabled);
+    if (IsEnabled()) {
+        TimerQueue::Get().setTimeout(*this, aTimeout);
+    }
+    else {
+        mTimeout = aTimeout;
+    }
     return *this;
 }
 
 Timer& Timer::Enable(bool aOn)
 {
-    if (mEnabled == aOn) {
-        return *this;
-    }
-    mEnabled = aOn;
-
     if (aOn) {
-        TimerQueue::Get().RegisterTimer(this);
+        if (!mEnabled) {
+            TimerQueue::Get().RegisterTimer(this);
+        }
     }
-    else {
+    else if (mEnabled || mTriggering) {
         TimerQueue::Get().UnregisterTimer(this);
     }
 
@@ -50,89 +49,215 @@ Timer& Timer::Enable(bool aOn)
 
 void Timer::trigger()
 {
-    if (mEnabled) {
-        mEnabled = false;
-        mCallback(*this);
-    }
+    mCallback(*this);
 }
 
 
 TimerQueue::TimerQueue()
 {
     TLOG("Creating TimerQueue");
-//    mOffset = std::chrono::time_point_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now()).time_since_epoch();
 }
 
-void TimerQueue::Poll()
+TimerQueue::~TimerQueue()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (Entry &entry : mHeap) {
+        entry.mpTimer->mEnabled = false;
+        entry.mpTimer->mQueueIndex = Timer::cNotQueued;
+    }
+}
+
+std::size_t TimerQueue::Poll()
 {
-    std::vector<Timer*> expired;
+    std::size_t result = 0;
+    std::int64_t now = RunTime().Milliseconds();
+    std::unique_lock<std::mutex> lock(mMutex);
+    std::uint64_t armed_before = mSequence;
 
-    for(;;) {
-        if (mQueue.size() == 0) {
-            TLOG("No timers exists.");
-            break;
-        }
-        auto it = mQueue.begin();
-
-        RunTime now;
-            TLOG("Timer " << (*it)->GetId()
-            << " expires at " << (*it)->mTimeoutAt
-            << ". Now: "
-            << now);
-
-        if ((*it)->mTimeoutAt <= now) {
-            expired.push_back(*it);
-            TLOG("Removing timer " << (*it)->GetId());
-            mQueue.erase(it);
-        }
-        else {
-            break;
+    // Timers armed during this poll have deadlines >= now and sequence numbers >= armed_before,
+    // so they always sort after the timers already expired when the poll started.
+    while (!mHeap.empty() && (mHeap.front().mDeadline <= now) && (mHeap.front().mSequence < armed_before)) {
+        Timer *timer = mHeap.front().mpTimer;
+        TLOG("Triggering timer " << timer->GetId() << " expired at " << mHeap.front().mDeadline << ". Now: " << now);
+        remove(*timer);
+        timer->mEnabled = false;
+        timer->mTriggering = true;
+        mpTriggering = timer;
+        mTriggeringThread = std::this_thread::get_id();
+        lock.unlock();
+
+        timer->trigger();
+        ++result;
+
+        lock.lock();
+        if (mpTriggering == timer) { // Not destroyed by the callback
+            timer->mTriggering = false;
+            mpTriggering = nullptr;
         }
+        mTriggered.notify_all();
     }
+    return result;
+}
 
-    if (expired.empty()) {
-        TLOG("No timers expired.");
+void TimerQueue::RegisterTimer(Timer *apTimer)
+{
+    if (!apTimer) {
         return;
     }
-    for(Timer* timer : expired) {
-        TLOG("Triggering timer " << timer->GetId());
-        timer->trigger();
-    }
+    std::lock_guard<std::mutex> lock(mMutex);
+    insert(*apTimer);
 }
 
-void TimerQueue::RegisterTimer(Timer *apTimer)
+void TimerQueue::UnregisterTimer(Timer *apTimer)
 {
     if (!apTimer) {
         return;
     }
-    apTimer->mTimeoutAt = RunTime(apTimer->GetTimeout());
+    std::unique_lock<std::mutex> lock(mMutex);
+    waitForTrigger(lock, *apTimer);
+    if (apTimer->mQueueIndex != Timer::cNotQueued) {
+        TLOG("Removing timer " << apTimer->GetId());
+        remove(*apTimer);
+    }
+    apTimer->mEnabled = false;
+}
 
-    for (auto it = mQueue.begin(); it != mQueue.end(); ++it) {
-        TLOG("Check timer: " << apTimer->GetId() << ":" << apTimer->mTimeoutAt
-            << " < " << (*it)->GetId() << ":" << (*it)->mTimeoutAt);
+std::optional<std::chrono::milliseconds> TimerQueue::NextDeadline() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mHeap.empty()) {
+        return std::nullopt;
+    }
+    return std::chrono::milliseconds(mHeap.front().mDeadline);
+}
 
-        if (apTimer->mTimeoutAt < (*it)->mTimeoutAt) {
-            TLOG("Inserting timer " << apTimer->GetId() << " before timer " << (*it)->GetId());
-            mQueue.insert(it, apTimer);
-            return;
-        }
+std::chrono::milliseconds TimerQueue::TimeUntilNext(std::chrono::milliseconds aMax) const
+{
+    auto deadline = NextDeadline();
+    if (!deadline) {
+        return aMax;
     }
-    TLOG("Appending timer " << apTimer->GetId());
-    mQueue.push_back(apTimer);
+    auto remaining = std::chrono::milliseconds(deadline->count() - RunTime().Milliseconds());
+    return std::clamp(remaining, std::chrono::milliseconds(0), aMax);
 }
 
-void TimerQueue::UnregisterTimer(Timer *apTimer)
+std::size_t TimerQueue::GetSize() const
 {
-    if (!apTimer) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mHeap.size();
+}
+
+void TimerQueue::SetWakeup(Function<void()> aWakeup)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mWakeup = std::move(aWakeup);
+}
+
+void TimerQueue::setTimeout(Timer &arTimer, std::chrono::milliseconds aTimeout)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    arTimer.mTimeout = aTimeout;
+    if (arTimer.mQueueIndex != Timer::cNotQueued) {
+        insert(arTimer);
+    }
+}
+
+void TimerQueue::insert(Timer &arTimer)
+{
+    arTimer.mTimeoutAt = RunTime(arTimer.mTimeout);
+    Entry entry{arTimer.mTimeoutAt.Milliseconds(), mSequence++, &arTimer};
+    TLOG("Inserting timer " << arTimer.GetId() << " expiring at " << entry.mDeadline);
+
+    if (arTimer.mQueueIndex == Timer::cNotQueued) {
+        mHeap.push_back(entry);
+        place(mHeap.size() - 1, entry);
+        siftUp(arTimer.mQueueIndex);
+    }
+    else {
+        place(arTimer.mQueueIndex, entry);
+        siftUp(arTimer.mQueueIndex);
+        siftDown(arTimer.mQueueIndex);
+    }
+    arTimer.mEnabled = true;
+    if (arTimer.mQueueIndex == 0 && mWakeup) {
+        mWakeup();
+    }
+}
+
+void TimerQueue::remove(Timer &arTimer)
+{
+    std::size_t index = arTimer.mQueueIndex;
+    Entry last = mHeap.back();
+    mHeap.pop_back();
+    arTimer.mQueueIndex = Timer::cNotQueued;
+    if (index < mHeap.size()) {
+        place(index, last);
+        siftUp(index);
+        siftDown(last.mpTimer->mQueueIndex);
+    }
+}
+
+void TimerQueue::waitForTrigger(std::unique_lock<std::mutex> &arLock, const Timer &arTimer)
+{
+    if (mpTriggering != &arTimer) {
+        return;
+    }
+    if (mTriggeringThread == std::this_thread::get_id()) {
+        // Called from the callback, Poll must not touch the timer after it returns
+        mpTriggering->mTriggering = false;
+        mpTriggering = nullptr;
         return;
     }
-    for (auto it = mQueue.cbegin(); it != mQueue.cend() ; ++it) {
-        if (*it == apTimer) {
-            TLOG("Removing timer " << (*it)->GetId());
-            mQueue.erase(it);
+    mTriggered.wait(arLock, [this, &arTimer]() { return mpTriggering != &arTimer; });
+}
+
+bool TimerQueue::isBefore(const Entry &arA, const Entry &arB)
+{
+    if (arA.mDeadline != arB.mDeadline) {
+        return arA.mDeadline < arB.mDeadline;
+    }
+    return arA.mSequence < arB.mSequence;
+}
+
+void TimerQueue::place(std::size_t aIndex, const Entry &arEntry)
+{
+    mHeap[aIndex] = arEntry;
+    arEntry.mpTimer->mQueueIndex = aIndex;
+}
+
+void TimerQueue::siftUp(std::size_t aIndex)
+{
+    Entry entry = mHeap[aIndex];
+    while (aIndex > 0) {
+        std::size_t parent = (aIndex - 1) / 2;
+        if (!isBefore(entry, mHeap[parent])) {
+            break;
+        }
+        place(aIndex, mHeap[parent]);
+        aIndex = parent;
+    }
+    place(aIndex, entry);
+}
+
+void TimerQueue::siftDown(std::size_t aIndex)
+{
+    Entry entry = mHeap[aIndex];
+    std::size_t size = mHeap.size();
+    for (;;) {
+        std::size_t child = 2 * aIndex + 1;
+        if (child >= size) {
+            break;
+        }
+        if ((child + 1 < size) && isBefore(mHeap[child + 1], mHeap[child])) {
+            ++child;
+        }
+        if (!isBefore(mHeap[child], entry)) {
             break;
         }
+        place(aIndex, mHeap[child]);
+        aIndex = child;
     }
+    place(aIndex, entry);
 }
 
-} /* namespace rsp::graphics */
+} /* namespace rsp::utils */
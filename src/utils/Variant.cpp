@@ -8,8 +8,10 @@
  * \author      Steffen Brummer
  */
 
-#include <sstream>
+#include <atomic>
 #include <cstdio>
+#include <cstring>
+#include <new>
 #include <utils/Variant.h>
 #include <logging/Logger.h>
 #include <utils/StrUtils.h>
@@ -19,207 +21,323 @@
 
 namespace rsp::utils {
 
+/**
+ * \brief Immutable heap string shared between Variant copies.
+ *
+ * The characters follow the header in the same allocation, zero terminated.
+ */
+struct Variant::SharedString
+{
+    std::atomic<std::uint32_t> mReferences;
+    std::size_t mSize;
+
+    const char* Data() const { return reinterpret_cast<const char*>(this + 1); }
+
+    static SharedString* Create(std::string_view aValue)
+    {
+        void *p = ::operator new(sizeof(SharedString) + aValue.size() + 1);
+        auto *result = new (p) SharedString{{1}, aValue.size()};
+        char *data = reinterpret_cast<char*>(result + 1);
+        std::memcpy(data, aValue.data(), aValue.size());
+        data[aValue.size()] = '\0';
+        return result;
+    }
+
+    void Acquire()
+    {
+        mReferences.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Release()
+    {
+        if (mReferences.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            this->~SharedString();
+            ::operator delete(this);
+        }
+    }
+};
+
 Variant::Variant()
-    : mType(Types::Null),
-      mPointer(reinterpret_cast<uintptr_t>(nullptr))
+    : mPointer(reinterpret_cast<uintptr_t>(nullptr)),
+      mType(Types::Null)
 {
     JLOG("Variant default constructor");
 }
 
 Variant::Variant(const Variant &arOther)
-    : mType(arOther.mType),
-      mInt(arOther.mInt),
-      mString(arOther.mString)
+    : mType(Types::Null)
 {
     JLOG("Variant copy constructor");
+    copyFrom(arOther);
 }
 
-Variant::Variant(Variant &&arOther)
-    : mType(arOther.mType),
-      mInt(arOther.mInt),
-      mString(arOther.mString)
+Variant::Variant(Variant &&arOther) noexcept
+    : mType(Types::Null)
 {
     JLOG("Variant move constructor");
-    arOther.mType = Types::Null;
+    moveFrom(arOther);
 }
 
 Variant& Variant::operator=(const Variant &arOther)
 {
     if (&arOther != this) {
         JLOG("Variant copy assignment");
-        mType = arOther.mType;
-        mInt = arOther.mInt,
-        mString = arOther.mString;
+        reset(Types::Null);
+        copyFrom(arOther);
     }
     return *this;
 }
 
-Variant& Variant::operator=(Variant &&arOther)
+Variant& Variant::operator=(Variant &&arOther) noexcept
 {
     if (&arOther != this) {
         JLOG("Variant move assignment");
-        mType = arOther.mType;
-        mInt = std::move(arOther.mInt),
-        mString = std::move(arOther.mString);
-        arOther.mType = Types::Null;
+        reset(Types::Null);
+        moveFrom(arOther);
     }
     return *this;
 }
 
+/*
+ * Copy the value of another object, this object must not hold a string.
+ */
+void Variant::copyFrom(const Variant &arOther)
+{
+    mType = arOther.mType;
+    mSize = arOther.mSize;
+    if (mType != Types::String) {
+        mInt = arOther.mInt;
+    }
+    else if (mSize == cShared) {
+        mpShared = arOther.mpShared;
+        mpShared->Acquire();
+    }
+    else {
+        std::memcpy(mInline, arOther.mInline, mSize + 1u);
+    }
+}
+
+/*
+ * Take over the value of another object, this object must not hold a string.
+ */
+void Variant::moveFrom(Variant &arOther) noexcept
+{
+    mType = arOther.mType;
+    mSize = arOther.mSize;
+    if (mType != Types::String) {
+        mInt = arOther.mInt;
+    }
+    else if (mSize == cShared) {
+        mpShared = arOther.mpShared;
+    }
+    else {
+        std::memcpy(mInline, arOther.mInline, mSize + 1u);
+    }
+    arOther.mSize = 0;
+    arOther.mType = Types::Null;
+}
+
+void Variant::reset(Types aType)
+{
+    if ((mType == Types::String) && (mSize == cShared)) {
+        mpShared->Release();
+    }
+    mSize = 0;
+    mType = aType;
+}
+
+void Variant::setString(std::string_view aValue)
+{
+    if (aValue.size() > cInlineCapacity) {
+        SharedString *shared = SharedString::Create(aValue);
+        reset(Types::String);
+        mpShared = shared;
+        mSize = cShared;
+        return;
+    }
+    // Copy first, aValue could be a view of the current value
+    char buffer[cInlineCapacity + 1];
+    std::memcpy(buffer, aValue.data(), aValue.size());
+    buffer[aValue.size()] = '\0';
+    reset(Types::String);
+    std::memcpy(mInline, buffer, aValue.size() + 1);
+    mSize = static_cast<std::uint8_t>(aValue.size());
+}
+
+std::string_view Variant::RawAsString() const
+{
+    if (mType != Types::String) {
+        return {};
+    }
+    if (mSize == cShared) {
+        return std::string_view(mpShared->Data(), mpShared->mSize);
+    }
+    return std::string_view(mInline, mSize);
+}
+
+Variant::operator const char*() const
+{
+    if (mType == Types::String) {
+        return RawAsString().data();
+    }
+    static thread_local std::string buffer;
+    buffer = AsString();
+    return buffer.c_str();
+}
+
 
 Variant::Variant(bool aValue)
-    : mType(Types::Bool),
-      mBool(aValue)
+    : mBool(aValue),
+      mType(Types::Bool)
 {
     JLOG("Variant bool constructor");
 }
 
 Variant::Variant(int aValue)
-    : mType(Types::Int),
-      mInt(aValue)
+    : mInt(aValue),
+      mType(Types::Int)
 {
     JLOG("Variant int constructor");
 }
 
 Variant::Variant(std::int64_t aValue)
-    : mType(Types::Int64),
-      mInt(aValue)
+    : mInt(aValue),
+      mType(Types::Int64)
 {
     JLOG("Variant int64 constructor");
 }
 
 Variant::Variant(std::uint64_t aValue)
-    : mType(Types::Uint64),
-      mInt(static_cast<std::int64_t>(aValue))
+    : mInt(static_cast<std::int64_t>(aValue)),
+      mType(Types::Uint64)
 {
     JLOG("Variant uint64 constructor");
 }
 
 Variant::Variant(std::uint32_t aValue)
-    : mType(Types::Uint32),
-      mInt(aValue)
+    : mInt(aValue),
+      mType(Types::Uint32)
 {
     JLOG("Variant uint32 constructor");
 }
 
 Variant::Variant(std::uint16_t aValue)
-    : mType(Types::Uint16),
-      mInt(aValue)
+    : mInt(aValue),
+      mType(Types::Uint16)
 {
     JLOG("Variant uint16 constructor");
 }
 
 Variant::Variant(float aValue)
-    : mType(Types::Float),
-      mFloat(aValue)
+    : mFloat(aValue),
+      mType(Types::Float)
 {
     JLOG("Variant float constructor");
 }
 
 Variant::Variant(double aValue)
-    : mType(Types::Double),
-      mDouble(aValue)
+    : mDouble(aValue),
+      mType(Types::Double)
 {
     JLOG("Variant double constructor");
 }
 
 Variant::Variant(void *apValue)
-    : mType(Types::Pointer),
-      mPointer(reinterpret_cast<uintptr_t>(apValue))
+    : mPointer(reinterpret_cast<uintptr_t>(apValue)),
+      mType(Types::Pointer)
 {
     JLOG("Variant pointer constructor");
 }
 
 Variant::Variant(const std::string &arValue)
-    : mType(Types::String),
-      mString(arValue)
+    : mType(Types::Null)
 {
+    setString(arValue);
 }
 
 Variant::Variant(const char *apValue)
-    : mType(Types::String),
-      mString(apValue)
+    : mType(Types::Null)
 {
+    setString(apValue);
 }
 
 Variant::~Variant()
 {
+    reset(Types::Null);
 }
 
 Variant& Variant::operator =(bool aValue)
 {
-    mType = Types::Bool;
+    reset(Types::Bool);
     mBool = aValue;
     return *this;
 }
 
 Variant& Variant::operator =(int aValue)
 {
-    mType = Types::Int;
+    reset(Types::Int);
     mInt = aValue;
     return *this;
 }
 
 Variant& Variant::operator =(std::int64_t aValue)
 {
-    mType = Types::Int64;
+    reset(Types::Int64);
     mInt = aValue;
     return *this;
 }
 
 Variant& Variant::operator =(std::uint64_t aValue)
 {
-    mType = Types::Uint64;
+    reset(Types::Uint64);
     mInt = static_cast<std::int64_t>(aValue);
     return *this;
 }
 
 Variant& Variant::operator =(std::uint32_t aValue)
 {
-    mType = Types::Uint32;
+    reset(Types::Uint32);
     mInt = aValue;
     return *this;
 }
 
 Variant& Variant::operator =(std::uint16_t aValue)
 {
-    mType = Types::Uint16;
+    reset(Types::Uint16);
     mInt = aValue;
     return *this;
 }
 
 Variant& Variant::operator =(float aValue)
 {
-    mType = Types::Float;
+    reset(Types::Float);
     mFloat = aValue;
     return *this;
 }
 
 Variant& Variant::operator =(double aValue)
 {
-    mType = Types::Double;
+    reset(Types::Double);
     mDouble = aValue;
     return *this;
 }
 
 Variant& Variant::operator =(void *apValue)
 {
-    mType = Types::Pointer;
+    reset(Types::Pointer);
     mPointer = reinterpret_cast<uintptr_t>(apValue);
     return *this;
 }
 
 Variant& Variant::operator =(const std::string &arValue)
 {
-    mType = Types::String;
-    mString = arValue;
+    setString(arValue);
     return *this;
 }
 
 Variant& Variant::operator =(const char *apValue)
 {
-    mType = Types::String;
-    mString = apValue;
+    setString(apValue);
     return *this;
 }
 
@@ -249,13 +367,16 @@ bool Variant::AsBool() const
             return (mPointer != reinterpret_cast<uintptr_t>(nullptr));
 
         case Types::String:
-            if (mString == "true" || mString == "1") {
+        {
+            std::string_view value = RawAsString();
+            if (value == "true" || value == "1") {
                 return true;
             }
-            else if (mString == "false" || mString == "0" || mString == "null") {
+            else if (value == "false" || value == "0" || value == "null") {
                 return false;
             }
-            return (mString.length() > 0);
+            return (value.length() > 0);
+        }
 
         default:
             THROW_WITH_BACKTRACE2(EConversionError, TypeToText(), "bool");
@@ -286,7 +407,8 @@ std::int64_t Variant::AsInt() const
             return static_cast<std::int64_t>(mPointer);
 
         case Types::String:
-            return static_cast<std::int64_t>(std::strtol(mString.c_str(), nullptr, 0));
+            // The string is zero terminated, strtol keeps the base prefix support without a copy
+            return static_cast<std::int64_t>(std::strtol(RawAsString().data(), nullptr, 0));
 
         default:
             THROW_WITH_BACKTRACE2(EConversionError, TypeToText(), "int");
@@ -317,7 +439,7 @@ double Variant::AsDouble() const
             return static_cast<double>(mPointer);
 
         case Types::String:
-            return StrUtils::ToDouble(mString);
+            return StrUtils::ToDouble(RawAsString());
 
         default:
             THROW_WITH_BACKTRACE2(EConversionError, TypeToText(), "double");
@@ -359,7 +481,7 @@ std::string Variant::AsString() const
         }
 
         case Types::String:
-            return mString;
+            return std::string(RawAsString());
 
         default:
             THROW_WITH_BACKTRACE2(EConversionError, TypeToText(), "string");
@@ -13,14 +13,22 @@
     #define GFX_FPS 100
 #endif
 
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <unistd.h>
 #include <doctest.h>
 #include <posix/FileSystem.h>
 #include <graphics/controls/Label.h>
 #include <graphics/Framebuffer.h>
 #include <graphics/GraphicsMain.h>
+#include <messaging/Broker.h>
+#include <messaging/Subscriber.h>
+#include <utils/EventLoop.h>
 #include <utils/Timer.h>
 #include <scenes/Scenes.h>
 #include <TestHelpers.h>
+#include <eventTypes/ClickedEvent.h>
 #include <TestTouchParser.h>
 
 using namespace rsp::graphics;
@@ -63,6 +71,56 @@ protected:
     int mMaxFps = 0;
 };
 
+/*
+ * Touch parser with a device that never becomes readable, so the event loop sleeps between events.
+ */
+class IdleTouchParser : public TestTouchParser
+{
+public:
+    IdleTouchParser()
+    {
+        REQUIRE_EQ(pipe(mPipe), 0);
+    }
+    ~IdleTouchParser() override
+    {
+        close(mPipe[0]);
+        close(mPipe[1]);
+    }
+
+    int GetFd() override { return mPipe[0]; }
+
+protected:
+    int mPipe[2]{ -1, -1 };
+};
+
+class UpdateHook : public Label
+{
+public:
+    void UpdateData() override
+    {
+        if (mOnUpdate) {
+            mOnUpdate();
+        }
+    }
+
+    std::function<void()> mOnUpdate{};
+};
+
+enum class GuiTopic { Changed };
+
+class GuiBroker : public rsp::messaging::Broker<GuiTopic>
+{
+};
+
+class GuiSubscriber : public rsp::messaging::Subscriber<GuiTopic>
+{
+public:
+    explicit GuiSubscriber(GuiBroker &arBroker) : Subscriber<GuiTopic>(arBroker, 16) {}
+    ~GuiSubscriber() override { Detach(); }
+
+    void HandleEvent(rsp::messaging::Event &) override {}
+};
+
 TEST_CASE("Graphics Main Test")
 {
     rsp::logging::Logger logger;
@@ -220,6 +278,66 @@ TEST_CASE("Graphics Main Test")
         gfx.Run(1000, true);
     }
 
+    SUBCASE("Event Loop") {
+        using Clock = std::chrono::steady_clock;
+
+        IdleTouchParser idle;
+        GraphicsMain loop_gfx(fb, idle, scenes);
+        loop_gfx.ChangeScene(SecondScene::ID);
+
+        EventLoop loop;
+        loop.PollTimers();
+        GuiBroker broker;
+        GuiSubscriber sub(broker);
+        sub.Subscribe(GuiTopic::Changed);
+        sub.SetEventLoop(&loop);
+
+        // Nothing else happens after the timer or the event, so the GUI must render them before it sleeps
+        Clock::time_point timer_fired{};
+        Clock::time_point published{};
+        std::chrono::milliseconds timer_latency{-1};
+        std::chrono::milliseconds event_latency{-1};
+        std::thread publisher;
+
+        Timer timer(2, 200ms);
+        timer.Callback() = [&](Timer &) {
+            timer_fired = Clock::now();
+            publisher = std::thread([&]() {
+                std::this_thread::sleep_for(200ms);
+                published = Clock::now();
+                broker.Publish(GuiTopic::Changed, rsp::messaging::MakeEvent<rsp::messaging::ClickedEvent>("Changed"));
+            });
+        };
+        Timer watchdog(3, 3000ms);
+        watchdog.Callback() = [&loop_gfx](Timer &) { loop_gfx.Terminate(); };
+
+        UpdateHook hook;
+        hook.mOnUpdate = [&]() {
+            if ((timer_fired != Clock::time_point{}) && (timer_latency.count() < 0)) {
+                timer_latency = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - timer_fired);
+            }
+            if (sub.ProcessEvents()) {
+                event_latency = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - published);
+                loop_gfx.Terminate();
+            }
+        };
+        loop_gfx.RegisterOverlay(&hook);
+
+        timer.Enable();
+        watchdog.Enable();
+        loop_gfx.Run(loop, 30);
+        if (publisher.joinable()) {
+            publisher.join();
+        }
+        sub.SetEventLoop(nullptr);
+        loop_gfx.RegisterOverlay(nullptr);
+
+        CHECK_GE(timer_latency.count(), 0);
+        CHECK_LT(timer_latency.count(), 150);
+        CHECK_GE(event_latency.count(), 0);
+        CHECK_LT(event_latency.count(), 150);
+    }
+
     gfx.RegisterOverlay(nullptr);
 
     TimerQueue::Destroy();
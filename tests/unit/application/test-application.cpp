@@ -10,6 +10,7 @@
 
 #include <fstream>
 #include <filesystem>
+#include <thread>
 #include <doctest.h>
 #include <application/CommandLine.h>
 #include <utils/StrUtils.h>
@@ -41,6 +42,21 @@ TEST_CASE("Application")
         CHECK(app.GetCommandLine().GetCommands().size() == 0);
     }
 
+    SUBCASE("Terminate Idle Application") {
+        ApplicationBase app;
+        int posted = 0;
+
+        // The default application sleeps in its event loop until woken
+        app.GetEventLoop().Post([&posted]() { posted++; });
+        std::thread terminator([&app]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            app.Terminate(42);
+        });
+        CHECK_EQ(app.Run(), 42);
+        CHECK_EQ(posted, 1);
+        terminator.join();
+    }
+
     SUBCASE("Instantiate TestApplication") {
         std::remove(cLogFileName);
 
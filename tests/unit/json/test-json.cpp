@@ -10,8 +10,16 @@
 
 #include <json/Json.h>
 #include <json/JsonDecoder.h>
+#include <json/JsonDocument.h>
+#include <json/JsonEncoder.h>
+#include <json/JsonIndexedDecoder.h>
+#include <json/JsonLazyDocument.h>
+#include <json/JsonReader.h>
+#include <json/JsonStructuralIndex.h>
 
 #include "doctest.h"
+#include <filesystem>
+#include <functional>
 #include <iostream>
 #include <utils/StrUtils.h>
 #include <utils/InRange.h>
@@ -224,6 +232,33 @@ null }
         CHECK_THROWS_AS(JsonDecoder(R"({ null })").GetValue(), const EJsonParseError &);
         CHECK_THROWS_AS(JsonDecoder(R"({ , })").GetValue(), const EJsonParseError &);
         CHECK_THROWS_AS(JsonDecoder(R"({ "BadObject": "Excessive Delimiter",})").GetValue(), const EJsonParseError &);
+        CHECK_THROWS_AS(JsonDecoder(R"([ 1, 2 )").GetValue(), const EJsonParseError &);
+        CHECK_THROWS_AS(JsonDecoder(R"({ "Unterminated: 1 })").GetValue(), const EJsonParseError &);
+        CHECK_THROWS_AS(JsonDecoder(R"("\u12G4")").GetValue(), const EJsonFormatError &);
+        CHECK_THROWS_AS(JsonDecoder(R"("\uD83D")").GetValue(), const EJsonFormatError &);
+        CHECK_THROWS_AS(JsonDecoder(R"("\uDE00")").GetValue(), const EJsonFormatError &);
+        CHECK_THROWS_AS(JsonDecoder(R"(012)").GetValue(), const EJsonNumberError &);
+        CHECK_THROWS_AS(JsonDecoder(R"(1.e5)").GetValue(), const EJsonNumberError &);
+        CHECK_THROWS_AS(JsonDecoder(std::string(1000, '[')).GetValue(), const EJsonParseError &);
+    }
+
+    SUBCASE("Decode Escapes and Numbers") {
+        JsonValue v = JsonDecoder(R"(["\uD83D\uDE00", "Tab\there\u00e6", -9223372036854775808, 18446744073709551615, 18446744073709551616, -0.5e-3, 1E2])").GetValue();
+        REQUIRE(v.GetCount() == 7);
+        CHECK_EQ(v[0].AsString(), "\xF0\x9F\x98\x80");
+        CHECK_EQ(v[1].AsString(), "Tab\there\xC3\xA6");
+        CHECK(v[2].GetType() == JsonValue::Types::Int64);
+        CHECK_EQ(v[2].AsInt(), INT64_MIN);
+        CHECK(v[3].GetType() == JsonValue::Types::Uint64);
+        CHECK_EQ(std::uint64_t(v[3]), UINT64_MAX);
+        CHECK(v[4].GetType() == JsonValue::Types::Double);
+        CHECK_EQ(v[5].AsDouble(), -0.0005);
+        CHECK_EQ(v[6].AsDouble(), 100.0);
+
+        std::string text = R"({"a":{"b":[1,{"c":"d"}]}})";
+        JsonDecoder decoder(text);
+        CHECK_EQ(std::string_view(decoder).data(), text.data());
+        CHECK_EQ(decoder.GetValue()["a"]["b"][1]["c"].AsString(), "d");
     }
 
     SUBCASE("Copy") {
@@ -337,6 +372,389 @@ null }
     }
 }
 
+static std::string readEvents(JsonReader &arReader, std::string_view aJson, std::size_t aChunkSize)
+{
+    std::string result;
+    std::size_t pos = 0;
+    for (;;) {
+        auto ev = arReader.Next();
+        switch (ev) {
+            case JsonReader::Event::NeedInput:
+                if (pos >= aJson.size()) {
+                    arReader.Finish();
+                }
+                else {
+                    arReader.Feed(aJson.substr(pos, aChunkSize));
+                    pos += aChunkSize;
+                }
+                continue;
+            case JsonReader::Event::StartObject: result += "{"; break;
+            case JsonReader::Event::EndObject: result += "}"; break;
+            case JsonReader::Event::StartArray: result += "["; break;
+            case JsonReader::Event::EndArray: result += "]"; break;
+            case JsonReader::Event::Key: result += "K:" + std::string(arReader.GetString()) + " "; break;
+            case JsonReader::Event::String: result += "S:" + std::string(arReader.GetString()) + " "; break;
+            case JsonReader::Event::Number: result += "N:" + arReader.GetValue().AsString() + " "; break;
+            case JsonReader::Event::Bool: result += arReader.GetValue().AsBool() ? "T " : "F "; break;
+            case JsonReader::Event::Null: result += "null "; break;
+            case JsonReader::Event::EndOfDocument: return result;
+        }
+    }
+}
+
+TEST_CASE("Json Reader") {
+    const std::string json = R"( {"a": [1, -2.5, true, false, null], "b\n": "xæ😀y", "c": {}, "d": [[]]} )";
+    const std::string expected = "{K:a [N:1 N:-2.5 T F null ]K:b\n S:xæ\U0001F600y K:c {}K:d [[]]}";
+
+    SUBCASE("Chunks") {
+        for (std::size_t chunk : {json.size(), std::size_t(7), std::size_t(1)}) {
+            JsonReader reader;
+            CHECK_EQ(readEvents(reader, json, chunk), expected);
+            CHECK_EQ(reader.GetDepth(), 0);
+        }
+    }
+
+    SUBCASE("Scalars") {
+        JsonReader reader;
+        CHECK_EQ(readEvents(reader, "42", 1), "N:42 ");
+        reader.Reset();
+        CHECK_EQ(readEvents(reader, "\"str\"", 2), "S:str ");
+        reader.Reset();
+        CHECK_EQ(readEvents(reader, "  ", 1), "");
+    }
+
+    SUBCASE("Errors") {
+        JsonReader reader;
+        CHECK_THROWS_AS(readEvents(reader, R"({"a" 1})", 3), EJsonParseError);
+        reader.Reset();
+        CHECK_THROWS_AS(readEvents(reader, R"([1, 2)", 3), EJsonParseError);
+        reader.Reset();
+        CHECK_THROWS_AS(readEvents(reader, R"([1} )", 3), EJsonParseError);
+        reader.Reset();
+        CHECK_THROWS_AS(readEvents(reader, R"(["\x"])", 3), EJsonFormatError);
+        reader.Reset();
+        CHECK_THROWS_AS(readEvents(reader, R"(["\ud83d"])", 3), EJsonFormatError);
+        reader.Reset();
+        CHECK_THROWS_AS(readEvents(reader, R"(nul)", 3), EJsonParseError);
+        reader.Reset();
+        CHECK_THROWS_AS(readEvents(reader, R"({} {})", 3), EJsonParseError);
+
+        JsonReader limited(8, 2);
+        CHECK_THROWS_AS(readEvents(limited, R"(["0123456789"])", 3), EJsonParseError);
+        limited.Reset();
+        CHECK_THROWS_AS(readEvents(limited, R"([[[]]])", 3), EJsonParseError);
+    }
+
+    SUBCASE("File") {
+        const std::string file_name = "json-reader-test.json";
+        {
+            rsp::posix::FileIO file(file_name, std::ios_base::out, 0644);
+            file.Write(json.data(), json.size());
+        }
+        rsp::posix::FileIO file(file_name, std::ios_base::in);
+        JsonReader reader;
+        std::size_t count = 0;
+        while (reader.Next(file) != JsonReader::Event::EndOfDocument) {
+            count++;
+        }
+        CHECK_EQ(count, 20);
+        std::filesystem::remove(file_name);
+    }
+}
+
+TEST_CASE("Json Encoder") {
+    rsp::logging::Logger logger;
+    rsp::logging::Logger::SetDefault(&logger);
+
+    SUBCASE("Escapes") {
+        std::string result;
+        JsonEncoder::EscapeString(result, "plain text without escapes");
+        CHECK_EQ(result, "plain text without escapes");
+
+        result.clear();
+        JsonEncoder::EscapeString(result, "a\"b\\c\b\f\n\r\t\x01 long clean run\x1f");
+        CHECK_EQ(result, R"(a\"b\\c\b\f\n\r\t\u0001 long clean run\u001f)");
+
+        result.clear();
+        JsonEncoder::EscapeString(result, "xæ€😀y", true);
+        CHECK_EQ(result, R"(x\u00e6\u20ac\ud83d\ude00y)");
+
+        result.clear();
+        JsonEncoder::EscapeString(result, "xæ€😀y", false);
+        CHECK_EQ(result, "xæ€😀y");
+
+        CHECK_THROWS_AS(JsonEncoder::EscapeString(result, "\xe2\x82", true), EJsonParseError);
+    }
+
+    SUBCASE("Values") {
+        DynamicData dd;
+        dd.Add("int", -12);
+        dd.Add("uint", std::uint64_t(18446744073709551615u));
+        dd.Add("float", 1.42f);
+        dd.Add("double", 456321.7651234);
+        dd.Add("bool", true);
+        dd.Add("null", DynamicData());
+        dd.Add("quote\"key", "line\nbreak");
+        DynamicData arr;
+        arr.Add(1).Add(22);
+        dd.Add("arr", arr);
+
+        CHECK_EQ(JsonEncoder::Encode(dd), R"({"int":-12,"uint":18446744073709551615,"float":1.41999996,"double":456321.76512340002,)"
+                                          R"("bool":true,"null":null,"quote\"key":"line\nbreak","arr":[1,22]})");
+
+        CHECK_EQ(JsonEncoder::Encode(arr, true, false, 4), "[\n             1,         22\n]");
+    }
+
+    SUBCASE("Sink") {
+        DynamicData dd;
+        for (int i = 0 ; i < 10000 ; ++i) {
+            dd.Add("Some text to encode " + std::to_string(i));
+        }
+        std::string expected = JsonEncoder::Encode(dd, true);
+
+        std::string result;
+        std::size_t chunks = 0;
+        JsonEncoder::EncodeToSink(dd, [&](std::string_view aChunk) {
+            result += aChunk;
+            chunks++;
+        }, true);
+        CHECK_EQ(result, expected);
+        CHECK_GT(chunks, 1);
+        CHECK(JsonValue::Decode(result).GetCount() == 10000);
+    }
+}
+
+TEST_CASE("Json Document") {
+    const std::string json = R"({"Name": "Plain", "Escaped": "a\nbæ", "Int": -42, "Uint": 18446744073709551615,
+        "Double": 1.5e3, "Bool": true, "Null": null, "Empty": {}, "List": [1, [], {"Name": "Nested"}], "Key\"Quote": 1})";
+
+    SUBCASE("Access") {
+        JsonDocument doc(json);
+        auto root = doc.GetRoot();
+        CHECK(root.IsObject());
+        CHECK_EQ(root.GetCount(), 10);
+        CHECK_EQ(doc.GetNodeCount(), 15);
+
+        CHECK_EQ(doc["Name"].AsString(), "Plain");
+        CHECK_EQ(doc["Escaped"].AsString(), "a\nbæ");
+        CHECK_EQ(doc["Int"].AsInt(), -42);
+        CHECK(doc["Uint"].GetType() == JsonDocument::Types::Uint);
+        CHECK_EQ(doc["Double"].AsDouble(), 1500.0);
+        CHECK(doc["Bool"].AsBool());
+        CHECK(doc["Null"].IsNull());
+        CHECK_EQ(doc["Empty"].GetCount(), 0);
+        CHECK_EQ(doc["List"][2]["Name"].AsString(), "Nested");
+        CHECK_EQ(doc["Key\"Quote"].AsInt(), 1);
+        CHECK(root.MemberExists("List"));
+        CHECK_FALSE(root.MemberExists("Missing"));
+        CHECK_FALSE(doc["List"][2].MemberExists("Int"));
+        CHECK_THROWS_AS(doc["Missing"], rsp::json::EMemberNotExisting);
+        CHECK_THROWS_AS(doc["Name"].AsInt(), EJsonTypeError);
+
+        std::vector<std::string_view> names;
+        for (auto value : root) {
+            names.push_back(value.GetName());
+        }
+        CHECK_EQ(names.size(), 10);
+        CHECK_EQ(names.front(), "Name");
+        CHECK_EQ(names.back(), "Key\"Quote");
+    }
+
+    SUBCASE("Errors") {
+        CHECK_THROWS_AS(JsonDocument(R"({"a" 1})"), EJsonParseError);
+        CHECK_THROWS_AS(JsonDocument(R"([1, 2)"), EJsonParseError);
+        CHECK_THROWS_AS(JsonDocument(R"(["\x"])"), EJsonFormatError);
+        CHECK_THROWS_AS(JsonDocument(R"([01])"), EJsonNumberError);
+        CHECK_THROWS_AS(JsonDocument(R"({} {})"), EJsonParseError);
+    }
+
+    SUBCASE("DynamicData") {
+        JsonDocument doc(json);
+        DynamicData dd = doc.ToDynamicData();
+        CHECK_EQ(dd["Escaped"].AsString(), "a\nbæ");
+        CHECK_EQ(dd["List"][2]["Name"].AsString(), "Nested");
+        CHECK(dd["Empty"].IsObject());
+        CHECK(dd["List"][1].IsArray());
+
+        JsonDocument copy(dd);
+        CHECK_EQ(copy.GetNodeCount(), doc.GetNodeCount());
+        CHECK(copy.ToDynamicData() == dd);
+        CHECK_EQ(JsonEncoder::Encode(copy.ToDynamicData()), JsonEncoder::Encode(dd));
+    }
+}
+
+static std::string errorOf(const std::function<void()> &arDecode)
+{
+    try {
+        arDecode();
+    }
+    catch (const EJsonParseError&) {
+        return "ParseError";
+    }
+    catch (const EJsonFormatError&) {
+        return "FormatError";
+    }
+    catch (const EJsonNumberError&) {
+        return "NumberError";
+    }
+    catch (const std::exception &e) {
+        return e.what();
+    }
+    return "";
+}
+
+TEST_CASE("Json Structural Index") {
+
+    using Kernels = JsonStructuralIndex::Kernels;
+
+    std::vector<Kernels> kernels;
+    for (Kernels kernel : { Kernels::Scalar, Kernels::Sse2, Kernels::Avx2, Kernels::Neon }) {
+        if (JsonStructuralIndex::IsSupported(kernel)) {
+            kernels.push_back(kernel);
+        }
+    }
+    MESSAGE("Best kernel: " << int(JsonStructuralIndex::GetBestKernel()) << ", " << kernels.size() << " supported");
+    CHECK(JsonStructuralIndex::IsSupported(Kernels::Scalar));
+    CHECK(JsonStructuralIndex::IsSupported(JsonStructuralIndex::GetBestKernel()));
+
+    std::vector<std::string> valid = {
+        "", "  \n", "null", "true", " false ", " 42 ", "-0.5e-3", "18446744073709551615", "-9223372036854775808",
+        R"("Hello")", "[]", "{}", " [ [ ] , { } ] ", R"([{"a":[{"b":{}}]}])",
+        R"({"Key\"Quote": "Value\\", "Escapes": "\b\f\n\r\t\/æ😀", "Ops": "{}[],: "})",
+        R"({"NullValue":null,"BooleanValue":true,"IntValue":42,"FloatValue":1.234567,"ArrayValue":[32,"Hello",true,null,{}]})",
+        "{\n\t\"a\" :\r\n [ 1 ,\t2 ] ,\"b\":{\"c\" : \"d\" } \n}",
+        std::string(200, '[') + std::string(200, ']')
+    };
+
+    // Strings with backslash runs, quotes and operators at every offset around the 64 byte block boundaries
+    for (std::size_t offset = 0 ; offset < 140 ; ++offset) {
+        for (std::size_t run = 1 ; run <= 4 ; ++run) {
+            std::string content = std::string(offset, 'x') + std::string(run, '\\') + ((run % 2) ? "\"" : "n") + " {}[],:";
+            valid.push_back(R"([ ")" + content + R"(", )" + std::to_string(offset) + R"(, {"a" : [true,false,null]}, ")" + content + R"("])");
+        }
+    }
+
+    const std::vector<std::string> invalid = {
+        R"({"a" 1})", R"([1, 2)", R"(["\x"])", R"([01])", R"({"a":1,})", "[1,]", "[,1]", "{,}", "[tru]", "[truex]",
+        R"(["a" "b"])", R"({"a":})", R"(["abc)", R"(["a\"])", "[1 2]", "[-]", "[1.]", R"({"a"::1})", "[nul]",
+        R"({"a":1 "b":2})", "[1}", "{1:2}", R"(["\uD800"])", R"(["\u12"])", "[}", ":", R"("abc)", "{", "[",
+        std::string(600, '[') + std::string(600, ']')
+    };
+
+    SUBCASE("Index") {
+        for (const std::string &json : valid) {
+            JsonStructuralIndex scalar(json, Kernels::Scalar);
+            for (Kernels kernel : kernels) {
+                JsonStructuralIndex index(json, kernel);
+                CHECK_EQ(index.GetPositions(), scalar.GetPositions());
+            }
+        }
+
+        JsonStructuralIndex index(R"( {"a\"b" : [1, true, "x,y"]} )");
+        CHECK_EQ(index.GetPositions(), std::vector<std::uint32_t>{ 1, 2, 9, 11, 12, 13, 15, 19, 21, 26, 27 });
+    }
+
+    SUBCASE("Valid") {
+        for (const std::string &json : valid) {
+            std::string expected = JsonDecoder(json).GetValue().Encode();
+            for (Kernels kernel : kernels) {
+                CHECK_EQ(JsonIndexedDecoder(json, kernel).GetValue().Encode(), expected);
+            }
+            CHECK_EQ(JsonValue::Decode(json, true).Encode(), expected);
+            if (json.find_first_not_of(" \t\r\n") == std::string::npos) {
+                // A document must hold a value
+                CHECK_THROWS_AS(JsonLazyDocument{json}, EJsonParseError);
+            }
+            else {
+                CHECK_EQ(JsonLazyDocument(json).GetRoot().GetValue().Encode(), expected);
+            }
+        }
+    }
+
+    SUBCASE("Invalid") {
+        for (const std::string &json : invalid) {
+            std::string expected = errorOf([&]() { JsonDecoder(json).GetValue(); });
+            CHECK_MESSAGE(!expected.empty(), json);
+            for (Kernels kernel : kernels) {
+                CHECK_MESSAGE(errorOf([&]() { JsonIndexedDecoder(json, kernel).GetValue(); }) == expected, json);
+            }
+            CHECK_THROWS_AS(JsonLazyDocument{json}, EJsonException);
+        }
+    }
+
+    SUBCASE("Trailing Content") {
+        for (const char *json : { "{} {}", R"("a" "b")", "truex", "null,", "1]" }) {
+            CHECK_THROWS_AS(JsonIndexedDecoder(json).GetValue(), EJsonException);
+            CHECK_THROWS_AS(JsonLazyDocument{json}, EJsonException);
+        }
+    }
+}
+
+TEST_CASE("Json Lazy Document") {
+    const std::string json = R"({"results": [{"id": 1, "name": "First", "tags": ["a", "b"]}, {"id": 2, "name": "Second\u00e6"}],
+        "count": 2, "a/b": {"m~n": true}, "": null, "nested": {"deep": [[[{"x": -1.5}]]]}, "Key\"Quote": "v"})";
+
+    JsonLazyDocument doc(json);
+
+    SUBCASE("Access") {
+        CHECK(doc.GetRoot().IsObject());
+        CHECK_EQ(doc.GetRoot().GetCount(), 6);
+        CHECK_EQ(doc["count"].AsInt(), 2);
+        CHECK_EQ(doc["results"].GetCount(), 2);
+        CHECK_EQ(doc["results"][0]["tags"].GetCount(), 2);
+        CHECK_EQ(doc["nested"]["deep"].GetCount(), 1);
+        CHECK_EQ(doc["count"].GetCount(), 0);
+        CHECK_EQ(JsonLazyDocument("[]").GetRoot().GetCount(), 0);
+        CHECK_EQ(JsonLazyDocument("{}").GetRoot().GetCount(), 0);
+        CHECK_EQ(JsonLazyDocument(R"([1, [2, 3], {"a": [4]}, "5"])").GetRoot().GetCount(), 4);
+        CHECK_EQ(doc["results"][1]["name"].AsString(), "Secondæ");
+        CHECK_EQ(doc["results"][0]["tags"][1].AsString(), "b");
+        CHECK_EQ(doc["Key\"Quote"].AsString(), "v");
+        CHECK_EQ(doc["nested"]["deep"][0][0][0]["x"].AsDouble(), -1.5);
+        CHECK(doc[""].IsNull());
+        CHECK(doc["results"][0][2].IsArray());
+        CHECK_EQ(doc["results"][0].GetText(), R"({"id": 1, "name": "First", "tags": ["a", "b"]})");
+        CHECK_EQ(doc["results"][0]["tags"].GetValue().Encode(), R"(["a","b"])");
+        CHECK(doc.GetRoot().MemberExists("a/b"));
+        CHECK_FALSE(doc.GetRoot().MemberExists("missing"));
+
+        CHECK_THROWS_AS(doc["missing"], rsp::json::EMemberNotExisting);
+        CHECK_THROWS_AS(doc["results"][2], std::out_of_range);
+        CHECK_THROWS_AS(doc["count"]["x"], EJsonTypeError);
+        CHECK_THROWS_AS(doc["count"][0], EJsonTypeError);
+    }
+
+    SUBCASE("JSON Pointer") {
+        CHECK_EQ(doc.At("").GetText(), json);
+        CHECK_EQ(doc.At("/results/0/id").AsInt(), 1);
+        CHECK_EQ(doc.At("/results/1/name").AsString(), "Secondæ");
+        CHECK(doc.At("/a~1b/m~0n").AsBool());
+        CHECK(doc.At("/").IsNull());
+        CHECK_EQ(doc.At("/nested/deep/0/0/0/x").AsDouble(), -1.5);
+        CHECK_EQ(doc["results"].At("/0/tags/0").AsString(), "a");
+
+        CHECK(doc.Contains("/results/1"));
+        CHECK_FALSE(doc.Contains("/results/2"));
+        CHECK_FALSE(doc.Contains("/results/-"));
+        CHECK_FALSE(doc.Contains("/results/01"));
+        CHECK_FALSE(doc.Contains("/results/x"));
+        CHECK_FALSE(doc.Contains("/count/0"));
+        CHECK_FALSE(doc.Contains("/missing"));
+        CHECK_THROWS_AS(doc.At("/missing"), rsp::json::EMemberNotExisting);
+        CHECK_THROWS_AS(doc.At("results"), EJsonParseError);
+        CHECK_THROWS_AS(doc.At("/a~2b"), EJsonParseError);
+    }
+
+    SUBCASE("Scalars") {
+        CHECK_THROWS_AS(JsonLazyDocument(""), EJsonParseError);
+        CHECK_THROWS_AS(JsonLazyDocument(" \r\n\t "), EJsonParseError);
+        CHECK_EQ(JsonLazyDocument(" 42 ").GetRoot().AsInt(), 42);
+        CHECK_EQ(JsonLazyDocument(" 42 ").GetRoot().GetText(), "42");
+        CHECK_EQ(JsonLazyDocument(R"("a\tb")").GetRoot().AsString(), "a\tb");
+        CHECK_THROWS_AS(JsonLazyDocument("[1e999999]"), EJsonNumberError);
+    }
+}
+
 template <typename E, E V, int I> void func_print() {
     MESSAGE(__PRETTY_FUNCTION__);
 }
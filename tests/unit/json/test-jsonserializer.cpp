@@ -0,0 +1,184 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#include "doctest.h"
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <json/JsonSerializer.h>
+#include <json/JsonValue.h>
+#include <posix/FileIO.h>
+
+using namespace rsp::json;
+using namespace rsp::utils;
+
+struct Sample {
+    std::int64_t mTime = 0;
+    double mValue = 0.0;
+    StructElement<std::string> mNote{};
+
+    bool operator==(const Sample&) const = default;
+
+    static constexpr auto GetJsonFields() {
+        return std::make_tuple(
+            JsonField("Time", &Sample::mTime),
+            JsonField("Value", &Sample::mValue),
+            JsonField("Note", &Sample::mNote));
+    }
+};
+
+struct Channel {
+    std::string mName{};
+    unsigned int mRate = 0;
+    bool mEnabled = false;
+    StructElement<float> mGain{};
+    std::vector<Sample> mSamples{};
+
+    bool operator==(const Channel&) const = default;
+
+    static constexpr auto GetJsonFields() {
+        return std::make_tuple(
+            JsonField("Name", &Channel::mName),
+            JsonField("Rate", &Channel::mRate),
+            JsonField("Enabled", &Channel::mEnabled),
+            JsonField("Gain", &Channel::mGain),
+            JsonField("Samples", &Channel::mSamples));
+    }
+};
+
+struct Telemetry {
+    std::string mDevice{};
+    std::vector<Channel> mChannels{};
+    std::vector<int> mErrors{};
+    StructElement<int> mVersion{};
+
+    bool operator==(const Telemetry&) const = default;
+};
+
+// Registry given outside of the struct
+template <>
+struct rsp::json::JsonFields<Telemetry> {
+    static constexpr auto Get() {
+        return std::make_tuple(
+            JsonField("Device", &Telemetry::mDevice),
+            JsonField("Channels", &Telemetry::mChannels),
+            JsonField("Errors", &Telemetry::mErrors),
+            JsonField("Version", &Telemetry::mVersion));
+    }
+};
+
+TEST_CASE("Json Serializer") {
+
+    Telemetry telemetry;
+    telemetry.mDevice = "Unit \"7\"\n";
+    telemetry.mErrors = { -1, 0, 42 };
+    telemetry.mChannels.resize(2);
+    telemetry.mChannels[0].mName = "Temperature";
+    telemetry.mChannels[0].mRate = 10;
+    telemetry.mChannels[0].mEnabled = true;
+    telemetry.mChannels[0].mGain = 1.5f;
+    telemetry.mChannels[0].mSamples = { {1000, 21.5, {}}, {2000, -0.125, std::string("Spike")} };
+    telemetry.mChannels[1].mName = "Pressure";
+
+    SUBCASE("Encode") {
+        std::string json = JsonSerializer::Encode(telemetry);
+        CHECK_EQ(json, R"({"Device":"Unit \"7\"\n","Channels":[)"
+            R"({"Name":"Temperature","Rate":10,"Enabled":true,"Gain":1.5,"Samples":[{"Time":1000,"Value":21.5},{"Time":2000,"Value":-0.125,"Note":"Spike"}]},)"
+            R"({"Name":"Pressure","Rate":0,"Enabled":false,"Samples":[]}],"Errors":[-1,0,42]})");
+
+        JsonValue value = JsonValue::Decode(json);
+        CHECK_EQ(value["Channels"][0]["Samples"][1]["Note"].AsString(), "Spike");
+        CHECK_FALSE(value["Channels"][1].MemberExists("Gain"));
+    }
+
+    SUBCASE("Round Trip") {
+        std::string json = JsonSerializer::Encode(telemetry);
+        Telemetry copy = JsonSerializer::Decode<Telemetry>(json);
+        CHECK(copy == telemetry);
+        CHECK(copy.mVersion.IsNull());
+        CHECK_EQ(JsonSerializer::Encode(copy), json);
+
+        telemetry.mVersion = 3;
+        JsonSerializer::Decode(JsonSerializer::Encode(telemetry), copy);
+        CHECK_EQ(copy.mVersion.Get(), 3);
+    }
+
+    SUBCASE("Optional and Unknown Members") {
+        Channel channel;
+        channel.mGain = 2.0f;
+        JsonSerializer::Decode(R"({ "Name": "X", "Extra": {"a": [1, {"b": null}], "c": "d"}, "Rate": 5,
+            "More": [[], {}], "Enabled": false, "Samples": [ {"Time": 1, "Value": 2, "Note": null} ] })", channel);
+        CHECK_EQ(channel.mName, "X");
+        CHECK_EQ(channel.mRate, 5);
+        CHECK(channel.mGain.IsNull());
+        CHECK_EQ(channel.mSamples.size(), 1);
+        CHECK(channel.mSamples[0].mNote.IsNull());
+        CHECK_EQ(channel.mSamples[0].mValue, 2.0);
+    }
+
+    SUBCASE("Errors") {
+        CHECK_THROWS_AS(JsonSerializer::Decode<Sample>(R"({"Time": 1})"), rsp::json::EMemberNotExisting);
+        CHECK_THROWS_AS(JsonSerializer::Decode<Sample>(R"({"Time": "1", "Value": 1})"), EJsonTypeError);
+        CHECK_THROWS_AS(JsonSerializer::Decode<Sample>(R"({"Time": 1.5, "Value": 1})"), EJsonNumberError);
+        CHECK_THROWS_AS(JsonSerializer::Decode<Channel>(R"({"Name": "", "Rate": -1, "Enabled": true, "Samples": []})"), EJsonNumberError);
+        CHECK_THROWS_AS(JsonSerializer::Decode<Sample>(R"([])"), EJsonTypeError);
+        CHECK_THROWS_AS(JsonSerializer::Decode<Sample>(R"({"Time": 1, "Value": 1} 2)"), EJsonException);
+        CHECK_THROWS_AS(JsonSerializer::Decode<std::vector<int>>(R"([1, 2)"), EJsonException);
+    }
+
+    SUBCASE("Scalars and Containers") {
+        std::vector<std::string> strings{ "a", "b\\" };
+        CHECK_EQ(JsonSerializer::Encode(strings), R"(["a","b\\"])");
+        std::vector<std::vector<int>> nested{ {1}, {}, {2, 3} };
+        CHECK(JsonSerializer::Decode<std::vector<std::vector<int>>>("[[1], [], [2, 3]]") == nested);
+        CHECK_EQ(JsonSerializer::Decode<std::uint64_t>("18446744073709551615"), UINT64_MAX);
+        CHECK_EQ(JsonSerializer::Decode<std::string>(R"("æ")"), "æ");
+
+        std::vector<bool> flags{ true, false, true };
+        CHECK_EQ(JsonSerializer::Encode(flags), "[true,false,true]");
+        CHECK(JsonSerializer::Decode<std::vector<bool>>(JsonSerializer::Encode(flags)) == flags);
+
+        StructElement<std::string> note(std::string("Note"));
+        note.Clear();
+        CHECK(note.IsNull());
+        CHECK_EQ(note.Get(std::string("Default")), "Default");
+    }
+
+    SUBCASE("Reader") {
+        std::string json = JsonSerializer::Encode(telemetry);
+
+        JsonReader partial;
+        partial.Feed(std::string_view(json).substr(0, json.size() / 2));
+        Telemetry copy;
+        CHECK_THROWS_AS(JsonSerializer::Decode(partial, copy), EJsonParseError);
+
+        JsonReader whole;
+        whole.Feed(json).Finish();
+        JsonSerializer::Decode(whole, copy);
+        CHECK(copy == telemetry);
+
+        // Larger than the chunks read from the file
+        telemetry.mChannels[1].mSamples.resize(2000, { 3000, 1.25, std::string("Sample") });
+        json = JsonSerializer::Encode(telemetry);
+        REQUIRE_GT(json.size(), JsonReader::cReadChunkSize * 2);
+
+        const std::string file_name = "json-serializer-test.json";
+        {
+            rsp::posix::FileIO file(file_name, std::ios_base::out, 0644);
+            file.Write(json.data(), json.size());
+        }
+        rsp::posix::FileIO file(file_name, std::ios_base::in);
+        JsonReader reader;
+        JsonSerializer::Decode(reader, file, copy);
+        CHECK(copy == telemetry);
+        CHECK_EQ(reader.Next(file), JsonReader::Event::EndOfDocument);
+        std::filesystem::remove(file_name);
+    }
+}
@@ -8,16 +8,25 @@
  * \author      Steffen Brummer
  */
 
+#include <atomic>
 #include <thread>
 #include <chrono>
+#include <csignal>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <vector>
 #include <time.h>
 #include <doctest.h>
 #include <logging/Logger.h>
 #include <logging/ConsoleLogWriter.h>
 #include <logging/FileLogWriter.h>
+#include <logging/FlightRecorderLogWriter.h>
+#include <logging/LogTimestamp.h>
+#include <logging/OutStreamBuffer.h>
+#include <utils/DateTime.h>
 #include <utils/StrUtils.h>
 #include <utils/AnsiEscapeCodes.h>
 #include <utils/CoreException.h>
@@ -177,4 +186,235 @@ TEST_CASE("Logging") {
     CHECK(&(logging::LoggerInterface::GetDefault()) == &log);
 }
 
+TEST_CASE("Log Timestamp") {
+    LogTimestamp ts;
 
+    DateTime dt(2022, 11, 8, 15, 43, 23, 813);
+    CHECK_EQ(ts.Format(dt), "2022-11-08 15:43:23.813");
+    CHECK_EQ(ts.Format(dt + std::chrono::milliseconds(7)), "2022-11-08 15:43:23.820");
+    CHECK_EQ(ts.Format(dt + std::chrono::milliseconds(187)), "2022-11-08 15:43:24.000");
+    CHECK_EQ(ts.Format(dt - std::chrono::hours(24)), "2022-11-07 15:43:23.813");
+
+    DateTime now;
+    std::string expected = now.ToLogging();
+    CHECK_EQ(ts.Format(now), expected);
+    CHECK_EQ(ts.Now().size(), expected.size());
+}
+
+TEST_CASE("Log Storm Suppression") {
+    using namespace std::chrono_literals;
+
+    SUBCASE("Folding") {
+        mConsoleErrorBuffer.clear();
+        mConsoleInfoBuffer.clear();
+
+        logging::Logger log;
+        log.AddLogWriter(std::make_shared<logging::ConsoleLogWriter>(logging::LogLevel::Debug, new TestConsoleStream()));
+        log.GetThrottle().SetFolding(true);
+
+        for (int i = 0 ; i < 100 ; i++) {
+            log.Warning() << "Chunk type was ignored";
+        }
+        log.Info() << "Done";
+
+        REQUIRE(mConsoleInfoBuffer.size() == 3);
+        CHECK_EQ(mConsoleInfoBuffer[0], "Chunk type was ignored");
+        CHECK_EQ(mConsoleInfoBuffer[1], "Last message repeated 99 times");
+        CHECK_EQ(mConsoleInfoBuffer[2], "Done");
+        CHECK_EQ(log.GetThrottle().GetCounters().mFolded, 99);
+        CHECK_EQ(log.GetThrottle().GetCounters().mRateLimited, 0);
+    }
+
+    SUBCASE("Rate Limit") {
+        LogThrottle throttle;
+        std::vector<LogThrottle::Summary> summaries;
+        auto now = LogThrottle::Clock_t::now();
+
+        throttle.SetRateLimit(LogLevel::Error, 10.0, 5);
+        throttle.SetRateLimit(LogLevel::Error, 1.0, 1, "Curl");
+
+        int accepted = 0;
+        for (int i = 0 ; i < 20 ; i++) {
+            accepted += throttle.Accept(LogLevel::Error, "", std::to_string(i), summaries, now) ? 1 : 0;
+        }
+        CHECK_EQ(accepted, 5);
+        CHECK(summaries.empty());
+        CHECK(throttle.Accept(LogLevel::Warning, "", "Not limited", summaries, now));
+
+        CHECK(throttle.Accept(LogLevel::Error, "Curl", "a", summaries, now));
+        CHECK_FALSE(throttle.Accept(LogLevel::Error, "Curl", "b", summaries, now + 500ms));
+        CHECK(throttle.Accept(LogLevel::Error, "Other", "c", summaries, now));
+
+        CHECK(throttle.Accept(LogLevel::Error, "", "After pause", summaries, now + 100ms));
+        REQUIRE(summaries.size() == 1);
+        CHECK_EQ(summaries[0].mMessage, "15 records suppressed by rate limit");
+        CHECK_EQ(summaries[0].mLevel, LogLevel::Error);
+
+        CHECK_EQ(throttle.GetCounters("").mRateLimited, 15);
+        CHECK_EQ(throttle.GetCounters("Curl").mRateLimited, 1);
+        CHECK_EQ(throttle.GetCounters().Total(), 16);
+
+        throttle.ResetCounters();
+        CHECK_EQ(throttle.GetCounters().Total(), 0);
+
+        throttle.RemoveRateLimit(LogLevel::Error);
+        for (int i = 0 ; i < 20 ; i++) {
+            CHECK(throttle.Accept(LogLevel::Error, "", std::to_string(i), summaries, now));
+        }
+    }
+}
+
+TEST_CASE("Flight Recorder") {
+    const std::string dump_file = "flight_recorder.log";
+    const std::string crash_file = "flight_recorder_crash.log";
+    std::filesystem::remove(dump_file);
+    std::filesystem::remove(crash_file);
+
+    auto read_lines = [](const std::string &arFileName) {
+        std::vector<std::string> lines;
+        std::ifstream fin(arFileName);
+        std::string line;
+        while (std::getline(fin, line)) {
+            lines.push_back(line);
+        }
+        return lines;
+    };
+
+    auto recorder = std::make_shared<logging::FlightRecorderLogWriter>(4096, crash_file, false);
+    CHECK_EQ(recorder->GetCapacity(), 4096);
+
+    logging::Logger log;
+    log.AddLogWriter(recorder);
+
+    for (int i = 0 ; i < 500 ; i++) {
+        log.Debug() << "Record " << i;
+    }
+
+    REQUIRE(recorder->Dump(dump_file));
+    auto lines = read_lines(dump_file);
+    REQUIRE(lines.size() > 10);
+    CHECK(lines.size() < 500);
+    CHECK(lines.back().ends_with("(Debug) Record 499"));
+    for (std::size_t i = 0 ; i < lines.size() ; i++) {
+        CHECK_EQ(lines[i][0], '[');
+        CHECK_EQ(lines[i].substr(DateTime::cLoggingLength + 1, 2), "] ");
+        CHECK(lines[i].ends_with("(Debug) Record " + std::to_string(500 - lines.size() + i)));
+    }
+    CHECK_FALSE(std::filesystem::exists(crash_file));
+
+    log.Critical() << "Fatal";
+    lines = read_lines(crash_file);
+    REQUIRE_FALSE(lines.empty());
+    CHECK(lines.back().ends_with("(Critical) Fatal"));
+
+    SUBCASE("Signal Handlers") {
+        struct sigaction before{};
+        sigaction(SIGSEGV, nullptr, &before);
+        {
+            logging::FlightRecorderLogWriter handler(1024, crash_file);
+            struct sigaction during{};
+            sigaction(SIGSEGV, nullptr, &during);
+            CHECK_NE(during.sa_handler, before.sa_handler);
+            CHECK((during.sa_flags & SA_ONSTACK));
+            stack_t stack{};
+            sigaltstack(nullptr, &stack);
+            CHECK_FALSE((stack.ss_flags & SS_DISABLE));
+            CHECK_THROWS_AS(logging::FlightRecorderLogWriter second(1024, crash_file), const CoreException&);
+        }
+        struct sigaction after{};
+        sigaction(SIGSEGV, nullptr, &after);
+        CHECK_EQ(after.sa_handler, before.sa_handler);
+    }
+
+    SUBCASE("Dump While Writing") {
+        logging::FlightRecorderLogWriter busy(4096, crash_file, false);
+        const std::string message(200, 'x');
+        std::atomic<bool> done{false};
+        std::vector<std::thread> writers;
+        for (int t = 0 ; t < 4 ; t++) {
+            writers.emplace_back([&busy, &done, &message]() {
+                while (!done) {
+                    busy.Write(message, LogLevel::Debug, "", DynamicData());
+                }
+            });
+        }
+        // Records overwritten while the dump reads them must be left out, never written torn
+        for (int i = 0 ; i < 200 ; i++) {
+            REQUIRE(busy.Dump(dump_file));
+            for (const std::string &line : read_lines(dump_file)) {
+                CHECK_EQ(line.size(), DateTime::cLoggingLength + 3 + 8 + message.size());
+                CHECK(line.ends_with("] (Debug) " + message));
+            }
+        }
+        done = true;
+        for (std::thread &writer : writers) {
+            writer.join();
+        }
+    }
+
+    std::filesystem::remove(dump_file);
+    std::filesystem::remove(crash_file);
+}
+
+TEST_CASE("Clog Capture") {
+    mConsoleErrorBuffer.clear();
+    mConsoleInfoBuffer.clear();
+
+    {
+        logging::Logger log(true);
+        log.AddLogWriter(std::make_shared<logging::ConsoleLogWriter>(logging::LogLevel::Debug, new TestConsoleStream()));
+
+        std::clog << SetLevel(LogLevel::Info);
+        std::vector<std::thread> threads;
+        for (int t = 0 ; t < 4 ; t++) {
+            threads.emplace_back([t]() {
+                for (int i = 0 ; i < 100 ; i++) {
+                    std::clog << "Thread " << t << " line " << i << '\n';
+                }
+            });
+        }
+        for (auto &t : threads) {
+            t.join();
+        }
+
+        std::string long_line(3000, 'x');
+        std::clog << long_line << std::endl;
+        std::clog << "First\nSecond\n" << "Partial";
+        std::clog.flush();
+        std::clog << " line" << std::endl;
+        std::clog << "Unterminated";
+    }
+
+    REQUIRE(mConsoleInfoBuffer.size() == 405);
+    std::map<std::string, int> counts;
+    for (std::size_t i = 0 ; i < 400 ; i++) {
+        CHECK_MESSAGE(StrUtils::StartsWith(mConsoleInfoBuffer[i], "Thread "), mConsoleInfoBuffer[i]);
+        counts[mConsoleInfoBuffer[i]]++;
+    }
+    CHECK_EQ(counts.size(), 400);
+    CHECK_EQ(mConsoleInfoBuffer[400], std::string(3000, 'x'));
+    CHECK_EQ(mConsoleInfoBuffer[401], "First");
+    CHECK_EQ(mConsoleInfoBuffer[402], "Second");
+    CHECK_EQ(mConsoleInfoBuffer[403], "Partial line");
+    CHECK_EQ(mConsoleInfoBuffer[404], "Unterminated");
+    CHECK(mConsoleErrorBuffer.empty());
+
+    // Unfinished lines of several buffers in the same thread are kept apart
+    mConsoleInfoBuffer.clear();
+    {
+        logging::Logger log;
+        log.AddLogWriter(std::make_shared<logging::ConsoleLogWriter>(logging::LogLevel::Debug, new TestConsoleStream()));
+        OutStreamBuffer first_buffer(&log, LogLevel::Info);
+        OutStreamBuffer second_buffer(&log, LogLevel::Info);
+        std::ostream first(&first_buffer);
+        std::ostream second(&second_buffer);
+
+        first << "First " << 1;
+        second << "Second " << 2;
+        first << " done" << std::endl;
+        second << " done" << std::endl;
+    }
+    REQUIRE(mConsoleInfoBuffer.size() == 2);
+    CHECK_EQ(mConsoleInfoBuffer[0], "First 1 done");
+    CHECK_EQ(mConsoleInfoBuffer[1], "Second 2 done");
+}
@@ -0,0 +1,416 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#include <messaging/BrokerBridge.h>
+#include <doctest.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace rsp::messaging;
+
+namespace {
+
+enum class IpcTopics { Measurement, Command };
+
+struct MeasurementEvent : public EventType<MeasurementEvent>
+{
+    MeasurementEvent(std::string aSensor, double aValue, int aSequence = 0) : mSensor(std::move(aSensor)), mValue(aValue), mSequence(aSequence) {}
+    explicit MeasurementEvent(EventReader &arReader)
+        : mSensor(arReader.ReadString()),
+          mValue(arReader.Read<double>()),
+          mSequence(arReader.Read<int>())
+    {
+    }
+
+    void Serialize(EventWriter &arWriter) const
+    {
+        arWriter.Write(mSensor).Write(mValue).Write(mSequence);
+    }
+
+    std::string mSensor;
+    double mValue;
+    int mSequence;
+};
+
+struct LocalEvent : public EventType<LocalEvent>
+{
+};
+
+class MeasurementSub : public Subscriber<IpcTopics>
+{
+public:
+    MeasurementSub(Broker<IpcTopics> &arBroker, IpcTopics aTopic) : Subscriber<IpcTopics>(arBroker)
+    {
+        Subscribe(aTopic);
+    }
+    void HandleEvent(Event &arNewEvent) override
+    {
+        if (arNewEvent.Is<MeasurementEvent>()) {
+            auto &event = arNewEvent.GetAs<MeasurementEvent>();
+            mSensor = event.mSensor;
+            mValue = event.mValue;
+            mSequence = event.mSequence;
+        }
+        mCount++;
+    }
+    std::string mSensor{};
+    double mValue = 0.0;
+    std::atomic<int> mSequence = 0;
+    std::atomic<int> mCount = 0;
+};
+
+void checkChannels(IpcChannel &arFirst, IpcChannel &arSecond)
+{
+    std::string frame;
+    CHECK_FALSE(arSecond.Receive(frame));
+    CHECK_FALSE(arSecond.Wait(std::chrono::milliseconds(1)));
+
+    for (int i = 0 ; i < 100 ; ++i) {
+        REQUIRE(arFirst.Send(std::string(static_cast<std::size_t>(i + 1), static_cast<char>('a' + i % 26))));
+        REQUIRE(arSecond.Receive(frame));
+        CHECK_EQ(frame.size(), static_cast<std::size_t>(i + 1));
+        CHECK_EQ(frame[0], static_cast<char>('a' + i % 26));
+    }
+    CHECK(arSecond.Send("Reply"));
+    CHECK(arFirst.Wait(std::chrono::milliseconds(0)));
+    REQUIRE(arFirst.Receive(frame));
+    CHECK_EQ(frame, "Reply");
+
+    std::thread sender([&arFirst]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        arFirst.Send("Wake up");
+    });
+    CHECK(arSecond.Wait(std::chrono::milliseconds(2000)));
+    sender.join();
+    REQUIRE(arSecond.Receive(frame));
+    CHECK_EQ(frame, "Wake up");
+}
+
+} // namespace
+
+TEST_CASE("Event Codec")
+{
+    EventCodec &codec = EventCodec::Get();
+    codec.Register<MeasurementEvent>();
+    CHECK(codec.IsRegistered(cEventTypeId<MeasurementEvent>));
+    CHECK_FALSE(codec.IsRegistered(cEventTypeId<LocalEvent>));
+
+    std::string data;
+    codec.Encode(MeasurementEvent("Probe", 21.5, 3), data);
+    CHECK_EQ(data.size(), sizeof(std::uint32_t) * 2 + 5 + sizeof(double) + sizeof(int));
+
+    EventPtr event = codec.Decode(data);
+    REQUIRE(event->Is<MeasurementEvent>());
+    CHECK_EQ(event->GetAs<MeasurementEvent>().mSensor, "Probe");
+    CHECK_EQ(event->GetAs<MeasurementEvent>().mValue, 21.5);
+    CHECK_EQ(event->GetAs<MeasurementEvent>().mSequence, 3);
+
+    CHECK_THROWS_AS(codec.Decode(std::string_view(data).substr(0, data.size() - 1)), EEventCodecError);
+    CHECK_THROWS_AS(codec.Decode(data + "x"), EEventCodecError);
+    CHECK_THROWS_AS(codec.Encode(LocalEvent(), data), EEventCodecError);
+}
+
+TEST_CASE("IPC Channels")
+{
+    SUBCASE("Socket")
+    {
+        auto channels = SocketChannel::Pair();
+        checkChannels(*channels.first, *channels.second);
+
+        channels.first.reset();
+        std::string frame;
+        CHECK(channels.second->Wait(std::chrono::milliseconds(100)));
+        CHECK_FALSE(channels.second->Receive(frame));
+        CHECK_FALSE(channels.second->IsOpen());
+        CHECK_FALSE(channels.second->Send("Closed"));
+    }
+
+    SUBCASE("Shared Memory")
+    {
+        auto channels = ShmChannel::Pair(1024);
+        CHECK_EQ(channels.first->GetCapacity(), 1024);
+        checkChannels(*channels.first, *channels.second);
+
+        // Large frames go through the socket, but stay in order
+        std::string frame;
+        std::string large(5000, 'L');
+        CHECK(channels.first->Send("Before"));
+        CHECK(channels.first->Send(large));
+        CHECK(channels.first->Send("After"));
+        REQUIRE(channels.second->Receive(frame));
+        CHECK_EQ(frame, "Before");
+        REQUIRE(channels.second->Receive(frame));
+        CHECK_EQ(frame, large);
+        REQUIRE(channels.second->Receive(frame));
+        CHECK_EQ(frame, "After");
+
+        // Full ring
+        int sent = 0;
+        while (channels.first->Send(std::string(100, 'F'))) {
+            ++sent;
+        }
+        CHECK_GE(sent, 8); // 1024 / 112 bytes per record, less any padding at the end of the ring
+        CHECK_LE(sent, 9);
+        for (int i = 0 ; i < sent ; ++i) {
+            CHECK(channels.second->Receive(frame));
+        }
+        CHECK_FALSE(channels.second->Receive(frame));
+
+        channels.first.reset();
+        CHECK(channels.second->Wait(std::chrono::milliseconds(100)));
+        CHECK_FALSE(channels.second->IsOpen());
+        CHECK_FALSE(channels.second->Send("Closed"));
+    }
+
+    SUBCASE("Listener")
+    {
+        std::string path = "/tmp/rsp-ipc-test-" + std::to_string(::getpid()) + ".sock";
+        IpcListener listener(path);
+        CHECK_FALSE(listener.Accept(std::chrono::milliseconds(0)));
+
+        std::unique_ptr<ShmChannel> client;
+        std::thread connector([&]() {
+            client = ShmChannel::Attach(SocketChannel::Connect(path));
+        });
+        auto server = ShmChannel::Create(listener.Accept(std::chrono::milliseconds(2000)), 4096);
+        connector.join();
+        REQUIRE(client);
+        CHECK_EQ(client->GetCapacity(), 4096);
+        checkChannels(*server, *client);
+    }
+
+    SUBCASE("Untrusted Peer")
+    {
+        // Plays the creating end by hand, using the handshake and ring layout of ShmChannel
+        struct Hello { std::uint32_t mMagic; std::uint32_t mVersion; std::uint64_t mCapacity; };
+        struct RecordHeader { std::uint32_t mSize; std::uint32_t mKind; };
+        constexpr std::size_t cRing = 3 * 64; // Head, tail and armed flag, each on its own cache line
+        constexpr std::size_t cCapacity = 1024;
+        constexpr std::size_t cMapSize = 2 * (cRing + cCapacity);
+
+        int memfd = ::memfd_create("rsp-ipc-test", MFD_CLOEXEC);
+        REQUIRE(memfd >= 0);
+        REQUIRE_EQ(::ftruncate(memfd, cMapSize), 0);
+        auto attach = [memfd](std::uint64_t aCapacity) {
+            auto sockets = SocketChannel::Pair();
+            int fds[3] = { memfd, ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC), ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC) };
+            Hello hello{0x52535049, 1, aCapacity};
+            sockets.first->SendWithFds(std::string_view(reinterpret_cast<const char*>(&hello), sizeof(hello)), fds, 3);
+            ::close(fds[1]);
+            ::close(fds[2]);
+            return ShmChannel::Attach(std::move(sockets.second));
+        };
+
+        CHECK_THROWS_AS(attach(cMapSize), EIpcError);
+        CHECK_THROWS_AS(attach(cCapacity + 8), EIpcError);
+        CHECK_THROWS_AS(attach(cCapacity - 1), EIpcError);
+
+        char *map = static_cast<char*>(::mmap(nullptr, cMapSize, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0));
+        REQUIRE(map != MAP_FAILED);
+        auto publish = [map](RecordHeader aHeader, std::uint64_t aHead) {
+            std::uint64_t tail = 0;
+            std::memcpy(map + cRing, &aHeader, sizeof(aHeader));
+            std::memcpy(map + 64, &tail, sizeof(tail));
+            std::memcpy(map, &aHead, sizeof(aHead));
+        };
+
+        std::string frame;
+        auto channel = attach(cCapacity);
+        publish({4, 0}, 16);
+        REQUIRE(channel->Receive(frame));
+        CHECK_EQ(frame.size(), 4);
+
+        // More in the ring than it can hold
+        channel = attach(cCapacity);
+        publish({4, 0}, cCapacity + 8);
+        CHECK_THROWS_AS(channel->Receive(frame), EIpcError);
+        CHECK_FALSE(channel->IsOpen());
+
+        // Frame larger than what was added to the ring
+        channel = attach(cCapacity);
+        publish({cCapacity, 0}, 16 + 24);
+        CHECK_THROWS_AS(channel->Receive(frame), EIpcError);
+
+        channel = attach(cCapacity);
+        publish({16, 1}, 16);
+        CHECK_THROWS_AS(channel->Receive(frame), EIpcError);
+
+        channel = attach(cCapacity);
+        publish({0, 7}, 16 + 24);
+        CHECK_THROWS_AS(channel->Receive(frame), EIpcError);
+
+        ::munmap(map, cMapSize);
+        ::close(memfd);
+    }
+}
+
+TEST_CASE("Broker Bridge")
+{
+    EventCodec::Get().Register<MeasurementEvent>();
+    auto channels = ShmChannel::Pair();
+    Broker<IpcTopics> gui;
+    Broker<IpcTopics> daemon;
+    BrokerBridge<IpcTopics> gui_bridge(gui, *channels.first);
+    BrokerBridge<IpcTopics> daemon_bridge(daemon, *channels.second);
+    daemon_bridge.Forward(IpcTopics::Measurement);
+    gui_bridge.Forward(IpcTopics::Command);
+    MeasurementSub gui_sub(gui, IpcTopics::Measurement);
+    MeasurementSub daemon_sub(daemon, IpcTopics::Command);
+
+    SUBCASE("Forward both ways")
+    {
+        daemon.Publish(IpcTopics::Measurement, MakeEvent<MeasurementEvent>("Temperature", 37.2));
+        CHECK_EQ(gui_sub.mCount, 0);
+        CHECK_EQ(gui_bridge.Process(), 1);
+        CHECK_EQ(gui_sub.mCount, 1);
+        CHECK_EQ(gui_sub.mSensor, "Temperature");
+        CHECK_EQ(gui_sub.mValue, 37.2);
+
+        MeasurementEvent command("Setpoint", 40.0);
+        gui.Publish(IpcTopics::Command, command);
+        CHECK_EQ(daemon_bridge.Process(std::chrono::milliseconds(100)), 1);
+        CHECK_EQ(daemon_sub.mSensor, "Setpoint");
+
+        CHECK_EQ(daemon_bridge.GetSentCount(), 1);
+        CHECK_EQ(gui_bridge.GetReceivedCount(), 1);
+        CHECK_EQ(gui_bridge.GetDroppedCount(), 0);
+    }
+
+    SUBCASE("Unregistered events are dropped")
+    {
+        daemon.Publish(IpcTopics::Measurement, MakeEvent<LocalEvent>());
+        CHECK_EQ(daemon_bridge.GetDroppedCount(), 1);
+        CHECK_EQ(gui_bridge.Process(), 0);
+    }
+
+    SUBCASE("Received events are not sent back")
+    {
+        gui_bridge.Forward(IpcTopics::Measurement);
+        daemon.Publish(IpcTopics::Measurement, MakeEvent<MeasurementEvent>("Temperature", 1.0));
+        CHECK_EQ(gui_bridge.Process(), 1);
+        CHECK_EQ(gui_bridge.GetSentCount(), 0);
+
+        gui.Publish(IpcTopics::Measurement, MakeEvent<MeasurementEvent>("Local", 2.0));
+        CHECK_EQ(gui_bridge.GetSentCount(), 1);
+    }
+
+    SUBCASE("Latest value topic")
+    {
+        daemon.SetLatestValue(IpcTopics::Measurement);
+        for (int i = 1 ; i <= 10 ; ++i) {
+            daemon.Publish(IpcTopics::Measurement, MakeEvent<MeasurementEvent>("Battery", i));
+        }
+        CHECK_EQ(daemon_bridge.GetSentCount(), 0);
+        daemon_bridge.Process();
+        CHECK_EQ(daemon_bridge.GetSentCount(), 1);
+        CHECK_EQ(gui_bridge.Process(), 1);
+        CHECK_EQ(gui_sub.mValue, 10.0);
+    }
+
+    SUBCASE("Latency")
+    {
+        constexpr int cCount = 2000;
+        std::atomic<bool> stop = false;
+        std::thread daemon_thread([&]() {
+            while (!stop) {
+                daemon_bridge.Process(std::chrono::milliseconds(10));
+            }
+        });
+        // The daemon answers every command with a measurement
+        struct Responder : public Subscriber<IpcTopics> {
+            using Subscriber<IpcTopics>::Subscriber;
+            void HandleEvent(Event &arNewEvent) override
+            {
+                mrBroker.Publish(IpcTopics::Measurement, MakeEvent<MeasurementEvent>("Pong", 0.0, arNewEvent.GetAs<MeasurementEvent>().mSequence));
+            }
+        } responder(daemon);
+        responder.Subscribe(IpcTopics::Command);
+
+        std::vector<double> round_trips;
+        for (int i = 1 ; i <= cCount ; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            gui.Publish(IpcTopics::Command, MakeEvent<MeasurementEvent>("Ping", 0.0, i));
+            while (gui_sub.mSequence != i) {
+                gui_bridge.Process(std::chrono::milliseconds(100));
+            }
+            round_trips.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        }
+        stop = true;
+        daemon_thread.join();
+
+        std::sort(round_trips.begin(), round_trips.end());
+        MESSAGE("Round trip median " << round_trips[round_trips.size() / 2] << " us, 99% " << round_trips[round_trips.size() * 99 / 100] << " us");
+        CHECK_EQ(gui_bridge.GetReceivedCount(), cCount);
+        CHECK_EQ(daemon_bridge.GetDroppedCount(), 0);
+    }
+}
+
+TEST_CASE("Broker Bridge across processes")
+{
+    EventCodec::Get().Register<MeasurementEvent>();
+    auto sockets = SocketChannel::Pair();
+
+    pid_t child = ::fork();
+    REQUIRE(child >= 0);
+    if (child == 0) {
+        // Measurement daemon: answer commands until the GUI closes the channel
+        sockets.first.reset();
+        int result = 1;
+        try {
+            auto channel = ShmChannel::Attach(std::move(sockets.second));
+            Broker<IpcTopics> broker;
+            BrokerBridge<IpcTopics> bridge(broker, *channel);
+            bridge.Forward(IpcTopics::Measurement);
+            MeasurementSub commands(broker, IpcTopics::Command);
+            while (channel->IsOpen()) {
+                int count = commands.mCount;
+                bridge.Process(std::chrono::milliseconds(100));
+                if (commands.mCount != count) {
+                    broker.Publish(IpcTopics::Measurement, MakeEvent<MeasurementEvent>("Child", commands.mValue * 2, commands.mSequence));
+                }
+            }
+            result = 0;
+        }
+        catch (...) {
+        }
+        ::_exit(result);
+    }
+
+    sockets.second.reset();
+    {
+        auto channel = ShmChannel::Create(std::move(sockets.first));
+        Broker<IpcTopics> broker;
+        BrokerBridge<IpcTopics> bridge(broker, *channel);
+        bridge.Forward(IpcTopics::Command);
+        MeasurementSub measurements(broker, IpcTopics::Measurement);
+
+        for (int i = 1 ; i <= 10 ; ++i) {
+            broker.Publish(IpcTopics::Command, MakeEvent<MeasurementEvent>("Parent", i, i));
+            for (int wait = 0 ; (wait < 50) && (measurements.mSequence != i) ; ++wait) {
+                bridge.Process(std::chrono::milliseconds(100));
+            }
+            CHECK_EQ(measurements.mSequence, i);
+            CHECK_EQ(measurements.mValue, 2.0 * i);
+        }
+        CHECK_EQ(measurements.mSensor, "Child");
+    }
+
+    int status = -1;
+    REQUIRE_EQ(::waitpid(child, &status, 0), child);
+    CHECK(WIFEXITED(status));
+    CHECK_EQ(WEXITSTATUS(status), 0);
+}
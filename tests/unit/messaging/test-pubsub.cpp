@@ -11,6 +11,10 @@
 #include <messaging/Publisher.h>
 #include <messaging/Subscriber.h>
 #include <doctest.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
 #include "../../helpers/eventTypes/ClickedEvent.h"
 
 using namespace rsp::messaging;
@@ -22,10 +26,6 @@ class TestBroker : public Broker<testTopic>
 {
   public:
     const char* GetName() { return __FUNCTION__; }
-    std::map<int, std::vector<SubscriberBase *>>& GetSubscriberMap()
-    {
-        return mSubscriberMap;
-    }
 };
 
 enum OtherTopic { other1, other2, other3 };
@@ -33,10 +33,6 @@ class OtherBroker : public Broker<OtherTopic>
 {
 public:
     const char* GetName() { return __FUNCTION__; }
-    std::map<int, std::vector<SubscriberBase *>>& GetSubscriberMap()
-    {
-        return mSubscriberMap;
-    }
 };
 
 class TestSubOne : public Subscriber<testTopic>
@@ -82,8 +78,8 @@ TEST_CASE("Subscriber Test")
         // Act & Assert
         CHECK_NOTHROW(testSub.Subscribe(testTopic::topicOne));
         CHECK_NOTHROW(testSub.Subscribe(testTopic::topicTwo));
-        CHECK(testBroker.GetSubscriberMap()[testTopic::topicOne].size() == 1);
-        CHECK(testBroker.GetSubscriberMap()[testTopic::topicTwo].size() == 1);
+        CHECK(testBroker.GetSubscriberCount(testTopic::topicOne) == 1);
+        CHECK(testBroker.GetSubscriberCount(testTopic::topicTwo) == 1);
 
         SUBCASE("Receive Event")
         {
@@ -98,7 +94,7 @@ TEST_CASE("Subscriber Test")
         {
             // Act
             CHECK_NOTHROW(testBroker.Unsubscribe(testSub, testTopic::topicOne));
-            CHECK(testBroker.GetSubscriberMap()[testTopic::topicOne].size() == 0);
+            CHECK(testBroker.GetSubscriberCount(testTopic::topicOne) == 0);
             CHECK_NOTHROW(testBroker.Publish(testTopic::topicOne, testEvent));
 
             // Assert
@@ -112,7 +108,7 @@ TEST_CASE("Subscriber Test")
         SUBCASE("Unsubscribe to Broker through Subscriber")
         {
             CHECK_NOTHROW(testSub.Unsubscribe(testTopic::topicOne));
-            CHECK(testBroker.GetSubscriberMap()[testTopic::topicOne].size() == 0);
+            CHECK(testBroker.GetSubscriberCount(testTopic::topicOne) == 0);
             CHECK_NOTHROW(testBroker.Publish(testTopic::topicOne, testEvent));
             CHECK_FALSE(testSub.isHandled);
 
@@ -128,15 +124,15 @@ TEST_CASE("Subscriber Test")
                 CHECK_NOTHROW(two.Subscribe(testTopic::topicOne));
                 CHECK_NOTHROW(two.Subscribe(testTopic::topicTwo));
 
-                CHECK(testBroker.GetSubscriberMap()[testTopic::topicOne].size() == 2);
-                CHECK(testBroker.GetSubscriberMap()[testTopic::topicTwo].size() == 2);
+                CHECK(testBroker.GetSubscriberCount(testTopic::topicOne) == 2);
+                CHECK(testBroker.GetSubscriberCount(testTopic::topicTwo) == 2);
 
                 CHECK_NOTHROW(testBroker.Publish(testTopic::topicOne, testEvent));
                 CHECK(two.isHandled);
                 CHECK_EQ(two.mMessage, "MyEvent");
             }
-            CHECK(testBroker.GetSubscriberMap()[testTopic::topicOne].size() == 1);
-            CHECK(testBroker.GetSubscriberMap()[testTopic::topicTwo].size() == 1);
+            CHECK(testBroker.GetSubscriberCount(testTopic::topicOne) == 1);
+            CHECK(testBroker.GetSubscriberCount(testTopic::topicTwo) == 1);
         }
     }
 }
@@ -200,3 +196,488 @@ TEST_CASE("Publisher Test")
         CHECK_FALSE(testSubTwo.isHandled);
     }
 }
+
+class QueuedSub : public Subscriber<testTopic>
+{
+public:
+    QueuedSub(Broker<testTopic>& arBroker, std::size_t aQueueCapacity)
+        : Subscriber<testTopic>(arBroker, aQueueCapacity)
+    {
+    }
+    void HandleEvent(Event &arNewEvent) override
+    {
+        if (arNewEvent.Is<ClickedEvent>()) {
+            mMessages.push_back(arNewEvent.GetAs<ClickedEvent>().mMessage);
+        }
+        mThreadId = std::this_thread::get_id();
+        mHandled++;
+    }
+    std::vector<std::string> mMessages{};
+    std::thread::id mThreadId{};
+    std::atomic<int> mHandled = 0;
+};
+
+TEST_CASE("Queued Subscriber")
+{
+    TestBroker broker;
+    QueuedSub sub(broker, 4);
+    sub.Subscribe(testTopic::topicOne);
+
+    SUBCASE("Publish only enqueues")
+    {
+        ClickedEvent event("First");
+        broker.Publish(testTopic::topicOne, event);
+        event.mMessage = "Changed";
+        broker.Publish(testTopic::topicOne, MakeEvent<ClickedEvent>("Second"));
+
+        CHECK(sub.IsQueued());
+        CHECK(sub.mMessages.empty());
+        CHECK_EQ(sub.GetPendingCount(), 2);
+        CHECK(sub.WaitForEvents(std::chrono::milliseconds(0)));
+
+        CHECK_EQ(sub.ProcessEvents(), 2);
+        REQUIRE_EQ(sub.mMessages.size(), 2);
+        CHECK_EQ(sub.mMessages[0], "First");
+        CHECK_EQ(sub.mMessages[1], "Second");
+        CHECK_FALSE(sub.WaitForEvents(std::chrono::milliseconds(1)));
+    }
+
+    SUBCASE("Full queue drops events")
+    {
+        ClickedEvent event("Event");
+        for (int i = 0 ; i < 6 ; ++i) {
+            broker.Publish(testTopic::topicOne, event);
+        }
+        CHECK_EQ(sub.GetDroppedCount(), 2);
+        CHECK_EQ(sub.ProcessEvents(1), 1);
+        CHECK_EQ(sub.ProcessEvents(), 3);
+    }
+
+    SUBCASE("Handled on own thread")
+    {
+        std::atomic<bool> stop = false;
+        std::thread worker([&]() {
+            while (!stop) {
+                if (sub.WaitForEvents(std::chrono::milliseconds(10))) {
+                    sub.ProcessEvents();
+                }
+            }
+        });
+
+        broker.Publish(testTopic::topicOne, MakeEvent<ClickedEvent>("Threaded"));
+        for (int i = 0 ; (i < 1000) && (sub.mHandled == 0) ; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        std::thread::id worker_id = worker.get_id();
+        stop = true;
+        worker.join();
+
+        REQUIRE_EQ(sub.mMessages.size(), 1);
+        CHECK_EQ(sub.mMessages[0], "Threaded");
+        CHECK_EQ(sub.mThreadId, worker_id);
+    }
+
+    SUBCASE("Wakes event loop")
+    {
+        rsp::utils::EventLoop loop;
+        sub.SetEventLoop(&loop);
+        std::thread publisher([&broker]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            broker.Publish(testTopic::topicOne, MakeEvent<ClickedEvent>("Wake"));
+        });
+        // Returns once the event has arrived, instead of sleeping forever
+        loop.RunOnce(rsp::utils::EventLoop::cForever);
+        publisher.join();
+        CHECK_EQ(sub.ProcessEvents(), 1);
+        sub.SetEventLoop(nullptr);
+    }
+
+    SUBCASE("Concurrent publish and subscribe")
+    {
+        constexpr int cPublishers = 4;
+        constexpr int cEvents = 2000;
+        QueuedSub big(broker, cPublishers * cEvents);
+        big.Subscribe(testTopic::topicTwo);
+
+        std::atomic<bool> stop = false;
+        std::thread changer([&]() {
+            while (!stop) {
+                QueuedSub temporary(broker, 16);
+                temporary.Subscribe(testTopic::topicTwo);
+                temporary.Unsubscribe(testTopic::topicTwo);
+                temporary.Subscribe(testTopic::topicTwo);
+            }
+        });
+
+        std::vector<std::thread> publishers;
+        for (int p = 0 ; p < cPublishers ; ++p) {
+            publishers.emplace_back([&]() {
+                for (int i = 0 ; i < cEvents ; ++i) {
+                    broker.Publish(testTopic::topicTwo, MakeEvent<ClickedEvent>("Concurrent"));
+                }
+            });
+        }
+        for (auto &thread : publishers) {
+            thread.join();
+        }
+        stop = true;
+        changer.join();
+
+        CHECK_EQ(big.GetDroppedCount(), 0);
+        CHECK_EQ(big.ProcessEvents(), cPublishers * cEvents);
+        CHECK_EQ(broker.GetSubscriberCount(testTopic::topicTwo), 1);
+    }
+}
+
+class ReentrantSub : public Subscriber<testTopic>
+{
+public:
+    ReentrantSub(Broker<testTopic>& arBroker, Subscriber<testTopic>* apOther)
+        : Subscriber<testTopic>(arBroker),
+          mpOther(apOther)
+    {
+    }
+    ReentrantSub(const ReentrantSub&) = delete;
+    ReentrantSub& operator=(const ReentrantSub&) = delete;
+
+    void HandleEvent(Event &) override
+    {
+        mHandled++;
+        Unsubscribe(testTopic::topicOne);
+        if (mpOther) {
+            mpOther->Subscribe(testTopic::topicOne);
+        }
+    }
+    Subscriber<testTopic>* mpOther;
+    int mHandled = 0;
+};
+
+class ForwardingSub : public Subscriber<testTopic>
+{
+public:
+    ForwardingSub(Broker<testTopic>& arBroker, Broker<testTopic>& arTarget)
+        : Subscriber<testTopic>(arBroker),
+          mrTarget(arTarget)
+    {
+        Subscribe(testTopic::topicOne);
+    }
+    ~ForwardingSub() override
+    {
+        Detach();
+    }
+    ForwardingSub(const ForwardingSub&) = delete;
+    ForwardingSub& operator=(const ForwardingSub&) = delete;
+
+    void HandleEvent(Event &arNewEvent) override
+    {
+        mHandled++;
+        if (arNewEvent.GetAs<ClickedEvent>().mMessage == "Forward") {
+            mrTarget.Publish(testTopic::topicOne, MakeEvent<ClickedEvent>("Stop"));
+        }
+        if (mpEntered) {
+            mpEntered->store(true);
+            while (!mpRelease->load()) {
+                std::this_thread::yield();
+            }
+            mLeft = true;
+        }
+    }
+    Broker<testTopic> &mrTarget;
+    std::atomic<int> mHandled{0};
+    std::atomic<bool> *mpEntered = nullptr;
+    std::atomic<bool> *mpRelease = nullptr;
+    std::atomic<bool> mLeft{false};
+};
+
+TEST_CASE("Synchronous Delivery")
+{
+    TestBroker a;
+    TestBroker b;
+
+    SUBCASE("Publish from handlers on several threads") {
+        // Each handler publishes to the other broker, so deliveries cross between the threads
+        ForwardingSub sub_a(a, b);
+        ForwardingSub sub_b(b, a);
+        constexpr int cEvents = 2000;
+        std::thread other([&b]() {
+            for (int i = 0 ; i < cEvents ; ++i) {
+                b.Publish(testTopic::topicOne, MakeEvent<ClickedEvent>("Forward"));
+            }
+        });
+        for (int i = 0 ; i < cEvents ; ++i) {
+            a.Publish(testTopic::topicOne, MakeEvent<ClickedEvent>("Forward"));
+        }
+        other.join();
+        CHECK_EQ(sub_a.mHandled, 2 * cEvents);
+        CHECK_EQ(sub_b.mHandled, 2 * cEvents);
+    }
+
+    SUBCASE("Detach waits for delivery in progress") {
+        std::atomic<bool> entered{false};
+        std::atomic<bool> release{false};
+        ForwardingSub sub(a, b);
+        sub.mpEntered = &entered;
+        sub.mpRelease = &release;
+        std::thread publisher([&a]() {
+            a.Publish(testTopic::topicOne, MakeEvent<ClickedEvent>("Wait"));
+        });
+        while (!entered) {
+            std::this_thread::yield();
+        }
+        std::thread releaser([&release]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            release = true;
+        });
+        sub.Detach();
+        CHECK(sub.mLeft);
+        publisher.join();
+        releaser.join();
+
+        a.Publish(testTopic::topicOne, MakeEvent<ClickedEvent>("Ignored"));
+        CHECK_EQ(sub.mHandled, 1);
+    }
+}
+
+TEST_CASE("Broker Topic Table")
+{
+    TestBroker broker;
+
+    SUBCASE("Subscription changes during publish")
+    {
+        TestSubOne late(broker);
+        ReentrantSub first(broker, &late);
+        ReentrantSub second(broker, nullptr);
+        first.Subscribe(testTopic::topicOne);
+        second.Subscribe(testTopic::topicOne);
+
+        // Both subscribers of the publication are called, the new one only gets later publications
+        broker.Publish(testTopic::topicOne, MakeEvent<ClickedEvent>("First"));
+        CHECK_EQ(first.mHandled, 1);
+        CHECK_EQ(second.mHandled, 1);
+        CHECK_FALSE(late.isHandled);
+        CHECK_EQ(broker.GetSubscriberCount(testTopic::topicOne), 1);
+
+        broker.Publish(testTopic::topicOne, MakeEvent<ClickedEvent>("Second"));
+        CHECK_EQ(first.mHandled, 1);
+        CHECK_EQ(late.mMessage, "Second");
+    }
+
+    SUBCASE("Topic range")
+    {
+        enum class WideTopic { Low = 0, High = BrokerBase::cMaxTopic, TooHigh, Negative = -1 };
+        Broker<WideTopic> wide;
+        struct WideSub : public Subscriber<WideTopic> {
+            using Subscriber<WideTopic>::Subscriber;
+            void HandleEvent(Event &) override { mHandled++; }
+            int mHandled = 0;
+        } sub(wide);
+
+        CHECK_NOTHROW(sub.Subscribe(WideTopic::High));
+        CHECK_THROWS_AS(sub.Subscribe(WideTopic::TooHigh), std::out_of_range);
+        CHECK_THROWS_AS(sub.Subscribe(WideTopic::Negative), std::out_of_range);
+
+        ClickedEvent event("Event");
+        wide.Publish(WideTopic::Low, event);
+        wide.Publish(WideTopic::TooHigh, event);
+        wide.Publish(WideTopic::Negative, event);
+        CHECK_EQ(sub.mHandled, 0);
+        wide.Publish(WideTopic::High, event);
+        CHECK_EQ(sub.mHandled, 1);
+        CHECK_EQ(wide.GetSubscriberCount(WideTopic::Negative), 0);
+    }
+}
+
+struct SensorEvent : public EventType<SensorEvent>
+{
+    static constexpr std::size_t cPoolCapacity = 8;
+
+    SensorEvent(int aChannel, double aValue) : mChannel(aChannel), mValue(aValue) {}
+
+    int mChannel;
+    double mValue;
+};
+
+TEST_CASE("Event Pool")
+{
+    auto &pool = EventPool<SensorEvent>::Get();
+    pool.Reserve(2);
+    std::size_t allocated = pool.GetAllocatedCount();
+    std::size_t available = pool.GetAvailable();
+    CHECK_GE(available, 2);
+
+    SUBCASE("Type Id")
+    {
+        SensorEvent sensor(1, 2.5);
+        ClickedEvent click("Click");
+        Event &event = sensor;
+        CHECK(event.Is<SensorEvent>());
+        CHECK_FALSE(event.Is<ClickedEvent>());
+        CHECK_EQ(event.GetTypeId(), cEventTypeId<SensorEvent>);
+        CHECK_NE(click.GetTypeId(), event.GetTypeId());
+        CHECK_EQ(event.GetAs<SensorEvent>().mValue, 2.5);
+        CHECK_THROWS(event.GetAs<ClickedEvent>());
+    }
+
+    SUBCASE("Shared Ownership")
+    {
+        {
+            EventPtr first = MakeEvent<SensorEvent>(3, 1.5);
+            CHECK_EQ(pool.GetAvailable(), available - 1);
+            EventPtr second = first;
+            EventPtr third = std::move(second);
+            CHECK_FALSE(second);
+            first = nullptr;
+            CHECK_EQ(pool.GetAvailable(), available - 1);
+            CHECK_EQ(third->GetAs<SensorEvent>().mChannel, 3);
+        }
+        CHECK_EQ(pool.GetAvailable(), available);
+    }
+
+    SUBCASE("Steady State")
+    {
+        TestBroker broker;
+        QueuedSub sub(broker, 4);
+        sub.Subscribe(testTopic::topicOne);
+        QueuedSub other(broker, 4);
+        other.Subscribe(testTopic::topicOne);
+
+        for (int i = 0 ; i < 100 ; ++i) {
+            broker.Publish(testTopic::topicOne, MakeEvent<SensorEvent>(i, 0.0));
+            SensorEvent copied(i, 1.0);
+            broker.Publish(testTopic::topicOne, copied);
+            CHECK_EQ(sub.GetPendingCount(), 2);
+            CHECK_EQ(sub.ProcessEvents(), 2);
+            CHECK_EQ(other.ProcessEvents(), 2);
+        }
+        CHECK_EQ(pool.GetAllocatedCount(), allocated);
+        CHECK_EQ(pool.GetAvailable(), available);
+    }
+
+    SUBCASE("Capacity")
+    {
+        std::vector<EventPtr> events;
+        for (int i = 0 ; i < 20 ; ++i) {
+            events.push_back(MakeEvent<SensorEvent>(i, 0.0));
+        }
+        events.clear();
+        CHECK_EQ(pool.GetAvailable(), 8);
+    }
+}
+
+class SensorSub : public Subscriber<testTopic>
+{
+public:
+    SensorSub(Broker<testTopic>& arBroker, std::size_t aQueueCapacity = 0)
+        : Subscriber<testTopic>(arBroker, aQueueCapacity)
+    {
+    }
+    void HandleEvent(Event &arNewEvent) override
+    {
+        if (arNewEvent.Is<SensorEvent>()) {
+            mValue = arNewEvent.GetAs<SensorEvent>().mValue;
+            mSensorCount++;
+        }
+        else {
+            mOtherCount++;
+        }
+    }
+    double mValue = 0.0;
+    int mSensorCount = 0;
+    int mOtherCount = 0;
+};
+
+TEST_CASE("Latest Value Topic")
+{
+    TestBroker broker;
+    broker.SetLatestValue(testTopic::topicOne);
+    CHECK(broker.IsLatestValue(testTopic::topicOne));
+    CHECK_FALSE(broker.IsLatestValue(testTopic::topicTwo));
+    CHECK_FALSE(broker.GetLatest(testTopic::topicOne));
+
+    SensorSub sub(broker);
+    sub.Subscribe(testTopic::topicOne);
+    sub.Subscribe(testTopic::topicTwo);
+
+    SUBCASE("Publications are coalesced")
+    {
+        for (int i = 1 ; i <= 100 ; ++i) {
+            broker.Publish(testTopic::topicOne, MakeEvent<SensorEvent>(1, i));
+        }
+        CHECK_EQ(sub.mSensorCount, 0);
+        CHECK_EQ(sub.GetLatest(testTopic::topicOne)->GetAs<SensorEvent>().mValue, 100.0);
+
+        CHECK(sub.WaitForEvents(std::chrono::milliseconds(0)));
+        CHECK_EQ(sub.ProcessEvents(), 1);
+        CHECK_EQ(sub.mSensorCount, 1);
+        CHECK_EQ(sub.mValue, 100.0);
+        CHECK_EQ(sub.ProcessEvents(), 0);
+        CHECK_FALSE(sub.WaitForEvents(std::chrono::milliseconds(0)));
+
+        // Published by reference
+        SensorEvent event(1, 101.0);
+        broker.Publish(testTopic::topicOne, event);
+        event.mValue = 0.0;
+        CHECK_EQ(sub.ProcessEvents(), 1);
+        CHECK_EQ(sub.mValue, 101.0);
+    }
+
+    SUBCASE("Normal topics are not affected")
+    {
+        broker.Publish(testTopic::topicTwo, MakeEvent<ClickedEvent>("Click"));
+        CHECK_EQ(sub.mOtherCount, 1);
+        broker.Publish(testTopic::topicOne, MakeEvent<SensorEvent>(1, 1.0));
+        CHECK_EQ(sub.mSensorCount, 0);
+    }
+
+    SUBCASE("New subscribers get the current value")
+    {
+        broker.Publish(testTopic::topicOne, MakeEvent<SensorEvent>(1, 7.0));
+        sub.ProcessEvents();
+
+        SensorSub late(broker, 4);
+        late.Subscribe(testTopic::topicOne);
+        CHECK_EQ(late.ProcessEvents(), 1);
+        CHECK_EQ(late.mValue, 7.0);
+    }
+
+    SUBCASE("Unsubscribe drops pending value")
+    {
+        broker.Publish(testTopic::topicOne, MakeEvent<SensorEvent>(1, 1.0));
+        sub.Unsubscribe(testTopic::topicOne);
+        CHECK_EQ(sub.ProcessEvents(), 0);
+        CHECK_EQ(broker.GetSubscriberCount(testTopic::topicOne), 0);
+    }
+
+    SUBCASE("Return to normal delivery")
+    {
+        broker.SetLatestValue(testTopic::topicOne, false);
+        CHECK_FALSE(broker.GetLatest(testTopic::topicOne));
+        broker.Publish(testTopic::topicOne, MakeEvent<SensorEvent>(1, 1.0));
+        broker.Publish(testTopic::topicOne, MakeEvent<SensorEvent>(1, 2.0));
+        CHECK_EQ(sub.mSensorCount, 2);
+        CHECK_EQ(sub.ProcessEvents(), 0);
+    }
+
+    SUBCASE("Fast publisher")
+    {
+        constexpr int cEvents = 20000;
+        SensorSub queued(broker, 4);
+        queued.Subscribe(testTopic::topicOne);
+
+        std::thread publisher([&broker]() {
+            for (int i = 1 ; i <= cEvents ; ++i) {
+                broker.Publish(testTopic::topicOne, MakeEvent<SensorEvent>(1, i));
+            }
+        });
+        while (queued.mValue < cEvents) {
+            if (queued.WaitForEvents(std::chrono::milliseconds(100))) {
+                queued.ProcessEvents();
+            }
+        }
+        publisher.join();
+
+        CHECK_EQ(queued.GetDroppedCount(), 0);
+        CHECK_LE(queued.mSensorCount, cEvents);
+        MESSAGE("Handled " << queued.mSensorCount << " of " << cEvents << " publications");
+    }
+}
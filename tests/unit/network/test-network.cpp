@@ -20,10 +20,12 @@
 #include <network/HttpDownload.h>
 #include <network/NetworkLibrary.h>
 #include <network/HttpSession.h>
+#include <network/HttpAwaitable.h>
 #include <network/NetworkException.h>
 #include <posix/FileSystem.h>
 #include <posix/FileIO.h>
 #include <utils/AnsiEscapeCodes.h>
+#include <utils/Coroutine.h>
 #include <utils/StrUtils.h>
 #include <TestHelpers.h>
 #include <cstdlib>
@@ -350,5 +352,39 @@ TEST_CASE("Network")
         CHECK(resp2);
     }
 
+    SUBCASE("Http Session Coroutine") {
+        EventLoop loop;
+        HttpSession session(2);
+        opt.BaseUrl = "https://server.localhost:44300/";
+        session.SetDefaultOptions(opt);
+        session.SetEventLoop(&loop);
+
+        auto fetch = [&session]() -> Task<std::size_t> {
+            HttpReply head = co_await HttpAwaitable(session, HttpRequestType::HEAD, "index.html");
+            CHECK_EQ(head.StatusCode, 200);
+            CHECK_EQ(head.Headers.at("content-length"), "120");
+            HttpReply image = co_await HttpAwaitable(session, HttpRequestType::GET, "image.png");
+            CHECK_EQ(image.StatusCode, 200);
+            co_return image.Body.size();
+        };
+        CHECK_EQ(SyncWait(loop, fetch()), 25138);
+
+        // Without a client certificate the transfer fails, and co_await throws its error
+        HttpRequestOptions no_client = opt;
+        no_client.CertPath = "";
+        no_client.KeyPath = "";
+        session.SetDefaultOptions(no_client);
+        auto failing = [&session]() -> Task<bool> {
+            try {
+                co_await HttpAwaitable(session, HttpRequestType::GET, "index.html");
+            }
+            catch (const NetworkException &) {
+                co_return true;
+            }
+            co_return false;
+        };
+        CHECK(SyncWait(loop, failing()));
+    }
+
     CHECK(0 == std::system("killall lighttpd"));
 }
@@ -0,0 +1,193 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#include "doctest.h"
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <utils/Coroutine.h>
+#include <utils/StopWatch.h>
+
+using namespace rsp::utils;
+using namespace std::literals::chrono_literals;
+
+static Task<int> answer()
+{
+    co_return 42;
+}
+
+static Task<std::string> twice(int aValue)
+{
+    int value = co_await answer();
+    co_return std::to_string(value + aValue);
+}
+
+static Task<int> failing()
+{
+    throw std::runtime_error("Task failed");
+    co_return 0;
+}
+
+static Task<int> countDown(int aDepth)
+{
+    if (aDepth == 0) {
+        co_return 0;
+    }
+    co_return 1 + co_await countDown(aDepth - 1);
+}
+
+static Task<> increment(int &arCount)
+{
+    arCount++;
+    co_return;
+}
+
+TEST_CASE("Coroutine")
+{
+    EventLoop loop;
+
+    SUBCASE("Task Is Lazy") {
+        int count = 0;
+        auto task = increment(count);
+        CHECK_EQ(count, 0);
+        CHECK_FALSE(task.IsDone());
+        task.Start();
+        CHECK_EQ(count, 1);
+        CHECK(task.IsDone());
+    }
+
+    SUBCASE("Chained Tasks") {
+        CHECK_EQ(SyncWait(loop, twice(8)), "50");
+    }
+
+    SUBCASE("Exception") {
+        auto caller = []() -> Task<int> {
+            int result = 0;
+            try {
+                result = co_await failing();
+            }
+            catch (const std::runtime_error &) {
+                result = -1;
+            }
+            co_return result;
+        };
+        CHECK_EQ(SyncWait(loop, caller()), -1);
+        CHECK_THROWS_AS(SyncWait(loop, failing()), const std::runtime_error &);
+    }
+
+    SUBCASE("Nested Tasks") {
+        // Every level completes at once and transfers control straight back to its caller.
+        // Kept shallow, unoptimized builds do not turn the transfer into a tail call.
+        CHECK_EQ(SyncWait(loop, countDown(1000)), 1000);
+    }
+
+    SUBCASE("Wait For Fd") {
+        int fds[2];
+        REQUIRE_EQ(pipe(fds), 0);
+        std::thread writer([&fds]() {
+            std::this_thread::sleep_for(10ms);
+            CHECK_EQ(write(fds[1], "a", 1), 1);
+        });
+        auto reader = [&]() -> Task<char> {
+            std::uint32_t events = co_await WaitFd(loop, fds[0]);
+            CHECK((events & EventLoop::cReadable));
+            char c = 0;
+            CHECK_EQ(read(fds[0], &c, 1), 1);
+            co_return c;
+        };
+        CHECK_EQ(SyncWait(loop, reader()), 'a');
+        writer.join();
+
+        // The descriptor is released again when the coroutine resumes
+        CHECK_NOTHROW(loop.AddFd(fds[0], EventLoop::cReadable, [](std::uint32_t) {}));
+        loop.RemoveFd(fds[0]);
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    SUBCASE("Offload") {
+        std::thread::id loop_thread = std::this_thread::get_id();
+        auto task = [&]() -> Task<int> {
+            int sum = co_await Offload(loop, [loop_thread]() {
+                CHECK_NE(std::this_thread::get_id(), loop_thread);
+                int result = 0;
+                for (int i = 1; i <= 100; ++i) {
+                    result += i;
+                }
+                return result;
+            });
+            CHECK_EQ(std::this_thread::get_id(), loop_thread);
+
+            bool caught = false;
+            try {
+                co_await Offload(loop, []() { throw std::runtime_error("Offload failed"); });
+            }
+            catch (const std::runtime_error &) {
+                caught = true;
+            }
+            CHECK(caught);
+            CHECK_EQ(std::this_thread::get_id(), loop_thread);
+            co_return sum;
+        };
+        CHECK_EQ(SyncWait(loop, task()), 5050);
+    }
+
+    SUBCASE("Switch Threads") {
+        std::thread::id loop_thread = std::this_thread::get_id();
+        auto task = [&]() -> Task<> {
+            co_await SwitchTo(ThreadPool::GetDefault());
+            CHECK(ThreadPool::GetDefault().IsWorkerThread());
+            co_await SwitchTo(loop);
+            CHECK_EQ(std::this_thread::get_id(), loop_thread);
+        };
+        SyncWait(loop, task());
+    }
+
+    SUBCASE("Spawn") {
+        int count = 0;
+        Spawn(loop, increment(count));
+        CHECK_EQ(count, 0);
+        CHECK_EQ(loop.RunOnce(0ms), 1);
+        CHECK_EQ(count, 1);
+
+        auto task = []() -> Task<> {
+            co_await failing();
+        };
+        Spawn(loop, task());
+        CHECK_EQ(loop.RunOnce(0ms), 1);
+        CHECK_THROWS_AS(loop.RunOnce(0ms), const std::runtime_error &);
+    }
+}
+
+TEST_CASE("Coroutine Delay")
+{
+    TimerQueue::Destroy();
+    TimerQueue::Create();
+    {
+        EventLoop loop;
+        loop.PollTimers();
+        StopWatch sw;
+
+        auto task = [&]() -> Task<int> {
+            co_await Delay(loop, 20ms);
+            co_await Delay(loop, 0ms);
+            co_await Delay(loop, 20ms);
+            co_return 1;
+        };
+        sw.Reset();
+        CHECK_EQ(SyncWait(loop, task()), 1);
+        auto elapsed = sw.Elapsed<std::chrono::milliseconds>();
+        CHECK_GE(elapsed, 39);
+        CHECK_LT(elapsed, 500);
+    }
+    TimerQueue::Destroy();
+}
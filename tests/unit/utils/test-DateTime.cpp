@@ -54,6 +54,9 @@ TEST_CASE("DateTime")
             DateTime dt(2022, 11, 8, 15, 43, 23, 813);
             DMESG("DateTime(2022, 11, 08, 15, 43, 23, 813) = " << dt);
             CHECK_EQ(dt.ToLogging(), cLogging);
+            std::stringstream ss;
+            ss << dt;
+            CHECK_EQ(ss.str(), cLogging);
         }
 
         SUBCASE("From RFC3339Milli string") {
@@ -73,6 +76,9 @@ TEST_CASE("DateTime")
             DateTime dt(cISO8601, DateTime::Formats::ISO8601);
             DMESG("DateTime(" << cISO8601 << ") = " << dt);
             CHECK_EQ(dt.ToISO8601(), cISO8601);
+
+            DateTime offset("2022-11-08 17:43:23+0200", DateTime::Formats::ISO8601);
+            CHECK_EQ(offset, dt);
         }
 
         SUBCASE("From ISO8601UTC string") {
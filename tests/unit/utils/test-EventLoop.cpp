@@ -0,0 +1,220 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#include "doctest.h"
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <utils/EventLoop.h>
+#include <utils/StopWatch.h>
+#include <utils/Timer.h>
+
+using namespace rsp::utils;
+using namespace std::literals::chrono_literals;
+
+TEST_CASE("Event Loop")
+{
+    EventLoop loop;
+    StopWatch sw;
+
+    SUBCASE("Idle") {
+        sw.Reset();
+        CHECK_EQ(loop.RunOnce(30ms), 0);
+        CHECK_GE(sw.Elapsed<std::chrono::milliseconds>(), 29);
+    }
+
+    SUBCASE("Post From Thread") {
+        std::atomic<int> count = 0;
+        std::thread::id loop_thread = std::this_thread::get_id();
+        std::thread poster([&]() {
+            std::this_thread::sleep_for(20ms);
+            for (int i = 0; i < 100; ++i) {
+                loop.Post([&count, loop_thread]() {
+                    CHECK_EQ(std::this_thread::get_id(), loop_thread);
+                    count++;
+                });
+            }
+        });
+        sw.Reset();
+        while (count < 100) {
+            loop.RunOnce(EventLoop::cForever);
+        }
+        CHECK_LT(sw.Elapsed<std::chrono::milliseconds>(), 1000);
+        poster.join();
+    }
+
+    SUBCASE("Post From Loop") {
+        int order = 0;
+        loop.Post([&]() {
+            CHECK_EQ(order++, 0);
+            loop.Post([&]() { CHECK_EQ(order++, 1); });
+        });
+        CHECK_EQ(loop.RunOnce(0ms), 1);
+        sw.Reset();
+        CHECK_EQ(loop.RunOnce(1000ms), 1);
+        CHECK_LT(sw.Elapsed<std::chrono::milliseconds>(), 100);
+        CHECK_EQ(order, 2);
+    }
+
+    SUBCASE("Failing Task") {
+        int count = 0;
+        loop.Post([]() { throw std::runtime_error("Task failed"); });
+        loop.Post([&count]() { count++; });
+        CHECK_THROWS_AS(loop.RunOnce(0ms), const std::runtime_error &);
+        CHECK_EQ(count, 0);
+        CHECK_EQ(loop.RunOnce(0ms), 1);
+        CHECK_EQ(count, 1);
+    }
+
+    SUBCASE("File Descriptors") {
+        int fds[2];
+        REQUIRE_EQ(pipe(fds), 0);
+
+        int reads = 0;
+        loop.AddFd(fds[0], EventLoop::cReadable, [&](std::uint32_t aEvents) {
+            CHECK((aEvents & EventLoop::cReadable));
+            char c;
+            CHECK_EQ(read(fds[0], &c, 1), 1);
+            reads++;
+        });
+        CHECK_THROWS_AS(loop.AddFd(fds[0], EventLoop::cReadable, [](std::uint32_t) {}), const std::system_error &);
+
+        CHECK_EQ(loop.RunOnce(0ms), 0);
+        std::thread writer([&]() {
+            std::this_thread::sleep_for(10ms);
+            CHECK_EQ(write(fds[1], "a", 1), 1);
+        });
+        CHECK_EQ(loop.RunOnce(1000ms), 1);
+        CHECK_EQ(reads, 1);
+        writer.join();
+
+        SUBCASE("Remove In Callback") {
+            loop.AddFd(fds[1], EventLoop::cWritable, [&](std::uint32_t) {
+                loop.RemoveFd(fds[1]);
+            });
+            CHECK_EQ(loop.RunOnce(0ms), 1);
+            CHECK_EQ(loop.RunOnce(0ms), 0);
+        }
+
+        loop.RemoveFd(fds[0]);
+        CHECK_EQ(write(fds[1], "b", 1), 1);
+        CHECK_EQ(loop.RunOnce(0ms), 0);
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    SUBCASE("Regular Files Are Rejected") {
+        FILE *file = tmpfile();
+        REQUIRE(file);
+        CHECK_THROWS_AS(loop.AddFd(fileno(file), EventLoop::cReadable, [](std::uint32_t) {}), const std::system_error &);
+        fclose(file);
+    }
+
+    SUBCASE("Signals") {
+        int received = 0;
+        loop.AddSignal(SIGUSR1, [&received](int aSignal) {
+            CHECK_EQ(aSignal, SIGUSR1);
+            received++;
+        });
+        raise(SIGUSR1);
+        CHECK_EQ(loop.RunOnce(1000ms), 1);
+        CHECK_EQ(received, 1);
+    }
+
+    SUBCASE("Wakeup") {
+        loop.Wakeup();
+        CHECK_EQ(loop.RunOnce(0ms), 1);
+        CHECK_EQ(loop.RunOnce(0ms), 0);
+
+        std::thread waker([&loop]() {
+            std::this_thread::sleep_for(20ms);
+            loop.Wakeup();
+        });
+        CHECK_EQ(loop.RunOnce(1000ms), 1);
+        waker.join();
+
+        // Woken through the eventfd, so no wakeup is left pending
+        sw.Reset();
+        CHECK_EQ(loop.RunOnce(30ms), 0);
+        CHECK_GE(sw.Elapsed<std::chrono::milliseconds>(), 29);
+    }
+
+    SUBCASE("Stop From Thread") {
+        std::thread stopper([&]() {
+            std::this_thread::sleep_for(20ms);
+            loop.Stop();
+        });
+        sw.Reset();
+        loop.Run();
+        CHECK_LT(sw.Elapsed<std::chrono::milliseconds>(), 1000);
+        CHECK_FALSE(loop.IsStopped());
+        stopper.join();
+    }
+}
+
+TEST_CASE("Event Loop Timers")
+{
+    TimerQueue::Destroy();
+    TimerQueue::Create();
+    StopWatch sw;
+
+    {
+        EventLoop loop;
+        loop.PollTimers();
+
+        int fired = 0;
+        Timer t1(1, 30ms);
+        t1.Callback() = [&fired](Timer &) { fired++; };
+
+        SUBCASE("Sleep Until Timer") {
+            t1.Enable();
+            sw.Reset();
+            while (!fired) {
+                loop.RunOnce(EventLoop::cForever);
+            }
+            auto elapsed = sw.Elapsed<std::chrono::milliseconds>();
+            CHECK_GE(elapsed, 29);
+            CHECK_LT(elapsed, 500);
+        }
+
+        SUBCASE("Timers Are Counted") {
+            t1.Enable();
+            std::size_t handled = 0;
+            while (!fired) {
+                handled = loop.RunOnce(EventLoop::cForever);
+            }
+            CHECK_EQ(handled, 1);
+        }
+
+        SUBCASE("Timer Armed From Thread") {
+            // The loop sleeps without deadline, so arming must wake it to shorten its wait
+            std::thread armer([&t1]() {
+                std::this_thread::sleep_for(10ms);
+                t1.Enable();
+            });
+            sw.Reset();
+            while (!fired) {
+                loop.RunOnce(EventLoop::cForever);
+            }
+            auto elapsed = sw.Elapsed<std::chrono::milliseconds>();
+            CHECK_GE(elapsed, 39);
+            CHECK_LT(elapsed, 500);
+            armer.join();
+        }
+        CHECK_EQ(fired, 1);
+    }
+
+    TimerQueue::Destroy();
+}
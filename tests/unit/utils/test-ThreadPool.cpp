@@ -0,0 +1,188 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#include "doctest.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <numeric>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <utils/ThreadPool.h>
+
+using namespace rsp::utils;
+using namespace std::literals::chrono_literals;
+
+static std::uint64_t fibonacci(std::uint64_t aN)
+{
+    if (aN < 10) {
+        return (aN < 2) ? aN : fibonacci(aN - 1) + fibonacci(aN - 2);
+    }
+    std::uint64_t a = 0;
+    TaskGroup group;
+    group.Run([&a, aN]() { a = fibonacci(aN - 1); });
+    std::uint64_t b = fibonacci(aN - 2);
+    group.Wait();
+    return a + b;
+}
+
+TEST_CASE("Thread Pool")
+{
+    ThreadPool pool(4);
+    CHECK_EQ(pool.GetSize(), 4);
+    CHECK_FALSE(pool.IsWorkerThread());
+
+    SUBCASE("Submit") {
+        auto answer = pool.Submit([&pool]() {
+            CHECK(pool.IsWorkerThread());
+            return 42;
+        });
+        CHECK_EQ(answer.get(), 42);
+
+        auto failing = pool.Submit([]() -> int { throw std::runtime_error("Task failed"); });
+        CHECK_THROWS_AS(failing.get(), const std::runtime_error &);
+    }
+
+    SUBCASE("All Workers Used") {
+        std::mutex mutex;
+        std::set<std::thread::id> threads;
+        std::atomic<int> started = 0;
+        TaskGroup group(pool);
+        for (int i = 0; i < 4; ++i) {
+            group.Run([&]() {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    threads.insert(std::this_thread::get_id());
+                }
+                // Hold on to the worker until all have started
+                started++;
+                while (started < 4) {
+                    std::this_thread::sleep_for(1ms);
+                }
+            });
+        }
+        group.Wait();
+        CHECK_EQ(threads.size(), 4);
+    }
+
+    SUBCASE("Priorities") {
+        // Keep the only worker busy while tasks are queued
+        ThreadPool single(1);
+        std::atomic<bool> release = false;
+        single.Post([&release]() {
+            while (!release) {
+                std::this_thread::sleep_for(1ms);
+            }
+        });
+        std::this_thread::sleep_for(10ms);
+
+        std::mutex mutex;
+        std::vector<int> order;
+        auto record = [&](int aValue) {
+            return [&, aValue]() {
+                std::lock_guard<std::mutex> lock(mutex);
+                order.push_back(aValue);
+            };
+        };
+        auto low = single.Submit(record(3), ThreadPool::Priority::Low);
+        auto normal = single.Submit(record(2));
+        auto high = single.Submit(record(1), ThreadPool::Priority::High);
+        release = true;
+        low.get();
+        normal.get();
+        high.get();
+        CHECK_EQ(order, std::vector<int>{1, 2, 3});
+    }
+
+    SUBCASE("Parallel For") {
+        std::vector<int> values(10000);
+        pool.ParallelFor(0, values.size(), [&values](std::size_t aFirst, std::size_t aLast) {
+            for (std::size_t i = aFirst; i < aLast; ++i) {
+                values[i] = static_cast<int>(i);
+            }
+        });
+        CHECK_EQ(std::accumulate(values.begin(), values.end(), 0LL), 49995000LL);
+
+        std::atomic<std::size_t> chunks = 0;
+        std::atomic<std::size_t> count = 0;
+        pool.ParallelFor(5, 105, [&](std::size_t aFirst, std::size_t aLast) {
+            CHECK_GE(aLast - aFirst, 10);
+            chunks++;
+            count += aLast - aFirst;
+        }, 10);
+        CHECK_EQ(count, 100);
+        CHECK_LE(chunks, 10);
+
+        count = 0;
+        pool.ParallelFor(7, 7, [&count](std::size_t, std::size_t) { count++; });
+        CHECK_EQ(count, 0);
+
+        CHECK_THROWS_AS(pool.ParallelFor(0, 100, [](std::size_t aFirst, std::size_t) {
+            if (aFirst > 0) {
+                throw std::runtime_error("Chunk failed");
+            }
+        }), const std::runtime_error &);
+    }
+
+    SUBCASE("Waiting Inside Tasks") {
+        // Far more nested waits than workers, only works if waiting runs other tasks
+        auto result = pool.Submit([&pool]() {
+            TaskGroup group(pool);
+            std::atomic<int> sum = 0;
+            for (int i = 1; i <= 100; ++i) {
+                group.Run([&pool, &sum, i]() {
+                    auto inner = pool.Submit([i]() noexcept { return i; });
+                    sum += pool.Await(inner);
+                });
+            }
+            group.Wait();
+            return sum.load();
+        });
+        CHECK_EQ(pool.Await(result), 5050);
+    }
+
+    SUBCASE("Task Group Exception") {
+        TaskGroup group(pool);
+        std::atomic<int> count = 0;
+        for (int i = 0; i < 10; ++i) {
+            group.Run([&count, i]() {
+                count++;
+                if (i == 5) {
+                    throw std::runtime_error("Task failed");
+                }
+            });
+        }
+        CHECK_THROWS_AS(group.Wait(), const std::runtime_error &);
+        CHECK_EQ(count, 10);
+        CHECK_NOTHROW(group.Wait());
+    }
+
+    SUBCASE("Destructor Runs Queued Tasks") {
+        std::atomic<int> count = 0;
+        {
+            ThreadPool small(2);
+            for (int i = 0; i < 100; ++i) {
+                small.Post([&count]() { count++; });
+            }
+        }
+        CHECK_EQ(count, 100);
+    }
+}
+
+TEST_CASE("Default Thread Pool")
+{
+    ThreadPool &pool = ThreadPool::GetDefault();
+    CHECK_EQ(&pool, &ThreadPool::GetDefault());
+    CHECK_GE(pool.GetSize(), 1);
+
+    CHECK_EQ(fibonacci(20), 6765);
+}
@@ -9,8 +9,12 @@
  */
 
 #include "doctest.h"
+#include <atomic>
 #include <chrono>
+#include <cstdint>
+#include <memory>
 #include <thread>
+#include <vector>
 #include <utils/Timer.h>
 #include <utils/Random.h>
 
@@ -75,3 +79,145 @@ TEST_CASE("Timer")
 
 }
 
+
+class DeadlineTimer : public Timer
+{
+public:
+    using Timer::Timer;
+    std::int64_t GetDeadline() const { return mTimeoutAt.Milliseconds(); }
+};
+
+TEST_CASE("Timer Queue Order")
+{
+    TimerQueue::Destroy();
+    CHECK_NOTHROW(TimerQueue::Create());
+    auto &queue = TimerQueue::Get();
+
+    constexpr int cCount = 200;
+    std::vector<std::unique_ptr<DeadlineTimer>> timers;
+    std::vector<int> fired;
+    for (int i = 0; i < cCount; ++i) {
+        // Timeouts 0..19 ms in scrambled order
+        auto timeout = std::chrono::milliseconds((i * 7) % 20);
+        timers.push_back(std::make_unique<DeadlineTimer>(i, timeout));
+        timers.back()->Callback() = [&fired](Timer &arTimer) { fired.push_back(arTimer.GetId()); };
+        timers.back()->Enable();
+    }
+    CHECK_EQ(queue.GetSize(), cCount);
+    REQUIRE(queue.NextDeadline().has_value());
+
+    SUBCASE("Expiry Order") {
+        // Cancel every third timer, and restart every fifth with a longer timeout
+        for (int i = 0; i < cCount; i += 3) {
+            timers[static_cast<std::size_t>(i)]->Enable(false);
+        }
+        for (int i = 1; i < cCount; i += 5) {
+            timers[static_cast<std::size_t>(i)]->SetTimeout(25ms);
+        }
+        std::this_thread::sleep_for(40ms);
+        queue.Poll();
+
+        std::size_t expected = 0;
+        for (int i = 0; i < cCount; ++i) {
+            expected += (i % 3) ? 1 : 0;
+        }
+        REQUIRE_EQ(fired.size(), expected);
+        for (std::size_t i = 1; i < fired.size(); ++i) {
+            auto &prev = *timers[static_cast<std::size_t>(fired[i - 1])];
+            auto &cur = *timers[static_cast<std::size_t>(fired[i])];
+            CHECK_LE(prev.GetDeadline(), cur.GetDeadline());
+        }
+        CHECK_EQ(queue.GetSize(), 0);
+        CHECK_FALSE(queue.NextDeadline().has_value());
+    }
+
+    SUBCASE("Destroyed Timers Leave Queue") {
+        timers.clear();
+        CHECK_EQ(queue.GetSize(), 0);
+        std::this_thread::sleep_for(25ms);
+        CHECK_NOTHROW(queue.Poll());
+        CHECK(fired.empty());
+    }
+}
+
+TEST_CASE("Timer Queue Deadline")
+{
+    TimerQueue::Destroy();
+    CHECK_NOTHROW(TimerQueue::Create());
+    auto &queue = TimerQueue::Get();
+
+    CHECK_FALSE(queue.NextDeadline().has_value());
+    CHECK_EQ(queue.TimeUntilNext(100ms), 100ms);
+
+    int count = 0;
+    Timer t1(1, 30ms);
+    Timer t2(2, 0ms);
+    t1.Callback() = [&count](Timer &) { count++; };
+    t2.Callback() = [&count](Timer &arTimer) { count++; arTimer.Enable(); };
+
+    t1.Enable();
+    auto until = queue.TimeUntilNext(100ms);
+    CHECK_GT(until, 20ms);
+    CHECK_LE(until, 30ms);
+    CHECK_EQ(queue.TimeUntilNext(10ms), 10ms);
+
+    SUBCASE("Sleep Until Deadline") {
+        std::this_thread::sleep_for(queue.TimeUntilNext(100ms) + 1ms);
+        queue.Poll();
+        CHECK_EQ(count, 1);
+        CHECK_FALSE(t1.IsEnabled());
+    }
+
+    SUBCASE("Rearmed Timers Wait For Next Poll") {
+        t2.Enable();
+        CHECK_EQ(queue.TimeUntilNext(100ms), 0ms);
+        queue.Poll();
+        CHECK_EQ(count, 1);
+        CHECK(t2.IsEnabled());
+        queue.Poll();
+        CHECK_EQ(count, 2);
+    }
+}
+
+TEST_CASE("Timer Queue Threads")
+{
+    TimerQueue::Destroy();
+    CHECK_NOTHROW(TimerQueue::Create());
+    auto &queue = TimerQueue::Get();
+
+    constexpr int cCount = 100;
+    std::atomic<int> count = 0;
+    std::vector<std::unique_ptr<Timer>> timers;
+    for (int i = 0; i < cCount; ++i) {
+        timers.push_back(std::make_unique<Timer>(i, 1ms));
+        timers.back()->Callback() = [&count](Timer &) { count++; };
+    }
+
+    std::atomic<bool> done = false;
+    std::thread poller([&]() {
+        while (!done) {
+            std::this_thread::sleep_for(queue.TimeUntilNext(1ms));
+            queue.Poll();
+        }
+    });
+
+    // Arm from this thread while the poller triggers
+    for (int round = 0; round < 5; ++round) {
+        for (auto &timer : timers) {
+            timer->Enable();
+        }
+        while (count < cCount * (round + 1)) {
+            std::this_thread::sleep_for(1ms);
+        }
+    }
+    CHECK_EQ(count, cCount * 5);
+
+    // Destroying timers while the poller may be triggering them must be safe
+    for (auto &timer : timers) {
+        timer->Enable();
+    }
+    timers.clear();
+    done = true;
+    poller.join();
+    CHECK_EQ(queue.GetSize(), 0);
+}
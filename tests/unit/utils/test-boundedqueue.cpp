@@ -0,0 +1,83 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#include "doctest.h"
+#include <utils/BoundedQueue.h>
+#include <memory>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+using namespace rsp::utils;
+
+TEST_CASE("BoundedQueue") {
+
+    SUBCASE("Single Thread") {
+        BoundedQueue<std::unique_ptr<int>> queue(3);
+        CHECK_EQ(queue.GetCapacity(), 4);
+        CHECK(queue.IsEmpty());
+
+        for (int i = 0 ; i < 4 ; ++i) {
+            CHECK(queue.TryPush(std::make_unique<int>(i)));
+        }
+        auto extra = std::make_unique<int>(4);
+        CHECK_FALSE(queue.TryPush(extra));
+        CHECK(extra);
+        CHECK_EQ(queue.GetSize(), 4);
+
+        std::unique_ptr<int> value;
+        for (int i = 0 ; i < 4 ; ++i) {
+            REQUIRE(queue.TryPop(value));
+            CHECK_EQ(*value, i);
+        }
+        CHECK_FALSE(queue.TryPop(value));
+        CHECK(queue.IsEmpty());
+
+        // Wrap around the ring a few times
+        for (int i = 0 ; i < 10 ; ++i) {
+            CHECK(queue.TryPush(std::make_unique<int>(i)));
+            REQUIRE(queue.TryPop(value));
+            CHECK_EQ(*value, i);
+        }
+    }
+
+    SUBCASE("Multiple Threads") {
+        constexpr int cThreads = 4;
+        constexpr int cCount = 10000;
+        BoundedQueue<int> queue(64);
+        std::vector<long> sums(cThreads, 0);
+        std::vector<std::thread> threads;
+
+        for (int t = 0 ; t < cThreads ; ++t) {
+            threads.emplace_back([&queue]() {
+                for (int i = 1 ; i <= cCount ; ++i) {
+                    while (!queue.TryPush(i)) {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+            threads.emplace_back([&queue, &sums, t]() {
+                int value;
+                for (int i = 0 ; i < cCount ; ++i) {
+                    while (!queue.TryPop(value)) {
+                        std::this_thread::yield();
+                    }
+                    sums[static_cast<std::size_t>(t)] += value;
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+
+        CHECK(queue.IsEmpty());
+        CHECK_EQ(std::accumulate(sums.begin(), sums.end(), 0L), cThreads * (static_cast<long>(cCount) * (cCount + 1) / 2));
+    }
+}
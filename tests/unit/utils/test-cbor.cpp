@@ -0,0 +1,212 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#include "doctest.h"
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <json/JsonValue.h>
+#include <logging/Logger.h>
+#include <utils/Cbor.h>
+#include <utils/DynamicData.h>
+
+using namespace rsp::utils;
+
+static std::string bytes(std::initializer_list<unsigned int> aBytes)
+{
+    std::string result;
+    for (unsigned int b : aBytes) {
+        result += static_cast<char>(b);
+    }
+    return result;
+}
+
+static DynamicData sample()
+{
+    DynamicData dd;
+    dd.Add("null", DynamicData());
+    dd.Add("bool", true);
+    dd.Add("int", -42);
+    dd.Add("int64", std::int64_t(7));
+    dd.Add("int64neg", std::int64_t(-5000000000));
+    dd.Add("uint64", std::uint64_t(UINT64_MAX));
+    dd.Add("uint32", std::uint32_t(4000000000));
+    dd.Add("uint16", std::uint16_t(65535));
+    dd.Add("float", 1.5f);
+    dd.Add("double", 0.1);
+    dd.Add("string", std::string("Text with \0 inside", 18));
+
+    DynamicData array;
+    array.Add(1);
+    array.Add(DynamicData(Variant::Types::Object));
+    array.Add(DynamicData(Variant::Types::Array));
+    array.Add("x");
+    dd.Add("array", array);
+    return dd;
+}
+
+TEST_CASE("Cbor") {
+    rsp::logging::Logger logger;
+    rsp::logging::Logger::SetDefault(&logger);
+
+    SUBCASE("Encode") {
+        DynamicData dd;
+        dd.Add("a", std::uint64_t(1000));
+        dd.Add("b", std::int64_t(-1));
+        dd.Add("c", 10);
+        dd.Add("d", 1.0);
+        std::string expected = bytes({ 0xA4,
+            0x61, 'a', 0x19, 0x03, 0xE8,
+            0x61, 'b', 0x20,
+            0x61, 'c', 0xD9, 0xA5, 0x02, 0x0A,
+            0x61, 'd', 0xFB, 0x3F, 0xF0, 0, 0, 0, 0, 0, 0 });
+        CHECK_EQ(CborEncoder::Encode(dd), expected);
+    }
+
+    SUBCASE("Round Trip") {
+        DynamicData dd = sample();
+        std::string cbor = CborEncoder::Encode(dd);
+        DynamicData result = CborDecoder::Decode<DynamicData>(cbor);
+
+        CHECK(result == dd);
+        CHECK(result["int"].GetType() == Variant::Types::Int);
+        CHECK(result["int64"].GetType() == Variant::Types::Int64);
+        CHECK(result["int64neg"].GetType() == Variant::Types::Int64);
+        CHECK(result["uint64"].GetType() == Variant::Types::Uint64);
+        CHECK(result["uint32"].GetType() == Variant::Types::Uint32);
+        CHECK(result["uint16"].GetType() == Variant::Types::Uint16);
+        CHECK(result["float"].GetType() == Variant::Types::Float);
+        CHECK(result["double"].GetType() == Variant::Types::Double);
+        CHECK_EQ(result["uint64"].AsString(), "18446744073709551615");
+        CHECK_EQ(result["double"].AsDouble(), 0.1);
+        CHECK_EQ(result["string"].AsString().size(), 18);
+        CHECK(result["array"][1].IsObject());
+        CHECK(result["array"][2].IsArray());
+        CHECK_EQ(result.GetMemberNames(), dd.GetMemberNames());
+    }
+
+    SUBCASE("JsonValue") {
+        rsp::json::JsonValue json = rsp::json::JsonValue::Decode(R"({"a": [1, -2, 3.5, "s", true, null, {}], "b": {"c": 18446744073709551615}})");
+        std::string cbor = CborEncoder::Encode(json);
+        rsp::json::JsonValue result = CborDecoder::Decode<rsp::json::JsonValue>(cbor);
+        CHECK(result == json);
+        CHECK_EQ(result.Encode(), json.Encode());
+        CHECK(result["a"][6].IsObject());
+    }
+
+    SUBCASE("Streaming") {
+        std::vector<std::string> chunks;
+        CborEncoder encoder([&chunks](std::string_view aChunk) { chunks.emplace_back(aChunk); });
+        DynamicData dd = sample();
+        DynamicData big;
+        for (int i = 0 ; i < 5000 ; ++i) {
+            big.Add(std::string(10, 'a'));
+        }
+        encoder.Write(dd).Write(big).Write(DynamicData(3)).Flush();
+        CHECK_GT(chunks.size(), 1);
+
+        std::string all;
+        for (const std::string &chunk : chunks) {
+            all += chunk;
+        }
+
+        CborDecoder decoder;
+        std::vector<DynamicData> values;
+        DynamicData value;
+        for (char c : all) {
+            decoder.Feed(std::string_view(&c, 1));
+            while (decoder.Next(value)) {
+                values.push_back(value);
+            }
+        }
+        CHECK_EQ(decoder.GetPending(), 0);
+        REQUIRE_EQ(values.size(), 3);
+        CHECK(values[0] == dd);
+        CHECK(values[1] == big);
+        CHECK_EQ(values[2].AsInt(), 3);
+
+        CborDecoder whole(all);
+        CHECK(whole.Next(value));
+        CHECK(value == dd);
+
+        // Scanning for completeness must resume where it stopped, not restart on every chunk
+        DynamicData huge;
+        for (int i = 0 ; i < 50000 ; ++i) {
+            huge.Add(i);
+        }
+        std::string cbor = CborEncoder::Encode(huge);
+        CborDecoder chunked;
+        std::size_t decoded = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0 ; i < cbor.size() ; i += 64) {
+            chunked.Feed(std::string_view(cbor).substr(i, 64));
+            while (chunked.Next(value)) {
+                decoded++;
+            }
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        CHECK_EQ(decoded, 1);
+        CHECK(value == huge);
+        CHECK_LT(elapsed.count(), 1000);
+    }
+
+    SUBCASE("Foreign Input") {
+        // Examples from RFC 8949 Appendix A
+        std::string indefinite = bytes({ 0xBF, 0x61, 'a', 0x01, 0x7F, 0x61, 'b', 0x61, 'c', 0xFF, 0x9F, 0x02, 0x03, 0xFF, 0xFF });
+        DynamicData dd = CborDecoder::Decode<DynamicData>(indefinite);
+        CHECK_EQ(dd.GetCount(), 2);
+        CHECK(dd["a"].GetType() == Variant::Types::Uint64);
+        CHECK_EQ(dd["bc"].GetCount(), 2);
+        CHECK_EQ(dd["bc"][1].AsInt(), 3);
+
+        CborDecoder fed;
+        DynamicData value;
+        for (std::size_t i = 0 ; i < indefinite.size() ; ++i) {
+            fed.Feed(indefinite.substr(i, 1));
+            CHECK_EQ(fed.Next(value), (i + 1 == indefinite.size()));
+        }
+        CHECK(value == dd);
+
+        CHECK_EQ(CborDecoder::Decode<DynamicData>(bytes({ 0xF9, 0x3C, 0x00 })).AsFloat(), 1.0f);
+        CHECK_EQ(CborDecoder::Decode<DynamicData>(bytes({ 0xF9, 0xC4, 0x00 })).AsFloat(), -4.0f);
+        CHECK_EQ(CborDecoder::Decode<DynamicData>(bytes({ 0x3B, 0x7F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF })).AsInt(), INT64_MIN);
+        CHECK_EQ(CborDecoder::Decode<DynamicData>(bytes({ 0xC1, 0x1A, 0x51, 0x4B, 0x67, 0xB0 })).AsInt(), 1363896240);
+        CHECK_EQ(CborDecoder::Decode<DynamicData>(bytes({ 0x44, 0x01, 0x02, 0x03, 0x04 })).AsString(), bytes({ 1, 2, 3, 4 }));
+        CHECK(CborDecoder::Decode<DynamicData>(bytes({ 0xF7 })).IsNull());
+    }
+
+    SUBCASE("Errors") {
+        CHECK_THROWS_AS(CborDecoder::Decode<DynamicData>(bytes({ 0x82, 0x01 })), ECborError);
+        CHECK_THROWS_AS(CborDecoder::Decode<DynamicData>(bytes({ 0x01, 0x02 })), ECborError);
+        CHECK_THROWS_AS(CborDecoder::Decode<DynamicData>(bytes({ 0xA1, 0x01, 0x02 })), ECborError);
+        CHECK_THROWS_AS(CborDecoder::Decode<DynamicData>(bytes({ 0x1C })), ECborError);
+        CHECK_THROWS_AS(CborDecoder::Decode<DynamicData>(bytes({ 0xFF })), ECborError);
+        CHECK_THROWS_AS(CborDecoder::Decode<DynamicData>(bytes({ 0x9B, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF })), ECborError);
+        CHECK_THROWS_AS(CborDecoder::Decode<DynamicData>(bytes({ 0xD9, 0xA5, 0x06, 0x1A, 0x00, 0x01, 0x00, 0x00 })), ECborError);
+        CHECK_THROWS_AS(CborDecoder::Decode<DynamicData>(bytes({ 0xD9, 0xA5, 0x07, 0x01 })), ECborError);
+        CHECK_THROWS_AS(CborDecoder::Decode<DynamicData>(bytes({ 0xD9, 0xA5, 0x09, 0x01 })), ECborError);
+
+        int target = 0;
+        DynamicData pointer;
+        pointer.Add("pointer", static_cast<void*>(&target));
+        CHECK_THROWS_AS(CborEncoder::Encode(pointer), ECborError);
+
+        std::string deep(600, '\x81');
+        deep += '\x01';
+        CHECK_THROWS_AS(CborDecoder::Decode<DynamicData>(deep), ECborError);
+
+        CborDecoder decoder;
+        DynamicData value;
+        decoder.Feed(bytes({ 0x83, 0x01 }));
+        CHECK_FALSE(decoder.Next(value));
+        CHECK_EQ(decoder.GetPending(), 2);
+    }
+}
@@ -0,0 +1,111 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#include "doctest.h"
+#include <string>
+#include <json/JsonValue.h>
+#include <logging/Logger.h>
+#include <utils/DynamicData.h>
+
+using namespace rsp::utils;
+
+TEST_CASE("DynamicData Member Index") {
+    rsp::logging::Logger logger;
+    rsp::logging::Logger::SetDefault(&logger);
+
+    constexpr int cMembers = 500;
+
+    SUBCASE("Lookup") {
+        DynamicData dd;
+        for (int i = 0 ; i < cMembers ; ++i) {
+            dd.Add("key" + std::to_string(i), i);
+        }
+        CHECK_EQ(dd.GetCount(), cMembers);
+
+        for (int i = 0 ; i < cMembers ; ++i) {
+            CHECK_EQ(dd["key" + std::to_string(i)].AsInt(), i);
+        }
+        CHECK(dd.MemberExists("key0"));
+        CHECK_FALSE(dd.MemberExists("key" + std::to_string(cMembers)));
+        CHECK_THROWS_AS(dd["missing"], EMemberNotExisting);
+
+        auto names = dd.GetMemberNames();
+        CHECK_EQ(names.front(), "key0");
+        CHECK_EQ(names.back(), "key" + std::to_string(cMembers - 1));
+    }
+
+    SUBCASE("Duplicates and Remove") {
+        DynamicData dd;
+        for (int i = 0 ; i < cMembers ; ++i) {
+            dd.Add("key" + std::to_string(i % 100), i);
+        }
+        // First member in insertion order wins, as with linear search, also after the table has
+        // grown and entries probed past the end of the table have wrapped around
+        for (int i = 0 ; i < 100 ; ++i) {
+            CHECK_EQ(dd["key" + std::to_string(i)].AsInt(), i);
+        }
+
+        DynamicData many;
+        for (int i = 0 ; i < 20 * cMembers ; ++i) {
+            many.Add("key" + std::to_string(i % 2000), i);
+        }
+        int first = 0;
+        for (int i = 0 ; i < 2000 ; ++i) {
+            first += (many["key" + std::to_string(i)].AsInt() == i) ? 1 : 0;
+        }
+        CHECK_EQ(first, 2000);
+
+        dd.Remove("key42");
+        CHECK_EQ(dd["key42"].AsInt(), 142);
+        CHECK_EQ(dd["key43"].AsInt(), 43);
+        CHECK_EQ(dd.GetCount(), cMembers - 1);
+        CHECK_THROWS_AS(dd.Remove("missing"), EMemberNotExisting);
+    }
+
+    SUBCASE("Compare and Copy") {
+        DynamicData forward;
+        DynamicData backward;
+        for (int i = 0 ; i < cMembers ; ++i) {
+            forward.Add("key" + std::to_string(i), i);
+            backward.Add("key" + std::to_string(cMembers - 1 - i), cMembers - 1 - i);
+        }
+        CHECK(forward == backward);
+
+        DynamicData copy(forward);
+        CHECK(copy == forward);
+        CHECK_EQ(copy["key321"].AsInt(), 321);
+
+        DynamicData moved(std::move(copy));
+        CHECK_EQ(moved["key123"].AsInt(), 123);
+
+        backward["key7"] = 8;
+        CHECK(forward != backward);
+    }
+
+    SUBCASE("JsonValue") {
+        std::string json = "{";
+        for (int i = 0 ; i < cMembers ; ++i) {
+            json += (i ? ",\"key" : "\"key") + std::to_string(i) + "\":" + std::to_string(i);
+        }
+        json += "}";
+
+        auto value = rsp::json::JsonValue::Decode(json);
+        CHECK_EQ(value.GetCount(), cMembers);
+        CHECK_EQ(value["key0"].AsInt(), 0);
+        CHECK_EQ(value["key499"].AsInt(), 499);
+        CHECK_FALSE(value.MemberExists("key500"));
+
+        value.Add("extra", 1);
+        CHECK_EQ(value["extra"].AsInt(), 1);
+        value.Remove("key250");
+        CHECK_FALSE(value.MemberExists("key250"));
+        CHECK_EQ(value["key251"].AsInt(), 251);
+    }
+}
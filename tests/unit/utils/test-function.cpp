@@ -9,6 +9,8 @@
  */
 
 #include "doctest.h"
+#include <functional>
+#include <memory>
 #include <utils/Function.h>
 
 using namespace rsp::utils;
@@ -55,4 +57,100 @@ TEST_CASE("Functions") {
     CHECK(bind_func3() == 6);
 }
 
+struct CopyCounter
+{
+    int *mpCopies;
+
+    explicit CopyCounter(int *apCopies) : mpCopies(apCopies) {}
+    CopyCounter(const CopyCounter &arOther) : mpCopies(arOther.mpCopies) { (*mpCopies)++; }
+    CopyCounter(CopyCounter&&) = default;
+    CopyCounter& operator=(const CopyCounter&) = default;
+};
+
+TEST_CASE("Function Storage") {
+
+    SUBCASE("Copies Share State") {
+        int count = 0;
+        Function<int(void)> counter = [count]() mutable { return ++count; };
+        Function<int(void)> copy = counter;
+        CHECK_EQ(counter(), 1);
+        CHECK_EQ(copy(), 2);
+        CHECK_EQ(count, 0);
+    }
+
+    SUBCASE("Move Only") {
+        Function<int(int)> add = [p = std::make_unique<int>(40)](int value) { return *p + value; };
+        Function<int(int)> copy = add;
+        Function<int(int)> moved = std::move(add);
+        CHECK_FALSE(add);
+        CHECK_EQ(moved(2), 42);
+        CHECK_EQ(copy(3), 43);
+
+        Function<int(std::unique_ptr<int>)> take = [](std::unique_ptr<int> p) { return *p; };
+        CHECK_EQ(take(std::make_unique<int>(7)), 7);
+    }
+
+    SUBCASE("Arguments Are Forwarded") {
+        int copies = 0;
+        CopyCounter counter(&copies);
+        Function<void(const CopyCounter&)> by_ref = [](const CopyCounter&) {};
+        by_ref(counter);
+        CHECK_EQ(copies, 0);
 
+        Function<void(CopyCounter)> by_value = [](CopyCounter) {};
+        by_value(counter);
+        CHECK_EQ(copies, 1);
+    }
+
+    SUBCASE("Empty") {
+        int (*null_func)() = nullptr;
+        Function<int(void)> empty = null_func;
+        CHECK_FALSE(empty);
+        CHECK_EQ(empty(), 0);
+
+        Function<int(void)> iv = []() { return 42; };
+        Function<int(void)> copy = iv;
+        iv.Clear();
+        CHECK_FALSE(iv);
+        CHECK_EQ(copy(), 42);
+        iv = copy;
+        CHECK_EQ(iv(), 42);
+    }
+
+    SUBCASE("Empty std::function") {
+        std::function<int(void)> std_empty;
+        Function<int(void)> empty = std_empty;
+        CHECK_FALSE(empty);
+        CHECK_EQ(empty(), 0);
+
+        std::function<int(void)> std_func = test_func;
+        Function<int(void)> func = std_func;
+        CHECK(func);
+        CHECK_EQ(func(), 84);
+    }
+
+    SUBCASE("Inline Storage") {
+        int copies = 0;
+        CopyCounter counter(&copies);
+
+        // Not trivially copyable, so copies of the Function share the callable
+        Function<int(void)> shared = [counter]() { return *counter.mpCopies; };
+        copies = 0;
+        Function<int(void)> shared_copy = shared;
+        CHECK_EQ(copies, 0);
+        CHECK_EQ(shared_copy(), 0);
+
+        // Trivially copyable captures and captureless lambdas are stored inline
+        int value = 40;
+        Function<int(int)> by_ref = [&value](int aAdd) { return value + aAdd; };
+        Function<int(int)> by_ref_copy = by_ref;
+        by_ref.Clear();
+        value = 41;
+        CHECK_EQ(by_ref_copy(1), 42);
+
+        Function<int(int)> captureless = [](int aAdd) { return aAdd * 2; };
+        Function<int(int)> captureless_copy = captureless;
+        captureless.Clear();
+        CHECK_EQ(captureless_copy(21), 42);
+    }
+}
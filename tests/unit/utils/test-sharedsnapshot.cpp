@@ -0,0 +1,66 @@
+/*!
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * \copyright   Copyright 2023 RSP Systems A/S. All rights reserved.
+ * \license     Mozilla Public License 2.0
+ * \author      Steffen Brummer
+ */
+
+#include "doctest.h"
+#include <utils/SharedSnapshot.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace rsp::utils;
+
+TEST_CASE("SharedSnapshot") {
+
+    SUBCASE("Readers keep their value") {
+        SharedSnapshot<std::vector<int>> snapshot;
+        CHECK(snapshot.Load()->empty());
+
+        snapshot.Store(std::make_shared<std::vector<int>>(std::vector<int>{1, 2, 3}));
+        auto old = snapshot.Load();
+        auto next = std::make_shared<std::vector<int>>(*old);
+        next->push_back(4);
+        snapshot.Store(std::move(next));
+
+        CHECK_EQ(old->size(), 3);
+        CHECK_EQ(snapshot.Load()->size(), 4);
+    }
+
+    SUBCASE("Multiple Threads") {
+        SharedSnapshot<std::vector<int>> snapshot;
+        std::atomic<bool> stop = false;
+        std::atomic<bool> ordered = true;
+
+        std::vector<std::thread> readers;
+        for (int t = 0 ; t < 3 ; ++t) {
+            readers.emplace_back([&]() {
+                while (!stop) {
+                    auto value = snapshot.Load();
+                    for (std::size_t i = 0 ; i < value->size() ; ++i) {
+                        if ((*value)[i] != static_cast<int>(i)) {
+                            ordered = false;
+                        }
+                    }
+                }
+            });
+        }
+        for (int i = 0 ; i < 1000 ; ++i) {
+            auto next = std::make_shared<std::vector<int>>(*snapshot.Load());
+            next->push_back(i);
+            snapshot.Store(std::move(next));
+        }
+        stop = true;
+        for (auto &thread : readers) {
+            thread.join();
+        }
+
+        CHECK(ordered);
+        CHECK_EQ(snapshot.Load()->size(), 1000);
+    }
+}
@@ -96,6 +96,53 @@ TEST_CASE("Variant")
         CHECK(c.AsInt() == 42);
     }
 
+    SUBCASE("Strings") {
+        CHECK(sizeof(Variant) <= 32);
+
+        const std::string inline_text(Variant::cInlineCapacity, 'a');
+        const std::string shared_text("A string too long to be stored inline");
+
+        v = inline_text;
+        CHECK(v.GetType() == Variant::Types::String);
+        CHECK_EQ(v.AsString(), inline_text);
+
+        Variant b(shared_text);
+        Variant c(b);
+        CHECK_EQ(c.RawAsString().data(), b.RawAsString().data());
+        CHECK_EQ(std::string(static_cast<const char*>(c)), shared_text);
+
+        c = v;
+        CHECK_EQ(c.AsString(), inline_text);
+        CHECK_EQ(b.AsString(), shared_text);
+
+        b = b.RawAsString().substr(0, 4).data();
+        CHECK_EQ(b.AsString(), "A string too long to be stored inline");
+        b = std::string(b.RawAsString().substr(2, 6));
+        CHECK_EQ(b.AsString(), "string");
+        b = std::string(b.RawAsString().substr(1));
+        CHECK_EQ(b.AsString(), "tring");
+
+        Variant d(std::move(c));
+        CHECK(c.IsNull());
+        CHECK_EQ(d.AsString(), inline_text);
+        c = shared_text;
+        d = std::move(c);
+        CHECK_EQ(d.AsString(), shared_text);
+        d = 5;
+        CHECK(d.RawAsString().empty());
+
+        v = std::string("Text with \0 inside", 18);
+        CHECK_EQ(v.RawAsString().size(), 18);
+        v = " 0x1F";
+        CHECK_EQ(v.AsInt(), 31);
+        v = " +2.5e1";
+        CHECK_EQ(v.AsDouble(), 25.0);
+        v = "true";
+        CHECK(v.AsBool());
+        v = 42;
+        CHECK_EQ(std::string(static_cast<const char*>(v)), "42");
+    }
+
     SUBCASE("String Precision") {
         v = 830.3468;
         CHECK_EQ(v.AsString(), "830.34680000000003");